@@ -24,6 +24,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#ifdef BUS_CTX
+#include <stdlib.h>
+#endif
 
 #include "sio.h"
 #include "sysdef.h"
@@ -35,6 +39,13 @@
 */
 /* size of buffer for SIO receiving */
 #define BUS_SIO_RX_BUF_SIZE                    10
+/* size of buffer for SIO receiving in BusCheckBatch (max. SioRead size) */
+#define BUS_BATCH_RX_BUF_SIZE                  255
+/* size of encoding buffer in BusSendToBuf, longer telegrams are passed to
+ * sio in several parts */
+#ifndef BUS_TX_CHUNK_SIZE
+#define BUS_TX_CHUNK_SIZE                      16
+#endif
 
 #define STX 0x02
 #define ESC 0x1B
@@ -59,6 +70,9 @@
 #define L2_WAIT_FOR_TYPE        1
 #define L2_WAIT_FOR_MSG         2
 
+/* size of device type dependent length tables (highest TBusDevType + 1) */
+#define NUM_DEV_TYPES           (eBusDevTypeSg + 1)
+
 /*-----------------------------------------------------------------------------
 *  typedefs
 */
@@ -71,13 +85,8 @@ typedef enum {
 } TBusLenType;
 
 typedef struct {
-    TBusDevType devType;
-    uint8_t     len;
-} TBusDevTypeLen;
-
-typedef struct {
-    uint8_t offset; // offset of TBusDevType element
-    TBusDevTypeLen len[];
+    uint8_t offset;              // offset of TBusDevType element
+    uint8_t len[NUM_DEV_TYPES];  // array index = TBusDevType, 0: invalid
 } TBusLenDevType;
 
 typedef struct {
@@ -85,143 +94,159 @@ typedef struct {
     uint8_t add;  // add this value to get the total telegram length
 } TBusLenDirect;
 
+typedef struct {
+    uint8_t idx;
+    uint8_t checkSum;
+} TEncodeState;
+
 typedef struct {
     TBusLenType lenType;
     union {
-        uint8_t        constant;
-        TBusLenDevType *pDevType;
-        TBusLenDirect  direct;
+        uint8_t              constant;
+        const TBusLenDevType *pDevType;
+        TBusLenDirect        direct;
     } len;
 } TTelegramSize;
 
 /*-----------------------------------------------------------------------------
 *  Variables
 */
-/* buffer for bus telegram just receiving/just received */
-static TBusTelegram sRxBuffer;
-static int sSioHandle = -1;
 
+#ifdef BUS_BOOTLOADER
+// bootloaders: only the constant telegram sizes of the firmware update,
+// 0: unknown type, the telegram is discarded
+// array index = telegram type (eBusDevStartup is 255 -> set to index 0)
+static const uint8_t sTelegramSize[] = {
+    [0]                         = MSG_BASE_SIZE1,
+    [eBusDevReqReboot]          = MSG_BASE_SIZE2 + sizeof(TBusDevReqReboot),
+    [eBusDevReqUpdEnter]        = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdEnter),
+    [eBusDevRespUpdEnter]       = MSG_BASE_SIZE2 + sizeof(TBusDevRespUpdEnter),
+    [eBusDevReqUpdData]         = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdData),
+    [eBusDevRespUpdData]        = MSG_BASE_SIZE2 + sizeof(TBusDevRespUpdData),
+    [eBusDevReqUpdTerm]         = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdTerm),
+    [eBusDevRespUpdTerm]        = MSG_BASE_SIZE2 + sizeof(TBusDevRespUpdTerm),
+    [eBusDevReqUpdDataWin]      = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdDataWin),
+    [eBusDevRespUpdDataWin]     = MSG_BASE_SIZE2 + sizeof(TBusDevRespUpdDataWin),
+    [eBusDevReqUpdEnterDiff]    = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdEnterDiff),
+    [eBusDevReqUpdPageSum]      = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdPageSum),
+    [eBusDevRespUpdPageSum]     = MSG_BASE_SIZE2 + sizeof(TBusDevRespUpdPageSum),
+    [eBusDevReqUpdDataWinState] = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdDataWinState)
+};
+#else
 #undef BASE_SIZE
 #define BASE_SIZE (MSG_BASE_SIZE2 + member_sizeof(TBusDevRespInfo, devType) + member_sizeof(TBusDevRespInfo, version))
-static TBusLenDevType sRespInfoSize = {
+static const TBusLenDevType sRespInfoSize = {
     MSG_BASE_SIZE2,
     {
-        {eBusDevTypeDo31,    BASE_SIZE + sizeof(TBusDevInfoDo31)},
-        {eBusDevTypeSw8,     BASE_SIZE + sizeof(TBusDevInfoSw8)},
-        {eBusDevTypeLum,     BASE_SIZE + sizeof(TBusDevInfoLum)},
-        {eBusDevTypeLed,     BASE_SIZE + sizeof(TBusDevInfoLed)},
-        {eBusDevTypeSw16,    BASE_SIZE + sizeof(TBusDevInfoSw16)},
-        {eBusDevTypeWind,    BASE_SIZE + sizeof(TBusDevInfoWind)},
-        {eBusDevTypeSw8Cal,  BASE_SIZE + sizeof(TBusDevInfoSw8Cal)},
-        {eBusDevTypeRs485If, BASE_SIZE + sizeof(TBusDevInfoRs485If)},
-        {eBusDevTypePwm4,    BASE_SIZE + sizeof(TBusDevInfoPwm4)},
-        {eBusDevTypeSmIf,    BASE_SIZE + sizeof(TBusDevInfoSmIf)},
-        {eBusDevTypePwm16,   BASE_SIZE + sizeof(TBusDevInfoPwm16)},
-        {eBusDevTypeKeyb,    BASE_SIZE + sizeof(TBusDevInfoKeyb)},
-        {eBusDevTypeKeyRc,   BASE_SIZE + sizeof(TBusDevInfoKeyrc)},
-        {eBusDevTypeSg,      BASE_SIZE + sizeof(TBusDevInfoSg)},
-        {eBusDevTypeInv,     0}
+        [eBusDevTypeDo31]    = BASE_SIZE + sizeof(TBusDevInfoDo31),
+        [eBusDevTypeSw8]     = BASE_SIZE + sizeof(TBusDevInfoSw8),
+        [eBusDevTypeLum]     = BASE_SIZE + sizeof(TBusDevInfoLum),
+        [eBusDevTypeLed]     = BASE_SIZE + sizeof(TBusDevInfoLed),
+        [eBusDevTypeSw16]    = BASE_SIZE + sizeof(TBusDevInfoSw16),
+        [eBusDevTypeWind]    = BASE_SIZE + sizeof(TBusDevInfoWind),
+        [eBusDevTypeSw8Cal]  = BASE_SIZE + sizeof(TBusDevInfoSw8Cal),
+        [eBusDevTypeRs485If] = BASE_SIZE + sizeof(TBusDevInfoRs485If),
+        [eBusDevTypePwm4]    = BASE_SIZE + sizeof(TBusDevInfoPwm4),
+        [eBusDevTypeSmIf]    = BASE_SIZE + sizeof(TBusDevInfoSmIf),
+        [eBusDevTypePwm16]   = BASE_SIZE + sizeof(TBusDevInfoPwm16),
+        [eBusDevTypeKeyb]    = BASE_SIZE + sizeof(TBusDevInfoKeyb),
+        [eBusDevTypeKeyRc]   = BASE_SIZE + sizeof(TBusDevInfoKeyrc),
+        [eBusDevTypeSg]      = BASE_SIZE + sizeof(TBusDevInfoSg)
     }
 };
 
 #undef BASE_SIZE
 #define BASE_SIZE  (MSG_BASE_SIZE2 + member_sizeof(TBusDevReqSetState, devType) + sizeof(TBusDevSetStateDo31))
-static TBusLenDevType sReqSetStateSize = {
+static const TBusLenDevType sReqSetStateSize = {
     MSG_BASE_SIZE2,
     {
-        {eBusDevTypeDo31, BASE_SIZE},
-        {eBusDevTypeInv,     0}
+        [eBusDevTypeDo31] = BASE_SIZE
     }
 };
 
 #undef BASE_SIZE
 #define BASE_SIZE  (MSG_BASE_SIZE2 + member_sizeof(TBusDevRespGetState, devType))
-static TBusLenDevType sRespGetStateSize = {
+static const TBusLenDevType sRespGetStateSize = {
     MSG_BASE_SIZE2,
     {
-        {eBusDevTypeDo31, BASE_SIZE + sizeof(TBusDevGetStateDo31)},
-        {eBusDevTypeSw8,  BASE_SIZE + sizeof(TBusDevGetStateSw8)},
-        {eBusDevTypeInv,     0}
+        [eBusDevTypeDo31] = BASE_SIZE + sizeof(TBusDevGetStateDo31),
+        [eBusDevTypeSw8]  = BASE_SIZE + sizeof(TBusDevGetStateSw8)
     }
 };
 
 #undef BASE_SIZE
 #define BASE_SIZE  (MSG_BASE_SIZE2 + member_sizeof(TBusDevReqSetValue, devType))
-static TBusLenDevType sReqSetValueSize = {
+static const TBusLenDevType sReqSetValueSize = {
     MSG_BASE_SIZE2,
     {
-        {eBusDevTypeDo31,    BASE_SIZE + sizeof(TBusDevSetValueDo31)},
-        {eBusDevTypeSw8,     BASE_SIZE + sizeof(TBusDevSetValueSw8)},
-        {eBusDevTypeSw16,    BASE_SIZE + sizeof(TBusDevSetValueSw16)},
-        {eBusDevTypeRs485If, BASE_SIZE + sizeof(TBusDevSetValueRs485if)},
-        {eBusDevTypePwm4,    BASE_SIZE + sizeof(TBusDevSetValuePwm4)},
-        {eBusDevTypePwm16,   BASE_SIZE + sizeof(TBusDevSetValuePwm16)},
-        {eBusDevTypeKeyRc,   BASE_SIZE + sizeof(TBusDevSetValueKeyrc)},
-        {eBusDevTypeInv,     0}
+        [eBusDevTypeDo31]    = BASE_SIZE + sizeof(TBusDevSetValueDo31),
+        [eBusDevTypeSw8]     = BASE_SIZE + sizeof(TBusDevSetValueSw8),
+        [eBusDevTypeSw16]    = BASE_SIZE + sizeof(TBusDevSetValueSw16),
+        [eBusDevTypeRs485If] = BASE_SIZE + sizeof(TBusDevSetValueRs485if),
+        [eBusDevTypePwm4]    = BASE_SIZE + sizeof(TBusDevSetValuePwm4),
+        [eBusDevTypePwm16]   = BASE_SIZE + sizeof(TBusDevSetValuePwm16),
+        [eBusDevTypeKeyRc]   = BASE_SIZE + sizeof(TBusDevSetValueKeyrc)
     }
 };
 
 #undef BASE_SIZE
 #define BASE_SIZE (MSG_BASE_SIZE2 + member_sizeof(TBusDevRespActualValue, devType))
-static TBusLenDevType sRespActualValueSize = {
+static const TBusLenDevType sRespActualValueSize = {
     MSG_BASE_SIZE2,
     {
-        {eBusDevTypeDo31,    BASE_SIZE + sizeof(TBusDevActualValueDo31)},
-        {eBusDevTypeSw8,     BASE_SIZE + sizeof(TBusDevActualValueSw8)},
-        {eBusDevTypeLum,     BASE_SIZE + sizeof(TBusDevActualValueLum)},
-        {eBusDevTypeLed,     BASE_SIZE + sizeof(TBusDevActualValueLed)},
-        {eBusDevTypeSw16,    BASE_SIZE + sizeof(TBusDevActualValueSw16)},
-        {eBusDevTypeWind,    BASE_SIZE + sizeof(TBusDevActualValueWind)},
-        {eBusDevTypeRs485If, BASE_SIZE + sizeof(TBusDevActualValueRs485if)},
-        {eBusDevTypePwm4,    BASE_SIZE + sizeof(TBusDevActualValuePwm4)},
-        {eBusDevTypeSmIf,    BASE_SIZE + sizeof(TBusDevActualValueSmif)},
-        {eBusDevTypePwm16,   BASE_SIZE + sizeof(TBusDevActualValuePwm16)},
-        {eBusDevTypeKeyb,    BASE_SIZE + sizeof(TBusDevActualValueKeyb)},
-        {eBusDevTypeKeyRc,   BASE_SIZE + sizeof(TBusDevActualValueKeyrc)},
-        {eBusDevTypeSg,      BASE_SIZE + sizeof(TBusDevActualValueSg)},
-        {eBusDevTypeInv,     0}
+        [eBusDevTypeDo31]    = BASE_SIZE + sizeof(TBusDevActualValueDo31),
+        [eBusDevTypeSw8]     = BASE_SIZE + sizeof(TBusDevActualValueSw8),
+        [eBusDevTypeLum]     = BASE_SIZE + sizeof(TBusDevActualValueLum),
+        [eBusDevTypeLed]     = BASE_SIZE + sizeof(TBusDevActualValueLed),
+        [eBusDevTypeSw16]    = BASE_SIZE + sizeof(TBusDevActualValueSw16),
+        [eBusDevTypeWind]    = BASE_SIZE + sizeof(TBusDevActualValueWind),
+        [eBusDevTypeRs485If] = BASE_SIZE + sizeof(TBusDevActualValueRs485if),
+        [eBusDevTypePwm4]    = BASE_SIZE + sizeof(TBusDevActualValuePwm4),
+        [eBusDevTypeSmIf]    = BASE_SIZE + sizeof(TBusDevActualValueSmif),
+        [eBusDevTypePwm16]   = BASE_SIZE + sizeof(TBusDevActualValuePwm16),
+        [eBusDevTypeKeyb]    = BASE_SIZE + sizeof(TBusDevActualValueKeyb),
+        [eBusDevTypeKeyRc]   = BASE_SIZE + sizeof(TBusDevActualValueKeyrc),
+        [eBusDevTypeSg]      = BASE_SIZE + sizeof(TBusDevActualValueSg)
     }
 };
 
 #undef BASE_SIZE
 #define BASE_SIZE (MSG_BASE_SIZE2 + member_sizeof(TBusDevReqActualValueEvent, devType))
-static TBusLenDevType sReqActualValueEventSize = {
+static const TBusLenDevType sReqActualValueEventSize = {
     MSG_BASE_SIZE2,
     {
-        {eBusDevTypeDo31,    BASE_SIZE + sizeof(TBusDevActualValueDo31)},
-        {eBusDevTypeSw8,     BASE_SIZE + sizeof(TBusDevActualValueSw8)},
-        {eBusDevTypeLum,     BASE_SIZE + sizeof(TBusDevActualValueLum)},
-        {eBusDevTypeLed,     BASE_SIZE + sizeof(TBusDevActualValueLed)},
-        {eBusDevTypeSw16,    BASE_SIZE + sizeof(TBusDevActualValueSw16)},
-        {eBusDevTypeWind,    BASE_SIZE + sizeof(TBusDevActualValueWind)},
-        {eBusDevTypeRs485If, BASE_SIZE + sizeof(TBusDevActualValueRs485if)},
-        {eBusDevTypePwm4,    BASE_SIZE + sizeof(TBusDevActualValuePwm4)},
-        {eBusDevTypeSmIf,    BASE_SIZE + sizeof(TBusDevActualValueSmif)},
-        {eBusDevTypePwm16,   BASE_SIZE + sizeof(TBusDevActualValuePwm16)},
-        {eBusDevTypeKeyb,    BASE_SIZE + sizeof(TBusDevActualValueKeyb)},
-        {eBusDevTypeSg,      BASE_SIZE + sizeof(TBusDevActualValueSg)},
-        {eBusDevTypeInv,     0}
+        [eBusDevTypeDo31]    = BASE_SIZE + sizeof(TBusDevActualValueDo31),
+        [eBusDevTypeSw8]     = BASE_SIZE + sizeof(TBusDevActualValueSw8),
+        [eBusDevTypeLum]     = BASE_SIZE + sizeof(TBusDevActualValueLum),
+        [eBusDevTypeLed]     = BASE_SIZE + sizeof(TBusDevActualValueLed),
+        [eBusDevTypeSw16]    = BASE_SIZE + sizeof(TBusDevActualValueSw16),
+        [eBusDevTypeWind]    = BASE_SIZE + sizeof(TBusDevActualValueWind),
+        [eBusDevTypeRs485If] = BASE_SIZE + sizeof(TBusDevActualValueRs485if),
+        [eBusDevTypePwm4]    = BASE_SIZE + sizeof(TBusDevActualValuePwm4),
+        [eBusDevTypeSmIf]    = BASE_SIZE + sizeof(TBusDevActualValueSmif),
+        [eBusDevTypePwm16]   = BASE_SIZE + sizeof(TBusDevActualValuePwm16),
+        [eBusDevTypeKeyb]    = BASE_SIZE + sizeof(TBusDevActualValueKeyb),
+        [eBusDevTypeSg]      = BASE_SIZE + sizeof(TBusDevActualValueSg)
     }
 };
 
 #undef BASE_SIZE
 #define BASE_SIZE (MSG_BASE_SIZE2 + member_sizeof(TBusDevRespActualValueEvent, devType))
-static TBusLenDevType sRespActualValueEventSize = {
+static const TBusLenDevType sRespActualValueEventSize = {
     MSG_BASE_SIZE2,
     {
-        {eBusDevTypeDo31,    BASE_SIZE + sizeof(TBusDevActualValueDo31)},
-        {eBusDevTypeSw8,     BASE_SIZE + sizeof(TBusDevActualValueSw8)},
-        {eBusDevTypeLum,     BASE_SIZE + sizeof(TBusDevActualValueLum)},
-        {eBusDevTypeLed,     BASE_SIZE + sizeof(TBusDevActualValueLed)},
-        {eBusDevTypeSw16,    BASE_SIZE + sizeof(TBusDevActualValueSw16)},
-        {eBusDevTypeWind,    BASE_SIZE + sizeof(TBusDevActualValueWind)},
-        {eBusDevTypeRs485If, BASE_SIZE + sizeof(TBusDevActualValueRs485if)},
-        {eBusDevTypePwm4,    BASE_SIZE + sizeof(TBusDevActualValuePwm4)},
-        {eBusDevTypeSmIf,    BASE_SIZE + sizeof(TBusDevActualValueSmif)},
-        {eBusDevTypePwm16,   BASE_SIZE + sizeof(TBusDevActualValuePwm16)},
-        {eBusDevTypeKeyb,    BASE_SIZE + sizeof(TBusDevActualValueKeyb)},
-        {eBusDevTypeSg,      BASE_SIZE + sizeof(TBusDevActualValueSg)},
-        {eBusDevTypeInv,     0}
+        [eBusDevTypeDo31]    = BASE_SIZE + sizeof(TBusDevActualValueDo31),
+        [eBusDevTypeSw8]     = BASE_SIZE + sizeof(TBusDevActualValueSw8),
+        [eBusDevTypeLum]     = BASE_SIZE + sizeof(TBusDevActualValueLum),
+        [eBusDevTypeLed]     = BASE_SIZE + sizeof(TBusDevActualValueLed),
+        [eBusDevTypeSw16]    = BASE_SIZE + sizeof(TBusDevActualValueSw16),
+        [eBusDevTypeWind]    = BASE_SIZE + sizeof(TBusDevActualValueWind),
+        [eBusDevTypeRs485If] = BASE_SIZE + sizeof(TBusDevActualValueRs485if),
+        [eBusDevTypePwm4]    = BASE_SIZE + sizeof(TBusDevActualValuePwm4),
+        [eBusDevTypeSmIf]    = BASE_SIZE + sizeof(TBusDevActualValueSmif),
+        [eBusDevTypePwm16]   = BASE_SIZE + sizeof(TBusDevActualValuePwm16),
+        [eBusDevTypeKeyb]    = BASE_SIZE + sizeof(TBusDevActualValueKeyb),
+        [eBusDevTypeSg]      = BASE_SIZE + sizeof(TBusDevActualValueSg)
     }
 };
 
@@ -243,6 +268,37 @@ static TBusLenDevType sRespActualValueEventSize = {
                                 member_sizeof(TBusDevReqSetVar, index) +       \
                                 member_sizeof(TBusDevReqSetVar, length)
 
+/* all bulk var telegrams start with the length of the entry list */
+#define LEN_VAR_BULK_OFFS       LD.offsetLen = MSG_BASE_SIZE2
+#define LEN_VAR_BULK_ADD        LD.add = MSG_BASE_SIZE2 +                      \
+                                member_sizeof(TBusDevReqGetVarBulk, length)
+
+#define LEN_REQ_SET_VALUE_MULTI_OFFS LD.offsetLen = MSG_BASE_SIZE2 +           \
+                                member_sizeof(TBusDevReqSetValueMulti, seq)
+#define LEN_REQ_SET_VALUE_MULTI_ADD  LD.add = MSG_BASE_SIZE2 +                 \
+                                member_sizeof(TBusDevReqSetValueMulti, seq) +  \
+                                member_sizeof(TBusDevReqSetValueMulti, length)
+
+#define LEN_REQ_ACTVAL_DELTA_OFFS LD.offsetLen = MSG_BASE_SIZE2 +              \
+                                member_sizeof(TBusDevReqActualValueEventDelta, devType) + \
+                                member_sizeof(TBusDevReqActualValueEventDelta, seq) +     \
+                                member_sizeof(TBusDevReqActualValueEventDelta, flags)
+#define LEN_REQ_ACTVAL_DELTA_ADD  LD.add = MSG_BASE_SIZE2 +                    \
+                                member_sizeof(TBusDevReqActualValueEventDelta, devType) + \
+                                member_sizeof(TBusDevReqActualValueEventDelta, seq) +     \
+                                member_sizeof(TBusDevReqActualValueEventDelta, flags) +   \
+                                member_sizeof(TBusDevReqActualValueEventDelta, length)
+
+#define LEN_EEPROM_BLOCK_OFFS   LD.offsetLen = MSG_BASE_SIZE2 +                \
+                                member_sizeof(TBusDevReqEepromWriteBlock, addr)
+#define LEN_EEPROM_BLOCK_ADD    LD.add = MSG_BASE_SIZE2 +                      \
+                                member_sizeof(TBusDevReqEepromWriteBlock, addr) + \
+                                member_sizeof(TBusDevReqEepromWriteBlock, length)
+
+#define LEN_REQ_ACTVAL_FANOUT_OFFS LD.offsetLen = MSG_BASE_SIZE2
+#define LEN_REQ_ACTVAL_FANOUT_ADD  LD.add = MSG_BASE_SIZE2 +                   \
+                                member_sizeof(TBusDevReqActualValueEventFanout, length)
+
 // telegram sizes without STX and checksum
 // array index = telegram type (eBusDevStartup is 255 -> set to index 0)
 static TTelegramSize sTelegramSize[] = {
@@ -296,33 +352,125 @@ static TTelegramSize sTelegramSize[] = {
     { eBusLenDirect,  .LEN_REQ_SET_VAR_OFFS, .LEN_REQ_SET_VAR_ADD             }, // eBusDevReqSetVar
     { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevRespSetVar)        }, // eBusDevRespSetVar
     { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevReqGetFlashData)   }, // eBusDevRepGetFlashData
-    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevRespGetFlashData)  }  // eBusDevRespGetFlashData
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevRespGetFlashData)  }, // eBusDevRespGetFlashData
+    { eBusLenDirect,  .LEN_REQ_SET_VALUE_MULTI_OFFS, .LEN_REQ_SET_VALUE_MULTI_ADD }, // eBusDevReqSetValueMulti
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevRespSetValueMulti) }, // eBusDevRespSetValueMulti
+    { eBusLenDirect,  .LEN_VAR_BULK_OFFS, .LEN_VAR_BULK_ADD                   }, // eBusDevReqGetVarBulk
+    { eBusLenDirect,  .LEN_VAR_BULK_OFFS, .LEN_VAR_BULK_ADD                   }, // eBusDevRespGetVarBulk
+    { eBusLenDirect,  .LEN_VAR_BULK_OFFS, .LEN_VAR_BULK_ADD                   }, // eBusDevReqSetVarBulk
+    { eBusLenDirect,  .LEN_VAR_BULK_OFFS, .LEN_VAR_BULK_ADD                   }, // eBusDevRespSetVarBulk
+    { eBusLenDirect,  .LEN_REQ_ACTVAL_DELTA_OFFS, .LEN_REQ_ACTVAL_DELTA_ADD   }, // eBusDevReqActualValueEventDelta
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevRespActualValueEventDelta) }, // eBusDevRespActualValueEventDelta
+    { eBusLenDirect,  .LEN_REQ_ACTVAL_FANOUT_OFFS, .LEN_REQ_ACTVAL_FANOUT_ADD }, // eBusDevReqActualValueEventFanout
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdDataWin)     }, // eBusDevReqUpdDataWin
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevRespUpdDataWin)    }, // eBusDevRespUpdDataWin
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdEnterDiff)   }, // eBusDevReqUpdEnterDiff
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdPageSum)     }, // eBusDevReqUpdPageSum
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevRespUpdPageSum)    }, // eBusDevRespUpdPageSum
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevReqUpdDataWinState) }, // eBusDevReqUpdDataWinState
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevReqEepromReadBlock) }, // eBusDevReqEepromReadBlock
+    { eBusLenDirect,  .LEN_EEPROM_BLOCK_OFFS, .LEN_EEPROM_BLOCK_ADD           }, // eBusDevRespEepromReadBlock
+    { eBusLenDirect,  .LEN_EEPROM_BLOCK_OFFS, .LEN_EEPROM_BLOCK_ADD           }, // eBusDevReqEepromWriteBlock
+    { eBusLenConst,   .LC = MSG_BASE_SIZE2 + sizeof(TBusDevRespEepromWriteBlock) } // eBusDevRespEepromWriteBlock
 };
+#endif
 
-static struct l2State {
+struct l2State {
    uint8_t        protoState;
    uint8_t        lastMsgIdx;
+   uint8_t        chIdx;
+#ifndef BUS_BOOTLOADER
    uint8_t        dynMsgTypeIdx;
    uint8_t        lengthIdx;
    uint8_t        lengthAdd;
-   uint8_t        chIdx;
-   TBusLenDevType *pLDT;
-} sL2State;
+   const TBusLenDevType *pLDT;
+#endif
+};
+
+struct l1State {
+   uint8_t        protoState;
+   uint8_t        checkSum;
+   bool           stuffByte;
+};
+
+/* all state of one bus line */
+struct busCtx {
+   int            sioHandle;
+   /* buffer for bus telegram just receiving/just received */
+   TBusTelegram   rxBuffer;
+   struct l1State l1State;
+   struct l2State l2State;
+   /* last return value of BusCheck while receiving */
+   uint8_t        checkRet;
+   uint8_t        sioRxBuf[BUS_SIO_RX_BUF_SIZE];
+#ifdef BUS_RX_BATCH
+   /* sio read buffer for BusCheckBatch */
+   struct {
+      uint8_t     buf[BUS_BATCH_RX_BUF_SIZE];
+      uint8_t     rdPos;
+      uint8_t     len;
+#ifdef BUS_RX_TIMESTAMP
+      uint64_t    timeUs;
+#endif
+   } batchRx;
+#endif
+#ifdef BUS_RX_TIMESTAMP
+   /* rx time of the chunk that completed the last telegram */
+   uint64_t       msgTimeUs;
+#endif
+};
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+/* context used by the functions without context parameter (set by BusInit) */
+static TBusCtx sBusCtx;
 
 /*-----------------------------------------------------------------------------
 *  Functions
 */
-static uint8_t BusDecode(uint8_t ch);
-static bool    TransmitCharProt(uint8_t data);
-static void    L2StateInit(uint8_t protoState);
+static uint8_t BusDecode(TBusCtx *pCtx, uint8_t numRxChar);
+static void    L2StateInit(TBusCtx *pCtx, uint8_t protoState);
+static void    CtxInit(TBusCtx *pCtx, int sioHandle);
+static uint8_t TelegramLen(TBusTelegram *pMsg, uint8_t *pLen);
+
+#ifdef BUS_BOOTLOADER
+/*-----------------------------------------------------------------------------
+*  telegram length for the bootloader
+*  returns 0 for unknown telegram types
+*/
+static uint8_t LenBootloader(uint8_t type) {
+
+   if (type == eBusDevStartup) {
+      type = 0; // DevStartup is index 0 in sTelegramSize
+   }
+   if (type < ARRAY_CNT(sTelegramSize)) {
+      return sTelegramSize[type];
+   } else {
+      return 0;
+   }
+}
+#else
+/*-----------------------------------------------------------------------------
+*  telegram length for device type dependent telegrams
+*  returns 0 for unknown device types
+*/
+static inline uint8_t LenDevType(const TBusLenDevType *pLDT, uint8_t devType) {
+
+   if (devType < NUM_DEV_TYPES) {
+      return pLDT->len[devType];
+   } else {
+      return 0;
+   }
+}
+#endif
 
 /*----------------------------------------------------------------------------
 *   init
 */
 void BusInit(int sioHandle) {
 
-   sSioHandle = sioHandle;
-   L2StateInit(L2_WAIT_FOR_SENDER_ADDR);
+   CtxInit(&sBusCtx, sioHandle);
 }
 
 /*----------------------------------------------------------------------------
@@ -330,7 +478,53 @@ void BusInit(int sioHandle) {
 */
 void BusExit(int sioHandle) {
 
-   sSioHandle = -1;
+   sBusCtx.sioHandle = -1;
+}
+
+#ifdef BUS_CTX
+/*----------------------------------------------------------------------------
+*   open bus context for sio interface sioHandle
+*   every context has its own rx/tx state, so different contexts can be used
+*   in parallel (e.g. one thread per bus line). one context must not be
+*   used by more than one thread at a time.
+*   returns 0 if no memory available
+*/
+TBusCtx *BusCtxOpen(int sioHandle) {
+
+   TBusCtx *pCtx;
+
+   pCtx = malloc(sizeof(TBusCtx));
+   if (pCtx != 0) {
+      CtxInit(pCtx, sioHandle);
+   }
+   return pCtx;
+}
+
+/*----------------------------------------------------------------------------
+*   close bus context (the sio interface is not closed)
+*/
+void BusCtxClose(TBusCtx *pCtx) {
+
+   free(pCtx);
+}
+#endif
+
+/*----------------------------------------------------------------------------
+*   init context
+*/
+static void CtxInit(TBusCtx *pCtx, int sioHandle) {
+
+   pCtx->sioHandle = sioHandle;
+   pCtx->checkRet = BUS_NO_MSG;
+   pCtx->l1State.protoState = L1_WAIT_FOR_STX;
+   L2StateInit(pCtx, L2_WAIT_FOR_SENDER_ADDR);
+#ifdef BUS_RX_BATCH
+   pCtx->batchRx.rdPos = 0;
+   pCtx->batchRx.len = 0;
+#endif
+#ifdef BUS_RX_TIMESTAMP
+   pCtx->msgTimeUs = 0;
+#endif
 }
 
 /*-----------------------------------------------------------------------------
@@ -343,25 +537,29 @@ void BusExit(int sioHandle) {
 */
 uint8_t BusCheck(void) {
 
+   return BusCtxCheck(&sBusCtx);
+}
+
+uint8_t BusCtxCheck(TBusCtx *pCtx) {
+
    uint8_t numRxChar;
-   static uint8_t ret = BUS_NO_MSG;
    uint8_t retTmp;
 
-    if (!SioHandleValid(sSioHandle)) {
+    if (!SioHandleValid(pCtx->sioHandle)) {
         return BUS_IF_ERROR;
     }
 
-   numRxChar = SioGetNumRxChar(sSioHandle);
+   numRxChar = SioGetNumRxChar(pCtx->sioHandle);
    if (numRxChar != 0) {
-      ret = BusDecode(numRxChar);
-      if ((ret == BUS_MSG_ERROR) ||
-          (ret == BUS_MSG_OK)) {
-         retTmp = ret;
-         ret = BUS_NO_MSG;
+      pCtx->checkRet = BusDecode(pCtx, numRxChar);
+      if ((pCtx->checkRet == BUS_MSG_ERROR) ||
+          (pCtx->checkRet == BUS_MSG_OK)) {
+         retTmp = pCtx->checkRet;
+         pCtx->checkRet = BUS_NO_MSG;
          return retTmp;
       }
    }
-   return ret;
+   return pCtx->checkRet;
 }
 
 /*-----------------------------------------------------------------------------
@@ -370,44 +568,79 @@ uint8_t BusCheck(void) {
 * of BusCheck
 */
 TBusTelegram *BusMsgBufGet(void) {
-   return &sRxBuffer;
+   return &sBusCtx.rxBuffer;
+}
+
+TBusTelegram *BusCtxMsgBufGet(TBusCtx *pCtx) {
+   return &pCtx->rxBuffer;
+}
+
+#ifdef BUS_RX_TIMESTAMP
+/*-----------------------------------------------------------------------------
+* rx time of the last telegram (CLOCK_MONOTONIC in us): time the sio chunk
+* with the last character was read, see SioReadTs
+* BusCheckBatch: all telegrams of one call have the same time
+*/
+uint64_t BusMsgTimeGet(void) {
+   return sBusCtx.msgTimeUs;
+}
+
+uint64_t BusCtxMsgTimeGet(TBusCtx *pCtx) {
+   return pCtx->msgTimeUs;
 }
+#endif
 
 /*-----------------------------------------------------------------------------
 * L2 init
 */
-static void L2StateInit(uint8_t protoState) {
+static void L2StateInit(TBusCtx *pCtx, uint8_t protoState) {
 
-   sL2State.protoState = protoState;
-   sL2State.chIdx = 1;
-   sL2State.lastMsgIdx = 0xff;
-   sL2State.dynMsgTypeIdx = 0;
-   sL2State.lengthIdx = 0;
-   sL2State.pLDT = 0;
+   pCtx->l2State.protoState = protoState;
+   pCtx->l2State.chIdx = 1;
+   pCtx->l2State.lastMsgIdx = 0xff;
+#ifndef BUS_BOOTLOADER
+   pCtx->l2State.dynMsgTypeIdx = 0;
+   pCtx->l2State.lengthIdx = 0;
+   pCtx->l2State.pLDT = 0;
+#endif
 }
 
 /*-----------------------------------------------------------------------------
 * L2 Rx state machine
 */
-static uint8_t L2StateMachine(uint8_t ch) {
+static uint8_t L2StateMachine(TBusCtx *pCtx, uint8_t ch) {
 
     uint8_t           rc = L2_ERROR;
+#ifndef BUS_BOOTLOADER
     uint8_t           numTypes;
     TTelegramSize     *pSize;
-    uint8_t           i;
-    struct l2State    *pL2State = &sL2State;
-    TBusDevTypeLen    *pLen;
+#endif
+    uint8_t           len;
+    struct l2State    *pL2State = &pCtx->l2State;
 
     switch (pL2State->protoState) {
     case L2_WAIT_FOR_SENDER_ADDR:
-        sRxBuffer.senderAddr = ch;
-        L2StateInit(L2_WAIT_FOR_TYPE);
+        pCtx->rxBuffer.senderAddr = ch;
+        L2StateInit(pCtx, L2_WAIT_FOR_TYPE);
         rc = L2_IN_PROGRESS;
         break;
     case L2_WAIT_FOR_TYPE:
-        sRxBuffer.type = (TBusMsgType)ch;
+        pCtx->rxBuffer.type = (TBusMsgType)ch;
         pL2State->chIdx = 2;
         // find expected length of message
+#ifdef BUS_BOOTLOADER
+        len = LenBootloader(ch);
+        if (len != 0) {
+            pL2State->lastMsgIdx = len - 1;
+            if (pL2State->lastMsgIdx == 1) {
+                rc = L2_COMPLETE;
+                pL2State->protoState = L2_WAIT_FOR_SENDER_ADDR;
+            } else {
+                pL2State->protoState = L2_WAIT_FOR_MSG;
+                rc = L2_IN_PROGRESS;
+            }
+        }
+#else
         numTypes = ARRAY_CNT(sTelegramSize);
         if (ch == eBusDevStartup) {
             ch = 0; // DevStartup is index 0 in sTelegramSize
@@ -451,20 +684,18 @@ static uint8_t L2StateMachine(uint8_t ch) {
                 break;
             }
          }
+#endif
         break;
     case L2_WAIT_FOR_MSG:
-        *((uint8_t *)&sRxBuffer + pL2State->chIdx) = ch;
+        *((uint8_t *)&pCtx->rxBuffer + pL2State->chIdx) = ch;
         if (pL2State->chIdx == pL2State->lastMsgIdx) {
             rc = L2_COMPLETE;
             pL2State->protoState = L2_WAIT_FOR_SENDER_ADDR;
+#ifndef BUS_BOOTLOADER
         } else if (pL2State->chIdx == pL2State->dynMsgTypeIdx) {
-            for (i = 0, pLen = pL2State->pLDT->len; pLen->devType != eBusDevTypeInv; i++, pLen++) {
-                if (pLen->devType == ch) {
-                    pL2State->lastMsgIdx = pLen->len - 1;
-                    break;
-                }
-            }
-            if (pL2State->lastMsgIdx != 0) {
+            len = LenDevType(pL2State->pLDT, ch);
+            if (len != 0) {
+                pL2State->lastMsgIdx = len - 1;
                 rc = L2_IN_PROGRESS;
             }
         } else if (pL2State->chIdx == pL2State->lengthIdx) {
@@ -475,6 +706,7 @@ static uint8_t L2StateMachine(uint8_t ch) {
             } else {
                 rc = L2_IN_PROGRESS;
             }
+#endif
         } else {
             rc = L2_IN_PROGRESS;
         }
@@ -490,115 +722,201 @@ static uint8_t L2StateMachine(uint8_t ch) {
 }
 
 /*-----------------------------------------------------------------------------
-*  state machine for telegram decoding
+*  L1 Rx state machine (STX, byte stuffing and checksum)
 *  return codes:
 *              BUS_MSG_OK     telegram received completely
 *              BUS_MSG_RXING  telegram receiving in progress
 *              BUS_MSG_ERROR  errorous telegram received (checksum error)
 *
-*  unkown telegram types are ignored
+*  *pReuse is set when ch is not consumed (unexpected STX). ch has to be
+*  passed again as start of the next telegram.
 */
-static uint8_t BusDecode(uint8_t numRxChar) {
+static uint8_t L1StateMachine(TBusCtx *pCtx, uint8_t ch, bool *pReuse) {
 
-    static uint8_t    sL1ProtoState = L1_WAIT_FOR_STX;
-    static uint8_t    sSioRxBuffer[BUS_SIO_RX_BUF_SIZE];
-    static uint8_t    sCheckSum;
-    static bool       sStuffByte;
-    uint8_t           *pBuf = sSioRxBuffer;
-    uint8_t           numRead;
     uint8_t           rc = BUS_MSG_RXING;
-    uint8_t           i;
-    uint8_t           ch;
     uint8_t           l2State;
+    struct l1State    *pL1State = &pCtx->l1State;
 
-    numRead = SioRead(sSioHandle, pBuf, min(sizeof(sSioRxBuffer), numRxChar));
-    for (i = 0; i < numRead; i++) {
-        if (rc != BUS_MSG_RXING) {
-            break;
+    *pReuse = false;
+    switch (pL1State->protoState) {
+    case L1_WAIT_FOR_STX:
+        if (ch == STX) {
+            pL1State->protoState = L1_RX_MSG;
+            pL1State->checkSum = CHECKSUM_START + ch;
+            pL1State->stuffByte = false;
+        } else {
+            // no STX at start
+            rc = BUS_MSG_ERROR;
         }
-        ch = *(pBuf + i);
-        switch (sL1ProtoState) {
-        case L1_WAIT_FOR_STX:
-            if (ch == STX) {
-                sL1ProtoState = L1_RX_MSG;
-                sCheckSum = CHECKSUM_START + ch;
-                sStuffByte = false;
-            } else {
-                // no STX at start
-                rc = BUS_MSG_ERROR;
-                // skip all chars till next STX
-                i++;
-                while (i < numRead) {
-                    ch = *(pBuf + i);
-                    if (ch == STX) {
-                        break;
-                    }
-                    i++;
-                }
-                i--;
+        break;
+    case L1_RX_MSG:
+    case L1_WAIT_FOR_CHECKSUM:
+        if (ch == STX) {
+            // unexpected STX
+            rc = BUS_MSG_ERROR;
+            *pReuse = true;
+        } else if (ch == ESC) {
+            pL1State->stuffByte = true;
+        } else {
+            if (pL1State->stuffByte == true) {
+                /* invert character */
+                ch = ~ch;
+                pL1State->stuffByte = false;
             }
-            break;
-        case L1_RX_MSG:
-        case L1_WAIT_FOR_CHECKSUM:
-            if (ch == STX) {
-                // unexpected STX
-                rc = BUS_MSG_ERROR;
-                i--;
-            } else if (ch == ESC) {
-                sStuffByte = true;
-            } else {
-                if (sStuffByte == true) {
-                    /* invert character */
-                    ch = ~ch;
-                    sStuffByte = false;
+            if (pL1State->protoState == L1_RX_MSG) {
+                l2State = L2StateMachine(pCtx, ch);
+                pL1State->checkSum += ch;
+                if (l2State == L2_COMPLETE) {
+                    pL1State->protoState = L1_WAIT_FOR_CHECKSUM;
+                } else if (l2State == L2_ERROR) {
+                    rc = BUS_MSG_ERROR;
                 }
-                if (sL1ProtoState == L1_RX_MSG) {
-                    l2State = L2StateMachine(ch);
-                    sCheckSum += ch;
-                    if (l2State == L2_COMPLETE) {
-                        sL1ProtoState = L1_WAIT_FOR_CHECKSUM;
-                    } else if (l2State == L2_ERROR) {
-                        rc = BUS_MSG_ERROR;
-                    }
+            } else {
+                if (ch == pL1State->checkSum) {
+                    rc = BUS_MSG_OK;
                 } else {
-                    if (ch == sCheckSum) {
-                        rc = BUS_MSG_OK;
-                    } else {
-                        rc = BUS_MSG_ERROR;
-                    }
+                    rc = BUS_MSG_ERROR;
                 }
             }
-            break;
-        default:
-            break;
         }
+        break;
+    default:
+        break;
     }
 
     if (rc != BUS_MSG_RXING) {
-        sL1ProtoState = L1_WAIT_FOR_STX;
-        if (i < numRead) {
-            SioUnRead(sSioHandle, pBuf + i, numRead - i);
-        }
+        pL1State->protoState = L1_WAIT_FOR_STX;
     }
     if (rc == BUS_MSG_ERROR) {
-        L2StateInit(L2_WAIT_FOR_SENDER_ADDR);
+        L2StateInit(pCtx, L2_WAIT_FOR_SENDER_ADDR);
     }
     return rc;
 }
 
 /*-----------------------------------------------------------------------------
-* send bus telegram
+*  state machine for telegram decoding
+*  return codes:
+*              BUS_MSG_OK     telegram received completely
+*              BUS_MSG_RXING  telegram receiving in progress
+*              BUS_MSG_ERROR  errorous telegram received (checksum error)
+*
+*  unkown telegram types are ignored
 */
-uint8_t BusSendToBuf(TBusTelegram *pMsg) {
+static uint8_t BusDecode(TBusCtx *pCtx, uint8_t numRxChar) {
+
+    uint8_t           *pBuf = pCtx->sioRxBuf;
+    uint8_t           numRead;
+    uint8_t           rc = BUS_MSG_RXING;
+    uint8_t           i;
+    bool              reuse;
+#ifdef BUS_RX_TIMESTAMP
+    uint64_t          timeUs = 0;
+
+    numRead = SioReadTs(pCtx->sioHandle, pBuf, min(sizeof(pCtx->sioRxBuf), numRxChar), &timeUs);
+#else
+    numRead = SioRead(pCtx->sioHandle, pBuf, min(sizeof(pCtx->sioRxBuf), numRxChar));
+#endif
+    for (i = 0; (i < numRead) && (rc == BUS_MSG_RXING); i++) {
+        rc = L1StateMachine(pCtx, *(pBuf + i), &reuse);
+        if (reuse) {
+            i--;
+        } else if (rc == BUS_MSG_ERROR) {
+            // skip all chars till next STX
+            while (((i + 1) < numRead) && (*(pBuf + i + 1) != STX)) {
+                i++;
+            }
+        }
+    }
+
+    if ((rc != BUS_MSG_RXING) && (i < numRead)) {
+        SioUnRead(pCtx->sioHandle, pBuf + i, numRead - i);
+    }
+#ifdef BUS_RX_TIMESTAMP
+    if (rc == BUS_MSG_OK) {
+        pCtx->msgTimeUs = timeUs;
+    }
+#endif
+    return rc;
+}
+
+#ifdef BUS_RX_BATCH
+/*-----------------------------------------------------------------------------
+*  decode all telegrams available from sio
+*  pMsg: array of maxMsg telegrams to store the received telegrams
+*  max. one SioRead per call, no SioUnRead: when maxMsg telegrams are decoded
+*  the remaining characters are kept and decoded in the next call. So call
+*  again without waiting for new sio data when maxMsg is returned.
+*  incomplete telegrams are continued in the next call.
+*  telegrams with errors are discarded.
+*  return value: number of telegrams in pMsg, -1 on interface error
+*/
+int BusCheckBatch(TBusTelegram *pMsg, int maxMsg) {
 
-    uint8_t         ch;
-    uint8_t         checkSum = CHECKSUM_START;
-    uint8_t         i;
+    return BusCtxCheckBatch(&sBusCtx, pMsg, maxMsg);
+}
+
+int BusCtxCheckBatch(TBusCtx *pCtx, TBusTelegram *pMsg, int maxMsg) {
+
+    int     numMsg = 0;
+    uint8_t rc;
+    bool    reuse;
+    bool    readDone = false;
+
+    while (numMsg < maxMsg) {
+        if (pCtx->batchRx.rdPos == pCtx->batchRx.len) {
+            if (readDone) {
+                break;
+            }
+            pCtx->batchRx.rdPos = 0;
+#ifdef BUS_RX_TIMESTAMP
+            pCtx->batchRx.len = SioReadTs(pCtx->sioHandle, pCtx->batchRx.buf, sizeof(pCtx->batchRx.buf),
+                                          &pCtx->batchRx.timeUs);
+#else
+            pCtx->batchRx.len = SioRead(pCtx->sioHandle, pCtx->batchRx.buf, sizeof(pCtx->batchRx.buf));
+#endif
+            readDone = true;
+            if (pCtx->batchRx.len == 0) {
+                if (!SioHandleValid(pCtx->sioHandle)) {
+                    return -1;
+                }
+                break;
+            }
+        }
+        rc = L1StateMachine(pCtx, pCtx->batchRx.buf[pCtx->batchRx.rdPos], &reuse);
+        if (!reuse) {
+            pCtx->batchRx.rdPos++;
+        }
+        if (rc == BUS_MSG_OK) {
+            memcpy(pMsg + numMsg, &pCtx->rxBuffer, sizeof(pCtx->rxBuffer));
+            numMsg++;
+#ifdef BUS_RX_TIMESTAMP
+            pCtx->msgTimeUs = pCtx->batchRx.timeUs;
+#endif
+        }
+    }
+    return numMsg;
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+* length of telegram (without STX and checksum)
+*/
+static uint8_t TelegramLen(TBusTelegram *pMsg, uint8_t *pLen) {
+
+#ifdef BUS_BOOTLOADER
+    uint8_t         len;
+
+    if (pMsg == 0) {
+        return BUS_SEND_TX_ERROR;
+    }
+    len = LenBootloader((uint8_t)pMsg->type);
+    if (len == 0) {
+        return BUS_SEND_BAD_TYPE;
+    }
+#else
     TTelegramSize   *pSize;
-    TBusDevTypeLen  *pLen;    
     uint8_t         len = 0;
     uint8_t         numTypes;
-    bool            rc;
     uint8_t         sizeIdx;
 
     if (pMsg == 0) {
@@ -620,12 +938,7 @@ uint8_t BusSendToBuf(TBusTelegram *pMsg) {
         len = pSize->len.constant;
         break;
     case eBusLenDevType:
-        for (i = 0, pLen = pSize->len.pDevType->len; pLen->devType != eBusDevTypeInv; i++, pLen++) {
-            if (pLen->devType == *((uint8_t *)pMsg + pSize->len.pDevType->offset)) {
-                len = pLen->len;
-                break;
-            }
-        }
+        len = LenDevType(pSize->len.pDevType, *((uint8_t *)pMsg + pSize->len.pDevType->offset));
         break;
     case eBusLenDirect:
         len = *((uint8_t *)pMsg + pSize->len.direct.offsetLen) + pSize->len.direct.add;
@@ -637,30 +950,299 @@ uint8_t BusSendToBuf(TBusTelegram *pMsg) {
     if (len == 0) {
         return BUS_SEND_BAD_LEN; // error
     }
-    ch = STX;
-    rc = SioWriteBuffered(sSioHandle, &ch, sizeof(ch)) == sizeof(ch) ? true : false;
-    checkSum += ch;
-    for (i = 0; rc && (i < len); i++) {
-        ch = *((uint8_t *)pMsg + i);
-        rc = TransmitCharProt(ch);
-        checkSum += ch;
+#endif
+    *pLen = len;
+    return BUS_SEND_OK;
+}
+
+/*-----------------------------------------------------------------------------
+*  encode telegram with low level protocol translation
+*  STX + telegram + checksum, STX -> ESC + ~STX, ESC -> ESC + ~ESC
+*  pState->idx: 0 STX, 1..len telegram, len + 1 checksum
+*  encoding stops when pDst is full (dstSize >= 2), call again with the same
+*  state for the next part. Encoding is complete when pState->idx is len + 2.
+*  return value: number of characters in pDst
+*/
+static uint8_t EncodeChunk(const uint8_t *pSrc, uint8_t len, TEncodeState *pState,
+                           uint8_t *pDst, uint8_t dstSize) {
+
+    uint8_t  pos = 0;
+    uint8_t  idx = pState->idx;
+    uint8_t  checkSum = pState->checkSum;
+    uint8_t  ch;
+
+    if (idx == 0) {
+        pDst[pos++] = STX;
+        checkSum = CHECKSUM_START + STX;
+        idx = 1;
+    }
+    while ((idx <= (len + 1)) && ((pos + 2) <= dstSize)) {
+        if (idx <= len) {
+            ch = pSrc[idx - 1];
+            checkSum += ch;
+        } else {
+            ch = checkSum;
+        }
+        if ((ch == STX) || (ch == ESC)) {
+            pDst[pos++] = ESC;
+            pDst[pos++] = ~ch;
+        } else {
+            pDst[pos++] = ch;
+        }
+        idx++;
     }
-    rc = rc && TransmitCharProt(checkSum);
-    if (rc) {
-        return BUS_SEND_OK;
-    } else {
+    pState->idx = idx;
+    pState->checkSum = checkSum;
+    return pos;
+}
+
+#ifdef BUS_CTX
+/*-----------------------------------------------------------------------------
+* encode bus telegram to pBuf (max. BUS_MAX_ENCODED_SIZE characters)
+* *pLen: number of characters in pBuf
+* returns BUS_SEND_TX_ERROR if pBuf is too small
+*/
+uint8_t BusEncode(TBusTelegram *pMsg, uint8_t *pBuf, uint8_t bufSize, uint8_t *pLen) {
+
+    uint8_t         rc;
+    uint8_t         len;
+    TEncodeState    state = { 0 };
+
+    rc = TelegramLen(pMsg, &len);
+    if (rc != BUS_SEND_OK) {
+        return rc;
+    }
+    if (bufSize < 2) {
+        return BUS_SEND_TX_ERROR;
+    }
+    *pLen = EncodeChunk((uint8_t *)pMsg, len, &state, pBuf, bufSize);
+    if (state.idx != (len + 2)) {
         return BUS_SEND_TX_ERROR;
     }
+    return BUS_SEND_OK;
+}
+#endif
+
+#ifndef BUS_BOOTLOADER
+/*-----------------------------------------------------------------------------
+* tx priority of telegram
+* responses and user triggered commands are preferred, bulk transfers
+* (firmware, flash, eeprom) and polling requests give way
+* BUS_BOOTLOADER: everything is sent with normal priority
+*/
+uint8_t BusTxPrio(TBusTelegram *pMsg) {
+
+    switch (pMsg->type) {
+    case eBusDevReqUpdData:
+    case eBusDevRespUpdData:
+    case eBusDevReqUpdDataWin:
+    case eBusDevRespUpdDataWin:
+    case eBusDevReqUpdPageSum:
+    case eBusDevRespUpdPageSum:
+    case eBusDevReqGetFlashData:
+    case eBusDevRespGetFlashData:
+    case eBusDevReqEepromRead:
+    case eBusDevRespEepromRead:
+    case eBusDevReqEepromWrite:
+    case eBusDevRespEepromWrite:
+    case eBusDevReqEepromReadBlock:
+    case eBusDevRespEepromReadBlock:
+    case eBusDevReqEepromWriteBlock:
+    case eBusDevRespEepromWriteBlock:
+    case eBusDevReqActualValue:
+    case eBusDevReqGetState:
+    case eBusDevReqInfo:
+    case eBusDevReqDiag:
+        return eSioTxPrioLow;
+    case eBusButtonPressed1:
+    case eBusButtonPressed2:
+    case eBusButtonPressed1_2:
+    case eBusDevReqSetValue:
+    case eBusDevReqSetValueMulti:
+    case eBusDevReqSetState:
+    case eBusDevReqSwitchState:
+    case eBusDevRespUpdEnter:
+    case eBusDevRespUpdTerm:
+    case eBusDevRespInfo:
+    case eBusDevRespSetState:
+    case eBusDevRespGetState:
+    case eBusDevRespSwitchState:
+    case eBusDevRespSetClientAddr:
+    case eBusDevRespGetClientAddr:
+    case eBusDevRespSetAddr:
+    case eBusDevRespSetValue:
+    case eBusDevRespSetValueMulti:
+    case eBusDevRespActualValue:
+    case eBusDevRespActualValueEvent:
+    case eBusDevRespActualValueEventDelta:
+    case eBusDevRespClockCalib:
+    case eBusDevRespDoClockCalib:
+    case eBusDevRespDiag:
+    case eBusDevRespGetTime:
+    case eBusDevRespSetTime:
+    case eBusDevRespGetVar:
+    case eBusDevRespSetVar:
+    case eBusDevRespGetVarBulk:
+    case eBusDevRespSetVarBulk:
+        return eSioTxPrioHigh;
+    default:
+        return eSioTxPrioNormal;
+    }
+}
+#endif
+
+#ifdef BUS_SETVALUE_MULTI
+/*-----------------------------------------------------------------------------
+* find the entry for addr in a multicast set value telegram
+* pSetValue is the device's TBusDevSetValueXxx (setValueSize bytes), preset
+* by the caller to 'no change'. the entry data is copied to the start of
+* pSetValue, with BUS_SETVALUE_MULTI_FILL the first outputSize bytes are set
+* to data[0]. *pIdx is the index of the entry in the list (response slot).
+* returns false if there is no (valid) entry for addr
+*/
+bool BusSetValueMultiGet(const TBusDevReqSetValueMulti *pReq, uint8_t addr,
+                         uint8_t *pSetValue, uint8_t setValueSize, uint8_t outputSize,
+                         uint8_t *pIdx) {
+
+    const uint8_t *pEntry = pReq->entry;
+    const uint8_t *pEnd;
+    uint8_t       len;
+    uint8_t       idx = 0;
+
+    if (pReq->length > sizeof(pReq->entry)) {
+        return false;
+    }
+    pEnd = pReq->entry + pReq->length;
+    while ((pEntry + BUS_SETVALUE_MULTI_HDR_SIZE) <= pEnd) {
+        len = pEntry[1] & BUS_SETVALUE_MULTI_LEN_MASK;
+        if ((pEntry + BUS_SETVALUE_MULTI_HDR_SIZE + len) > pEnd) {
+            break;
+        }
+        if (pEntry[0] == addr) {
+            pEntry += BUS_SETVALUE_MULTI_HDR_SIZE;
+            if ((pEntry[-1] & BUS_SETVALUE_MULTI_FILL) != 0) {
+                if (len < 1) {
+                    return false;
+                }
+                memset(pSetValue, pEntry[0], min(outputSize, setValueSize));
+            } else {
+                memcpy(pSetValue, pEntry, min(len, setValueSize));
+            }
+            *pIdx = idx;
+            return true;
+        }
+        pEntry += BUS_SETVALUE_MULTI_HDR_SIZE + len;
+        idx++;
+    }
+    return false;
+}
+#endif
+
+#ifdef BUS_CTX
+/*-----------------------------------------------------------------------------
+* append the entry for addr to a multicast set value telegram (sender side)
+* with fill only pData[0] is used
+* returns false if there is not enough space left
+*/
+bool BusSetValueMultiAdd(TBusDevReqSetValueMulti *pReq, uint8_t addr,
+                         const uint8_t *pData, uint8_t len, bool fill) {
+
+    uint8_t *pEntry;
+
+    if (fill) {
+        len = 1;
+    }
+    if ((len > BUS_SETVALUE_MULTI_LEN_MASK) ||
+        ((pReq->length + BUS_SETVALUE_MULTI_HDR_SIZE + len) > sizeof(pReq->entry))) {
+        return false;
+    }
+    pEntry = pReq->entry + pReq->length;
+    pEntry[0] = addr;
+    pEntry[1] = len | (fill ? BUS_SETVALUE_MULTI_FILL : 0);
+    memcpy(&pEntry[BUS_SETVALUE_MULTI_HDR_SIZE], pData, len);
+    pReq->length += BUS_SETVALUE_MULTI_HDR_SIZE + len;
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+* remove the entry for addr from a multicast set value telegram, e.g. when
+* the device has confirmed. the remaining telegram is used for the retry.
+* returns false if there is no entry for addr
+*/
+bool BusSetValueMultiRemove(TBusDevReqSetValueMulti *pReq, uint8_t addr) {
+
+    uint8_t *pEntry = pReq->entry;
+    uint8_t *pEnd = pReq->entry + min(pReq->length, sizeof(pReq->entry));
+    uint8_t entrySize;
+
+    while ((pEntry + BUS_SETVALUE_MULTI_HDR_SIZE) <= pEnd) {
+        entrySize = BUS_SETVALUE_MULTI_HDR_SIZE + (pEntry[1] & BUS_SETVALUE_MULTI_LEN_MASK);
+        if ((pEntry + entrySize) > pEnd) {
+            break;
+        }
+        if (pEntry[0] == addr) {
+            memmove(pEntry, pEntry + entrySize, pEnd - (pEntry + entrySize));
+            pReq->length -= entrySize;
+            return true;
+        }
+        pEntry += entrySize;
+    }
+    return false;
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+* send bus telegram
+* the telegram is encoded in chunks of BUS_TX_CHUNK_SIZE characters
+*/
+uint8_t BusSendToBuf(TBusTelegram *pMsg) {
+
+    return BusCtxSendToBuf(&sBusCtx, pMsg);
+}
+
+uint8_t BusCtxSendToBuf(TBusCtx *pCtx, TBusTelegram *pMsg) {
+
+    uint8_t         chunk[BUS_TX_CHUNK_SIZE];
+    uint8_t         chunkLen;
+    uint8_t         len;
+    uint8_t         rc;
+    TEncodeState    state = { 0 };
+
+    rc = TelegramLen(pMsg, &len);
+    if (rc != BUS_SEND_OK) {
+        return rc;
+    }
+    do {
+        chunkLen = EncodeChunk((uint8_t *)pMsg, len, &state, chunk, sizeof(chunk));
+        if (SioWriteBuffered(pCtx->sioHandle, chunk, chunkLen) != chunkLen) {
+            return BUS_SEND_TX_ERROR;
+        }
+    } while (state.idx != (len + 2));
+#ifndef BUS_BOOTLOADER
+    SioSetTxPrio(pCtx->sioHandle, BusTxPrio(pMsg));
+#endif
+
+    return BUS_SEND_OK;
 }
 
 uint8_t BusSendToBufRaw(uint8_t *pBuf, uint8_t len) {
     
-    return SioWriteBuffered(sSioHandle, pBuf, len);
+    return BusCtxSendToBufRaw(&sBusCtx, pBuf, len);
+}
+
+uint8_t BusCtxSendToBufRaw(TBusCtx *pCtx, uint8_t *pBuf, uint8_t len) {
+    
+    return SioWriteBuffered(pCtx->sioHandle, pBuf, len);
 }
 
 uint8_t BusSendBuf(void) {
     
-    if (SioSendBuffer(sSioHandle)) {
+    return BusCtxSendBuf(&sBusCtx);
+}
+
+uint8_t BusCtxSendBuf(TBusCtx *pCtx) {
+    
+    if (SioSendBuffer(pCtx->sioHandle)) {
         return BUS_SEND_OK;
     } else {
         return BUS_SEND_TX_ERROR;
@@ -669,37 +1251,16 @@ uint8_t BusSendBuf(void) {
 
 uint8_t BusSend(TBusTelegram *pMsg) {
 
+    return BusCtxSend(&sBusCtx, pMsg);
+}
+
+uint8_t BusCtxSend(TBusCtx *pCtx, TBusTelegram *pMsg) {
+
     uint8_t rc;
 
-    rc = BusSendToBuf(pMsg);
+    rc = BusCtxSendToBuf(pCtx, pMsg);
     if (rc == BUS_SEND_OK) {
-        rc = BusSendBuf();
-    }
-    return rc;
-}
-
-/*-----------------------------------------------------------------------------
-*  send character with low level protocol translation
-*  STX -> ESC + ~STX
-*  ESC -> ESC + ~ESC
-*/
-static bool TransmitCharProt(uint8_t data) {
-
-    uint8_t tmp;
-    bool    rc;
-
-    if (data == STX) {
-        tmp = ESC;
-        rc = SioWriteBuffered(sSioHandle, &tmp, sizeof(tmp)) == sizeof(tmp) ? true : false;
-        tmp = ~STX;
-        rc = rc && SioWriteBuffered(sSioHandle, &tmp, sizeof(tmp)) == sizeof(tmp) ? true : false;
-    } else if (data == ESC) {
-        tmp = ESC;
-        rc = SioWriteBuffered(sSioHandle, &tmp, sizeof(tmp)) == sizeof(tmp) ? true : false;
-        tmp = ~ESC;
-        rc = rc && SioWriteBuffered(sSioHandle, &tmp, sizeof(tmp)) == sizeof(tmp) ? true : false;
-    } else {
-        rc = SioWriteBuffered(sSioHandle, &data, sizeof(data)) == sizeof(tmp) ? true : false;
+        rc = BusCtxSendBuf(pCtx);
     }
     return rc;
 }
@@ -0,0 +1,517 @@
+/*
+ * busevent.c
+ *
+ * Copyright 2018 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sysdef.h>
+
+#include "bus.h"
+
+#define DELTA_ENTRY_SIZE  2 /* offset, value */
+#define DELTA_HDR_SIZE    4 /* devType, seq, flags, length */
+
+/*-----------------------------------------------------------------------------
+*  Functions
+*/
+static bool Encode(uint8_t *pEntry, uint8_t maxLen,
+                   const uint8_t *pOld, const uint8_t *pNew, uint8_t size,
+                   uint8_t *pFlags, uint8_t *pLen);
+static bool SendFanout(TBusEvent *pEv, TBusTelegram *pTxMsg, uint8_t myAddr,
+                       uint16_t actualTime16);
+static uint8_t GetUnconfirmedClient(TBusEvent *pEv, uint8_t actualClient);
+static TBusEventClient *GetWaitingClient(TBusEvent *pEv, uint8_t addr);
+
+/*-----------------------------------------------------------------------------
+* size of the actual value image (TBusDevActualValueXxx) of devType
+* returns 0 for device types without actual value event
+*/
+uint8_t BusEventImageSize(TBusDevType devType) {
+
+    switch (devType) {
+    case eBusDevTypeDo31:    return sizeof(TBusDevActualValueDo31);
+    case eBusDevTypeSw8:     return sizeof(TBusDevActualValueSw8);
+    case eBusDevTypeLum:     return sizeof(TBusDevActualValueLum);
+    case eBusDevTypeLed:     return sizeof(TBusDevActualValueLed);
+    case eBusDevTypeSw16:    return sizeof(TBusDevActualValueSw16);
+    case eBusDevTypeWind:    return sizeof(TBusDevActualValueWind);
+    case eBusDevTypeRs485If: return sizeof(TBusDevActualValueRs485if);
+    case eBusDevTypePwm4:    return sizeof(TBusDevActualValuePwm4);
+    case eBusDevTypeSmIf:    return sizeof(TBusDevActualValueSmif);
+    case eBusDevTypePwm16:   return sizeof(TBusDevActualValuePwm16);
+    case eBusDevTypeKeyb:    return sizeof(TBusDevActualValueKeyb);
+    case eBusDevTypeSg:      return sizeof(TBusDevActualValueSg);
+    default:                 return 0;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* fill entry[], length and flags of a delta event (device side)
+* pOld is the image of the previous event (seq - 1), with pOld == 0 or if
+* the delta is not shorter than the image the full image is used
+* returns false if the image does not fit into the telegram
+*/
+bool BusEventDeltaEncode(TBusDevReqActualValueEventDelta *pEv,
+                         const uint8_t *pOld, const uint8_t *pNew, uint8_t size) {
+
+    return Encode(pEv->entry, sizeof(pEv->entry), pOld, pNew, size,
+                  &pEv->flags, &pEv->length);
+}
+
+static bool Encode(uint8_t *pEntry, uint8_t maxLen,
+                   const uint8_t *pOld, const uint8_t *pNew, uint8_t size,
+                   uint8_t *pFlags, uint8_t *pLen) {
+
+    uint8_t i;
+    uint8_t len = 0;
+
+    if (size > maxLen) {
+        return false;
+    }
+    if (pOld != 0) {
+        for (i = 0; i < size; i++) {
+            if (pOld[i] == pNew[i]) {
+                continue;
+            }
+            if ((len + DELTA_ENTRY_SIZE) >= size) {
+                break;
+            }
+            pEntry[len++] = i;
+            pEntry[len++] = pNew[i];
+        }
+        if (i == size) {
+            *pFlags = 0;
+            *pLen = len;
+            return true;
+        }
+    }
+    memcpy(pEntry, pNew, size);
+    *pFlags = BUS_ACTVAL_DELTA_FULL;
+    *pLen = size;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+* apply a delta event to the client's image of seq - 1 (or overwrite it
+* with the full image)
+* returns false for an invalid telegram, pImage is unchanged then
+*/
+bool BusEventDeltaApply(const TBusDevReqActualValueEventDelta *pEv,
+                        uint8_t *pImage, uint8_t size) {
+
+    uint8_t i;
+
+    if (pEv->length > sizeof(pEv->entry)) {
+        return false;
+    }
+    if ((pEv->flags & BUS_ACTVAL_DELTA_FULL) != 0) {
+        if (pEv->length != size) {
+            return false;
+        }
+        memcpy(pImage, pEv->entry, size);
+        return true;
+    }
+    if ((pEv->length % DELTA_ENTRY_SIZE) != 0) {
+        return false;
+    }
+    for (i = 0; i < pEv->length; i += DELTA_ENTRY_SIZE) {
+        if (pEv->entry[i] >= size) {
+            return false;
+        }
+    }
+    for (i = 0; i < pEv->length; i += DELTA_ENTRY_SIZE) {
+        pImage[pEv->entry[i]] = pEv->entry[i + 1];
+    }
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+* start a fan-out event with an empty client list (device side)
+*/
+void BusEventFanoutInit(TBusDevReqActualValueEventFanout *pReq) {
+
+    pReq->data[0] = 0;
+    pReq->length = 1;
+}
+
+/*-----------------------------------------------------------------------------
+* append a client to the fan-out event, must be called before
+* BusEventFanoutEncode
+* returns false if there is not enough space left
+*/
+bool BusEventFanoutAddClient(TBusDevReqActualValueEventFanout *pReq, uint8_t addr) {
+
+    if ((pReq->length != (1 + pReq->data[0])) ||
+        ((pReq->length + 1 + DELTA_HDR_SIZE) > sizeof(pReq->data))) {
+        return false;
+    }
+    pReq->data[pReq->length] = addr;
+    pReq->data[0]++;
+    pReq->length++;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+* append the delta event for all clients of the fan-out event
+* see BusEventDeltaEncode
+* returns false if the image does not fit into the telegram
+*/
+bool BusEventFanoutEncode(TBusDevReqActualValueEventFanout *pReq,
+                          TBusDevType devType, uint8_t seq,
+                          const uint8_t *pOld, const uint8_t *pNew, uint8_t size) {
+
+    uint8_t *pHdr = &pReq->data[pReq->length];
+
+    if ((pReq->length + DELTA_HDR_SIZE) > sizeof(pReq->data)) {
+        return false;
+    }
+    if (!Encode(pHdr + DELTA_HDR_SIZE, sizeof(pReq->data) - pReq->length - DELTA_HDR_SIZE,
+                pOld, pNew, size, &pHdr[2], &pHdr[3])) {
+        return false;
+    }
+    pHdr[0] = devType;
+    pHdr[1] = seq;
+    pReq->length += DELTA_HDR_SIZE + pHdr[3];
+
+    return true;
+}
+
+#ifdef BUS_CTX
+/*-----------------------------------------------------------------------------
+* get the delta event of a fan-out event for client addr
+* returns false if addr is not in the client list or the telegram is invalid
+*/
+bool BusEventFanoutGet(const TBusDevReqActualValueEventFanout *pReq, uint8_t addr,
+                       TBusDevReqActualValueEventDelta *pEv) {
+
+    const uint8_t *pHdr;
+    uint8_t       len = min(pReq->length, sizeof(pReq->data));
+    uint8_t       numClients;
+    uint8_t       i;
+
+    if (len < 1) {
+        return false;
+    }
+    numClients = pReq->data[0];
+    if ((1 + numClients + DELTA_HDR_SIZE) > len) {
+        return false;
+    }
+    for (i = 0; (i < numClients) && (pReq->data[1 + i] != addr); i++);
+    if (i == numClients) {
+        return false;
+    }
+    pHdr = &pReq->data[1 + numClients];
+    if ((pHdr[3] > sizeof(pEv->entry)) ||
+        ((1 + numClients + DELTA_HDR_SIZE + pHdr[3]) > len)) {
+        return false;
+    }
+    pEv->devType = pHdr[0];
+    pEv->seq = pHdr[1];
+    pEv->flags = pHdr[2];
+    pEv->length = pHdr[3];
+    memcpy(pEv->entry, pHdr + DELTA_HDR_SIZE, pEv->length);
+
+    return true;
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+* init the actual value event of a device with an empty client list
+* pCur and pPrev (size bytes each) are kept up to date by the device
+*/
+void BusEventInit(TBusEvent *pEv, TBusDevType devType,
+                  const void *pCur, const void *pPrev, uint8_t size) {
+
+    pEv->devType = devType;
+    pEv->pCur = pCur;
+    pEv->pPrev = pPrev;
+    pEv->size = size;
+    pEv->numClients = 0;
+    pEv->actualClient = BUS_EVENT_CLIENT_NONE;
+    pEv->fanoutPending = false;
+    pEv->newClientCycleDelay = false;
+}
+
+/*-----------------------------------------------------------------------------
+* append a client (e.g. from the EEPROM client list)
+* returns false if the list is full
+*/
+bool BusEventClientAdd(TBusEvent *pEv, uint8_t addr, uint8_t maxRetry) {
+
+    TBusEventClient *pClient;
+
+    if (pEv->numClients >= BUS_MAX_CLIENT_NUM) {
+        return false;
+    }
+    pClient = &pEv->client[pEv->numClients];
+    pClient->address = addr;
+    pClient->maxRetry = maxRetry;
+    pClient->curRetry = 0;
+    pClient->state = eBusEventInit;
+    pClient->format = eBusEventFormatUnknown;
+    pClient->synced = false;
+    pEv->numClients++;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+* the device has captured a new image: start the event to all clients
+*/
+void BusEventChanged(TBusEvent *pEv) {
+
+    TBusEventClient *pClient;
+    uint8_t         i;
+
+    pEv->seq++;
+    for (i = 0, pClient = pEv->client; i < pEv->numClients; i++, pClient++) {
+        pClient->synced = pClient->state == eBusEventConfirmationOK;
+        pClient->state = eBusEventInit;
+        pClient->curRetry = 0;
+    }
+    pEv->actualClient = 0;
+    pEv->newClientCycleDelay = false;
+    pEv->fanoutPending = true;
+}
+
+/*-----------------------------------------------------------------------------
+* send the event: fan-out to all clients with delta support, then one
+* client per call until all clients have confirmed or reached maxRetry
+* pTxMsg is the device's tx buffer
+*/
+void BusEventCheck(TBusEvent *pEv, TBusTelegram *pTxMsg, uint8_t myAddr,
+                   uint16_t actualTime16) {
+
+    TBusEventClient                 *pClient;
+    TBusDevReqActualValueEvent      *pActVal;
+    TBusDevReqActualValueEventDelta *pActValDelta;
+    bool                            getNextClient;
+    uint8_t                         nextClient;
+
+    if (pEv->actualClient == BUS_EVENT_CLIENT_NONE) {
+        return;
+    }
+
+    if (pEv->fanoutPending) {
+        pEv->fanoutPending = !SendFanout(pEv, pTxMsg, myAddr, actualTime16);
+        return;
+    }
+
+    if (pEv->newClientCycleDelay) {
+        if (((uint16_t)(actualTime16 - pEv->newClientCycleTimeStamp)) < BUS_EVENT_RETRY_CYCLE_TIME_MS) {
+            return;
+        } else {
+            pEv->newClientCycleDelay = false;
+        }
+    }
+
+    pClient = &pEv->client[pEv->actualClient];
+    getNextClient = true;
+    switch (pClient->state) {
+    case eBusEventInit:
+        pTxMsg->senderAddr = myAddr;
+        pTxMsg->msg.devBus.receiverAddr = pClient->address;
+        if (pClient->format == eBusEventFormatFull) {
+            pActVal = &pTxMsg->msg.devBus.x.devReq.actualValueEvent;
+            pTxMsg->type = eBusDevReqActualValueEvent;
+            pActVal->devType = pEv->devType;
+            memcpy(&pActVal->actualValue, pEv->pCur, pEv->size);
+        } else {
+            /* only the changes for a client that has the previous image */
+            pActValDelta = &pTxMsg->msg.devBus.x.devReq.actualValueEventDelta;
+            pTxMsg->type = eBusDevReqActualValueEventDelta;
+            pActValDelta->devType = pEv->devType;
+            pActValDelta->seq = pEv->seq;
+            BusEventDeltaEncode(pActValDelta, pClient->synced ? pEv->pPrev : 0,
+                                pEv->pCur, pEv->size);
+        }
+
+        if (BusSend(pTxMsg) == BUS_SEND_OK) {
+            pClient->state = eBusEventWaitForConfirmation;
+            pClient->requestTimeStamp = actualTime16;
+        } else {
+            getNextClient = false;
+        }
+        break;
+    case eBusEventWaitForConfirmation:
+        if (((uint16_t)(actualTime16 - pClient->requestTimeStamp)) >= BUS_EVENT_RESPONSE_TIMEOUT_MS) {
+            if (pClient->format == eBusEventFormatUnknown) {
+                /* no answer to delta event: repeat with eBusDevReqActualValueEvent */
+                pClient->format = eBusEventFormatFull;
+            }
+            /* the response could be lost: repeat with full image */
+            pClient->synced = false;
+            if (pClient->curRetry < pClient->maxRetry) {
+                /* try again */
+                pClient->curRetry++;
+                getNextClient = false;
+                pClient->state = eBusEventInit;
+            } else {
+                pClient->state = eBusEventMaxRetry;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (getNextClient) {
+        nextClient = GetUnconfirmedClient(pEv, pEv->actualClient);
+        if (nextClient <= pEv->actualClient) {
+            pEv->newClientCycleDelay = true;
+            pEv->newClientCycleTimeStamp = actualTime16;
+        }
+        pEv->actualClient = nextClient;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* eBusDevRespActualValueEvent of a client matches the image (checked by the
+* device)
+*/
+void BusEventConfirm(TBusEvent *pEv, uint8_t addr) {
+
+    TBusEventClient *pClient = GetWaitingClient(pEv, addr);
+
+    if (pClient != 0) {
+        pClient->state = eBusEventConfirmationOK;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* eBusDevRespActualValueEventDelta of a client
+*/
+void BusEventRespDelta(TBusEvent *pEv, uint8_t addr,
+                       const TBusDevRespActualValueEventDelta *pResp) {
+
+    TBusEventClient *pClient = GetWaitingClient(pEv, addr);
+
+    if ((pClient == 0) || (pResp->seq != pEv->seq)) {
+        return;
+    }
+    pClient->format = eBusEventFormatDelta;
+    if (pResp->state == BUS_ACTVAL_DELTA_OK) {
+        pClient->state = eBusEventConfirmationOK;
+    } else if (pClient->curRetry < pClient->maxRetry) {
+        /* client has lost the image: repeat with full image */
+        pClient->curRetry++;
+        pClient->synced = false;
+        pClient->state = eBusEventInit;
+    } else {
+        pClient->state = eBusEventMaxRetry;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+* send the event to all clients with delta support in one telegram
+* clients that don't confirm get the event again by BusEventCheck
+* returns false if the telegram could not be sent
+*/
+static bool SendFanout(TBusEvent *pEv, TBusTelegram *pTxMsg, uint8_t myAddr,
+                       uint16_t actualTime16) {
+
+    TBusDevReqActualValueEventFanout *pFanout;
+    TBusEventClient *pClient;
+    uint8_t         i;
+    uint8_t         numClients = 0;
+    bool            synced = true;
+
+    pFanout = &pTxMsg->msg.devBus.x.devReq.actualValueEventFanout;
+    BusEventFanoutInit(pFanout);
+    for (i = 0, pClient = pEv->client; i < pEv->numClients; i++, pClient++) {
+        if ((pClient->format != eBusEventFormatFull) &&
+            BusEventFanoutAddClient(pFanout, pClient->address)) {
+            synced = synced && pClient->synced;
+            numClients++;
+        }
+    }
+    if ((numClients < 2) ||
+        !BusEventFanoutEncode(pFanout, pEv->devType, pEv->seq,
+                              synced ? pEv->pPrev : 0, pEv->pCur, pEv->size)) {
+        /* nothing to gain, BusEventCheck sends to each client */
+        return true;
+    }
+    pTxMsg->type = eBusDevReqActualValueEventFanout;
+    pTxMsg->senderAddr = myAddr;
+    pTxMsg->msg.devBus.receiverAddr = BUS_CLIENT_ADDRESS_INVALID;
+    if (BusSend(pTxMsg) != BUS_SEND_OK) {
+        return false;
+    }
+    for (i = 0, pClient = pEv->client; i < pEv->numClients; i++, pClient++) {
+        if (pClient->format != eBusEventFormatFull) {
+            pClient->state = eBusEventWaitForConfirmation;
+            pClient->requestTimeStamp = actualTime16;
+        }
+    }
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+* get next client array index
+* if all clients are processed BUS_EVENT_CLIENT_NONE is returned
+*/
+static uint8_t GetUnconfirmedClient(TBusEvent *pEv, uint8_t actualClient) {
+
+    uint8_t         i;
+    uint8_t         nextClient;
+    TBusEventClient *pClient;
+
+    if (actualClient >= pEv->numClients) {
+        return BUS_EVENT_CLIENT_NONE;
+    }
+
+    for (i = 0; i < pEv->numClients; i++) {
+        nextClient = actualClient + i + 1;
+        nextClient %= pEv->numClients;
+        pClient = &pEv->client[nextClient];
+        if (pClient->state == eBusEventMaxRetry) {
+            continue;
+        }
+        if (pClient->state != eBusEventConfirmationOK) {
+            break;
+        }
+    }
+    if (i == pEv->numClients) {
+        /* all client's confirmations received or retry count expired */
+        nextClient = BUS_EVENT_CLIENT_NONE;
+    }
+    return nextClient;
+}
+
+/*-----------------------------------------------------------------------------
+* client addr waiting for the confirmation of the event
+*/
+static TBusEventClient *GetWaitingClient(TBusEvent *pEv, uint8_t addr) {
+
+    TBusEventClient *pClient;
+    uint8_t         i;
+
+    for (i = 0, pClient = pEv->client; i < pEv->numClients; i++, pClient++) {
+        if ((pClient->address == addr) &&
+            (pClient->state == eBusEventWaitForConfirmation)) {
+            return pClient;
+        }
+    }
+    return 0;
+}
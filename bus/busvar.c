@@ -30,7 +30,16 @@
 #define TX_RETRY_TIMEOUT 50  /* ms */
 #define RESPONSE_TIMEOUT 100 /* ms */
 
-#define TRANSACTION_FIFO_LEN    8 /* must be power of 2 */
+#ifndef BUSVAR_TRANSACTION_FIFO_LEN
+#define BUSVAR_TRANSACTION_FIFO_LEN 8
+#endif
+#define TRANSACTION_FIFO_LEN    BUSVAR_TRANSACTION_FIFO_LEN /* must be power of 2 */
+
+/* entry sizes in bulk telegrams without variable data */
+#define BULK_GET_REQ_SIZE       1 /* index */
+#define BULK_GET_RESP_HDR_SIZE  3 /* index, result, length */
+#define BULK_SET_REQ_HDR_SIZE   2 /* index, length */
+#define BULK_SET_RESP_SIZE      2 /* index, result */
 
 #define NUM_FIFO_FREE     ((sVarFifoRdIdx - sVarFifoWrIdx - 1) & (TRANSACTION_FIFO_LEN - 1))
 #define IDX_INC(__idx__)   __idx__++; __idx__ &= (TRANSACTION_FIFO_LEN - 1)
@@ -50,6 +59,9 @@ typedef struct {
     TBusVarState state;
     uint8_t txRetryCnt;
     uint16_t txTime;
+    bool    bulk;     // sent in bulk telegram
+    bool    single;   // don't use bulk telegrams
+    bool    inTx;     // part of the telegram just being sent
 } TVarTransactionDesc;
 
 static TVarTab  sVarTable[BUSVAR_NUMVAR];
@@ -178,6 +190,9 @@ TBusVarHdl BusVarTransactionOpen(uint8_t addr, uint8_t idx, void *buf, uint8_t s
     vtd->size = size;
     vtd->state = eBusVarState_Scheduled;
     vtd->txRetryCnt = 5;
+    vtd->bulk = false;
+    vtd->single = false;
+    vtd->inTx = false;
     IDX_INC(sVarFifoWrIdx);
     return (TBusVarHdl)vtd;
 }
@@ -216,7 +231,7 @@ void BusVarRespSet(uint8_t addr, TBusDevRespSetVar *respSet) {
     rdIdx = sVarFifoRdIdx;
     do {
         vtd = &sVarTransactionFifo[rdIdx];
-        if ((addr == vtd->addr) && (vtd->idx != respSet->index)) {
+        if ((addr == vtd->addr) && (vtd->idx == respSet->index)) {
             break;
         }
         IDX_INC(rdIdx);
@@ -254,18 +269,118 @@ void BusVarRespGet(uint8_t addr, TBusDevRespGetVar *respGet) {
     }
 }
 
-static void Process(TVarTransactionDesc *vtd) {
+/*
+ * find the transaction waiting for the response from addr
+ */
+static TVarTransactionDesc *FindWaiting(uint8_t addr, uint8_t idx, TBusVarDir dir) {
+    TVarTransactionDesc *vtd;
+    uint8_t rdIdx;
 
-    static TBusTelegram  sTxMsg;
-    uint16_t actualTime16;
-    uint8_t i;
+    for (rdIdx = sVarFifoRdIdx; rdIdx != sVarFifoWrIdx; ) {
+        vtd = &sVarTransactionFifo[rdIdx];
+        if ((vtd->state == eBusVarState_Waiting) &&
+            (vtd->addr == addr) && (vtd->idx == idx) && (vtd->dir == dir)) {
+            return vtd;
+        }
+        IDX_INC(rdIdx);
+    }
+    return 0;
+}
 
-    GET_TIME_MS16(actualTime16);
+void BusVarRespGetBulk(uint8_t addr, TBusDevRespGetVarBulk *respGet) {
+    TVarTransactionDesc *vtd;
+    uint8_t *entry = respGet->entry;
+    uint8_t *end = respGet->entry + min(respGet->length, sizeof(respGet->entry));
+    uint8_t len;
 
-    switch (vtd->state) {
-    case eBusVarState_Scheduled:
-        sTxMsg.senderAddr = sMyAddr;
-        sTxMsg.msg.devBus.receiverAddr = vtd->addr;
+    while ((entry + BULK_GET_RESP_HDR_SIZE) <= end) {
+        len = entry[2];
+        if ((entry + BULK_GET_RESP_HDR_SIZE + len) > end) {
+            break;
+        }
+        vtd = FindWaiting(addr, entry[0], eBusVarRead);
+        if (vtd != 0) {
+            if ((entry[1] == eBusVarSuccess) && (len == vtd->size)) {
+                memcpy(vtd->buf, &entry[BULK_GET_RESP_HDR_SIZE], len);
+                vtd->state = eBusVarState_Ready;
+            } else {
+                vtd->state = eBusVarState_Error;
+            }
+        }
+        entry += BULK_GET_RESP_HDR_SIZE + len;
+    }
+}
+
+void BusVarRespSetBulk(uint8_t addr, TBusDevRespSetVarBulk *respSet) {
+    TVarTransactionDesc *vtd;
+    uint8_t *entry = respSet->entry;
+    uint8_t *end = respSet->entry + min(respSet->length, sizeof(respSet->entry));
+
+    for (; (entry + BULK_SET_RESP_SIZE) <= end; entry += BULK_SET_RESP_SIZE) {
+        vtd = FindWaiting(addr, entry[0], eBusVarWrite);
+        if (vtd != 0) {
+            if (entry[1] == eBusVarSuccess) {
+                vtd->state = eBusVarState_Ready;
+            } else {
+                vtd->state = eBusVarState_Error;
+            }
+        }
+    }
+}
+
+/*
+ * send the telegram for vtd. further pending transactions to the same
+ * device are packed into one bulk telegram as long as request and
+ * response fit into the telegram.
+ */
+static void Send(TVarTransactionDesc *vtd, uint16_t actualTime16) {
+
+    static TBusTelegram  sTxMsg;
+    TVarTransactionDesc *next;
+    uint8_t rdIdx;
+    uint8_t reqLen = 0;
+    uint8_t respLen = 0;
+    uint8_t reqSize;
+    uint8_t respSize;
+    uint8_t num = 0;
+    uint8_t *entry;
+    bool    ok;
+
+    /* select the transactions for this telegram */
+    for (rdIdx = vtd - sVarTransactionFifo; rdIdx != sVarFifoWrIdx; ) {
+        next = &sVarTransactionFifo[rdIdx];
+        IDX_INC(rdIdx);
+        next->inTx = false;
+        if ((next != vtd) &&
+            (vtd->single ||
+             next->single ||
+             (next->addr != vtd->addr) ||
+             (next->dir != vtd->dir) ||
+             ((next->state != eBusVarState_Scheduled) &&
+              (next->state != eBusVarState_TxRetry)))) {
+            continue;
+        }
+        if (vtd->dir == eBusVarRead) {
+            reqSize = BULK_GET_REQ_SIZE;
+            respSize = BULK_GET_RESP_HDR_SIZE + next->size;
+        } else {
+            reqSize = BULK_SET_REQ_HDR_SIZE + next->size;
+            respSize = BULK_SET_RESP_SIZE;
+        }
+        if ((next != vtd) &&
+            (((reqLen + reqSize) > BUS_VAR_BULK_SIZE) ||
+             ((respLen + respSize) > BUS_VAR_BULK_SIZE))) {
+            continue;
+        }
+        reqLen += reqSize;
+        respLen += respSize;
+        next->inTx = true;
+        num++;
+    }
+
+    sTxMsg.senderAddr = sMyAddr;
+    sTxMsg.msg.devBus.receiverAddr = vtd->addr;
+    if (num == 1) {
         if (vtd->dir == eBusVarRead) {
             sTxMsg.type = eBusDevReqGetVar;
             sTxMsg.msg.devBus.x.devReq.getVar.index = vtd->idx;
@@ -273,32 +388,70 @@ static void Process(TVarTransactionDesc *vtd) {
             sTxMsg.type = eBusDevReqSetVar;
             sTxMsg.msg.devBus.x.devReq.setVar.index = vtd->idx;
             sTxMsg.msg.devBus.x.devReq.setVar.length = vtd->size;
-            for (i = 0; i < vtd->size; i++) {
-                sTxMsg.msg.devBus.x.devReq.setVar.data[i] = *((uint8_t *)vtd->buf + i);
-            }
+            memcpy(sTxMsg.msg.devBus.x.devReq.setVar.data, vtd->buf, vtd->size);
         }
-        if (BusSend(&sTxMsg) == BUS_SEND_OK) {
-            vtd->state = eBusVarState_Waiting;
-        } else {
-            vtd->state = eBusVarState_TxRetry;
+    } else if (vtd->dir == eBusVarRead) {
+        sTxMsg.type = eBusDevReqGetVarBulk;
+        sTxMsg.msg.devBus.x.devReq.getVarBulk.length = reqLen;
+        entry = sTxMsg.msg.devBus.x.devReq.getVarBulk.entry;
+    } else {
+        sTxMsg.type = eBusDevReqSetVarBulk;
+        sTxMsg.msg.devBus.x.devReq.setVarBulk.length = reqLen;
+        entry = sTxMsg.msg.devBus.x.devReq.setVarBulk.entry;
+    }
+    for (rdIdx = vtd - sVarTransactionFifo; (num > 1) && (rdIdx != sVarFifoWrIdx); ) {
+        next = &sVarTransactionFifo[rdIdx];
+        IDX_INC(rdIdx);
+        if (!next->inTx) {
+            continue;
+        }
+        *entry++ = next->idx;
+        if (next->dir == eBusVarWrite) {
+            *entry++ = next->size;
+            memcpy(entry, next->buf, next->size);
+            entry += next->size;
         }
-        vtd->txTime = actualTime16;
+    }
+
+    ok = BusSend(&sTxMsg) == BUS_SEND_OK;
+    for (rdIdx = vtd - sVarTransactionFifo; rdIdx != sVarFifoWrIdx; ) {
+        next = &sVarTransactionFifo[rdIdx];
+        IDX_INC(rdIdx);
+        if (next->inTx) {
+            next->inTx = false;
+            next->bulk = num > 1;
+            next->state = ok ? eBusVarState_Waiting : eBusVarState_TxRetry;
+            next->txTime = actualTime16;
+        }
+    }
+}
+
+static void Process(TVarTransactionDesc *vtd) {
+
+    uint16_t actualTime16;
+
+    GET_TIME_MS16(actualTime16);
+
+    switch (vtd->state) {
+    case eBusVarState_Scheduled:
+        Send(vtd, actualTime16);
         break;
     case eBusVarState_Waiting:
         if ((actualTime16 - vtd->txTime) > RESPONSE_TIMEOUT) {
-            vtd->state = eBusVarState_Timeout;
+            if (vtd->bulk) {
+                /* device without support of bulk telegrams? */
+                vtd->single = true;
+                vtd->state = eBusVarState_Scheduled;
+            } else {
+                vtd->state = eBusVarState_Timeout;
+            }
         }
         break;
     case eBusVarState_TxRetry:
         if ((actualTime16 - vtd->txTime) > TX_RETRY_TIMEOUT) {
             if (vtd->txRetryCnt > 0) {
-                if (BusSend(&sTxMsg) == BUS_SEND_OK) {
-                    vtd->state = eBusVarState_Waiting;
-                } else {
-                    vtd->state = eBusVarState_TxRetry;
-                    vtd->txRetryCnt--;
-                }
-                vtd->txTime = actualTime16;
+                vtd->txRetryCnt--;
+                Send(vtd, actualTime16);
             } else {
                 vtd->state = eBusVarState_TxError;
             }
@@ -307,6 +460,7 @@ static void Process(TVarTransactionDesc *vtd) {
     case eBusVarState_Timeout:
     case eBusVarState_TxError:
     case eBusVarState_Ready:
+    case eBusVarState_Error:
         // do nothing - transaction shall be closed by user
         break;
     default:
@@ -330,6 +484,53 @@ void BusVarProcess(void) {
     }
 }
 
+/*
+ * device side: read the requested variables into the bulk response
+ * entries that don't fit into the response are omitted
+ */
+void BusVarGetBulk(TBusDevReqGetVarBulk *reqGet, TBusDevRespGetVarBulk *respGet) {
+    uint8_t i;
+    uint8_t pos = 0;
+    uint8_t *entry;
+
+    for (i = 0; i < min(reqGet->length, sizeof(reqGet->entry)); i++) {
+        if ((pos + BULK_GET_RESP_HDR_SIZE) > sizeof(respGet->entry)) {
+            break;
+        }
+        entry = &respGet->entry[pos];
+        entry[0] = reqGet->entry[i];
+        entry[2] = BusVarRead(entry[0], &entry[BULK_GET_RESP_HDR_SIZE],
+                              sizeof(respGet->entry) - pos - BULK_GET_RESP_HDR_SIZE,
+                              (TBusVarResult *)&entry[1]);
+        pos += BULK_GET_RESP_HDR_SIZE + entry[2];
+    }
+    respGet->length = pos;
+}
+
+/*
+ * device side: write the variables of the bulk request
+ */
+void BusVarSetBulk(TBusDevReqSetVarBulk *reqSet, TBusDevRespSetVarBulk *respSet) {
+    uint8_t *entry = reqSet->entry;
+    uint8_t *end = reqSet->entry + min(reqSet->length, sizeof(reqSet->entry));
+    uint8_t pos = 0;
+    uint8_t len;
+
+    while ((entry + BULK_SET_REQ_HDR_SIZE) <= end) {
+        len = entry[1];
+        if (((entry + BULK_SET_REQ_HDR_SIZE + len) > end) ||
+            ((pos + BULK_SET_RESP_SIZE) > sizeof(respSet->entry))) {
+            break;
+        }
+        respSet->entry[pos] = entry[0];
+        BusVarWrite(entry[0], &entry[BULK_SET_REQ_HDR_SIZE], len,
+                    (TBusVarResult *)&respSet->entry[pos + 1]);
+        pos += BULK_SET_RESP_SIZE;
+        entry += BULK_SET_REQ_HDR_SIZE + len;
+    }
+    respSet->length = pos;
+}
+
 bool BusVarSetInfo(uint8_t idx, const char *name, TBusVarType type, TBusVarMode mode) {
     return true;
 }
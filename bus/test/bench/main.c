@@ -0,0 +1,515 @@
+/*
+ * main.c
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+/*
+ * host benchmark for the bus codec (decoding and encoding)
+ * the sio interface is replaced by a memory buffer, so only the cost of
+ * bus.c is measured
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sio.h"
+#include "bus.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define BENCH_HANDLE     0
+#define NUM_FRAMES       200000
+#define MAX_FRAME_SIZE   (2 * sizeof(TBusTelegram) + 4)
+#define BATCH_SIZE       32
+#define NUM_LOOKUPS      2000000
+#define NUM_DEV_TYPES    (eBusDevTypeSg + 1)
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+typedef void (* TSetupFunc)(TBusTelegram *pMsg);
+
+typedef struct {
+   const char *name;
+   TSetupFunc setup;
+} TBenchSet;
+
+/* former layout of the device type dependent length lists (linear search) */
+typedef struct {
+   TBusDevType devType;
+   uint8_t     len;
+} TRefDevTypeLen;
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+/* memory sio: tx data is appended to sTxBuf, rx data is taken from sRxBuf */
+static uint8_t  *sTxBuf;
+static unsigned sTxPos;
+static unsigned sTxSize;
+static uint8_t  *sRxBuf;
+static unsigned sRxPos;
+static unsigned sRxLen;
+static unsigned sNumSioCalls;
+
+static TBusTelegram sBatchMsg[BATCH_SIZE];
+
+/* reference for the length lookup: RespActualValue list in both layouts */
+static const TRefDevTypeLen sRefLenList[] = {
+   {eBusDevTypeDo31,    sizeof(TBusDevActualValueDo31)},
+   {eBusDevTypeSw8,     sizeof(TBusDevActualValueSw8)},
+   {eBusDevTypeLum,     sizeof(TBusDevActualValueLum)},
+   {eBusDevTypeLed,     sizeof(TBusDevActualValueLed)},
+   {eBusDevTypeSw16,    sizeof(TBusDevActualValueSw16)},
+   {eBusDevTypeWind,    sizeof(TBusDevActualValueWind)},
+   {eBusDevTypeRs485If, sizeof(TBusDevActualValueRs485if)},
+   {eBusDevTypePwm4,    sizeof(TBusDevActualValuePwm4)},
+   {eBusDevTypeSmIf,    sizeof(TBusDevActualValueSmif)},
+   {eBusDevTypePwm16,   sizeof(TBusDevActualValuePwm16)},
+   {eBusDevTypeKeyb,    sizeof(TBusDevActualValueKeyb)},
+   {eBusDevTypeKeyRc,   sizeof(TBusDevActualValueKeyrc)},
+   {eBusDevTypeSg,      sizeof(TBusDevActualValueSg)},
+   {eBusDevTypeInv,     0}
+};
+
+static const uint8_t sRefLenArray[NUM_DEV_TYPES] = {
+   [eBusDevTypeDo31]    = sizeof(TBusDevActualValueDo31),
+   [eBusDevTypeSw8]     = sizeof(TBusDevActualValueSw8),
+   [eBusDevTypeLum]     = sizeof(TBusDevActualValueLum),
+   [eBusDevTypeLed]     = sizeof(TBusDevActualValueLed),
+   [eBusDevTypeSw16]    = sizeof(TBusDevActualValueSw16),
+   [eBusDevTypeWind]    = sizeof(TBusDevActualValueWind),
+   [eBusDevTypeRs485If] = sizeof(TBusDevActualValueRs485if),
+   [eBusDevTypePwm4]    = sizeof(TBusDevActualValuePwm4),
+   [eBusDevTypeSmIf]    = sizeof(TBusDevActualValueSmif),
+   [eBusDevTypePwm16]   = sizeof(TBusDevActualValuePwm16),
+   [eBusDevTypeKeyb]    = sizeof(TBusDevActualValueKeyb),
+   [eBusDevTypeKeyRc]   = sizeof(TBusDevActualValueKeyrc),
+   [eBusDevTypeSg]      = sizeof(TBusDevActualValueSg)
+};
+
+static volatile uint8_t sRefDevType;
+static volatile uint8_t sRefLen;
+
+/*-----------------------------------------------------------------------------
+*  memory sio
+*/
+bool SioHandleValid(int handle) {
+   sNumSioCalls++;
+   return handle == BENCH_HANDLE;
+}
+
+uint8_t SioGetNumRxChar(int handle) {
+   sNumSioCalls++;
+   return min(sRxLen - sRxPos, 255);
+}
+
+uint8_t SioRead(int handle, uint8_t *pBuf, uint8_t bufSize) {
+
+   unsigned len = min(sRxLen - sRxPos, bufSize);
+
+   sNumSioCalls++;
+   memcpy(pBuf, sRxBuf + sRxPos, len);
+   sRxPos += len;
+   return len;
+}
+
+uint8_t SioReadTs(int handle, uint8_t *pBuf, uint8_t bufSize, uint64_t *pTimeUs) {
+   *pTimeUs = 0;
+   return SioRead(handle, pBuf, bufSize);
+}
+
+uint8_t SioUnRead(int handle, uint8_t *pBuf, uint8_t bufSize) {
+   sNumSioCalls++;
+   /* bus.c unreads the tail of the last read only */
+   sRxPos -= bufSize;
+   return bufSize;
+}
+
+uint8_t SioWriteBuffered(int handle, uint8_t *pBuf, uint8_t bufSize) {
+
+   unsigned len = min(sTxSize - sTxPos, bufSize);
+
+   sNumSioCalls++;
+   memcpy(sTxBuf + sTxPos, pBuf, len);
+   sTxPos += len;
+   return len;
+}
+
+bool SioSendBuffer(int handle) {
+   return true;
+}
+
+void SioSetTxPrio(int handle, TSioTxPrio prio) {
+}
+
+/*-----------------------------------------------------------------------------
+*  telegram setup
+*/
+static void SetupButton(TBusTelegram *pMsg) {
+   pMsg->type = eBusButtonPressed1;
+}
+
+static void SetupReqActualValue(TBusTelegram *pMsg) {
+   pMsg->type = eBusDevReqActualValue;
+}
+
+static void SetupRespGetVar(TBusTelegram *pMsg) {
+   pMsg->type = eBusDevRespGetVar;
+   pMsg->msg.devBus.x.devResp.getVar.result = eBusVarSuccess;
+   pMsg->msg.devBus.x.devResp.getVar.index = 3;
+   pMsg->msg.devBus.x.devResp.getVar.length = 4;
+}
+
+static void SetupActualValueEventDo31(TBusTelegram *pMsg) {
+   pMsg->type = eBusDevReqActualValueEvent;
+   pMsg->msg.devBus.x.devReq.actualValueEvent.devType = eBusDevTypeDo31;
+}
+
+static void SetupRespActualValueSg(TBusTelegram *pMsg) {
+   pMsg->type = eBusDevRespActualValue;
+   pMsg->msg.devBus.x.devResp.actualValue.devType = eBusDevTypeSg;
+}
+
+static void SetupRespInfoSg(TBusTelegram *pMsg) {
+   pMsg->type = eBusDevRespInfo;
+   pMsg->msg.devBus.x.devResp.info.devType = eBusDevTypeSg;
+}
+
+static void SetupReqSetValueKeyrc(TBusTelegram *pMsg) {
+   pMsg->type = eBusDevReqSetValue;
+   pMsg->msg.devBus.x.devReq.setValue.devType = eBusDevTypeKeyRc;
+}
+
+static const TBenchSet sBenchSet[] = {
+   { "const ButtonPressed1        ", SetupButton               },
+   { "const ReqActualValue        ", SetupReqActualValue       },
+   { "direct RespGetVar           ", SetupRespGetVar           },
+   { "devtype ReqActValEvent Do31 ", SetupActualValueEventDo31 },
+   { "devtype RespActualValue Sg  ", SetupRespActualValueSg    },
+   { "devtype RespInfo Sg         ", SetupRespInfoSg           },
+   { "devtype ReqSetValue KeyRc   ", SetupReqSetValueKeyrc     }
+};
+
+/*-----------------------------------------------------------------------------
+*  time in ns
+*/
+static uint64_t TimeNs(void) {
+
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------------
+*  length lookup as before: linear search of the list
+*/
+static uint8_t RefLenLinear(const TRefDevTypeLen *pList, uint8_t devType) {
+
+   const TRefDevTypeLen *pLen;
+
+   for (pLen = pList; pLen->devType != eBusDevTypeInv; pLen++) {
+      if (pLen->devType == devType) {
+         return pLen->len;
+      }
+   }
+   return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  length lookup as in bus.c: array indexed by device type
+*/
+static uint8_t RefLenIndexed(const uint8_t *pArray, uint8_t devType) {
+
+   if (devType < NUM_DEV_TYPES) {
+      return pArray[devType];
+   } else {
+      return 0;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+*  reference path: old and new length lookup measured in the same run
+*/
+static int BenchLookup(TBusDevType devType, const char *pName) {
+
+   unsigned i;
+   uint8_t  lenLinear;
+   uint8_t  lenIndexed;
+   uint64_t start;
+   uint64_t durationLinear;
+   uint64_t durationIndexed;
+
+   sRefDevType = devType;
+   start = TimeNs();
+   for (i = 0; i < NUM_LOOKUPS; i++) {
+      sRefLen = RefLenLinear(sRefLenList, sRefDevType);
+   }
+   durationLinear = TimeNs() - start;
+   lenLinear = sRefLen;
+
+   start = TimeNs();
+   for (i = 0; i < NUM_LOOKUPS; i++) {
+      sRefLen = RefLenIndexed(sRefLenArray, sRefDevType);
+   }
+   durationIndexed = TimeNs() - start;
+   lenIndexed = sRefLen;
+
+   printf("%s linear %5.2f ns/lookup, indexed %5.2f ns/lookup\n", pName,
+          (double)durationLinear / NUM_LOOKUPS, (double)durationIndexed / NUM_LOOKUPS);
+
+   if (lenLinear != lenIndexed) {
+      printf("%s: length differs (%u, %u)\n", pName, lenLinear, lenIndexed);
+      return -1;
+   }
+   return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  fill rx buffer with NUM_FRAMES telegrams of one type
+*  return value: frame length, 0 on error
+*/
+static unsigned PrepareFrames(const TBenchSet *pSet) {
+
+   TBusTelegram txMsg;
+   unsigned     frameLen;
+   unsigned     i;
+
+   memset(&txMsg, 0x11, sizeof(txMsg));
+   txMsg.senderAddr = 66;
+   txMsg.msg.devBus.receiverAddr = 67;
+   pSet->setup(&txMsg);
+
+   /* encode the telegram once and replicate it */
+   sTxPos = 0;
+   if (BusSendToBuf(&txMsg) != BUS_SEND_OK) {
+      printf("%s: encode error\n", pSet->name);
+      return 0;
+   }
+   frameLen = sTxPos;
+   for (i = 1; i < NUM_FRAMES; i++) {
+      memcpy(sTxBuf + i * frameLen, sTxBuf, frameLen);
+   }
+   memcpy(sRxBuf, sTxBuf, frameLen * NUM_FRAMES);
+   sRxLen = frameLen * NUM_FRAMES;
+   sRxPos = 0;
+   sNumSioCalls = 0;
+
+   return frameLen;
+}
+
+/*-----------------------------------------------------------------------------
+*  decode the rx buffer with BusCheck
+*/
+static unsigned DecodeSingle(unsigned *pNumErr) {
+
+   unsigned numOk = 0;
+   uint8_t  ret = BUS_NO_MSG;
+
+   while ((sRxPos < sRxLen) || (ret == BUS_MSG_RXING)) {
+      ret = BusCheck();
+      if (ret == BUS_MSG_OK) {
+         numOk++;
+      } else if (ret == BUS_MSG_ERROR) {
+         (*pNumErr)++;
+      } else if ((ret == BUS_NO_MSG) && (sRxPos == sRxLen)) {
+         break;
+      }
+   }
+   return numOk;
+}
+
+/*-----------------------------------------------------------------------------
+*  decode the rx buffer with BusCheckBatch
+*/
+static unsigned DecodeBatch(unsigned *pNumErr) {
+
+   unsigned numOk = 0;
+   int      ret;
+
+   do {
+      ret = BusCheckBatch(sBatchMsg, BATCH_SIZE);
+      if (ret > 0) {
+         numOk += ret;
+      } else if (ret < 0) {
+         (*pNumErr)++;
+      }
+   } while (ret != 0);
+
+   return numOk;
+}
+
+/*-----------------------------------------------------------------------------
+*  decode NUM_FRAMES telegrams of one type
+*/
+static int BenchDecode(const TBenchSet *pSet, bool batch) {
+
+   unsigned     frameLen;
+   unsigned     numOk;
+   unsigned     numErr = 0;
+   uint64_t     start;
+   uint64_t     duration;
+
+   frameLen = PrepareFrames(pSet);
+   if (frameLen == 0) {
+      return -1;
+   }
+
+   start = TimeNs();
+   if (batch) {
+      numOk = DecodeBatch(&numErr);
+   } else {
+      numOk = DecodeSingle(&numErr);
+   }
+   duration = TimeNs() - start;
+
+   printf("%s len %2u: %6u ok %u err, %6.1f ns/frame, %5.2f sio calls/frame\n",
+          pSet->name, frameLen, numOk, numErr, (double)duration / NUM_FRAMES,
+          (double)sNumSioCalls / NUM_FRAMES);
+
+   if ((numOk != NUM_FRAMES) || (numErr != 0)) {
+      return -1;
+   }
+   return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  encode NUM_FRAMES telegrams of one type
+*  toBuf: BusEncode to local buffer, else BusSendToBuf to sio
+*/
+static int BenchEncode(const TBenchSet *pSet, bool toBuf) {
+
+   TBusTelegram txMsg;
+   uint8_t      buf[BUS_MAX_ENCODED_SIZE];
+   uint8_t      len = 0;
+   unsigned     numErr = 0;
+   unsigned     i;
+   uint64_t     start;
+   uint64_t     duration;
+
+   memset(&txMsg, 0x11, sizeof(txMsg));
+   txMsg.senderAddr = 66;
+   txMsg.msg.devBus.receiverAddr = 67;
+   pSet->setup(&txMsg);
+   sNumSioCalls = 0;
+
+   start = TimeNs();
+   for (i = 0; i < NUM_FRAMES; i++) {
+      if (toBuf) {
+         if (BusEncode(&txMsg, buf, sizeof(buf), &len) != BUS_SEND_OK) {
+            numErr++;
+         }
+      } else {
+         sTxPos = 0;
+         if (BusSendToBuf(&txMsg) != BUS_SEND_OK) {
+            numErr++;
+         }
+         len = sTxPos;
+      }
+   }
+   duration = TimeNs() - start;
+
+   printf("%s len %2u: %u err, %6.1f ns/frame, %5.2f Mframes/s, %5.2f sio calls/frame\n",
+          pSet->name, len, numErr, (double)duration / NUM_FRAMES,
+          (double)NUM_FRAMES * 1000 / duration,
+          (double)sNumSioCalls / NUM_FRAMES);
+
+   if (numErr != 0) {
+      return -1;
+   }
+   if (toBuf) {
+      /* the encoded telegram must be the same as the one sent to sio */
+      sTxPos = 0;
+      if ((BusSendToBuf(&txMsg) != BUS_SEND_OK) ||
+          (sTxPos != len) ||
+          (memcmp(buf, sTxBuf, len) != 0)) {
+         printf("%s: BusEncode differs from BusSendToBuf\n", pSet->name);
+         return -1;
+      }
+   }
+   return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  main
+*/
+int main(int argc, char *argv[]) {
+
+   unsigned i;
+   int      rc = 0;
+
+   sTxSize = MAX_FRAME_SIZE * NUM_FRAMES;
+   sTxBuf = malloc(sTxSize);
+   sRxBuf = malloc(sTxSize);
+   if ((sTxBuf == 0) || (sRxBuf == 0)) {
+      printf("out of memory\n");
+      return 1;
+   }
+
+   BusInit(BENCH_HANDLE);
+
+   printf("length lookup benchmark RespActualValue (%u lookups per type)\n", NUM_LOOKUPS);
+   if ((BenchLookup(eBusDevTypeDo31,  "devtype Do31  (first entry)") != 0) ||
+       (BenchLookup(eBusDevTypeKeyRc, "devtype KeyRc              ") != 0) ||
+       (BenchLookup(eBusDevTypeSg,    "devtype Sg    (last entry) ") != 0) ||
+       (BenchLookup(eBusDevTypeInv,   "devtype Inv   (unknown)    ") != 0)) {
+      rc = 1;
+   }
+
+   printf("decode benchmark BusCheck (%u frames per type)\n", NUM_FRAMES);
+   for (i = 0; i < ARRAY_CNT(sBenchSet); i++) {
+      if (BenchDecode(&sBenchSet[i], false) != 0) {
+         rc = 1;
+      }
+   }
+   printf("decode benchmark BusCheckBatch (%u frames per type)\n", NUM_FRAMES);
+   for (i = 0; i < ARRAY_CNT(sBenchSet); i++) {
+      if (BenchDecode(&sBenchSet[i], true) != 0) {
+         rc = 1;
+      }
+   }
+
+   printf("encode benchmark BusSendToBuf (%u frames per type)\n", NUM_FRAMES);
+   for (i = 0; i < ARRAY_CNT(sBenchSet); i++) {
+      if (BenchEncode(&sBenchSet[i], false) != 0) {
+         rc = 1;
+      }
+   }
+   printf("encode benchmark BusEncode (%u frames per type)\n", NUM_FRAMES);
+   for (i = 0; i < ARRAY_CNT(sBenchSet); i++) {
+      if (BenchEncode(&sBenchSet[i], true) != 0) {
+         rc = 1;
+      }
+   }
+
+   BusExit(BENCH_HANDLE);
+   free(sTxBuf);
+   free(sRxBuf);
+
+   printf(rc == 0 ? "OK\n" : "ERROR\n");
+   return rc;
+}
@@ -44,6 +44,13 @@
 #define MSG_SIZE1      2
 #define MSG_SIZE2      3
 
+#define BATCH_SIZE     16
+#define BATCH_NUM_TX   8
+
+#define TXQUEUE_NUM_TX 20
+
+#define TIMESTAMP_GAP_US 20000
+
 /*-----------------------------------------------------------------------------
 *  print help
 */
@@ -81,10 +88,693 @@ static int TestTelegram(TBusTelegram *pTxMsg, uint8_t msgSize) {
     return 0;
 }
 
+/*-----------------------------------------------------------------------------
+*  send several telegrams with one write and receive them with BusCheckBatch
+*/
+static int TestBatch(void) {
+
+    TBusTelegram    txMsg;
+    TBusTelegram    rxMsg[BATCH_SIZE];
+    int             i;
+    int             ret;
+    int             numRx = 0;
+    int             timeout;
+
+    memset(&txMsg, 0, sizeof(txMsg));
+    txMsg.type = eBusDevReqSetVar;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    txMsg.msg.devBus.x.devReq.setVar.length = 2;
+    for (i = 0; i < BATCH_NUM_TX; i++) {
+        /* index and data contain STX and ESC to check the byte stuffing */
+        txMsg.msg.devBus.x.devReq.setVar.index = i;
+        txMsg.msg.devBus.x.devReq.setVar.data[0] = 0x02;
+        txMsg.msg.devBus.x.devReq.setVar.data[1] = 0x1b;
+        if (BusSendToBuf(&txMsg) != BUS_SEND_OK) {
+            return -1;
+        }
+    }
+    if (BusSendBuf() != BUS_SEND_OK) {
+        return -1;
+    }
+
+    for (timeout = 0; (timeout < RX_TIMEOUT) && (numRx < BATCH_NUM_TX); timeout++) {
+        ret = BusCheckBatch(&rxMsg[numRx], BATCH_SIZE - numRx);
+        if (ret < 0) {
+            return -1;
+        } else if (ret == 0) {
+            usleep(1000);
+        }
+        numRx += ret;
+    }
+    if (numRx != BATCH_NUM_TX) {
+        return -1;
+    }
+    for (i = 0; i < BATCH_NUM_TX; i++) {
+        txMsg.msg.devBus.x.devReq.setVar.index = i;
+        if (memcmp(&txMsg, &rxMsg[i], MSG_SIZE2 + 1 + 1 + 2) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  monotonic time in us
+*/
+static uint64_t TimeUs(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*-----------------------------------------------------------------------------
+*  rx timestamp: two telegrams sent TIMESTAMP_GAP_US apart, the timestamps
+*  must lie between send and BusCheck and show the gap
+*/
+static int TestRxTimestamp(void) {
+
+    TBusTelegram txMsg;
+    uint64_t     txTimeUs[2];
+    uint64_t     rxTimeUs[2];
+    uint64_t     checkTimeUs;
+    int          i;
+    int          timeout;
+
+    memset(&txMsg, 0, sizeof(txMsg));
+    txMsg.type = eBusDevReqInfo;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    for (i = 0; i < 2; i++) {
+        if (i > 0) {
+            usleep(TIMESTAMP_GAP_US);
+        }
+        txTimeUs[i] = TimeUs();
+        if (BusSend(&txMsg) != BUS_SEND_OK) {
+            return -1;
+        }
+        /* let the echo arrive before BusCheck: the timestamp is the sio
+         * read time, not the time of BusCheck */
+        usleep(5000);
+        for (timeout = 0; (timeout < RX_TIMEOUT) && (BusCheck() != BUS_MSG_OK); timeout++) {
+            usleep(1000);
+        }
+        checkTimeUs = TimeUs();
+        if (timeout == RX_TIMEOUT) {
+            return -1;
+        }
+        rxTimeUs[i] = BusMsgTimeGet();
+        if ((rxTimeUs[i] < txTimeUs[i]) || (rxTimeUs[i] > checkTimeUs)) {
+            return -1;
+        }
+    }
+    if ((rxTimeUs[1] - rxTimeUs[0]) < TIMESTAMP_GAP_US) {
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  tx queue: send several telegrams with SioTxQueueAdd/SioTxQueueFlush
+*  the last telegram is queued with high priority and overtakes the others
+*/
+static int sTxDoneCnt;
+static int sTxDoneErr;
+
+static void TxDone(int handle, int id) {
+
+    /* high priority telegram first, then in the order of SioTxQueueAdd */
+    if (id != ((sTxDoneCnt == 0) ? (TXQUEUE_NUM_TX - 1) : (sTxDoneCnt - 1))) {
+        sTxDoneErr++;
+    }
+    sTxDoneCnt++;
+}
+
+static int TestTxQueue(int handle) {
+
+    TBusTelegram    txMsg;
+    TBusTelegram    rxMsg[TXQUEUE_NUM_TX];
+    uint8_t         buf[BUS_MAX_ENCODED_SIZE];
+    uint8_t         len;
+    TSioTxPrio      prio;
+    int             i;
+    int             ret;
+    int             numRx = 0;
+    int             timeout;
+
+    sTxDoneCnt = 0;
+    sTxDoneErr = 0;
+    SioSetTxDoneFunc(handle, TxDone);
+
+    memset(&txMsg, 0, sizeof(txMsg));
+    txMsg.type = eBusDevReqSetVar;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    txMsg.msg.devBus.x.devReq.setVar.length = 2;
+    txMsg.msg.devBus.x.devReq.setVar.data[0] = 0x02;
+    txMsg.msg.devBus.x.devReq.setVar.data[1] = 0x1b;
+    for (i = 0; i < TXQUEUE_NUM_TX; i++) {
+        txMsg.msg.devBus.x.devReq.setVar.index = i;
+        prio = (i == (TXQUEUE_NUM_TX - 1)) ? eSioTxPrioHigh : BusTxPrio(&txMsg);
+        if ((BusEncode(&txMsg, buf, sizeof(buf), &len) != BUS_SEND_OK) ||
+            (SioTxQueueAdd(handle, buf, len, prio) != i)) {
+            return -1;
+        }
+    }
+    for (timeout = 0; (timeout < RX_TIMEOUT) && ((ret = SioTxQueueFlush(handle)) > 0); timeout++) {
+        usleep(1000);
+    }
+    if ((ret != 0) || (sTxDoneCnt != TXQUEUE_NUM_TX) || (sTxDoneErr != 0)) {
+        return -1;
+    }
+
+    for (timeout = 0; (timeout < RX_TIMEOUT) && (numRx < TXQUEUE_NUM_TX); timeout++) {
+        ret = BusCheckBatch(&rxMsg[numRx], TXQUEUE_NUM_TX - numRx);
+        if (ret < 0) {
+            return -1;
+        } else if (ret == 0) {
+            usleep(1000);
+        }
+        numRx += ret;
+    }
+    if (numRx != TXQUEUE_NUM_TX) {
+        return -1;
+    }
+    for (i = 0; i < TXQUEUE_NUM_TX; i++) {
+        txMsg.msg.devBus.x.devReq.setVar.index = (i == 0) ? (TXQUEUE_NUM_TX - 1) : (i - 1);
+        if (memcmp(&txMsg, &rxMsg[i], MSG_SIZE2 + 1 + 1 + 2) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  multicast set value: build entry list, decode entries, remove confirmed
+*  entries for the retry telegram
+*/
+static int TestSetValueMulti(void) {
+
+    TBusTelegram            txMsg;
+    TBusDevReqSetValueMulti *pReq = &txMsg.msg.devBus.x.devReq.setValueMulti;
+    TBusDevSetValueDo31     do31;
+    TBusDevSetValuePwm4     pwm4;
+    TBusDevSetValueSw8      sw8;
+    uint8_t                 allOff = 0xaa;
+    uint8_t                 sw8Pulse[BUS_SW8_DIGOUT_SIZE_SET_VALUE] = { 0x04, 0x00 };
+    uint8_t                 pwm4Data[3] = { 0x02, 0x34, 0x12 }; /* ch 0 on with pwm 0x1234 */
+    uint8_t                 addr;
+    uint8_t                 idx;
+    int                     i;
+
+    memset(&txMsg, 0, sizeof(txMsg));
+    txMsg.type = eBusDevReqSetValueMulti;
+    txMsg.senderAddr = 66;
+    pReq->seq = 7;
+    /* 12 do31 all off + 1 sw8 fill the telegram */
+    for (addr = 10; addr < 22; addr++) {
+        if (!BusSetValueMultiAdd(pReq, addr, &allOff, 1, true)) {
+            return -1;
+        }
+    }
+    if (!BusSetValueMultiAdd(pReq, 30, sw8Pulse, sizeof(sw8Pulse), false) ||
+        (pReq->length != BUS_SETVALUE_MULTI_SIZE)) {
+        return -1;
+    }
+    if (BusSetValueMultiAdd(pReq, 31, pwm4Data, sizeof(pwm4Data), false)) {
+        return -1;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 2 + BUS_SETVALUE_MULTI_SIZE) != 0) {
+        return -1;
+    }
+
+    memset(do31.digOut, 0, sizeof(do31.digOut));
+    memset(do31.shader, 254, sizeof(do31.shader));
+    /* the entry index gives the response slot */
+    if (!BusSetValueMultiGet(pReq, 15, (uint8_t *)&do31, sizeof(do31), sizeof(do31.digOut), &idx) ||
+        (idx != 5)) {
+        return -1;
+    }
+    for (i = 0; i < sizeof(do31.digOut); i++) {
+        if (do31.digOut[i] != 0xaa) {
+            return -1;
+        }
+    }
+    for (i = 0; i < sizeof(do31.shader); i++) {
+        if (do31.shader[i] != 254) {
+            return -1;
+        }
+    }
+    memset(&sw8, 0, sizeof(sw8));
+    if (!BusSetValueMultiGet(pReq, 30, (uint8_t *)&sw8, sizeof(sw8), sizeof(sw8.digOut), &idx) ||
+        (idx != 12) || (memcmp(sw8.digOut, sw8Pulse, sizeof(sw8Pulse)) != 0)) {
+        return -1;
+    }
+    if (BusSetValueMultiGet(pReq, 99, (uint8_t *)&sw8, sizeof(sw8), sizeof(sw8.digOut), &idx)) {
+        return -1;
+    }
+
+    /* all except 21 and 30 confirmed */
+    for (addr = 10; addr < 21; addr++) {
+        if (!BusSetValueMultiRemove(pReq, addr)) {
+            return -1;
+        }
+    }
+    if (BusSetValueMultiRemove(pReq, 10) ||
+        (pReq->length != 3 + 4) ||
+        !BusSetValueMultiGet(pReq, 21, (uint8_t *)&do31, sizeof(do31), sizeof(do31.digOut), &idx) ||
+        (idx != 0) ||
+        !BusSetValueMultiGet(pReq, 30, (uint8_t *)&sw8, sizeof(sw8), sizeof(sw8.digOut), &idx) ||
+        (idx != 1)) {
+        return -1;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 2 + 3 + 4) != 0) {
+        return -1;
+    }
+
+    /* partial entry: missing pwm[] values are kept */
+    if (!BusSetValueMultiAdd(pReq, 31, pwm4Data, sizeof(pwm4Data), false)) {
+        return -1;
+    }
+    pwm4.set = 0;
+    for (i = 0; i < BUS_PWM4_PWM_SIZE_SET_VALUE; i++) {
+        pwm4.pwm[i] = 100;
+    }
+    if (!BusSetValueMultiGet(pReq, 31, (uint8_t *)&pwm4, sizeof(pwm4), sizeof(pwm4.set), &idx) ||
+        (idx != 2) || (pwm4.set != 0x02) || (pwm4.pwm[0] != 0x1234) || (pwm4.pwm[1] != 100)) {
+        return -1;
+    }
+    if (!BusSetValueMultiRemove(pReq, 21) ||
+        !BusSetValueMultiRemove(pReq, 30) ||
+        !BusSetValueMultiRemove(pReq, 31) ||
+        (pReq->length != 0)) {
+        return -1;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 2) != 0) {
+        return -1;
+    }
+
+    txMsg.type = eBusDevRespSetValueMulti;
+    txMsg.senderAddr = 21;
+    txMsg.msg.devBus.receiverAddr = 66;
+    txMsg.msg.devBus.x.devResp.setValueMulti.seq = 7;
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 1) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  delta actual value event: encode the changes of a do31 image, transmit,
+*  apply to the client's image, fall back to the full image
+*/
+static int TestActValDelta(void) {
+
+    TBusTelegram                    txMsg;
+    TBusDevReqActualValueEventDelta *pEv = &txMsg.msg.devBus.x.devReq.actualValueEventDelta;
+    TBusDevActualValueDo31          oldVal;
+    TBusDevActualValueDo31          newVal;
+    TBusDevActualValueDo31          clientVal;
+    TBusDevActualValueSmif          oldSmif;
+    TBusDevActualValueSmif          newSmif;
+
+    memset(&txMsg, 0, sizeof(txMsg));
+    txMsg.type = eBusDevReqActualValueEventDelta;
+    txMsg.senderAddr = 240;
+    txMsg.msg.devBus.receiverAddr = 66;
+    pEv->devType = eBusDevTypeDo31;
+    pEv->seq = 1;
+    if (BusEventImageSize(eBusDevTypeDo31) != sizeof(TBusDevActualValueDo31)) {
+        return -1;
+    }
+
+    /* first event: full image */
+    memset(&oldVal, 0, sizeof(oldVal));
+    memset(&newVal, 0, sizeof(newVal));
+    newVal.digOut[0] = 0x01;
+    memset(newVal.shader, 252, sizeof(newVal.shader));
+    if (!BusEventDeltaEncode(pEv, 0, (uint8_t *)&newVal, sizeof(newVal)) ||
+        (pEv->flags != BUS_ACTVAL_DELTA_FULL) ||
+        (pEv->length != sizeof(newVal))) {
+        return -1;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 4 + sizeof(newVal)) != 0) {
+        return -1;
+    }
+    memset(&clientVal, 0xff, sizeof(clientVal));
+    if (!BusEventDeltaApply(pEv, (uint8_t *)&clientVal, sizeof(clientVal)) ||
+        (memcmp(&clientVal, &newVal, sizeof(newVal)) != 0)) {
+        return -1;
+    }
+
+    /* one output switched: 1 entry */
+    oldVal = newVal;
+    newVal.digOut[2] = 0x80;
+    pEv->seq = 2;
+    if (!BusEventDeltaEncode(pEv, (uint8_t *)&oldVal, (uint8_t *)&newVal, sizeof(newVal)) ||
+        (pEv->flags != 0) ||
+        (pEv->length != 2) ||
+        (pEv->entry[0] != 2) || (pEv->entry[1] != 0x80)) {
+        return -1;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 4 + 2) != 0) {
+        return -1;
+    }
+    if (!BusEventDeltaApply(pEv, (uint8_t *)&clientVal, sizeof(clientVal)) ||
+        (memcmp(&clientVal, &newVal, sizeof(newVal)) != 0)) {
+        return -1;
+    }
+
+    /* invalid offset: image unchanged */
+    pEv->entry[0] = sizeof(newVal);
+    if (BusEventDeltaApply(pEv, (uint8_t *)&clientVal, sizeof(clientVal)) ||
+        (memcmp(&clientVal, &newVal, sizeof(newVal)) != 0)) {
+        return -1;
+    }
+
+    /* most bytes changed: delta is not shorter than full image */
+    oldVal = newVal;
+    memset(newVal.shader, 50, sizeof(newVal.shader));
+    pEv->seq = 3;
+    if (!BusEventDeltaEncode(pEv, (uint8_t *)&oldVal, (uint8_t *)&newVal, sizeof(newVal)) ||
+        (pEv->flags != BUS_ACTVAL_DELTA_FULL) ||
+        !BusEventDeltaApply(pEv, (uint8_t *)&clientVal, sizeof(clientVal)) ||
+        (memcmp(&clientVal, &newVal, sizeof(newVal)) != 0)) {
+        return -1;
+    }
+
+    /* smartmeter: one counter changed in the low bytes */
+    memset(&oldSmif, 0, sizeof(oldSmif));
+    newSmif = oldSmif;
+    pEv->devType = eBusDevTypeSmIf;
+    if (!BusEventDeltaEncode(pEv, 0, (uint8_t *)&newSmif, sizeof(newSmif)) ||
+        (TestTelegram(&txMsg, MSG_SIZE2 + 4 + sizeof(newSmif)) != 0)) {
+        return -1;
+    }
+    newSmif.countA_plus = 0x0102;
+    if (!BusEventDeltaEncode(pEv, (uint8_t *)&oldSmif, (uint8_t *)&newSmif, sizeof(newSmif)) ||
+        (pEv->length != 4) ||
+        (TestTelegram(&txMsg, MSG_SIZE2 + 4 + 4) != 0)) {
+        return -1;
+    }
+
+    txMsg.type = eBusDevRespActualValueEventDelta;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 240;
+    txMsg.msg.devBus.x.devResp.actualValueEventDelta.devType = eBusDevTypeDo31;
+    txMsg.msg.devBus.x.devResp.actualValueEventDelta.seq = 3;
+    txMsg.msg.devBus.x.devResp.actualValueEventDelta.state = BUS_ACTVAL_DELTA_RESYNC;
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 3) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  fan-out actual value event: one event for all clients, each client gets
+*  its delta event
+*/
+static int TestActValFanout(void) {
+
+    TBusTelegram                     txMsg;
+    TBusDevReqActualValueEventFanout *pReq = &txMsg.msg.devBus.x.devReq.actualValueEventFanout;
+    TBusDevReqActualValueEventDelta  ev;
+    TBusDevActualValueDo31           oldVal;
+    TBusDevActualValueDo31           newVal;
+    TBusDevActualValueDo31           clientVal;
+    uint8_t                          addr;
+
+    memset(&txMsg, 0, sizeof(txMsg));
+    txMsg.type = eBusDevReqActualValueEventFanout;
+    txMsg.senderAddr = 240;
+    txMsg.msg.devBus.receiverAddr = BUS_CLIENT_ADDRESS_INVALID;
+
+    /* full do31 image for the max. number of clients */
+    memset(&newVal, 0x11, sizeof(newVal));
+    BusEventFanoutInit(pReq);
+    for (addr = 100; addr < (100 + BUS_MAX_CLIENT_NUM); addr++) {
+        if (!BusEventFanoutAddClient(pReq, addr)) {
+            return -1;
+        }
+    }
+    if (!BusEventFanoutEncode(pReq, eBusDevTypeDo31, 5, 0, (uint8_t *)&newVal, sizeof(newVal)) ||
+        (TestTelegram(&txMsg, MSG_SIZE2 + 1 + 1 + BUS_MAX_CLIENT_NUM + 4 + sizeof(newVal)) != 0)) {
+        return -1;
+    }
+    if (!BusEventFanoutGet(pReq, 100 + BUS_MAX_CLIENT_NUM - 1, &ev) ||
+        (ev.devType != eBusDevTypeDo31) || (ev.seq != 5) ||
+        !BusEventDeltaApply(&ev, (uint8_t *)&clientVal, sizeof(clientVal)) ||
+        (memcmp(&clientVal, &newVal, sizeof(newVal)) != 0)) {
+        return -1;
+    }
+    if (BusEventFanoutGet(pReq, 99, &ev)) {
+        return -1;
+    }
+
+    /* delta for 3 clients */
+    oldVal = newVal;
+    newVal.digOut[1] = 0x12;
+    BusEventFanoutInit(pReq);
+    if (!BusEventFanoutAddClient(pReq, 10) ||
+        !BusEventFanoutAddClient(pReq, 20) ||
+        !BusEventFanoutAddClient(pReq, 30) ||
+        !BusEventFanoutEncode(pReq, eBusDevTypeDo31, 6,
+                              (uint8_t *)&oldVal, (uint8_t *)&newVal, sizeof(newVal))) {
+        return -1;
+    }
+    /* no more clients after the event */
+    if (BusEventFanoutAddClient(pReq, 40)) {
+        return -1;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 1 + 1 + 3 + 4 + 2) != 0) {
+        return -1;
+    }
+    if (!BusEventFanoutGet(pReq, 20, &ev) ||
+        (ev.seq != 6) || (ev.flags != 0) ||
+        !BusEventDeltaApply(&ev, (uint8_t *)&clientVal, sizeof(clientVal)) ||
+        (memcmp(&clientVal, &newVal, sizeof(newVal)) != 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  wait for the echo of the telegram sent by BusEventCheck
+*/
+static TBusTelegram *EventRx(void) {
+
+    TBusTelegram *pRxMsg = BusMsgBufGet();
+    int          timeout;
+
+    for (timeout = 0; (timeout < RX_TIMEOUT) && (BusCheck() != BUS_MSG_OK); timeout++) {
+        usleep(1000);
+    }
+    return (timeout < RX_TIMEOUT) ? pRxMsg : 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  actual value event of a device to its clients (bus/busevent.c): fan-out
+*  to all clients, repeat for a client that has lost the image, full event
+*  for a client without delta support, delta fan-out for the next change
+*/
+static int TestActValClients(void) {
+
+    static TBusDevActualValueDo31    curVal;
+    static TBusDevActualValueDo31    prevVal;
+    TBusTelegram                     txMsg;
+    TBusDevActualValueDo31           clientVal;
+    TBusEvent                        event;
+    TBusDevRespActualValueEventDelta resp;
+    TBusDevReqActualValueEventDelta  ev;
+    TBusTelegram                     *pRxMsg;
+
+    memset(&curVal, 0x11, sizeof(curVal));
+    memset(&prevVal, 0, sizeof(prevVal));
+    BusEventInit(&event, eBusDevTypeDo31, &curVal, &prevVal, sizeof(curVal));
+    if (!BusEventClientAdd(&event, 10, 1) ||
+        !BusEventClientAdd(&event, 20, 1) ||
+        !BusEventClientAdd(&event, 30, 1)) {
+        return -1;
+    }
+    BusEventChanged(&event);
+
+    /* first event: full image in one fan-out for all clients */
+    BusEventCheck(&event, &txMsg, 240, 0);
+    pRxMsg = EventRx();
+    memset(&clientVal, 0, sizeof(clientVal));
+    if ((pRxMsg == 0) || (pRxMsg->type != eBusDevReqActualValueEventFanout) ||
+        !BusEventFanoutGet(&pRxMsg->msg.devBus.x.devReq.actualValueEventFanout, 30, &ev) ||
+        (ev.seq != event.seq) ||
+        !BusEventDeltaApply(&ev, (uint8_t *)&clientVal, sizeof(clientVal)) ||
+        (memcmp(&clientVal, &curVal, sizeof(curVal)) != 0)) {
+        return -1;
+    }
+    /* 10 confirms, 20 has lost the image, 30 does not answer */
+    resp.devType = eBusDevTypeDo31;
+    resp.seq = event.seq;
+    resp.state = BUS_ACTVAL_DELTA_OK;
+    BusEventRespDelta(&event, 10, &resp);
+    resp.state = BUS_ACTVAL_DELTA_RESYNC;
+    BusEventRespDelta(&event, 20, &resp);
+
+    BusEventCheck(&event, &txMsg, 240, 1);
+    BusEventCheck(&event, &txMsg, 240, 2);
+    pRxMsg = EventRx();
+    if ((pRxMsg == 0) || (pRxMsg->type != eBusDevReqActualValueEventDelta) ||
+        (pRxMsg->msg.devBus.receiverAddr != 20) ||
+        !(pRxMsg->msg.devBus.x.devReq.actualValueEventDelta.flags & BUS_ACTVAL_DELTA_FULL)) {
+        return -1;
+    }
+    resp.state = BUS_ACTVAL_DELTA_OK;
+    BusEventRespDelta(&event, 20, &resp);
+
+    /* response timeout of 30: full event after the retry cycle time */
+    BusEventCheck(&event, &txMsg, 240, 3);
+    BusEventCheck(&event, &txMsg, 240, 3 + BUS_EVENT_RETRY_CYCLE_TIME_MS);
+    BusEventCheck(&event, &txMsg, 240, 4 + BUS_EVENT_RETRY_CYCLE_TIME_MS);
+    pRxMsg = EventRx();
+    if ((pRxMsg == 0) || (pRxMsg->type != eBusDevReqActualValueEvent) ||
+        (pRxMsg->msg.devBus.receiverAddr != 30) ||
+        (memcmp(&pRxMsg->msg.devBus.x.devReq.actualValueEvent.actualValue.do31,
+                &curVal, sizeof(curVal)) != 0)) {
+        return -1;
+    }
+    BusEventConfirm(&event, 30);
+    BusEventCheck(&event, &txMsg, 240, 4 + 2 * BUS_EVENT_RETRY_CYCLE_TIME_MS);
+    if (event.actualClient != BUS_EVENT_CLIENT_NONE) {
+        return -1;
+    }
+
+    /* next change: delta fan-out to 10 and 20, full event to 30 */
+    prevVal = curVal;
+    curVal.digOut[2] = 0x22;
+    BusEventChanged(&event);
+    BusEventCheck(&event, &txMsg, 240, 1000);
+    pRxMsg = EventRx();
+    if ((pRxMsg == 0) || (pRxMsg->type != eBusDevReqActualValueEventFanout) ||
+        BusEventFanoutGet(&pRxMsg->msg.devBus.x.devReq.actualValueEventFanout, 30, &ev) ||
+        !BusEventFanoutGet(&pRxMsg->msg.devBus.x.devReq.actualValueEventFanout, 20, &ev) ||
+        (ev.flags & BUS_ACTVAL_DELTA_FULL) ||
+        !BusEventDeltaApply(&ev, (uint8_t *)&clientVal, sizeof(clientVal)) ||
+        (memcmp(&clientVal, &curVal, sizeof(curVal)) != 0)) {
+        return -1;
+    }
+    BusEventCheck(&event, &txMsg, 240, 1001);
+    BusEventCheck(&event, &txMsg, 240, 1002);
+    BusEventCheck(&event, &txMsg, 240, 1003);
+    pRxMsg = EventRx();
+    if ((pRxMsg == 0) || (pRxMsg->type != eBusDevReqActualValueEvent) ||
+        (pRxMsg->msg.devBus.receiverAddr != 30)) {
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  bulk var transactions: several transactions to the same device are sent
+*  in one bulk telegram. the echoed request is answered by the local var
+*  table (device side).
+*/
+static int VarBulkExchange(TBusMsgType reqType, TBusVarHdl *pHdl, int numHdl) {
+
+    TBusTelegram    *pRxMsg;
+    TBusTelegram    respMsg;
+    int             i;
+    int             timeout;
+    int             numReady;
+
+    BusVarProcess();
+    for (timeout = 0; (timeout < RX_TIMEOUT) && (BusCheck() != BUS_MSG_OK); timeout++) {
+        usleep(1000);
+    }
+    pRxMsg = BusMsgBufGet();
+    if ((timeout == RX_TIMEOUT) ||
+        (pRxMsg->type != reqType) ||
+        (pRxMsg->msg.devBus.receiverAddr != 67)) {
+        return -1;
+    }
+    memset(&respMsg, 0, sizeof(respMsg));
+    respMsg.senderAddr = 67;
+    respMsg.msg.devBus.receiverAddr = 66;
+    if (reqType == eBusDevReqGetVarBulk) {
+        respMsg.type = eBusDevRespGetVarBulk;
+        BusVarGetBulk(&pRxMsg->msg.devBus.x.devReq.getVarBulk, &respMsg.msg.devBus.x.devResp.getVarBulk);
+        if (TestTelegram(&respMsg, MSG_SIZE2 + 1 + respMsg.msg.devBus.x.devResp.getVarBulk.length) != 0) {
+            return -1;
+        }
+        BusVarRespGetBulk(67, &respMsg.msg.devBus.x.devResp.getVarBulk);
+    } else {
+        respMsg.type = eBusDevRespSetVarBulk;
+        BusVarSetBulk(&pRxMsg->msg.devBus.x.devReq.setVarBulk, &respMsg.msg.devBus.x.devResp.setVarBulk);
+        if (TestTelegram(&respMsg, MSG_SIZE2 + 1 + respMsg.msg.devBus.x.devResp.setVarBulk.length) != 0) {
+            return -1;
+        }
+        BusVarRespSetBulk(67, &respMsg.msg.devBus.x.devResp.setVarBulk);
+    }
+    for (i = 0, numReady = 0; i < numHdl; i++) {
+        if (BusVarTransactionState(pHdl[i]) == eBusVarState_Ready) {
+            numReady++;
+        }
+        BusVarTransactionClose(pHdl[i]);
+    }
+    return numReady == numHdl ? 0 : -1;
+}
+
+static int TestVarBulk(void) {
+
+    uint8_t         var0 = 0x12;
+    uint16_t        var1 = 0x3456;
+    uint8_t         var2[20];
+    uint8_t         rd0 = 0;
+    uint16_t        rd1 = 0;
+    uint8_t         rd2[sizeof(var2)];
+    TBusVarHdl      hdl[3];
+    TBusVarResult   result;
+    int             i;
+
+    for (i = 0; i < sizeof(var2); i++) {
+        var2[i] = i;
+    }
+    memset(rd2, 0, sizeof(rd2));
+    BusVarInit(66, 0);
+    if (!BusVarAdd(0, sizeof(var0), false) ||
+        !BusVarAdd(1, sizeof(var1), false) ||
+        !BusVarAdd(2, sizeof(var2), false)) {
+        return -1;
+    }
+    BusVarWrite(0, &var0, sizeof(var0), &result);
+    BusVarWrite(1, &var1, sizeof(var1), &result);
+    BusVarWrite(2, var2, sizeof(var2), &result);
+
+    hdl[0] = BusVarTransactionOpen(67, 0, &rd0, sizeof(rd0), eBusVarRead);
+    hdl[1] = BusVarTransactionOpen(67, 1, &rd1, sizeof(rd1), eBusVarRead);
+    hdl[2] = BusVarTransactionOpen(67, 2, rd2, sizeof(rd2), eBusVarRead);
+    if ((VarBulkExchange(eBusDevReqGetVarBulk, hdl, 3) != 0) ||
+        (rd0 != var0) || (rd1 != var1) || (memcmp(rd2, var2, sizeof(var2)) != 0)) {
+        return -1;
+    }
+
+    rd0 = 0x78;
+    rd1 = 0x9abc;
+    hdl[0] = BusVarTransactionOpen(67, 0, &rd0, sizeof(rd0), eBusVarWrite);
+    hdl[1] = BusVarTransactionOpen(67, 1, &rd1, sizeof(rd1), eBusVarWrite);
+    if (VarBulkExchange(eBusDevReqSetVarBulk, hdl, 2) != 0) {
+        return -1;
+    }
+    BusVarRead(0, &var0, sizeof(var0), &result);
+    BusVarRead(1, &var1, sizeof(var1), &result);
+    if ((var0 != 0x78) || (var1 != 0x9abc)) {
+        return -1;
+    }
+    return 0;
+}
+
 /*-----------------------------------------------------------------------------
 *  print decoded telegrams
 */
-static int Test(void) {
+static int Test(int handle) {
 
     int             i;
     TBusTelegram    txMsg;
@@ -162,6 +852,109 @@ static int Test(void) {
 		return -1;
 	}
 
+    txMsg.type = eBusDevReqUpdDataWin;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    txMsg.msg.devBus.x.devReq.updDataWin.wordAddr = 0x4560;
+    txMsg.msg.devBus.x.devReq.updDataWin.flags = BUS_FWU_WIN_ACK_REQ | BUS_FWU_WIN_START;
+    for (i = 0; i < (BUS_FWU_PACKET_SIZE / 2); i++) {
+        txMsg.msg.devBus.x.devReq.updDataWin.data[i] = i + 0x1b0;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 3 + BUS_FWU_PACKET_SIZE) != 0) {
+        return -1;
+    }
+
+    txMsg.type = eBusDevRespUpdDataWin;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    txMsg.msg.devBus.x.devResp.updDataWin.wordAddr = 0x4580;
+    txMsg.msg.devBus.x.devResp.updDataWin.rxMask = 0x1b02;
+    txMsg.msg.devBus.x.devResp.updDataWin.window = BUS_FWU_WIN_MAX;
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 5) != 0) {
+        return -1;
+    }
+
+    txMsg.type = eBusDevReqUpdDataWinState;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    if (TestTelegram(&txMsg, MSG_SIZE2) != 0) {
+        return -1;
+    }
+
+    txMsg.type = eBusDevReqUpdEnterDiff;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    if (TestTelegram(&txMsg, MSG_SIZE2) != 0) {
+        return -1;
+    }
+
+    txMsg.type = eBusDevReqUpdPageSum;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    txMsg.msg.devBus.x.devReq.updPageSum.page = 0x1d3;
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 2) != 0) {
+        return -1;
+    }
+
+    txMsg.type = eBusDevRespUpdPageSum;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    txMsg.msg.devBus.x.devResp.updPageSum.page = 0x1d0;
+    txMsg.msg.devBus.x.devResp.updPageSum.pageWordSize = 128;
+    txMsg.msg.devBus.x.devResp.updPageSum.numPages = 480;
+    txMsg.msg.devBus.x.devResp.updPageSum.num = BUS_FWU_PAGESUM_NUM;
+    for (i = 0; i < BUS_FWU_PAGESUM_NUM; i++) {
+        txMsg.msg.devBus.x.devResp.updPageSum.crc[i] = 0xa5c3 + i * 0x1111;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 7 + BUS_FWU_PAGESUM_NUM * 2) != 0) {
+        return -1;
+    }
+
+    txMsg.type = eBusDevReqEepromReadBlock;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    txMsg.msg.devBus.x.devReq.readEepromBlock.addr = 0x3e8;
+    txMsg.msg.devBus.x.devReq.readEepromBlock.length = BUS_EEPROM_BLOCK_SIZE;
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 3) != 0) {
+        return -1;
+    }
+
+    txMsg.type = eBusDevRespEepromReadBlock;
+    txMsg.senderAddr = 67;
+    txMsg.msg.devBus.receiverAddr = 66;
+    txMsg.msg.devBus.x.devResp.readEepromBlock.addr = 0x3e8;
+    txMsg.msg.devBus.x.devResp.readEepromBlock.length = BUS_EEPROM_BLOCK_SIZE;
+    for (i = 0; i < BUS_EEPROM_BLOCK_SIZE; i++) {
+        txMsg.msg.devBus.x.devResp.readEepromBlock.data[i] = 0xf0 - i;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 3 + BUS_EEPROM_BLOCK_SIZE) != 0) {
+        return -1;
+    }
+
+    /* short block: data beyond length is not transmitted */
+    memset(&txMsg, 0xaa, sizeof(txMsg));
+    txMsg.type = eBusDevReqEepromWriteBlock;
+    txMsg.senderAddr = 66;
+    txMsg.msg.devBus.receiverAddr = 67;
+    txMsg.msg.devBus.x.devReq.writeEepromBlock.addr = 0xffe;
+    txMsg.msg.devBus.x.devReq.writeEepromBlock.length = 5;
+    for (i = 0; i < 5; i++) {
+        txMsg.msg.devBus.x.devReq.writeEepromBlock.data[i] = 0x31 + i;
+    }
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 3 + 5) != 0) {
+        return -1;
+    }
+    memset(&txMsg, 0, sizeof(txMsg));
+
+    txMsg.type = eBusDevRespEepromWriteBlock;
+    txMsg.senderAddr = 67;
+    txMsg.msg.devBus.receiverAddr = 66;
+    txMsg.msg.devBus.x.devResp.writeEepromBlock.addr = 0xffe;
+    txMsg.msg.devBus.x.devResp.writeEepromBlock.length = 2;
+    if (TestTelegram(&txMsg, MSG_SIZE2 + 3) != 0) {
+        return -1;
+    }
+
     txMsg.type = eBusDevRespInfo;
     txMsg.senderAddr = 66;
     txMsg.msg.devBus.receiverAddr = 67;
@@ -537,9 +1330,42 @@ static int Test(void) {
 		return -1;
 	}
 
+    if (TestBatch() != 0) {
+        return -1;
+    }
+
+    if (TestTxQueue(handle) != 0) {
+        return -1;
+    }
+
+    if (TestRxTimestamp() != 0) {
+        return -1;
+    }
+
+    if (TestSetValueMulti() != 0) {
+        return -1;
+    }
+
+    if (TestVarBulk() != 0) {
+        return -1;
+    }
+
+    if (TestActValDelta() != 0) {
+        return -1;
+    }
+
+    if (TestActValFanout() != 0) {
+        return -1;
+    }
+
+    if (TestActValClients() != 0) {
+        return -1;
+    }
+
 	return 0;
 }
 
+#if 0
 /*-----------------------------------------------------------------------------
 *  NV memory for persist bus variables
 */
@@ -563,6 +1389,7 @@ static bool BusVarNv(uint16_t address, void *buf, uint8_t bufSize, TBusVarDir di
     }
     return true;
 }
+#endif
 
 /*-----------------------------------------------------------------------------
 *  main
@@ -605,7 +1432,7 @@ int main(int argc, char *argv[]) {
     }
 
     BusInit(handle);
-#if 1
+#if 0
     BusVarInit(67, BusVarNv);
 
     {
@@ -677,7 +1504,7 @@ int main(int argc, char *argv[]) {
     return 0;
 #endif
 
-    if (Test() == 0) {
+    if (Test(handle) == 0) {
     	printf("OK\n");
     } else {
     	printf("ERROR\n");
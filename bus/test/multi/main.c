@@ -0,0 +1,271 @@
+/*
+ * main.c
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+/*
+ * test for the bus context API
+ * several bus lines are used in parallel, one thread per line. Every line is
+ * a pty pair: the bus side is opened with SioOpen, the thread echoes the
+ * master side itself. The test is run for all baud rates of TSioBaud.
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <termios.h>
+#include <pthread.h>
+
+#include "sio.h"
+#include "bus.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define NUM_LINES        3   /* sio/linux supports max. 4 handles */
+#define NUM_TX           200
+#define RX_TIMEOUT_MS    1000
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+typedef struct {
+   TSioBaud      baud;
+   speed_t       speed;
+   unsigned long rate;
+} TBaud;
+
+typedef struct {
+   int       lineNr;
+   int       masterFd;
+   int       sioHandle;
+   pthread_t thread;
+   int       numOk;
+   int       numErr;
+} TLine;
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+static TLine sLine[NUM_LINES];
+
+static const TBaud sBaud[] = {
+   { eSioBaud9600,   B9600,   9600   },
+   { eSioBaud19200,  B19200,  19200  },
+   { eSioBaud38400,  B38400,  38400  },
+   { eSioBaud57600,  B57600,  57600  },
+   { eSioBaud115200, B115200, 115200 }
+};
+
+/*-----------------------------------------------------------------------------
+*  time in ms
+*/
+static unsigned long TimeMs(void) {
+
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+/*-----------------------------------------------------------------------------
+*  open pty pair and bus side sio interface
+*/
+static int LineOpen(TLine *pLine, const TBaud *pBaud) {
+
+   const char     *pSlaveName;
+   struct termios settings;
+
+   pLine->masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+   if ((pLine->masterFd < 0) ||
+       (grantpt(pLine->masterFd) != 0) ||
+       (unlockpt(pLine->masterFd) != 0)) {
+      printf("cannot open pty\n");
+      return -1;
+   }
+   pSlaveName = ptsname(pLine->masterFd);
+   /* SioOpen is not thread safe: open all lines before starting the threads */
+   pLine->sioHandle = SioOpen(pSlaveName, pBaud->baud, eSioDataBits8,
+                              eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+   if (pLine->sioHandle == -1) {
+      printf("cannot open %s\n", pSlaveName);
+      return -1;
+   }
+   /* check the baud rate setting */
+   if ((tcgetattr(SioGetFd(pLine->sioHandle), &settings) != 0) ||
+       (cfgetispeed(&settings) != pBaud->speed) ||
+       (cfgetospeed(&settings) != pBaud->speed)) {
+      printf("wrong baud rate setting on %s\n", pSlaveName);
+      return -1;
+   }
+   pLine->numOk = 0;
+   pLine->numErr = 0;
+   return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  echo all data from master side (timeout in ms)
+*/
+static void Echo(TLine *pLine, int timeout) {
+
+   struct pollfd pfd;
+   uint8_t       buf[256];
+   int           len;
+
+   pfd.fd = pLine->masterFd;
+   pfd.events = POLLIN;
+   while (poll(&pfd, 1, timeout) > 0) {
+      len = read(pLine->masterFd, buf, sizeof(buf));
+      if (len <= 0) {
+         break;
+      }
+      if (write(pLine->masterFd, buf, len) != len) {
+         break;
+      }
+      timeout = 0;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+*  line specific telegram
+*/
+static void SetupMsg(TBusTelegram *pMsg, int lineNr, int seq) {
+
+   TBusDevReqSetVar *pSetVar;
+   int              i;
+
+   memset(pMsg, 0, sizeof(*pMsg));
+   pMsg->senderAddr = 10 + lineNr;
+   pMsg->type = eBusDevReqSetVar;
+   pMsg->msg.devBus.receiverAddr = 20 + lineNr;
+   pSetVar = &pMsg->msg.devBus.x.devReq.setVar;
+   pSetVar->index = seq % 32;
+   pSetVar->length = 1 + seq % 8;
+   for (i = 0; i < pSetVar->length; i++) {
+      /* include STX and ESC to check byte stuffing */
+      pSetVar->data[i] = (i % 2) == 0 ? 0x02 : (uint8_t)(lineNr + seq + i);
+   }
+   pSetVar->data[pSetVar->length - 1] = 0x1b;
+}
+
+/*-----------------------------------------------------------------------------
+*  thread function of one line: send telegrams and check the echoed ones
+*/
+static void *LineThread(void *pArg) {
+
+   TLine         *pLine = (TLine *)pArg;
+   TBusCtx       *pCtx;
+   TBusTelegram  txMsg;
+   TBusTelegram  *pRxMsg;
+   uint8_t       ret;
+   unsigned long start;
+   int           len;
+   int           seq;
+
+   pCtx = BusCtxOpen(pLine->sioHandle);
+   if (pCtx == 0) {
+      pLine->numErr = NUM_TX;
+      return 0;
+   }
+   pRxMsg = BusCtxMsgBufGet(pCtx);
+   for (seq = 0; seq < NUM_TX; seq++) {
+      SetupMsg(&txMsg, pLine->lineNr, seq);
+      if (BusCtxSend(pCtx, &txMsg) != BUS_SEND_OK) {
+         pLine->numErr++;
+         continue;
+      }
+      start = TimeMs();
+      do {
+         Echo(pLine, 5);
+         ret = BusCtxCheck(pCtx);
+      } while ((ret != BUS_MSG_OK) && (ret != BUS_MSG_ERROR) &&
+               ((TimeMs() - start) < RX_TIMEOUT_MS));
+
+      /* sender, type, receiver, index, length + data */
+      len = 5 + txMsg.msg.devBus.x.devReq.setVar.length;
+      if ((ret == BUS_MSG_OK) &&
+          (memcmp(pRxMsg, &txMsg, len) == 0)) {
+         pLine->numOk++;
+      } else {
+         pLine->numErr++;
+      }
+   }
+   BusCtxClose(pCtx);
+   return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  run all lines in parallel with baud rate pBaud
+*/
+static int TestBaud(const TBaud *pBaud) {
+
+   int i;
+   int rc = 0;
+
+   for (i = 0; i < NUM_LINES; i++) {
+      sLine[i].lineNr = i;
+      if (LineOpen(&sLine[i], pBaud) != 0) {
+         return -1;
+      }
+   }
+   for (i = 0; i < NUM_LINES; i++) {
+      pthread_create(&sLine[i].thread, 0, LineThread, &sLine[i]);
+   }
+   for (i = 0; i < NUM_LINES; i++) {
+      pthread_join(sLine[i].thread, 0);
+      printf("%6lu baud line %d: %d ok %d err\n", pBaud->rate, i, sLine[i].numOk, sLine[i].numErr);
+      if ((sLine[i].numOk != NUM_TX) || (sLine[i].numErr != 0)) {
+         rc = -1;
+      }
+   }
+   for (i = 0; i < NUM_LINES; i++) {
+      SioClose(sLine[i].sioHandle);
+      close(sLine[i].masterFd);
+   }
+   return rc;
+}
+
+/*-----------------------------------------------------------------------------
+*  main
+*/
+int main(int argc, char *argv[]) {
+
+   unsigned int i;
+   int          rc = 0;
+
+   SioInit();
+   for (i = 0; i < ARRAY_CNT(sBaud); i++) {
+      if (TestBaud(&sBaud[i]) != 0) {
+         rc = 1;
+      }
+   }
+
+   printf(rc == 0 ? "OK\n" : "ERROR\n");
+   return rc;
+}
@@ -41,6 +41,13 @@ typedef struct {
    TFuncOff    fOff;
 } TAccessFunc;
 
+typedef struct {
+   volatile uint8_t *pPort;
+   uint8_t          firstOut;  /* Nummer des ersten Ausgangs am Port */
+   uint8_t          bitPos;    /* Bitposition des ersten Ausgangs im Port */
+   uint8_t          portMask;  /* Bits der Ausgnge im Port */
+} TDigOutPort;
+
 typedef enum {
    eDigOutNoDelay,
    eDigOutDelayOn,
@@ -98,8 +105,13 @@ static const TAccessFunc sDigOutFuncs[NUM_DIGOUT] PROGMEM = {
    {On30, Off30}
 };
 
+static const TDigOutPort sDigOutPorts[] PROGMEM = {
+   DIGOUT_PORT_TABLE
+};
+
 static TDigoutDesc sState[eDigOutNum];
 static uint32_t    sDigOutShadow;
+static uint32_t    sDigOutDirty;  /* outputs changed since last DigOutChanged() */
           
 /*-----------------------------------------------------------------------------
 *  init
@@ -153,9 +165,12 @@ bool DigOutClearShaderFunction(TDigOutNumber number) {
 */
 void DigOutOn(TDigOutNumber number) {
 
-   TFuncOn fOn = (TFuncOn)pgm_read_word(&sDigOutFuncs[number].fOn);
+   TFuncOn  fOn = (TFuncOn)pgm_read_word(&sDigOutFuncs[number].fOn);
+   uint32_t bitMask = 1UL << (uint32_t)number;
+
    fOn();
-   sDigOutShadow |= 1UL << (uint32_t)number;
+   sDigOutDirty |= ~sDigOutShadow & bitMask;
+   sDigOutShadow |= bitMask;
 }
 
 /*-----------------------------------------------------------------------------
@@ -164,19 +179,82 @@ void DigOutOn(TDigOutNumber number) {
 void DigOutOff(TDigOutNumber number) {
 
    TFuncOff fOff = (TFuncOff)pgm_read_word(&sDigOutFuncs[number].fOff);
+   uint32_t bitMask = 1UL << (uint32_t)number;
+
    fOff();
-   sDigOutShadow &= ~(1UL << (uint32_t)number);
+   sDigOutDirty |= sDigOutShadow & bitMask;
+   sDigOutShadow &= ~bitMask;
 }
 
 /*-----------------------------------------------------------------------------
 *  alle Ausgnge ausschalten
 */
 void DigOutOffAll(void) {     
-   uint8_t i;
+   uint8_t           i;
+   const TDigOutPort *pPort;
+   volatile uint8_t  *pReg;
+   uint8_t           portMask;
+   uint8_t           flags;
+
+   /* alle Ports unabhngig vom Schattenregister schreiben (Aufruf auch bei
+    * Netzausfall im INT0-Interrupt) */
+   pPort = sDigOutPorts;
+   for (i = 0; i < ARRAY_CNT(sDigOutPorts); i++) {
+      portMask = pgm_read_byte(&pPort->portMask);
+      pReg = (volatile uint8_t *)pgm_read_word(&pPort->pPort);
+      flags = DISABLE_INT;
+      *pReg &= ~portMask;
+      RESTORE_INT(flags);
+      pPort++;
+   }
+   sDigOutDirty |= sDigOutShadow;
+   sDigOutShadow = 0;
+}
 
-   for (i = 0; i < NUM_DIGOUT; i++) {
-      DigOutOff(i);
+/*-----------------------------------------------------------------------------
+*  mehrere Ausgnge gleichzeitig schalten
+*  Ausgnge mit gesetztem Bit in mask werden auf den Zustand des Bits in state
+*  gesetzt (1 Bit pro Ausgang wie DigOutStateAll), ein Schreibzugriff je Port
+*  Verzgerungen und Rollladenfunktion werden nicht bercksichtigt
+*/
+void DigOutSet(uint32_t state, uint32_t mask) {
+   uint8_t           i;
+   const TDigOutPort *pPort;
+   volatile uint8_t  *pReg;
+   uint8_t           firstOut;
+   uint8_t           bitPos;
+   uint8_t           portMask;
+   uint8_t           changeBits;
+   uint8_t           onBits;
+   uint32_t          newShadow;
+   uint32_t          change;
+   uint8_t           flags;
+
+   mask &= (1UL << NUM_DIGOUT) - 1;
+   newShadow = (sDigOutShadow & ~mask) | (state & mask);
+   change = newShadow ^ sDigOutShadow;
+   if (change == 0) {
+      return;
+   }
+
+   pPort = sDigOutPorts;
+   for (i = 0; i < ARRAY_CNT(sDigOutPorts); i++) {
+      firstOut = pgm_read_byte(&pPort->firstOut);
+      bitPos = pgm_read_byte(&pPort->bitPos);
+      portMask = pgm_read_byte(&pPort->portMask);
+      changeBits = ((uint8_t)(change >> firstOut) << bitPos) & portMask;
+      if (changeBits != 0) {
+         onBits = ((uint8_t)(newShadow >> firstOut) << bitPos) & changeBits;
+         pReg = (volatile uint8_t *)pgm_read_word(&pPort->pPort);
+         /* Port wird auch von Einzelausgngen (sbi/cbi) geschrieben */
+         flags = DISABLE_INT;
+         *pReg = (*pReg & ~changeBits) | onBits;
+         RESTORE_INT(flags);
+      }
+      pPort++;
    }
+   sDigOutDirty |= change;
+   sDigOutShadow = newShadow;
 }
 
 /*-----------------------------------------------------------------------------
@@ -198,6 +276,20 @@ void DigOutStateAll(uint8_t *pBuf, uint8_t bufLen) {
    memcpy(pBuf, &sDigOutShadow, bufLen);
 }
 
+/*-----------------------------------------------------------------------------
+*  Maske der seit dem letzten Aufruf genderten Ausgnge lesen und lschen
+*  (1 Bit pro Ausgang wie DigOutStateAll)
+*  Rckgabe false: kein Ausgang gendert
+*/
+bool DigOutChanged(uint8_t *pBuf, uint8_t bufLen) {
+
+   uint32_t dirty = sDigOutDirty;
+
+   sDigOutDirty = 0;
+   memcpy(pBuf, &dirty, min(bufLen, sizeof(dirty)));
+   return dirty != 0;
+}
+
 /*-----------------------------------------------------------------------------
 *  alle Ausgangszustnde lesen
 *  Ausgangzustnde von Ausgngen mit Sonderfunktion (Shade, Delay-Zustand)
@@ -228,18 +320,25 @@ void DigOutStateAllStandard(uint8_t *pBuf, uint8_t bufLen) {
 *  Ausgngen zur Verringerung von Einschaltstromspitzen)
 */
 void DigOutAll(uint8_t *pBuf, uint8_t bufLen) {
-   uint8_t i;
-   uint8_t maxIdx;
+   uint8_t  i;
+   uint8_t  maxIdx;
+   uint32_t offMask = 0;
 
    maxIdx = min(bufLen * 8, NUM_DIGOUT);
+   for (i = 0; i < maxIdx; i++) {
+      if ((*(pBuf + i / 8) & (1 << (i % 8))) == 0) {
+         offMask |= 1UL << i;
+      }
+   }
+   /* ausgeschaltete Ausgnge gleichzeitig */
+   DigOutSet(0, offMask);
+
    for (i = 0; i < maxIdx; i++) {
       if ((*(pBuf + i / 8) & (1 << (i % 8))) != 0) { 
          DigOutOn(i);
          /* Verzgerung nur bei eingeschalteten Ausgngen */
          DELAY_MS(200);
-      } else {
-         DigOutOff(i);
-      }      
+      }
    }
 }
 
@@ -67,6 +67,7 @@
 #define MODUL_ADDRESS           0  /* 1 byte */
 #define CLIENT_ADDRESS_BASE     1  /* BUS_MAX_CLIENT_NUM from bus.h (16 byte) */
 #define CLIENT_RETRY_CNT        17 /* size: 16 byte (BUS_MAX_CLIENT_NUM)      */
+#define BUS_BAUD                33 /* 1 byte TSioBaud, 0xff: 9600           */
 
 #ifdef BUSVAR
 /* non volatile bus variables memory */
@@ -83,12 +84,6 @@
 
 #define IDLE_SIO1  0x01
 
-/* acual value event */
-#define RESPONSE_TIMEOUT_MS         100  /* time in ms */
-/* timeout for unreachable client  */
-#define RETRY_CYCLE_TIME_MS         200 /* time in ms */
-#define CHANGE_DETECT_CYCLE_TIME_MS 500 /* time in ms */
-
 /* timeout for doClockCalibReq */
 #define CLOCK_CALIB_TIMEOUT_MS 200 /* time in ms */
 
@@ -97,19 +92,6 @@
 /*-----------------------------------------------------------------------------
 *  Typedefs
 */
-typedef struct {
-    uint8_t  address;
-    uint8_t  maxRetry;
-    uint8_t  curRetry;
-    enum {
-        eEventInit,
-        eEventWaitForConfirmation,
-        eEventConfirmationOK,
-        eEventMaxRetry
-    } state;
-    uint16_t requestTimeStamp;
-} TClient;
-
 typedef struct {
     enum {
         eCalibIdle,
@@ -140,12 +122,11 @@ static uint8_t       sMyAddr;
 
 static uint8_t   sIdle = 0;
 
-static TClient sClient[BUS_MAX_CLIENT_NUM];
-static uint8_t sNumClients;
+static TBusEvent sEvent;
 
 static uint8_t sOldDigOutActVal[BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE];
-static uint8_t sCurDigOutActVal[BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE];
-static uint8_t sCurShaderActVal[BUS_DO31_SHADER_SIZE_ACTUAL_VALUE];
+static TBusDevActualValueDo31 sCurActVal;
+static TBusDevActualValueDo31 sPrevActVal; /* image of previous event */
 
 static TClockCalib sClockCalib;
 
@@ -161,12 +142,14 @@ static void ButtonEvent(uint8_t address, uint8_t button);
 static void SwitchEvent(uint8_t address, uint8_t button, bool pressed);
 static void Sw8SwitchEvent(uint8_t address, uint8_t state);
 static void ProcessBus(uint8_t ret);
+static void SetValue(const TBusDevSetValueDo31 *pSetValue);
 static void RestoreDigOut(void);
 static void Idle(void);
 static void IdleSio1(bool setIdle);
 static void BusTransceiverPowerDown(bool powerDown);
 static void CheckEvent(void);
 static void GetClientListFromEeprom(void);
+static uint8_t EepromBlockLen(uint16_t addr, uint8_t len);
 static void ClockCalibTask(void);
 #ifdef BUSVAR
 static bool BusVarNv(uint16_t address, void *buf, uint8_t bufSize, TBusVarDir dir);
@@ -200,9 +183,14 @@ int main(void) {
    SioInit();
    SioRandSeed(sMyAddr);
 
-   /* sio for bus interface */
-   sioHdl = SioOpen("USART1", eSioBaud9600, eSioDataBits8, eSioParityNo,
-                    eSioStopBits1, eSioModeHalfDuplex);
+   /* sio for bus interface, baud rate from EEPROM (9600 if not possible,
+    * the bootloader always uses 9600) */
+   sioHdl = SioOpen("USART1", eeprom_read_byte((const uint8_t *)BUS_BAUD),
+                    eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+   if (sioHdl == -1) {
+      sioHdl = SioOpen("USART1", eSioBaud9600, eSioDataBits8, eSioParityNo,
+                       eSioStopBits1, eSioModeHalfDuplex);
+   }
 
    SioSetIdleFunc(sioHdl, IdleSio1);
    SioSetTransceiverPowerDownFunc(sioHdl, BusTransceiverPowerDown);
@@ -248,6 +236,23 @@ int main(void) {
    return 0;
 }
 
+/*-----------------------------------------------------------------------------
+*  length of block eeprom access, limited to telegram size and eeprom end
+*/
+static uint8_t EepromBlockLen(uint16_t addr, uint8_t len) {
+
+    if (addr > E2END) {
+        return 0;
+    }
+    if (len > BUS_EEPROM_BLOCK_SIZE) {
+        len = BUS_EEPROM_BLOCK_SIZE;
+    }
+    if (len > (E2END - addr + 1)) {
+        len = (uint8_t)(E2END - addr + 1);
+    }
+    return len;
+}
+
 #ifdef BUSVAR
 /*-----------------------------------------------------------------------------
 *  NV memory for persist bus variables
@@ -270,70 +275,20 @@ static bool BusVarNv(uint16_t address, void *buf, uint8_t bufSize, TBusVarDir di
     return true;
 }
 #endif
-/*-----------------------------------------------------------------------------
-*  get next client array index
-*  if all clients are processed 0xff is returned
-*/
-static uint8_t GetUnconfirmedClient(uint8_t actualClient) {
-
-    uint8_t  i;
-    uint8_t  nextClient;
-    TClient  *pClient;
-
-    if (actualClient >= sNumClients) {
-        return 0xff;
-    }
-
-    for (i = 0; i < sNumClients; i++) {
-        nextClient = actualClient + i +1;
-        nextClient %= sNumClients;
-        pClient = &sClient[nextClient];
-        if (pClient->state == eEventMaxRetry) {
-            continue;
-        }
-        if (pClient->state != eEventConfirmationOK) {
-            break;
-        }
-    }
-    if (i == sNumClients) {
-        /* all client's confirmations received or retry count expired */
-        nextClient = 0xff;
-    }
-    return nextClient;
-}
-
-static void InitClientState(void) {
-
-    TClient *pClient;
-    uint8_t  i;
-
-    for (i = 0, pClient = sClient; i < sNumClients; i++) {
-        pClient->state = eEventInit;
-        pClient->curRetry = 0;
-        pClient++;
-    }
-}
-
 static void GetClientListFromEeprom(void) {
 
-    TClient *pClient;
     uint8_t i;
-    uint8_t numClients;
     uint8_t clientAddr;
     uint8_t retryCnt;
 
-    for (i = 0, numClients = 0, pClient = sClient; i < BUS_MAX_CLIENT_NUM; i++) {
+    BusEventInit(&sEvent, eBusDevTypeDo31, &sCurActVal, &sPrevActVal, sizeof(sCurActVal));
+    for (i = 0; i < BUS_MAX_CLIENT_NUM; i++) {
         clientAddr = eeprom_read_byte((const uint8_t *)(CLIENT_ADDRESS_BASE + i));
         retryCnt = eeprom_read_byte((const uint8_t *)(CLIENT_RETRY_CNT + i));
         if (clientAddr != BUS_CLIENT_ADDRESS_INVALID) {
-            pClient->address = clientAddr;
-            pClient->maxRetry = retryCnt;
-            pClient->state = eEventInit;
-            pClient++;
-            numClients++;
+            BusEventClientAdd(&sEvent, clientAddr, retryCnt);
         }
     }
-    sNumClients = numClients;
 }
 
 static uint8_t GetActualValueShader(uint8_t shader) {
@@ -363,105 +318,32 @@ static uint8_t GetActualValueShader(uint8_t shader) {
 */
 static void CheckEvent(void) {
 
-    static uint8_t   sActualClient = 0xff; /* actual client's index being processed */
-    static uint16_t  sChangeTestTimeStamp;
-    TClient          *pClient;
     uint8_t          i;
     uint16_t         actualTime16;
-    bool             actValChanged;
-    static bool      sNewClientCycleDelay = false;
-    static uint16_t  sNewClientCycleTimeStamp;
-    TBusDevReqActualValueEvent *pActVal;
-    bool             getNextClient;
-    uint8_t          nextClient;
-
-    if (sNumClients == 0) {
-        return;
-    }
+    uint8_t          changed[BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE];
 
-    /* do the change detection not in each cycle */
-    GET_TIME_MS16(actualTime16);
-    if (((uint16_t)(actualTime16 - sChangeTestTimeStamp)) >= CHANGE_DETECT_CYCLE_TIME_MS) {
-        DigOutStateAll(sCurDigOutActVal, sizeof(sCurDigOutActVal));
-        if (memcmp(sCurDigOutActVal, sOldDigOutActVal, sizeof(sCurDigOutActVal)) == 0) {
-            actValChanged = false;
-        } else {
-            actValChanged = true;
-        }
-
-        if (actValChanged) {
-            for (i = 0; i < sizeof(sCurShaderActVal); i++) {
-                sCurShaderActVal[i] = GetActualValueShader(i);
-            }
-            memcpy(sOldDigOutActVal, sCurDigOutActVal, sizeof(sOldDigOutActVal));
-            sActualClient = 0;
-            sNewClientCycleDelay = false;
-            InitClientState();
-        }
-        sChangeTestTimeStamp = actualTime16;
-    }
-
-    if (sActualClient == 0xff) {
+    if (sEvent.numClients == 0) {
         return;
     }
 
-    if (sNewClientCycleDelay) {
-        if (((uint16_t)(actualTime16 - sNewClientCycleTimeStamp)) < RETRY_CYCLE_TIME_MS) {
-            return;
-        } else {
-            sNewClientCycleDelay = false;
-        }
-    }
-
-    pClient = &sClient[sActualClient];
-    getNextClient = true;
-    switch (pClient->state) {
-    case eEventInit:
-        pActVal = &sTxBusMsg.msg.devBus.x.devReq.actualValueEvent;
-        sTxBusMsg.type = eBusDevReqActualValueEvent;
-        sTxBusMsg.senderAddr = MY_ADDR;
-        sTxBusMsg.msg.devBus.receiverAddr = pClient->address;
-        pActVal->devType = eBusDevTypeDo31;
-
-        memcpy(pActVal->actualValue.do31.digOut, sCurDigOutActVal,
-               sizeof(pActVal->actualValue.do31.digOut));
-        memcpy(pActVal->actualValue.do31.shader, sCurShaderActVal,
-               sizeof(pActVal->actualValue.do31.shader));
-
-        if (BusSend(&sTxBusMsg) == BUS_SEND_OK) {
-            pClient->state = eEventWaitForConfirmation;
-            pClient->requestTimeStamp = actualTime16;
-        } else {
-            getNextClient = false;
-        }
-        break;
-    case eEventWaitForConfirmation:
-        if ((((uint16_t)(actualTime16 - pClient->requestTimeStamp)) >= RESPONSE_TIMEOUT_MS) &&
-            (pClient->state != eEventMaxRetry)) {
-            if (pClient->curRetry < pClient->maxRetry) {
-                /* try again */
-                pClient->curRetry++;
-                getNextClient = false;
-                pClient->state = eEventInit;
-            } else {
-                pClient->state = eEventMaxRetry;
+    GET_TIME_MS16(actualTime16);
+    /* digout marks switched outputs: the image is compared only after a
+     * change (an output switched on and off again is no change) */
+    if (DigOutChanged(changed, sizeof(changed))) {
+        DigOutStateAll(sCurActVal.digOut, sizeof(sCurActVal.digOut));
+        if (memcmp(sCurActVal.digOut, sOldDigOutActVal, sizeof(sCurActVal.digOut)) != 0) {
+            /* the previous image is the base for delta events */
+            memcpy(sPrevActVal.digOut, sOldDigOutActVal, sizeof(sPrevActVal.digOut));
+            memcpy(sPrevActVal.shader, sCurActVal.shader, sizeof(sPrevActVal.shader));
+            for (i = 0; i < sizeof(sCurActVal.shader); i++) {
+                sCurActVal.shader[i] = GetActualValueShader(i);
             }
+            memcpy(sOldDigOutActVal, sCurActVal.digOut, sizeof(sOldDigOutActVal));
+            BusEventChanged(&sEvent);
         }
-        break;
-    case eEventConfirmationOK:
-        break;
-    default:
-        break;
     }
 
-    if (getNextClient) {
-        nextClient = GetUnconfirmedClient(sActualClient);
-        if (nextClient <= sActualClient) {
-            sNewClientCycleDelay = true;
-            sNewClientCycleTimeStamp = actualTime16;
-        }
-        sActualClient = nextClient;
-    }
+    BusEventCheck(&sEvent, &sTxBusMsg, MY_ADDR, actualTime16);
 }
 
 /*-----------------------------------------------------------------------------
@@ -574,6 +456,50 @@ static void CheckButton(void) {
    }
 }
 
+/*-----------------------------------------------------------------------------
+*  Sollwerte setzen (eBusDevReqSetValue, eBusDevReqSetValueMulti)
+*/
+static void SetValue(const TBusDevSetValueDo31 *pSetValue) {
+    uint8_t  i;
+    uint32_t state = 0;
+    uint32_t mask = 0;
+
+    for (i = 0; i < eDigOutNum; i++) {
+        /* fr Rollladenfunktion konfigurierte Ausgnge werden nicht gendert */
+        if (!DigOutGetShaderFunction(i)) {
+            uint8_t action = (pSetValue->digOut[i / 4] >>
+                             ((i % 4) * 2)) & 0x03;
+            switch (action) {
+            case 0x00:
+                break;
+            case 0x01:
+                DigOutTrigger(i);
+                break;
+            case 0x02:
+                mask |= 1UL << i;
+                break;
+            case 0x03:
+                state |= 1UL << i;
+                mask |= 1UL << i;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    /* ein Schreibzugriff je Port */
+    DigOutSet(state, mask);
+    for (i = 0; i < eShaderNum; i++) {
+        uint8_t position = pSetValue->shader[i];
+        if (position <= 100) {
+            ShaderSetPosition(i, position);
+        } else if (position == 255) {
+            // stop
+            ShaderSetAction(i, eShaderStop);
+        }
+    }
+}
+
 /*-----------------------------------------------------------------------------
 *  Verarbeitung der Bustelegramme
 */
@@ -588,18 +514,42 @@ static void ProcessBus(uint8_t ret) {
         TBusDevRespActualValue     *pActVal;
         TBusDevReqActualValueEvent *pActValEv;
     } t;
-    TClient                *pClient;
     TClockCalibState       calibState;
     static TBusTelegram    sTxMsg;
     static bool            sTxRetry = false;
+    static uint8_t         sSetValueMultiSender = BUS_CLIENT_ADDRESS_INVALID;
+    static uint8_t         sSetValueMultiSeq;
+    static bool            sSetValueMultiResp = false;
+    static uint8_t         sSetValueMultiRespAddr;
+    static uint8_t         sSetValueMultiRespSeq;
+    static uint16_t        sSetValueMultiRespTime;
+    static uint16_t        sSetValueMultiRespDelay;
+    uint16_t               actualTime16;
+    uint8_t                idx;
+    TBusDevSetValueDo31    setValue;
     uint8_t                val8;
     uint32_t               val32;
+    uint32_t               digOutState;
+    uint32_t               digOutMask;
 
     if (sTxRetry) {
         sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
         return;
     }
 
+    /* multicast set value: response in the slot of our entry */
+    if (sSetValueMultiResp && (ret != BUS_MSG_OK)) {
+        GET_TIME_MS16(actualTime16);
+        if (((uint16_t)(actualTime16 - sSetValueMultiRespTime)) >= sSetValueMultiRespDelay) {
+            sSetValueMultiResp = false;
+            sTxMsg.type = eBusDevRespSetValueMulti;
+            sTxMsg.senderAddr = MY_ADDR;
+            sTxMsg.msg.devBus.receiverAddr = sSetValueMultiRespAddr;
+            sTxMsg.msg.devBus.x.devResp.setValueMulti.seq = sSetValueMultiRespSeq;
+            sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
+        }
+    }
+
     if (ret == BUS_MSG_OK) {
         msgType = spBusMsg->type;
         switch (msgType) {
@@ -613,9 +563,12 @@ static void ProcessBus(uint8_t ret) {
         case eBusDevReqSetAddr:
         case eBusDevReqEepromRead:
         case eBusDevReqEepromWrite:
+        case eBusDevReqEepromReadBlock:
+        case eBusDevReqEepromWriteBlock:
         case eBusDevReqSetClientAddr:
         case eBusDevReqGetClientAddr:
         case eBusDevRespActualValueEvent:
+        case eBusDevRespActualValueEventDelta:
         case eBusDevReqActualValueEvent:
         case eBusDevReqClockCalib:
         case eBusDevRespDoClockCalib:
@@ -625,11 +578,19 @@ static void ProcessBus(uint8_t ret) {
         case eBusDevReqSetVar:
         case eBusDevRespGetVar:
         case eBusDevRespSetVar:
+        case eBusDevReqGetVarBulk:
+        case eBusDevReqSetVarBulk:
+        case eBusDevRespGetVarBulk:
+        case eBusDevRespSetVarBulk:
 #endif
             if (spBusMsg->msg.devBus.receiverAddr == MY_ADDR) {
                 msgForMe = true;
             }
             break;
+        case eBusDevReqSetValueMulti:
+            /* Adresse steht in der Eintragsliste */
+            msgForMe = true;
+            break;
         case eBusButtonPressed1:
         case eBusButtonPressed2:
         case eBusButtonPressed1_2:
@@ -726,6 +687,8 @@ static void ProcessBus(uint8_t ret) {
         if (spBusMsg->msg.devBus.x.devReq.setState.devType != eBusDevTypeDo31) {
             break;
         }
+        digOutState = 0;
+        digOutMask = 0;
         for (i = 0; i < eDigOutNum; i++) {
             /* fr Rollladenfunktion konfigurierte Ausgnge werden nicht gendert */
             if (!DigOutGetShaderFunction(i)) {
@@ -736,16 +699,18 @@ static void ProcessBus(uint8_t ret) {
                 case 0x01:
                     break;
                 case 0x02:
-                    DigOutOff(i);
+                    digOutMask |= 1UL << i;
                     break;
                 case 0x3:
-                    DigOutOn(i);
+                    digOutState |= 1UL << i;
+                    digOutMask |= 1UL << i;
                     break;
                 default:
                     break;
                 }
             }
         }
+        DigOutSet(digOutState, digOutMask);
         for (i = 0; i < eShaderNum; i++) {
             uint8_t action = (spBusMsg->msg.devBus.x.devReq.setState.state.do31.shader[i / 4] >>
                              ((i % 4) * 2)) & 0x03;
@@ -794,43 +759,40 @@ static void ProcessBus(uint8_t ret) {
         if (spBusMsg->msg.devBus.x.devReq.setValue.devType != eBusDevTypeDo31) {
             break;
         }
-        for (i = 0; i < eDigOutNum; i++) {
-            /* fr Rollladenfunktion konfigurierte Ausgnge werden nicht gendert */
-            if (!DigOutGetShaderFunction(i)) {
-                uint8_t action = (spBusMsg->msg.devBus.x.devReq.setValue.setValue.do31.digOut[i / 4] >>
-                                 ((i % 4) * 2)) & 0x03;
-                switch (action) {
-                case 0x00:
-                    break;
-                case 0x01:
-                    DigOutTrigger(i);
-                    break;
-                case 0x02:
-                    DigOutOff(i);
-                    break;
-                case 0x03:
-                    DigOutOn(i);
-                    break;
-                default:
-                    break;
-                }
-            }
-        }
-        for (i = 0; i < eShaderNum; i++) {
-            uint8_t position = spBusMsg->msg.devBus.x.devReq.setValue.setValue.do31.shader[i];
-            if (position <= 100) {
-                ShaderSetPosition(i, position);
-            } else if (position == 255) {
-                // stop
-                ShaderSetAction(i, eShaderStop);
-            }
-        }
+        SetValue(&spBusMsg->msg.devBus.x.devReq.setValue.setValue.do31);
         /* response packet */
         sTxMsg.type = eBusDevRespSetValue;
         sTxMsg.senderAddr = MY_ADDR;
         sTxMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
         sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
         break;
+    case eBusDevReqSetValueMulti:
+        memset(setValue.digOut, 0x00, sizeof(setValue.digOut));   /* no change */
+        memset(setValue.shader, 254, sizeof(setValue.shader));    /* no change */
+        if (!BusSetValueMultiGet(&spBusMsg->msg.devBus.x.devReq.setValueMulti, MY_ADDR,
+                                 (uint8_t *)&setValue, sizeof(setValue), sizeof(setValue.digOut),
+                                 &idx)) {
+            /* no entry for us: the next telegram of this sender is new even
+             * with the same seq */
+            if (spBusMsg->senderAddr == sSetValueMultiSender) {
+                sSetValueMultiSender = BUS_CLIENT_ADDRESS_INVALID;
+            }
+            break;
+        }
+        /* bei Wiederholung (gleiche seq) nicht nochmals ausfhren, nur besttigen */
+        if ((spBusMsg->senderAddr != sSetValueMultiSender) ||
+            (spBusMsg->msg.devBus.x.devReq.setValueMulti.seq != sSetValueMultiSeq)) {
+            sSetValueMultiSender = spBusMsg->senderAddr;
+            sSetValueMultiSeq = spBusMsg->msg.devBus.x.devReq.setValueMulti.seq;
+            SetValue(&setValue);
+        }
+        /* response delayed by the index of our entry (one slot per entry) */
+        sSetValueMultiRespAddr = spBusMsg->senderAddr;
+        sSetValueMultiRespSeq = sSetValueMultiSeq;
+        GET_TIME_MS16(sSetValueMultiRespTime);
+        sSetValueMultiRespDelay = idx * BUS_SETVALUE_MULTI_SLOT_MS;
+        sSetValueMultiResp = true;
+        break;
     case eBusDevReqActualValueEvent:
         t.pActValEv = &spBusMsg->msg.devBus.x.devReq.actualValueEvent;
         if (t.pActValEv->devType == eBusDevTypeSw8) {
@@ -879,31 +841,54 @@ static void ProcessBus(uint8_t ret) {
                           spBusMsg->msg.devBus.x.devReq.writeEeprom.data);
         sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
         break;
-    case eBusDevRespActualValueEvent:
-        pClient = sClient;
-        for (i = 0; i < sNumClients; i++) {
-            if ((pClient->address == spBusMsg->senderAddr) &&
-                (pClient->state == eEventWaitForConfirmation)) {
-                TBusDevActualValueDo31 *p;
-                uint8_t j;
-                uint8_t buf[BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE];
-
-                DigOutStateAllStandard(buf, sizeof(buf));
-
-                p = &spBusMsg->msg.devBus.x.devResp.actualValueEvent.actualValue.do31;
-                for (j = 0;
-                     (j < BUS_DO31_SHADER_SIZE_ACTUAL_VALUE) &&
-                     (p->shader[j] == GetActualValueShader(j));
-                     j++);
-                if ((j == BUS_DO31_SHADER_SIZE_ACTUAL_VALUE) &&
-                    (memcmp(p->digOut, buf, sizeof(buf)) == 0)) {
-                    pClient->state = eEventConfirmationOK;
-                }
-                break;
-            }
-            pClient++;
+    case eBusDevReqEepromReadBlock: {
+        TBusDevReqEepromReadBlock  *pReq = &spBusMsg->msg.devBus.x.devReq.readEepromBlock;
+        TBusDevRespEepromReadBlock *pResp = &sTxMsg.msg.devBus.x.devResp.readEepromBlock;
+
+        sTxMsg.senderAddr = MY_ADDR;
+        sTxMsg.type = eBusDevRespEepromReadBlock;
+        sTxMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
+        pResp->addr = pReq->addr;
+        pResp->length = EepromBlockLen(pReq->addr, pReq->length);
+        eeprom_read_block(pResp->data, (const void *)pReq->addr, pResp->length);
+        sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
+        break;
+    }
+    case eBusDevReqEepromWriteBlock: {
+        TBusDevReqEepromWriteBlock  *pReq = &spBusMsg->msg.devBus.x.devReq.writeEepromBlock;
+        TBusDevRespEepromWriteBlock *pResp = &sTxMsg.msg.devBus.x.devResp.writeEepromBlock;
+
+        sTxMsg.senderAddr = MY_ADDR;
+        sTxMsg.type = eBusDevRespEepromWriteBlock;
+        sTxMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
+        pResp->addr = pReq->addr;
+        pResp->length = EepromBlockLen(pReq->addr, pReq->length);
+        eeprom_update_block(pReq->data, (void *)pReq->addr, pResp->length);
+        sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
+        break;
+    }
+    case eBusDevRespActualValueEvent: {
+        TBusDevActualValueDo31 *p;
+        uint8_t j;
+        uint8_t buf[BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE];
+
+        DigOutStateAllStandard(buf, sizeof(buf));
+
+        p = &spBusMsg->msg.devBus.x.devResp.actualValueEvent.actualValue.do31;
+        for (j = 0;
+             (j < BUS_DO31_SHADER_SIZE_ACTUAL_VALUE) &&
+             (p->shader[j] == GetActualValueShader(j));
+             j++);
+        if ((j == BUS_DO31_SHADER_SIZE_ACTUAL_VALUE) &&
+            (memcmp(p->digOut, buf, sizeof(buf)) == 0)) {
+            BusEventConfirm(&sEvent, spBusMsg->senderAddr);
         }
         break;
+    }
+    case eBusDevRespActualValueEventDelta:
+        BusEventRespDelta(&sEvent, spBusMsg->senderAddr,
+                          &spBusMsg->msg.devBus.x.devResp.actualValueEventDelta);
+        break;
     case eBusDevReqSetClientAddr:
         sTxMsg.senderAddr = MY_ADDR;
         sTxMsg.type = eBusDevRespSetClientAddr;
@@ -1011,6 +996,28 @@ static void ProcessBus(uint8_t ret) {
     case eBusDevRespGetVar:
         BusVarRespGet(spBusMsg->senderAddr, &spBusMsg->msg.devBus.x.devResp.getVar);
         break;
+    case eBusDevReqGetVarBulk:
+        BusVarGetBulk(&spBusMsg->msg.devBus.x.devReq.getVarBulk,
+                      &sTxMsg.msg.devBus.x.devResp.getVarBulk);
+        sTxMsg.senderAddr = MY_ADDR;
+        sTxMsg.type = eBusDevRespGetVarBulk;
+        sTxMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
+        sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
+        break;
+    case eBusDevReqSetVarBulk:
+        BusVarSetBulk(&spBusMsg->msg.devBus.x.devReq.setVarBulk,
+                      &sTxMsg.msg.devBus.x.devResp.setVarBulk);
+        sTxMsg.senderAddr = MY_ADDR;
+        sTxMsg.type = eBusDevRespSetVarBulk;
+        sTxMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
+        sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
+        break;
+    case eBusDevRespSetVarBulk:
+        BusVarRespSetBulk(spBusMsg->senderAddr, &spBusMsg->msg.devBus.x.devResp.setVarBulk);
+        break;
+    case eBusDevRespGetVarBulk:
+        BusVarRespGetBulk(spBusMsg->senderAddr, &spBusMsg->msg.devBus.x.devResp.getVarBulk);
+        break;
 #endif
     case eBusDevReqGetFlashData:
         sTxMsg.senderAddr = MY_ADDR;
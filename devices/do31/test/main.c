@@ -0,0 +1,294 @@
+/*
+ * main.c - host test for the do31 digital outputs
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "sysdef.h"
+#include "board.h"
+#include "digout.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define NUM_PORT        7
+#define NUM_RANDOM_TEST 10000
+/* port bits not used by digout, must not be changed */
+#define FOREIGN_BITS    { 0x00, 0x0a, 0x00, 0x05, 0x80, 0x80, 0x18 }
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+/* required by sysdef.h and the avr register simulation (see avr/io.h) */
+volatile uint8_t  gTimeMs;
+volatile uint16_t gTimeMs16;
+volatile uint16_t gTime10Ms16;
+volatile uint32_t gTimeMs32;
+volatile uint16_t gTimeS;
+uint8_t gSimSreg;
+uint8_t gSimPort[NUM_PORT];
+
+/* port bit of each output, from the single output functions */
+static uint8_t sOutPort[NUM_DIGOUT];
+static uint8_t sOutBit[NUM_DIGOUT];
+
+static const uint8_t sForeign[NUM_PORT] = FOREIGN_BITS;
+
+/*-----------------------------------------------------------------------------
+*  Functions
+*/
+static uint32_t StateAll(void) {
+
+    uint32_t state = 0;
+
+    DigOutStateAll((uint8_t *)&state, sizeof(state));
+    return state;
+}
+
+static uint32_t Changed(void) {
+
+    uint32_t changed = 0;
+
+    DigOutChanged((uint8_t *)&changed, sizeof(changed));
+    return changed;
+}
+
+/*-----------------------------------------------------------------------------
+*  all outputs off, ports with foreign bits only
+*/
+static void Reset(void) {
+
+    DigOutOffAll();
+    Changed();
+    memcpy(gSimPort, sForeign, sizeof(gSimPort));
+}
+
+/*-----------------------------------------------------------------------------
+*  port and bit of each output, switched with DigOutOn (DIGOUT_x_ON)
+*/
+static int TestSingle(void) {
+
+    int     rc = 0;
+    uint8_t i;
+    uint8_t p;
+    uint8_t diff;
+    int     num;
+
+    for (i = 0; i < NUM_DIGOUT; i++) {
+        Reset();
+        DigOutOn(i);
+        num = 0;
+        for (p = 0; p < NUM_PORT; p++) {
+            diff = gSimPort[p] ^ sForeign[p];
+            if (diff != 0) {
+                sOutPort[i] = p;
+                sOutBit[i] = diff;
+                num++;
+            }
+        }
+        if ((num != 1) || ((sOutBit[i] & (sOutBit[i] - 1)) != 0) ||
+            (StateAll() != (1UL << i)) || (Changed() != (1UL << i))) {
+            printf("single output %d: %d ports changed\n", i, num);
+            rc = -1;
+        }
+        DigOutOff(i);
+        if (memcmp(gSimPort, sForeign, sizeof(gSimPort)) != 0) {
+            printf("single output %d: off failed\n", i);
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+/*-----------------------------------------------------------------------------
+*  port state expected for the output state
+*/
+static void ExpectedPorts(uint32_t state, uint8_t *pPort) {
+
+    uint8_t i;
+
+    memcpy(pPort, sForeign, NUM_PORT);
+    for (i = 0; i < NUM_DIGOUT; i++) {
+        if ((state & (1UL << i)) != 0) {
+            pPort[sOutPort[i]] |= sOutBit[i];
+        }
+    }
+}
+
+static int CheckPorts(const char *pName, uint32_t state) {
+
+    uint8_t expected[NUM_PORT];
+    int     p;
+
+    ExpectedPorts(state, expected);
+    if ((StateAll() != state) || (memcmp(gSimPort, expected, sizeof(expected)) != 0)) {
+        printf("%s: state %08x expected %08x\n", pName, StateAll(), state);
+        for (p = 0; p < NUM_PORT; p++) {
+            printf("  port %d: %02x expected %02x\n", p, gSimPort[p], expected[p]);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  DigOutSet with random state and mask, mixed with single output switching
+*/
+static int TestSet(void) {
+
+    int      i;
+    uint32_t state;
+    uint32_t mask;
+    uint32_t old;
+    uint32_t expected;
+    uint32_t changed;
+    uint8_t  out;
+
+    Reset();
+    DigOutSet(0xffffffff, 0xffffffff);
+    if (CheckPorts("all on", (1UL << NUM_DIGOUT) - 1) != 0) {
+        return -1;
+    }
+    DigOutSet(0, 0xffffffff);
+    if (CheckPorts("all off", 0) != 0) {
+        return -1;
+    }
+    Changed();
+
+    for (i = 0; i < NUM_RANDOM_TEST; i++) {
+        old = StateAll();
+        if ((i % 4) == 0) {
+            out = rand() % NUM_DIGOUT;
+            DigOutToggle(out);
+            expected = old ^ (1UL << out);
+        } else {
+            state = ((uint32_t)rand() << 16) ^ rand();
+            mask = ((uint32_t)rand() << 16) ^ rand();
+            if ((i % 3) == 0) {
+                /* few outputs */
+                mask &= mask >> 7;
+            }
+            DigOutSet(state, mask);
+            expected = ((old & ~mask) | (state & mask)) & ((1UL << NUM_DIGOUT) - 1);
+        }
+        if (CheckPorts("set", expected) != 0) {
+            return -1;
+        }
+        changed = Changed();
+        if (changed != (old ^ expected)) {
+            printf("set: changed %08x expected %08x\n", changed, old ^ expected);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  DigOutOffAll switches off all outputs, also if the ports differ from the
+*  output state (the power fail interrupt must not rely on it)
+*/
+static int TestOffAll(void) {
+
+    uint8_t i;
+
+    Reset();
+    DigOutSet(0x00f0f0f0, 0x00f0f0f0);
+    Changed();
+    for (i = 0; i < NUM_DIGOUT; i++) {
+        gSimPort[sOutPort[i]] |= sOutBit[i];
+    }
+    DigOutOffAll();
+    if ((memcmp(gSimPort, sForeign, sizeof(gSimPort)) != 0) ||
+        (StateAll() != 0) || (Changed() != 0x00f0f0f0)) {
+        printf("off all failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  delayed outputs are switched by DigOutStateCheck after DigOutSet
+*/
+static void Run(uint32_t ms) {
+
+    uint32_t end = gTimeMs32 + ms;
+    uint8_t  i;
+
+    while (gTimeMs32 != end) {
+        gTimeMs32++;
+        gTimeMs = (uint8_t)gTimeMs32;
+        for (i = 0; i < NUM_DIGOUT; i++) {
+            DigOutStateCheck();
+        }
+    }
+}
+
+static int TestDelayed(void) {
+
+    int     rc = 0;
+    uint8_t buf[4];
+
+    Reset();
+    DigOutDelayedOn(3, 100);
+    DigOutTrigger(20);
+    DigOutSet(0x01000f00, 0x01000f00);
+    rc |= CheckPorts("delayed start", 0x01100f00);
+    Run(99);
+    rc |= CheckPorts("delayed on wait", 0x01100f00);
+    Run(1);
+    rc |= CheckPorts("delayed on", 0x01100f08);
+    Run(900);
+    rc |= CheckPorts("trigger end", 0x01000f08);
+    if (DigOutIsDelayed(3) || DigOutIsDelayed(20)) {
+        printf("delay state not cleared\n");
+        rc = -1;
+    }
+
+    /* DigOutAll without switched on outputs (no switch on delay) */
+    memset(buf, 0, sizeof(buf));
+    DigOutAll(buf, sizeof(buf));
+    rc |= CheckPorts("all", 0);
+
+    return rc;
+}
+
+/*-----------------------------------------------------------------------------
+*  program start
+*/
+int main(void) {
+
+    int rc = 0;
+
+    srand(1);
+    DigOutInit();
+    rc |= TestSingle();
+    rc |= TestSet();
+    rc |= TestOffAll();
+    rc |= TestDelayed();
+
+    printf(rc == 0 ? "OK\n" : "ERROR\n");
+    return rc;
+}
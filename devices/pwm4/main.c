@@ -54,6 +54,7 @@
 #define MODUL_ADDRESS           0  /* 1 byte */
 #define CLIENT_ADDRESS_BASE     1  /* BUS_MAX_CLIENT_NUM from bus.h (16 byte) */
 #define CLIENT_RETRY_CNT        17 /* size: 16 byte (BUS_MAX_CLIENT_NUM)      */
+#define BUS_BAUD                33 /* 1 byte TSioBaud, 0xff: 9600           */
 
 /* DO restore after power fail */
 #define EEPROM_PWM_RESTORE_START  (uint8_t *)512
@@ -65,29 +66,10 @@
 #define IDLE_SIO1  0x01
 
 /* acual value event */
-#define RESPONSE_TIMEOUT_MS         100  /* time in ms */
-/* timeout for unreachable client  */
-#define RETRY_CYCLE_TIME_MS         200 /* time in ms */
 #define CHANGE_DETECT_CYCLE_TIME_MS 500 /* time in ms */
 
 #define MAX_FIRMWARE_SIZE           (28UL * 1024UL)
 
-/*-----------------------------------------------------------------------------
-*  Typedefs
-*/
-typedef struct {
-    uint8_t  address;
-    uint8_t  maxRetry;
-    uint8_t  curRetry;
-    enum {
-        eEventInit,
-        eEventWaitForConfirmation,
-        eEventConfirmationOK,
-        eEventMaxRetry
-    } state;
-    uint16_t requestTimeStamp;
-} TClient;
-
 /*-----------------------------------------------------------------------------
 *  Variables
 */
@@ -105,11 +87,12 @@ static uint8_t       sMyAddr;
 
 static uint8_t       sIdle = 0;
 
-static TClient       sClient[BUS_MAX_CLIENT_NUM];
-static uint8_t       sNumClients;
+static TBusEvent     sEvent;
 
 static uint16_t      sOldPwmActVal[NUM_PWM_CHANNEL];
 static bool          sOldPwmState[NUM_PWM_CHANNEL];
+static TBusDevActualValuePwm4 sCurActVal;
+static TBusDevActualValuePwm4 sPrevActVal; /* image of previous event */
 
 /*-----------------------------------------------------------------------------
 *  Functions
@@ -121,6 +104,7 @@ static void CheckButton(void);
 static void ButtonEvent(uint8_t address, uint8_t button);
 static void SwitchEvent(uint8_t address, uint8_t button, bool pressed);
 static void ProcessBus(uint8_t ret);
+static void SetValue(const TBusDevSetValuePwm4 *pSetValue);
 static void RestorePwm(void);
 static void Idle(void);
 static void IdleSio1(bool setIdle);
@@ -153,9 +137,14 @@ int main(void) {
    SioInit();
    SioRandSeed(sMyAddr);
 
-   /* sio for bus interface */
-   sioHdl = SioOpen("USART1", eSioBaud9600, eSioDataBits8, eSioParityNo,
-                    eSioStopBits1, eSioModeHalfDuplex);
+   /* sio for bus interface, baud rate from EEPROM (9600 if not possible,
+    * the bootloader always uses 9600) */
+   sioHdl = SioOpen("USART1", eeprom_read_byte((const uint8_t *)BUS_BAUD),
+                    eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+   if (sioHdl == -1) {
+      sioHdl = SioOpen("USART1", eSioBaud9600, eSioDataBits8, eSioParityNo,
+                       eSioStopBits1, eSioModeHalfDuplex);
+   }
 
    SioSetIdleFunc(sioHdl, IdleSio1);
    SioSetTransceiverPowerDownFunc(sioHdl, BusTransceiverPowerDown);
@@ -191,70 +180,20 @@ int main(void) {
    return 0;
 }
 
-/*-----------------------------------------------------------------------------
-*  get next client array index
-*  if all clients are processed 0xff is returned
-*/
-static uint8_t GetUnconfirmedClient(uint8_t actualClient) {
-
-    uint8_t  i;
-    uint8_t  nextClient;
-    TClient  *pClient;
-
-    if (actualClient >= sNumClients) {
-        return 0xff;
-    }
-   
-    for (i = 0; i < sNumClients; i++) {
-        nextClient = actualClient + i +1;
-        nextClient %= sNumClients;
-        pClient = &sClient[nextClient];
-        if (pClient->state == eEventMaxRetry) {
-            continue;
-        }
-        if (pClient->state != eEventConfirmationOK) {
-            break;
-        }
-    }
-    if (i == sNumClients) {
-        /* all client's confirmations received or retry count expired */
-        nextClient = 0xff;
-    }
-    return nextClient;
-}
-
-static void InitClientState(void) {
-
-    TClient *pClient;
-    uint8_t  i;
-
-    for (i = 0, pClient = sClient; i < sNumClients; i++) {
-        pClient->state = eEventInit;
-        pClient->curRetry = 0;
-        pClient++;
-    }
-}
-
 static void GetClientListFromEeprom(void) {
 
-    TClient *pClient;
     uint8_t i;
-    uint8_t numClients;
     uint8_t clientAddr;
     uint8_t retryCnt;
 
-    for (i = 0, numClients = 0, pClient = sClient; i < BUS_MAX_CLIENT_NUM; i++) {
+    BusEventInit(&sEvent, eBusDevTypePwm4, &sCurActVal, &sPrevActVal, sizeof(sCurActVal));
+    for (i = 0; i < BUS_MAX_CLIENT_NUM; i++) {
         clientAddr = eeprom_read_byte((const uint8_t *)(CLIENT_ADDRESS_BASE + i));
         retryCnt = eeprom_read_byte((const uint8_t *)(CLIENT_RETRY_CNT + i));
         if (clientAddr != BUS_CLIENT_ADDRESS_INVALID) {
-            pClient->address = clientAddr;
-            pClient->maxRetry = retryCnt;
-            pClient->state = eEventInit;
-            pClient++;
-            numClients++;
+            BusEventClientAdd(&sEvent, clientAddr, retryCnt);
         }
     }
-    sNumClients = numClients;
 }
 
 /*-----------------------------------------------------------------------------
@@ -262,22 +201,14 @@ static void GetClientListFromEeprom(void) {
 */
 static void CheckEvent(void) {
 
-    static uint8_t   sActualClient = 0xff; /* actual client's index being processed */
     static uint16_t  sChangeTestTimeStamp;
-    TClient          *pClient;
     uint16_t         actualTime16;
-    bool             actValChanged;
-    static bool      sNewClientCycleDelay = false;
-    static uint16_t  sNewClientCycleTimeStamp;
-    TBusDevReqActualValueEvent *pActVal;
-    bool             getNextClient;
-    uint8_t          nextClient;
     static uint16_t  sCurPwmActVal[NUM_PWM_CHANNEL];
     static bool      sCurPwmState[NUM_PWM_CHANNEL];
     uint8_t          i;
     uint8_t          val8;
 
-    if (sNumClients == 0) {
+    if (sEvent.numClients == 0) {
         return;
     }
 
@@ -288,87 +219,24 @@ static void CheckEvent(void) {
         for (i = 0; i < NUM_PWM_CHANNEL; i++) {
             PwmIsOn(i, &sCurPwmState[i]);
         }
-        if ((memcmp(sCurPwmActVal, sOldPwmActVal, sizeof(sCurPwmActVal)) == 0) && 
-            (memcmp(sCurPwmState,  sOldPwmState,  sizeof(sCurPwmActVal)) == 0)) {
-            actValChanged = false;
-        } else {
-            actValChanged = true;
-        }
-        
-        if (actValChanged) {
+        if ((memcmp(sCurPwmActVal, sOldPwmActVal, sizeof(sCurPwmActVal)) != 0) ||
+            (memcmp(sCurPwmState,  sOldPwmState,  sizeof(sCurPwmState)) != 0)) {
             memcpy(sOldPwmActVal, sCurPwmActVal, sizeof(sOldPwmActVal));
             memcpy(sOldPwmState,  sCurPwmState,  sizeof(sOldPwmState));
-            sActualClient = 0;
-            sNewClientCycleDelay = false;
-            InitClientState();
+            /* the previous image is the base for delta events */
+            sPrevActVal = sCurActVal;
+            memcpy(sCurActVal.pwm, sCurPwmActVal, sizeof(sCurActVal.pwm));
+            val8 = 0;
+            for (i = 0; i < NUM_PWM_CHANNEL; i++) {
+                val8 |= sCurPwmState[i] ? 1 << i : 0;
+            }
+            sCurActVal.state = val8;
+            BusEventChanged(&sEvent);
         }
         sChangeTestTimeStamp = actualTime16;
     }
 
-    if (sActualClient == 0xff) {
-        return;
-    }
-
-    if (sNewClientCycleDelay) {
-        if (((uint16_t)(actualTime16 - sNewClientCycleTimeStamp)) < RETRY_CYCLE_TIME_MS) {
-            return;
-        } else {
-            sNewClientCycleDelay = false;
-        }
-    }
-
-    pClient = &sClient[sActualClient];
-    getNextClient = true;
-    switch (pClient->state) {
-    case eEventInit:
-        pActVal = &sTxBusMsg.msg.devBus.x.devReq.actualValueEvent;
-        sTxBusMsg.type = eBusDevReqActualValueEvent;
-        sTxBusMsg.senderAddr = MY_ADDR;
-        sTxBusMsg.msg.devBus.receiverAddr = pClient->address;
-        pActVal->devType = eBusDevTypePwm4;
-    
-        memcpy(pActVal->actualValue.pwm4.pwm, sCurPwmActVal, 
-               sizeof(pActVal->actualValue.pwm4.pwm));
-        val8 = 0;
-        for (i = 0; i < NUM_PWM_CHANNEL; i++) {
-            val8 |= sCurPwmState[i] ? 1 << i : 0;
-        }
-        pActVal->actualValue.pwm4.state = val8;
-        
-        if (BusSend(&sTxBusMsg) == BUS_SEND_OK) {
-            pClient->state = eEventWaitForConfirmation;
-            pClient->requestTimeStamp = actualTime16;
-        } else {
-            getNextClient = false;
-        }
-        break;
-    case eEventWaitForConfirmation:
-        if ((((uint16_t)(actualTime16 - pClient->requestTimeStamp)) >= RESPONSE_TIMEOUT_MS) &&
-            (pClient->state != eEventMaxRetry)) {
-            if (pClient->curRetry < pClient->maxRetry) {
-                /* try again */
-                pClient->curRetry++;
-                getNextClient = false;
-                pClient->state = eEventInit;
-            } else {
-                pClient->state = eEventMaxRetry;
-            }
-        }
-        break;
-    case eEventConfirmationOK:
-        break;
-    default:
-        break;
-    }
-    
-    if (getNextClient) {
-        nextClient = GetUnconfirmedClient(sActualClient);
-        if (nextClient <= sActualClient) {
-            sNewClientCycleDelay = true;
-            sNewClientCycleTimeStamp = actualTime16;
-        }
-        sActualClient = nextClient;
-    }
+    BusEventCheck(&sEvent, &sTxBusMsg, MY_ADDR, actualTime16);
 }
 
 /*-----------------------------------------------------------------------------
@@ -500,6 +368,40 @@ static void CheckButton(void) {
    }
 }
 
+/*-----------------------------------------------------------------------------
+*  set outputs (eBusDevReqSetValue, eBusDevReqSetValueMulti)
+*/
+static void SetValue(const TBusDevSetValuePwm4 *pSetValue) {
+    uint8_t i;
+    uint8_t mask8;
+    uint8_t action;
+
+    mask8 = pSetValue->set;
+    for (i = 0; i < NUM_PWM_CHANNEL; i++) {
+        action = (0x3 << (i * 2) & mask8) >> (i * 2);
+        switch (action) {
+        case 0x00:
+            /* no action, ignore pwm[] from telegram */
+            break;
+        case 0x01:
+            /* set current pwm, ignore pwm[] from telegram */
+            PwmOn(i, true);
+            break;
+        case 0x02:
+            /* set to pwm[] from telegram */
+            PwmSet(i, pSetValue->pwm[i]);
+            PwmOn(i, true);
+            break;
+        case 0x03:
+            /* off, ignore pwm[] from telegram  */
+            PwmOn(i, false);
+            break;
+        default:
+            break;
+        }    
+    }
+}
+
 /*-----------------------------------------------------------------------------
 *  process bus telegrams
 */
@@ -508,13 +410,20 @@ static void ProcessBus(uint8_t ret) {
     uint8_t                i;
     bool                   msgForMe = false;
     uint8_t                state;
-    uint8_t                mask8;
-    uint8_t                action;
     TBusDevRespInfo        *pInfo;
     TBusDevRespActualValue *pActVal;
-    TClient                *pClient;
     static TBusTelegram    sTxMsg;
     static bool            sTxRetry = false;
+    static uint8_t         sSetValueMultiSender = BUS_CLIENT_ADDRESS_INVALID;
+    static uint8_t         sSetValueMultiSeq;
+    static bool            sSetValueMultiResp = false;
+    static uint8_t         sSetValueMultiRespAddr;
+    static uint8_t         sSetValueMultiRespSeq;
+    static uint16_t        sSetValueMultiRespTime;
+    static uint16_t        sSetValueMultiRespDelay;
+    uint16_t               actualTime16;
+    uint8_t                idx;
+    TBusDevSetValuePwm4    setValue;
     bool                   flag;
     uint8_t                val8;
     uint32_t               val32;
@@ -524,6 +433,19 @@ static void ProcessBus(uint8_t ret) {
         return;
     }
 
+    /* multicast set value: response in the slot of our entry */
+    if (sSetValueMultiResp && (ret != BUS_MSG_OK)) {
+        GET_TIME_MS16(actualTime16);
+        if (((uint16_t)(actualTime16 - sSetValueMultiRespTime)) >= sSetValueMultiRespDelay) {
+            sSetValueMultiResp = false;
+            sTxMsg.type = eBusDevRespSetValueMulti;
+            sTxMsg.senderAddr = MY_ADDR;
+            sTxMsg.msg.devBus.receiverAddr = sSetValueMultiRespAddr;
+            sTxMsg.msg.devBus.x.devResp.setValueMulti.seq = sSetValueMultiRespSeq;
+            sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
+        }
+    }
+
     if (ret == BUS_MSG_OK) {
         msgType = spBusMsg->type;
         switch (msgType) {
@@ -538,11 +460,16 @@ static void ProcessBus(uint8_t ret) {
         case eBusDevReqSetClientAddr:
         case eBusDevReqGetClientAddr:
         case eBusDevRespActualValueEvent:
+        case eBusDevRespActualValueEventDelta:
         case eBusDevReqGetFlashData:
             if (spBusMsg->msg.devBus.receiverAddr == MY_ADDR) {
                 msgForMe = true;
             }
             break;
+        case eBusDevReqSetValueMulti:
+            /* my address is in the entry list */
+            msgForMe = true;
+            break;
         case eBusButtonPressed1:
         case eBusButtonPressed2:
         case eBusButtonPressed1_2:
@@ -609,36 +536,41 @@ static void ProcessBus(uint8_t ret) {
         if (spBusMsg->msg.devBus.x.devReq.setValue.devType != eBusDevTypePwm4) {
             break;
         }
-        mask8 = spBusMsg->msg.devBus.x.devReq.setValue.setValue.pwm4.set;
-        for (i = 0; i < NUM_PWM_CHANNEL; i++) {
-            action = (0x3 << (i * 2) & mask8) >> (i * 2);
-            switch (action) {
-            case 0x00:
-                /* no action, ignore pwm[] from telegram */
-                break;
-            case 0x01:
-                /* set current pwm, ignore pwm[] from telegram */
-                PwmOn(i, true);
-                break;
-            case 0x02:
-                /* set to pwm[] from telegram */
-                PwmSet(i, spBusMsg->msg.devBus.x.devReq.setValue.setValue.pwm4.pwm[i]);
-                PwmOn(i, true);
-                break;
-            case 0x03:
-                /* off, ignore pwm[] from telegram  */
-                PwmOn(i, false);
-                break;
-            default:
-                break;
-            }    
-        }
+        SetValue(&spBusMsg->msg.devBus.x.devReq.setValue.setValue.pwm4);
         /* response packet */
         sTxMsg.type = eBusDevRespSetValue;
         sTxMsg.senderAddr = MY_ADDR;
         sTxMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
         sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
         break;
+    case eBusDevReqSetValueMulti:
+        /* no change, 'on with pwm[]' without pwm[] in entry: current pwm */
+        setValue.set = 0;
+        PwmGetAll(setValue.pwm, sizeof(setValue.pwm));
+        if (!BusSetValueMultiGet(&spBusMsg->msg.devBus.x.devReq.setValueMulti, MY_ADDR,
+                                 (uint8_t *)&setValue, sizeof(setValue), sizeof(setValue.set),
+                                 &idx)) {
+            /* no entry for us: the next telegram of this sender is new even
+             * with the same seq */
+            if (spBusMsg->senderAddr == sSetValueMultiSender) {
+                sSetValueMultiSender = BUS_CLIENT_ADDRESS_INVALID;
+            }
+            break;
+        }
+        /* retry (same seq): confirm only */
+        if ((spBusMsg->senderAddr != sSetValueMultiSender) ||
+            (spBusMsg->msg.devBus.x.devReq.setValueMulti.seq != sSetValueMultiSeq)) {
+            sSetValueMultiSender = spBusMsg->senderAddr;
+            sSetValueMultiSeq = spBusMsg->msg.devBus.x.devReq.setValueMulti.seq;
+            SetValue(&setValue);
+        }
+        /* response delayed by the index of our entry (one slot per entry) */
+        sSetValueMultiRespAddr = spBusMsg->senderAddr;
+        sSetValueMultiRespSeq = sSetValueMultiSeq;
+        GET_TIME_MS16(sSetValueMultiRespTime);
+        sSetValueMultiRespDelay = idx * BUS_SETVALUE_MULTI_SLOT_MS;
+        sSetValueMultiResp = true;
+        break;
     case eBusDevReqSwitchState:
         state = spBusMsg->msg.devBus.x.devReq.switchState.switchState;
         if ((state & 0x01) != 0) {
@@ -681,30 +613,27 @@ static void ProcessBus(uint8_t ret) {
                           spBusMsg->msg.devBus.x.devReq.writeEeprom.data);
         sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;  
         break;
-    case eBusDevRespActualValueEvent:
-        pClient = sClient;
-        for (i = 0; i < sNumClients; i++) {
-            if ((pClient->address == spBusMsg->senderAddr) &&
-                (pClient->state == eEventWaitForConfirmation)) {
-                TBusDevActualValuePwm4 *p;
-                uint16_t buf[NUM_PWM_CHANNEL];
-
-                PwmGetAll(buf, sizeof(buf));
-                val8 = 0;
-                for (i = 0; i < NUM_PWM_CHANNEL; i++) {
-                    PwmIsOn(i, &flag);
-                    val8 |= flag ? 1 << i: 0;
-                }
-                p = &spBusMsg->msg.devBus.x.devResp.actualValueEvent.actualValue.pwm4;
-                if ((memcmp(p->pwm, buf, sizeof(buf)) == 0) &&
-                    (p->state == val8)) {
-                    pClient->state = eEventConfirmationOK;
-                }
-                break;
-            }
-            pClient++;
+    case eBusDevRespActualValueEvent: {
+        TBusDevActualValuePwm4 *p;
+        uint16_t buf[NUM_PWM_CHANNEL];
+
+        PwmGetAll(buf, sizeof(buf));
+        val8 = 0;
+        for (i = 0; i < NUM_PWM_CHANNEL; i++) {
+            PwmIsOn(i, &flag);
+            val8 |= flag ? 1 << i: 0;
+        }
+        p = &spBusMsg->msg.devBus.x.devResp.actualValueEvent.actualValue.pwm4;
+        if ((memcmp(p->pwm, buf, sizeof(buf)) == 0) &&
+            (p->state == val8)) {
+            BusEventConfirm(&sEvent, spBusMsg->senderAddr);
         }
         break;
+    }
+    case eBusDevRespActualValueEventDelta:
+        BusEventRespDelta(&sEvent, spBusMsg->senderAddr,
+                          &spBusMsg->msg.devBus.x.devResp.actualValueEventDelta);
+        break;
     case eBusDevReqSetClientAddr:
         sTxMsg.senderAddr = MY_ADDR; 
         sTxMsg.type = eBusDevRespSetClientAddr;  
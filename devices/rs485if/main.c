@@ -50,6 +50,7 @@
 #define MODUL_ADDRESS           0  /* 1 byte */
 #define CLIENT_ADDRESS_BASE     1  /* BUS_MAX_CLIENT_NUM from bus.h (16 byte) */
 #define CLIENT_RETRY_CNT        17 /* size: 16 byte (BUS_MAX_CLIENT_NUM)      */
+#define BUS_BAUD                33 /* 1 byte TSioBaud, 0xff: 9600           */
 
 /* DO restore after power fail */
 #define EEPROM_DO_RESTORE_START  (uint8_t *)3072
@@ -61,9 +62,6 @@
 #define IDLE_SIO0  0x01
 
 /* acual value event */
-#define RESPONSE_TIMEOUT_MS         100  /* time in ms */
-/* timeout for unreachable client  */
-#define RETRY_CYCLE_TIME_MS         200 /* time in ms */
 #define CHANGE_DETECT_CYCLE_TIME_MS 500 /* time in ms */
 
 /* timeout for doClockCalibReq */
@@ -72,19 +70,6 @@
 /*-----------------------------------------------------------------------------
 *  Typedefs
 */
-typedef struct {
-    uint8_t  address;
-    uint8_t  maxRetry;
-    uint8_t  curRetry;
-    enum {
-        eEventInit,
-        eEventWaitForConfirmation,
-        eEventConfirmationOK,
-        eEventMaxRetry
-    } state;
-    uint16_t requestTimeStamp;
-} TClient;
-
 typedef struct {
     enum {
         eCalibIdle,
@@ -113,8 +98,10 @@ static uint8_t sMyAddr;
 
 static uint8_t sIdle = 0;
 
-static TClient sClient[BUS_MAX_CLIENT_NUM];
-static uint8_t sNumClients;
+static TBusEvent sEvent;
+
+static TBusDevActualValueRs485if sCurActVal;
+static TBusDevActualValueRs485if sPrevActVal; /* image of previous event */
 
 static TClockCalib sClockCalib;
 
@@ -165,9 +152,14 @@ int main(void) {
     SioInit();
     SioRandSeed(sMyAddr);
 
-    /* sio for bus interface */
-    sioHdl = SioOpen("USART0", eSioBaud9600, eSioDataBits8, eSioParityNo,
-                     eSioStopBits1, eSioModeHalfDuplex);
+    /* sio for bus interface, baud rate from EEPROM (9600 if not possible,
+     * the bootloader always uses 9600) */
+    sioHdl = SioOpen("USART0", eeprom_read_byte((const uint8_t *)BUS_BAUD),
+                     eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+    if (sioHdl == -1) {
+        sioHdl = SioOpen("USART0", eSioBaud9600, eSioDataBits8, eSioParityNo,
+                         eSioStopBits1, eSioModeHalfDuplex);
+    }
 
     SioSetIdleFunc(sioHdl, IdleSio0);
     SioSetTransceiverPowerDownFunc(sioHdl, BusTransceiverPowerDown);
@@ -223,70 +215,20 @@ int main(void) {
     return 0;
 }
 
-/*-----------------------------------------------------------------------------
-*  get next client array index
-*  if all clients are processed 0xff is returned
-*/
-static uint8_t GetUnconfirmedClient(uint8_t actualClient) {
-
-    uint8_t  i;
-    uint8_t  nextClient;
-    TClient  *pClient;
-
-    if (actualClient >= sNumClients) {
-        return 0xff;
-    }
-   
-    for (i = 0; i < sNumClients; i++) {
-        nextClient = actualClient + i +1;
-        nextClient %= sNumClients;
-        pClient = &sClient[nextClient];
-        if (pClient->state == eEventMaxRetry) {
-            continue;
-        }
-        if (pClient->state != eEventConfirmationOK) {
-            break;
-        }
-    }
-    if (i == sNumClients) {
-        /* all client's confirmations received or retry count expired */
-        nextClient = 0xff;
-    }
-    return nextClient;
-}
-
-static void InitClientState(void) {
-
-    TClient *pClient;
-    uint8_t  i;
-
-    for (i = 0, pClient = sClient; i < sNumClients; i++) {
-        pClient->state = eEventInit;
-        pClient->curRetry = 0;
-        pClient++;
-    }
-}
-
 static void GetClientListFromEeprom(void) {
 
-    TClient *pClient;
     uint8_t i;
-    uint8_t numClients;
     uint8_t clientAddr;
     uint8_t retryCnt;
 
-    for (i = 0, numClients = 0, pClient = sClient; i < BUS_MAX_CLIENT_NUM; i++) {
+    BusEventInit(&sEvent, eBusDevTypeRs485If, &sCurActVal, &sPrevActVal, sizeof(sCurActVal));
+    for (i = 0; i < BUS_MAX_CLIENT_NUM; i++) {
         clientAddr = eeprom_read_byte((const uint8_t *)(CLIENT_ADDRESS_BASE + i));
         retryCnt = eeprom_read_byte((const uint8_t *)(CLIENT_RETRY_CNT + i));
         if (clientAddr != BUS_CLIENT_ADDRESS_INVALID) {
-            pClient->address = clientAddr;
-            pClient->maxRetry = retryCnt;
-            pClient->state = eEventInit;
-            pClient++;
-            numClients++;
+            BusEventClientAdd(&sEvent, clientAddr, retryCnt);
         }
     }
-    sNumClients = numClients;
 }
 
 /*-----------------------------------------------------------------------------
@@ -294,21 +236,14 @@ static void GetClientListFromEeprom(void) {
 */
 static void CheckEvent(void) {
 
-    static uint8_t   sActualClient = 0xff; /* actual client's index being processed */
     static uint16_t  sChangeTestTimeStamp;
-    TClient          *pClient;
     uint16_t         actualTime16;
     bool             actValChanged;
-    static bool      sNewClientCycleDelay = false;
-    static uint16_t  sNewClientCycleTimeStamp;
-    TBusDevReqActualValueEvent *pActVal;
-    bool             getNextClient;
-    uint8_t          nextClient;
-   
-    if (sNumClients == 0) {
+
+    if (sEvent.numClients == 0) {
         return;
     }
-    
+
     /* do the change detection not in each cycle */
     GET_TIME_MS16(actualTime16);
     if (((uint16_t)(actualTime16 - sChangeTestTimeStamp)) >= CHANGE_DETECT_CYCLE_TIME_MS) {
@@ -317,71 +252,16 @@ static void CheckEvent(void) {
         } else {
             actValChanged = true;
         }
-     
+
         if (actValChanged) {
-            sActualClient = 0;
-            sNewClientCycleDelay = false;
-            InitClientState();
+            /* the previous image is the base for delta events */
+            sPrevActVal = sCurActVal;
+            BusEventChanged(&sEvent);
         }
         sChangeTestTimeStamp = actualTime16;
     }
 
-    if (sActualClient == 0xff) {
-        return;
-    }
-
-    if (sNewClientCycleDelay) {
-        if (((uint16_t)(actualTime16 - sNewClientCycleTimeStamp)) < RETRY_CYCLE_TIME_MS) {
-            return;
-        } else {
-            sNewClientCycleDelay = false;
-        }
-    }
-
-    pClient = &sClient[sActualClient];
-    getNextClient = true;
-    switch (pClient->state) {
-    case eEventInit:
-        pActVal = &sTxBusMsg.msg.devBus.x.devReq.actualValueEvent;
-        sTxBusMsg.type = eBusDevReqActualValueEvent;
-        sTxBusMsg.senderAddr = MY_ADDR;
-        sTxBusMsg.msg.devBus.receiverAddr = pClient->address;
-        pActVal->devType = eBusDevTypeRs485If;
-    
-        if (BusSend(&sTxBusMsg) == BUS_SEND_OK) {
-            pClient->state = eEventWaitForConfirmation;
-            pClient->requestTimeStamp = actualTime16;
-        } else {
-            getNextClient = false;
-        }
-        break;
-    case eEventWaitForConfirmation:
-        if ((((uint16_t)(actualTime16 - pClient->requestTimeStamp)) >= RESPONSE_TIMEOUT_MS) &&
-            (pClient->state != eEventMaxRetry)) {
-            if (pClient->curRetry < pClient->maxRetry) {
-                /* try again */
-                pClient->curRetry++;
-                getNextClient = false;
-                pClient->state = eEventInit;
-            } else {
-                pClient->state = eEventMaxRetry;
-            }
-        }
-        break;
-    case eEventConfirmationOK:
-        break;
-    default:
-        break;
-    }
-    
-    if (getNextClient) {
-        nextClient = GetUnconfirmedClient(sActualClient);
-        if (nextClient <= sActualClient) {
-            sNewClientCycleDelay = true;
-            sNewClientCycleTimeStamp = actualTime16;
-        }
-        sActualClient = nextClient;
-    }
+    BusEventCheck(&sEvent, &sTxBusMsg, MY_ADDR, actualTime16);
 }
 
 /*-----------------------------------------------------------------------------
@@ -458,7 +338,6 @@ static void ProcessBus(uint8_t ret) {
     uint8_t                state;
     TBusDevRespInfo        *pInfo;
     TBusDevRespActualValue *pActVal;
-    TClient                *pClient;
     TClockCalibState       calibState;
     static TBusTelegram    sTxMsg;
     static bool            sTxRetry = false;
@@ -482,6 +361,7 @@ static void ProcessBus(uint8_t ret) {
         case eBusDevReqSetClientAddr:
         case eBusDevReqGetClientAddr:
         case eBusDevRespActualValueEvent:
+        case eBusDevRespActualValueEventDelta:
         case eBusDevReqClockCalib:
         case eBusDevRespDoClockCalib:
             if (spBusMsg->msg.devBus.receiverAddr == MY_ADDR) {
@@ -597,16 +477,12 @@ static void ProcessBus(uint8_t ret) {
         sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;  
         break;
     case eBusDevRespActualValueEvent:
-        pClient = sClient;
-        for (i = 0; i < sNumClients; i++) {
-            if ((pClient->address == spBusMsg->senderAddr) &&
-                (pClient->state == eEventWaitForConfirmation)) {
-                /* todo: compare with current state */
-                pClient->state = eEventConfirmationOK;
-                break;
-            }
-            pClient++;
-        }
+        /* todo: compare with current state */
+        BusEventConfirm(&sEvent, spBusMsg->senderAddr);
+        break;
+    case eBusDevRespActualValueEventDelta:
+        BusEventRespDelta(&sEvent, spBusMsg->senderAddr,
+                          &spBusMsg->msg.devBus.x.devResp.actualValueEventDelta);
         break;
     case eBusDevReqSetClientAddr:
         sTxMsg.senderAddr = MY_ADDR; 
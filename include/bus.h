@@ -33,6 +33,12 @@ extern "C" {
 *  Macros
 */
 #define BUS_FWU_PACKET_SIZE    32   /* Anzahl der Bytes (geradzahlig)*/
+#define BUS_FWU_WIN_MAX        16   /* max. packets buffered by the device in windowed update */
+#define BUS_FWU_WIN_ERROR      0xffff /* wordAddr in windowed update response: programming error */
+#define BUS_FWU_WIN_ACK_REQ    0x01 /* flag: response requested */
+#define BUS_FWU_WIN_START      0x02 /* flag: discard buffered packets, window starts at page of wordAddr */
+#define BUS_FWU_PAGESUM_NUM    16   /* page checksums per response */
+#define BUS_BROADCAST_ADDR     0xff /* receiverAddr for all devices (fleet firmware update), no device address */
 #define BUS_DEV_INFO_VERSION_LEN 16 /* length of version string */
 
 #define BUS_DO31_NUM_SHADER    15   /* max. Anzahl Rollladen-Gruppen */
@@ -67,6 +73,22 @@ extern "C" {
 
 #define BUS_GETFLASH_PACKET_SIZE           32
 
+#define BUS_EEPROM_BLOCK_SIZE              44   /* max. data size in block eeprom telegrams */
+
+#define BUS_VAR_BULK_SIZE                  44   /* size of entry list in bulk var telegrams */
+
+#define BUS_SETVALUE_MULTI_SIZE            40   /* size of entry list in multicast set value */
+#define BUS_SETVALUE_MULTI_FILL            0x80 /* entry flag: data[0] is used for all output bytes */
+#define BUS_SETVALUE_MULTI_LEN_MASK        0x3f /* entry length of data[] */
+#define BUS_SETVALUE_MULTI_HDR_SIZE        2    /* entry header: address, flags/length */
+#define BUS_SETVALUE_MULTI_SLOT_MS         16   /* response delay per entry index (>= timer tick) */
+
+#define BUS_ACTVAL_DELTA_SIZE              42   /* size of entry list in delta actual value event */
+#define BUS_ACTVAL_DELTA_FULL              0x01 /* flag: entry[] contains the complete image */
+#define BUS_ACTVAL_DELTA_OK                0    /* response state: image of seq is valid */
+#define BUS_ACTVAL_DELTA_RESYNC            1    /* response state: full image required */
+#define BUS_ACTVAL_FANOUT_SIZE             46   /* size of data[] in fan-out actual value event */
+
 /* return codes for function BusCheck */
 #define BUS_NO_MSG     0
 #define BUS_MSG_OK     1
@@ -81,6 +103,10 @@ extern "C" {
 #define BUS_SEND_BAD_VARLEN    3
 #define BUS_SEND_BAD_LEN       4
 
+/* max. size of encoded telegram: STX, telegram and checksum, each character
+ * of telegram and checksum may be stuffed to 2 characters */
+#define BUS_MAX_ENCODED_SIZE   (1 + 2 * (sizeof(TBusTelegram) + 1))
+
 /*-----------------------------------------------------------------------------
 *  typedefs
 */
@@ -626,6 +652,176 @@ typedef struct {                                          /* type 0x32 */
     uint8_t  data[BUS_GETFLASH_PACKET_SIZE];
 } __attribute__ ((packed)) TBusDevRespGetFlashData;
 
+/* multicast set value: one telegram for several devices
+ * entry[] is a list of entries for each addressed device:
+ *   uint8_t address
+ *   uint8_t flags/length: bit 0..5 length of data (BUS_SETVALUE_MULTI_LEN_MASK)
+ *                         bit 7    BUS_SETVALUE_MULTI_FILL
+ *   uint8_t data[length]: start of TBusDevSetValueXxx of the device (without
+ *                         devType), missing bytes are set to 'no change'.
+ *                         with BUS_SETVALUE_MULTI_FILL data[0] is used for
+ *                         all bytes of the output field (do31/sw8 digOut,
+ *                         pwm4 set), e.g. 0xaa: all outputs off (do31, sw8)
+ * msg.devBus.receiverAddr is not used.
+ * each addressed device confirms with eBusDevRespSetValueMulti, delayed by
+ * the index of its entry * BUS_SETVALUE_MULTI_SLOT_MS (one response slot
+ * per entry). for a retry the sender repeats the telegram with the same seq
+ * containing the entries of the devices that did not confirm. a device does
+ * not apply the entry again when sender and seq are unchanged; a telegram
+ * of the same sender without entry for the device resets this state.
+ */
+typedef struct {                                          /* type 0x33 */
+    uint8_t seq;
+    uint8_t length;  /* number of bytes used in entry[] */
+    uint8_t entry[BUS_SETVALUE_MULTI_SIZE];
+} __attribute__ ((packed)) TBusDevReqSetValueMulti;
+
+typedef struct {                                          /* type 0x34 */
+    uint8_t seq;
+} __attribute__ ((packed)) TBusDevRespSetValueMulti;
+
+/* bulk var telegrams: get/set several variables of a device in one
+ * telegram. entries are packed without gaps, length is the number of
+ * bytes used in entry[].
+ */
+typedef struct {                                          /* type 0x35 */
+    uint8_t length;
+    uint8_t entry[BUS_VAR_BULK_SIZE];  /* entry: index */
+} __attribute__ ((packed)) TBusDevReqGetVarBulk;
+
+typedef struct {                                          /* type 0x36 */
+    uint8_t length;
+    uint8_t entry[BUS_VAR_BULK_SIZE];  /* entry: index, TBusVarResult, length, data[length] */
+} __attribute__ ((packed)) TBusDevRespGetVarBulk;
+
+typedef struct {                                          /* type 0x37 */
+    uint8_t length;
+    uint8_t entry[BUS_VAR_BULK_SIZE];  /* entry: index, length, data[length] */
+} __attribute__ ((packed)) TBusDevReqSetVarBulk;
+
+typedef struct {                                          /* type 0x38 */
+    uint8_t length;
+    uint8_t entry[BUS_VAR_BULK_SIZE];  /* entry: index, TBusVarResult */
+} __attribute__ ((packed)) TBusDevRespSetVarBulk;
+
+/* delta actual value event: changes of the actual value image of the
+ * device (TBusDevActualValueXxx of devType) since the previous event.
+ * entry[] is a list of (offset, value) byte pairs. with
+ * BUS_ACTVAL_DELTA_FULL entry[] contains the complete image instead.
+ * seq is incremented for each new actual value, a delta applies to the
+ * image of seq - 1 only. a client that does not have this image answers
+ * with BUS_ACTVAL_DELTA_RESYNC and the device repeats the event with the
+ * full image. the device uses eBusDevReqActualValueEvent for a client that
+ * does not answer this telegram.
+ */
+typedef struct {                                          /* type 0x39 */
+    TBusDevType devType;
+    uint8_t     seq;
+    uint8_t     flags;
+    uint8_t     length;  /* number of bytes used in entry[] */
+    uint8_t     entry[BUS_ACTVAL_DELTA_SIZE];
+} __attribute__ ((packed)) TBusDevReqActualValueEventDelta;
+
+typedef struct {                                          /* type 0x3a */
+    TBusDevType devType;
+    uint8_t     seq;
+    uint8_t     state;   /* BUS_ACTVAL_DELTA_OK, BUS_ACTVAL_DELTA_RESYNC */
+} __attribute__ ((packed)) TBusDevRespActualValueEventDelta;
+
+/* fan-out actual value event: one delta event for several clients
+ * data[] contains:
+ *   uint8_t numClients
+ *   uint8_t clientAddr[numClients]
+ *   TBusDevReqActualValueEventDelta without unused bytes of entry[]
+ * msg.devBus.receiverAddr is not used.
+ * each addressed client confirms with eBusDevRespActualValueEventDelta, the
+ * device repeats the event to each client that did not confirm with
+ * eBusDevReqActualValueEventDelta.
+ */
+typedef struct {                                          /* type 0x3b */
+    uint8_t length;  /* number of bytes used in data[] */
+    uint8_t data[BUS_ACTVAL_FANOUT_SIZE];
+} __attribute__ ((packed)) TBusDevReqActualValueEventFanout;
+
+/* windowed firmware update: several eBusDevReqUpdDataWin packets are sent
+ * without waiting for a response, the device buffers them and answers only
+ * a packet with BUS_FWU_WIN_ACK_REQ set. the response acknowledges all words
+ * below wordAddr (cumulative, programmed to flash) and the packets at
+ * wordAddr + i * BUS_FWU_PACKET_SIZE / 2 with bit i set in rxMask
+ * (selective, buffered). packets from wordAddr on are accepted up to window
+ * packets (<= BUS_FWU_WIN_MAX). wordAddr BUS_FWU_WIN_ERROR: flash error.
+ * BUS_FWU_WIN_START moves the window to the page of the packet (differential
+ * update, unchanged pages are skipped).
+ */
+typedef struct {                                          /* type 0x3c */
+    uint16_t wordAddr;
+    uint8_t  flags;  /* BUS_FWU_WIN_ACK_REQ, BUS_FWU_WIN_START */
+    uint16_t data[BUS_FWU_PACKET_SIZE / 2];
+} __attribute__ ((packed)) TBusDevReqUpdDataWin;
+
+typedef struct {                                          /* type 0x3d */
+    uint16_t wordAddr;
+    uint16_t rxMask;
+    uint8_t  window;
+} __attribute__ ((packed)) TBusDevRespUpdDataWin;
+
+/* differential firmware update: enter the update without erasing the flash,
+ * the device answers with eBusDevRespUpdEnter. the data is sent with
+ * eBusDevReqUpdDataWin, each programmed page is erased before. only pages
+ * with a different checksum (eBusDevReqUpdPageSum) are transferred.
+ */
+typedef struct {                                          /* type 0x3e */
+} __attribute__ ((packed)) TBusDevReqUpdEnterDiff;
+
+typedef struct {                                          /* type 0x3f */
+    uint16_t page;
+} __attribute__ ((packed)) TBusDevReqUpdPageSum;
+
+/* crc: CRC-CCITT (avr-libc _crc_ccitt_update, start value 0xffff) over the
+ * bytes of the flash pages page .. page + num - 1
+ */
+typedef struct {                                          /* type 0x40 */
+    uint16_t page;
+    uint16_t pageWordSize;
+    uint16_t numPages;  /* pages of the application flash */
+    uint8_t  num;
+    uint16_t crc[BUS_FWU_PAGESUM_NUM];
+} __attribute__ ((packed)) TBusDevRespUpdPageSum;
+
+/* fleet firmware update: eBusDevReqUpdDataWin to BUS_BROADCAST_ADDR is
+ * buffered by all devices in update mode and never answered. each device
+ * is polled with eBusDevReqUpdDataWinState, the response is
+ * eBusDevRespUpdDataWin (complete pages are programmed before).
+ */
+typedef struct {                                          /* type 0x41 */
+} __attribute__ ((packed)) TBusDevReqUpdDataWinState;
+
+/* block eeprom telegrams: read/write up to BUS_EEPROM_BLOCK_SIZE bytes
+ * from addr. the response length is the number of bytes read/written,
+ * it is shortened at the end of the eeprom (0: addr out of range).
+ */
+typedef struct {                                          /* type 0x42 */
+    uint16_t addr;
+    uint8_t  length;
+} __attribute__ ((packed)) TBusDevReqEepromReadBlock;
+
+typedef struct {                                          /* type 0x43 */
+    uint16_t addr;
+    uint8_t  length;
+    uint8_t  data[BUS_EEPROM_BLOCK_SIZE];
+} __attribute__ ((packed)) TBusDevRespEepromReadBlock;
+
+typedef struct {                                          /* type 0x44 */
+    uint16_t addr;
+    uint8_t  length;
+    uint8_t  data[BUS_EEPROM_BLOCK_SIZE];
+} __attribute__ ((packed)) TBusDevReqEepromWriteBlock;
+
+typedef struct {                                          /* type 0x45 */
+    uint16_t addr;
+    uint8_t  length;
+} __attribute__ ((packed)) TBusDevRespEepromWriteBlock;
+
 typedef union {
    TBusDevReqReboot           reboot;
    TBusDevReqUpdEnter         updEnter;
@@ -651,6 +847,17 @@ typedef union {
    TBusDevReqGetVar           getVar;
    TBusDevReqSetVar           setVar;
    TBusDevReqGetFlashData     getFlashData;
+   TBusDevReqSetValueMulti    setValueMulti;
+   TBusDevReqGetVarBulk       getVarBulk;
+   TBusDevReqSetVarBulk       setVarBulk;
+   TBusDevReqActualValueEventDelta actualValueEventDelta;
+   TBusDevReqActualValueEventFanout actualValueEventFanout;
+   TBusDevReqUpdDataWin       updDataWin;
+   TBusDevReqUpdEnterDiff     updEnterDiff;
+   TBusDevReqUpdPageSum       updPageSum;
+   TBusDevReqUpdDataWinState  updDataWinState;
+   TBusDevReqEepromReadBlock  readEepromBlock;
+   TBusDevReqEepromWriteBlock writeEepromBlock;
 } __attribute__ ((packed)) TUniDevReq;
 
 typedef union {
@@ -677,6 +884,14 @@ typedef union {
    TBusDevRespGetVar           getVar;
    TBusDevRespSetVar           setVar;
    TBusDevRespGetFlashData     getFlashData;
+   TBusDevRespSetValueMulti    setValueMulti;
+   TBusDevRespGetVarBulk       getVarBulk;
+   TBusDevRespSetVarBulk       setVarBulk;
+   TBusDevRespActualValueEventDelta actualValueEventDelta;
+   TBusDevRespUpdDataWin       updDataWin;
+   TBusDevRespUpdPageSum       updPageSum;
+   TBusDevRespEepromReadBlock  readEepromBlock;
+   TBusDevRespEepromWriteBlock writeEepromBlock;
 } __attribute__ ((packed)) TUniDevResp;
 
 typedef struct {
@@ -745,6 +960,25 @@ typedef enum {
    eBusDevRespSetVar =                   0x30,
    eBusDevReqGetFlashData =              0x31,
    eBusDevRespGetFlashData =             0x32,
+   eBusDevReqSetValueMulti =             0x33,
+   eBusDevRespSetValueMulti =            0x34,
+   eBusDevReqGetVarBulk =                0x35,
+   eBusDevRespGetVarBulk =               0x36,
+   eBusDevReqSetVarBulk =                0x37,
+   eBusDevRespSetVarBulk =               0x38,
+   eBusDevReqActualValueEventDelta =     0x39,
+   eBusDevRespActualValueEventDelta =    0x3a,
+   eBusDevReqActualValueEventFanout =    0x3b,
+   eBusDevReqUpdDataWin =                0x3c,
+   eBusDevRespUpdDataWin =               0x3d,
+   eBusDevReqUpdEnterDiff =              0x3e,
+   eBusDevReqUpdPageSum =                0x3f,
+   eBusDevRespUpdPageSum =               0x40,
+   eBusDevReqUpdDataWinState =           0x41,
+   eBusDevReqEepromReadBlock =           0x42,
+   eBusDevRespEepromReadBlock =          0x43,
+   eBusDevReqEepromWriteBlock =          0x44,
+   eBusDevRespEepromWriteBlock =         0x45,
    eBusDevStartup =                      0xff
 } __attribute__ ((packed)) TBusMsgType;
 
@@ -754,17 +988,113 @@ typedef struct {
    TBusUniTelegram  msg;
 } __attribute__ ((packed)) TBusTelegram;
 
+/* actual value event of a device to its clients (BusEvent, device side):
+ * the device captures the image to pCur (and the image of the previous
+ * event to pPrev) and calls BusEventChanged. BusEventCheck sends the event
+ * as fan-out to the clients with delta support and repeats it per client
+ * until confirmation or maxRetry. A client that does not answer the delta
+ * telegram gets eBusDevReqActualValueEvent.
+ */
+#define BUS_EVENT_RESPONSE_TIMEOUT_MS  100 /* time in ms */
+#define BUS_EVENT_RETRY_CYCLE_TIME_MS  200 /* time in ms */
+#define BUS_EVENT_CLIENT_NONE          0xff
+
+typedef struct {
+    uint8_t  address;
+    uint8_t  maxRetry;
+    uint8_t  curRetry;
+    enum {
+        eBusEventInit,
+        eBusEventWaitForConfirmation,
+        eBusEventConfirmationOK,
+        eBusEventMaxRetry
+    } state;
+    enum {
+        eBusEventFormatUnknown, /* delta event not confirmed yet */
+        eBusEventFormatDelta,   /* eBusDevReqActualValueEventDelta */
+        eBusEventFormatFull     /* no delta support: eBusDevReqActualValueEvent */
+    } format;
+    bool     synced;            /* client has confirmed the previous event */
+    uint16_t requestTimeStamp;
+} TBusEventClient;
+
+typedef struct {
+    TBusDevType     devType;
+    const uint8_t   *pCur;      /* actual value image */
+    const uint8_t   *pPrev;     /* image of previous event */
+    uint8_t         size;
+    uint8_t         seq;
+    TBusEventClient client[BUS_MAX_CLIENT_NUM];
+    uint8_t         numClients;
+    uint8_t         actualClient; /* index being processed, BUS_EVENT_CLIENT_NONE: done */
+    bool            fanoutPending;
+    bool            newClientCycleDelay;
+    uint16_t        newClientCycleTimeStamp;
+} TBusEvent;
+
 /*-----------------------------------------------------------------------------
 *  Functions
 */
 void           BusInit(int sioHandle);
 void           BusExit(int sioHandle);
 uint8_t        BusCheck(void);
+int            BusCheckBatch(TBusTelegram *pMsg, int maxMsg);
 TBusTelegram   *BusMsgBufGet(void);
+uint64_t       BusMsgTimeGet(void); /* linux only (BUS_RX_TIMESTAMP) */
 uint8_t        BusSend(TBusTelegram *pMsg);
 uint8_t        BusSendToBuf(TBusTelegram *pMsg);
 uint8_t        BusSendToBufRaw(uint8_t *pRawData, uint8_t len);
 uint8_t        BusSendBuf(void);
+uint8_t        BusEncode(TBusTelegram *pMsg, uint8_t *pBuf, uint8_t bufSize, uint8_t *pLen); /* BUS_CTX */
+uint8_t        BusTxPrio(TBusTelegram *pMsg); /* TSioTxPrio, not with BUS_BOOTLOADER */
+bool           BusSetValueMultiGet(const TBusDevReqSetValueMulti *pReq, uint8_t addr,
+                                   uint8_t *pSetValue, uint8_t setValueSize, uint8_t outputSize,
+                                   uint8_t *pIdx); /* BUS_SETVALUE_MULTI */
+bool           BusSetValueMultiAdd(TBusDevReqSetValueMulti *pReq, uint8_t addr,
+                                   const uint8_t *pData, uint8_t len, bool fill);
+bool           BusSetValueMultiRemove(TBusDevReqSetValueMulti *pReq, uint8_t addr);
+
+/*
+*  BusEvent: delta actual value events
+*/
+uint8_t        BusEventImageSize(TBusDevType devType);
+bool           BusEventDeltaEncode(TBusDevReqActualValueEventDelta *pEv,
+                                   const uint8_t *pOld, const uint8_t *pNew, uint8_t size);
+bool           BusEventDeltaApply(const TBusDevReqActualValueEventDelta *pEv,
+                                  uint8_t *pImage, uint8_t size);
+void           BusEventFanoutInit(TBusDevReqActualValueEventFanout *pReq);
+bool           BusEventFanoutAddClient(TBusDevReqActualValueEventFanout *pReq, uint8_t addr);
+bool           BusEventFanoutEncode(TBusDevReqActualValueEventFanout *pReq,
+                                    TBusDevType devType, uint8_t seq,
+                                    const uint8_t *pOld, const uint8_t *pNew, uint8_t size);
+bool           BusEventFanoutGet(const TBusDevReqActualValueEventFanout *pReq, uint8_t addr,
+                                 TBusDevReqActualValueEventDelta *pEv);
+void           BusEventInit(TBusEvent *pEv, TBusDevType devType,
+                            const void *pCur, const void *pPrev, uint8_t size);
+bool           BusEventClientAdd(TBusEvent *pEv, uint8_t addr, uint8_t maxRetry);
+void           BusEventChanged(TBusEvent *pEv);
+void           BusEventCheck(TBusEvent *pEv, TBusTelegram *pTxMsg, uint8_t myAddr,
+                             uint16_t actualTime16);
+void           BusEventConfirm(TBusEvent *pEv, uint8_t addr);
+void           BusEventRespDelta(TBusEvent *pEv, uint8_t addr,
+                                 const TBusDevRespActualValueEventDelta *pResp);
+
+/* bus context: state of one bus line, for use of several bus lines in
+ * parallel (e.g. one thread per line). The functions without context
+ * use a default context initialized by BusInit.
+ */
+typedef struct busCtx TBusCtx;
+
+TBusCtx        *BusCtxOpen(int sioHandle);
+void           BusCtxClose(TBusCtx *pCtx);
+uint8_t        BusCtxCheck(TBusCtx *pCtx);
+int            BusCtxCheckBatch(TBusCtx *pCtx, TBusTelegram *pMsg, int maxMsg);
+TBusTelegram   *BusCtxMsgBufGet(TBusCtx *pCtx);
+uint64_t       BusCtxMsgTimeGet(TBusCtx *pCtx);
+uint8_t        BusCtxSend(TBusCtx *pCtx, TBusTelegram *pMsg);
+uint8_t        BusCtxSendToBuf(TBusCtx *pCtx, TBusTelegram *pMsg);
+uint8_t        BusCtxSendToBufRaw(TBusCtx *pCtx, uint8_t *pRawData, uint8_t len);
+uint8_t        BusCtxSendBuf(TBusCtx *pCtx);
 
 /*
 *  BusVar
@@ -861,8 +1191,14 @@ TBusVarState BusVarTransactionState(TBusVarHdl varHdl);
 void BusVarTransactionClose(TBusVarHdl varHdl);
 void BusVarRespGet(uint8_t addr, TBusDevRespGetVar *respGet);
 void BusVarRespSet(uint8_t addr, TBusDevRespSetVar *respSet);
+void BusVarRespGetBulk(uint8_t addr, TBusDevRespGetVarBulk *respGet);
+void BusVarRespSetBulk(uint8_t addr, TBusDevRespSetVarBulk *respSet);
 void BusVarProcess(void);
 
+/* device side handling of bulk requests */
+void BusVarGetBulk(TBusDevReqGetVarBulk *reqGet, TBusDevRespGetVarBulk *respGet);
+void BusVarSetBulk(TBusDevReqSetVarBulk *reqSet, TBusDevRespSetVarBulk *respSet);
+
 #ifdef __cplusplus
 }
 #endif
@@ -84,9 +84,11 @@ void DigOutInit(void);
 void DigOutOn(TDigOutNumber number);
 void DigOutOff(TDigOutNumber number);
 void DigOutOffAll(void);
+void DigOutSet(uint32_t state, uint32_t mask);
 bool DigOutState(TDigOutNumber number);  
 void DigOutStateAll(uint8_t *pBuf, uint8_t bufLen);
 void DigOutStateAllStandard(uint8_t *pBuf, uint8_t bufLen);
+bool DigOutChanged(uint8_t *pBuf, uint8_t bufLen);
 void DigOutAll(uint8_t *pBuf, uint8_t bufLen);
 void DigOutToggle(TDigOutNumber number);
 void DigOutDelayedOn(TDigOutNumber number, uint32_t onDelayMs);
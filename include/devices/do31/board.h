@@ -151,6 +151,15 @@
 #define DIGOUT_30_ON       (PORTF |=  0b01000000)
 #define DIGOUT_30_OFF      (PORTF &= ~0b01000000)
 
+/* Ausgnge je Port fr gleichzeitiges Schalten (DigOutSet):
+ * Port, erster Ausgang, Bitposition des ersten Ausgangs, Bitmaske im Port */
+#define DIGOUT_PORT_TABLE                    \
+   { &PORTA,  0, 0, 0b11111111 },            \
+   { &PORTC,  8, 0, 0b11111111 },            \
+   { &PORTB, 16, 4, 0b11110000 },            \
+   { &PORTD, 20, 4, 0b11110000 },            \
+   { &PORTF, 24, 0, 0b01111111 }
+
 /*-----------------------------------------------------------------------------
 *  typedefs
 */
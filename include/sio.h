@@ -40,7 +40,11 @@ extern "C" {
 *  typedefs
 */
 typedef enum {
-   eSioBaud9600
+   eSioBaud9600,
+   eSioBaud19200,
+   eSioBaud38400,
+   eSioBaud57600,
+   eSioBaud115200
 } TSioBaud;
 
 typedef enum {
@@ -58,17 +62,35 @@ typedef enum {
 
 typedef enum {
    eSioModeHalfDuplex,
-   eSioModeFullDuplex
+   eSioModeFullDuplex,
+   eSioModeHalfDuplexCd  /* half duplex with collision detection: wait for idle
+                          * line, read back compare, jam and random backoff
+                          * (linux, other targets: eSioModeHalfDuplex) */
 } TSioMode;
 
 typedef void (* TBusTransceiverPowerDownFunc)(bool powerDown);
 
+/* tx priority classes: higher priority telegrams use shorter idle wait and
+ * backoff windows for bus access (avr), overtake queued telegrams (linux)
+ */
+typedef enum {
+   eSioTxPrioLow,      /* bulk transfers, polling */
+   eSioTxPrioNormal,
+   eSioTxPrioHigh      /* responses, user triggered commands */
+} TSioTxPrio;
+
+/* called when the telegram with id is written completely from tx queue */
+typedef void (* TSioTxDoneFunc)(int handle, int id);
+
 /*-----------------------------------------------------------------------------
 *  Variables
 */
 
 /*-----------------------------------------------------------------------------
 *  Functions
+*  linux: the functions of different handles may be called by different
+*  threads, but SioInit, SioExit, SioOpen and SioClose must not run
+*  concurrently with any other Sio call
 */
 
 void    SioInit(void);
@@ -84,7 +106,23 @@ void    SioSetIdleFunc(int handle, TIdleStateFunc idleFunc);
 int     SioGetFd(int handle);
 uint8_t SioWriteBuffered(int handle,  uint8_t *pBuf, uint8_t bufSize);
 bool    SioSendBuffer(int handle);
+void    SioSetTxPrio(int handle, TSioTxPrio prio);
 bool    SioHandleValid(int handle);
+/* tx queue, linux only */
+int     SioTxQueueAdd(int handle, uint8_t *pBuf, uint8_t bufSize, TSioTxPrio prio);
+int     SioTxQueueFlush(int handle);
+void    SioSetTxDoneFunc(int handle, TSioTxDoneFunc doneFunc);
+/* low latency receive with timestamp, linux only */
+bool    SioSetLowLatency(int handle, bool enable);
+uint8_t SioReadTs(int handle, uint8_t *pBuf, uint8_t bufSize, uint64_t *pTimeUs);
+/* record received characters for replay://file, linux only */
+bool    SioCaptureOpen(int handle, const char *pFileName);
+bool    SioIsReplay(int handle);
+/* buffer sizes above 255 characters, linux only */
+bool     SioSetBufSize(int handle, uint16_t rxSize, uint16_t txSize);
+uint16_t SioGetNumRxChar16(int handle);
+/* baud rate option of the tools, linux and win32 only */
+bool     SioBaudFromRate(unsigned long rate, TSioBaud *pBaud);
 
 #ifdef __cplusplus
 }
@@ -132,6 +132,8 @@ static uint8_t CheckTimeout(void);
 static void Idle(void);
 static void IdleSio1(bool setIdle);
 static void BusTransceiverPowerDown(bool powerDown);
+static bool ChecksumOk(void);
+static void SendUpdDataWinResp(uint8_t receiverAddr, bool ok);
 
 /*-----------------------------------------------------------------------------
 *  Programstart
@@ -139,8 +141,6 @@ static void BusTransceiverPowerDown(bool powerDown);
 int main(void) {
 
    uint8_t   ret;
-   uint16_t  flashWordAddr;
-   uint16_t  sum;
    int       sioHdl;
 
    sMyAddr = eeprom_read_byte((const uint8_t *)MODUL_ADDRESS);
@@ -177,13 +177,8 @@ int main(void) {
 
    LedSet(eLedRedOff);
 
-   /* Prfsumme der Applikation berechnen */
-   sum = 0;
-   for (flashWordAddr = 0; flashWordAddr < (MAX_FIRMWARE_SIZE / 2); flashWordAddr += CHECKSUM_BLOCK_SIZE) {
-      sum += FlashSum(flashWordAddr, (uint8_t)CHECKSUM_BLOCK_SIZE);
-   }
-
-   if (sum == FLASH_CHECKSUM) {
+   /* Prfsumme der Applikation prfen */
+   if (ChecksumOk()) {
       /* OK */
       LedSet(eLedGreenFlashFast);
    } else {
@@ -227,6 +222,20 @@ int main(void) {
    return 0;
 }
 
+/*-----------------------------------------------------------------------------
+*  Prfsumme ber den Applikationsbereich
+*/
+static bool ChecksumOk(void) {
+
+   uint16_t  flashWordAddr;
+   uint16_t  sum = 0;
+
+   for (flashWordAddr = 0; flashWordAddr < (MAX_FIRMWARE_SIZE / 2); flashWordAddr += CHECKSUM_BLOCK_SIZE) {
+      sum += FlashSum(flashWordAddr, (uint8_t)CHECKSUM_BLOCK_SIZE);
+   }
+   return sum == FLASH_CHECKSUM;
+}
+
 /*-----------------------------------------------------------------------------
 *  liefert bei Timeout 1
 */
@@ -252,6 +261,9 @@ static void ProcessBus(uint8_t ret) {
    uint16_t        *pData;
    uint16_t        wordAddr;
    bool          rc;
+   uint16_t        page;
+   uint8_t         flags;
+   uint8_t         i;
 
    if (ret == BUS_MSG_OK) {
       msgType = spBusMsg->type;
@@ -272,6 +284,22 @@ static void ProcessBus(uint8_t ret) {
 
                   /* Applicationbereich des Flash lschen */
                   FlashErase();
+                  FlashBufInit(false);
+
+                  /* Antwort senden */
+                  sTxBusMsg.type = eBusDevRespUpdEnter;
+                  sTxBusMsg.senderAddr = MY_ADDR;
+                  sTxBusMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
+                  BusSend(&sTxBusMsg);
+                  sFwuState = WAIT_FOR_UPD_DATA;
+                  LedSet(eLedRedFlashFast);
+                  LedSet(eLedGreenFlashFast);
+               } else if ((msgType == eBusDevReqUpdEnterDiff) &&
+                          (spBusMsg->msg.devBus.receiverAddr == MY_ADDR)) {
+
+                  /* Differenzupdate: Flash bleibt erhalten, Pages werden
+                   * erst vor dem Programmieren gelscht */
+                  FlashBufInit(true);
 
                   /* Antwort senden */
                   sTxBusMsg.type = eBusDevRespUpdEnter;
@@ -304,10 +332,56 @@ static void ProcessBus(uint8_t ret) {
                      sTxBusMsg.msg.devBus.x.devResp.updData.wordAddr = -1;
                   }
                   BusSend(&sTxBusMsg);
+               } else if ((msgType == eBusDevReqUpdDataWin) &&
+                          (spBusMsg->msg.devBus.receiverAddr == BUS_BROADCAST_ADDR)) {
+
+                  /* Paket an alle Gerte (Fleet-Update): nur puffern, nie antworten */
+                  wordAddr = spBusMsg->msg.devBus.x.devReq.updDataWin.wordAddr;
+                  pData = spBusMsg->msg.devBus.x.devReq.updDataWin.data;
+                  FlashBufWrite(wordAddr, pData, false);
+               } else if ((msgType == eBusDevReqUpdDataWin) &&
+                          (spBusMsg->msg.devBus.receiverAddr == MY_ADDR)) {
+
+                  wordAddr = spBusMsg->msg.devBus.x.devReq.updDataWin.wordAddr;
+                  pData = spBusMsg->msg.devBus.x.devReq.updDataWin.data;
+
+                  flags = spBusMsg->msg.devBus.x.devReq.updDataWin.flags;
+
+                  /* Paket puffern, geantwortet wird nur auf Anforderung */
+                  rc = FlashBufWrite(wordAddr, pData, (flags & BUS_FWU_WIN_START) != 0);
+                  if ((rc == true) && ((flags & BUS_FWU_WIN_ACK_REQ) == 0)) {
+                     break;
+                  }
+                  SendUpdDataWinResp(spBusMsg->senderAddr, rc);
+               } else if ((msgType == eBusDevReqUpdDataWinState) &&
+                          (spBusMsg->msg.devBus.receiverAddr == MY_ADDR)) {
+                  SendUpdDataWinResp(spBusMsg->senderAddr, true);
+               } else if ((msgType == eBusDevReqUpdPageSum) &&
+                          (spBusMsg->msg.devBus.receiverAddr == MY_ADDR)) {
+
+                  page = spBusMsg->msg.devBus.x.devReq.updPageSum.page;
+
+                  sTxBusMsg.type = eBusDevRespUpdPageSum;
+                  sTxBusMsg.senderAddr = MY_ADDR;
+                  sTxBusMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
+                  sTxBusMsg.msg.devBus.x.devResp.updPageSum.page = page;
+                  sTxBusMsg.msg.devBus.x.devResp.updPageSum.pageWordSize = FlashPageWordSize();
+                  sTxBusMsg.msg.devBus.x.devResp.updPageSum.numPages = FlashNumPages();
+                  for (i = 0; (i < BUS_FWU_PAGESUM_NUM) && (page < FlashNumPages()); i++, page++) {
+                     sTxBusMsg.msg.devBus.x.devResp.updPageSum.crc[i] = FlashPageSum(page);
+                  }
+                  sTxBusMsg.msg.devBus.x.devResp.updPageSum.num = i;
+                  BusSend(&sTxBusMsg);
                } else if ((msgType == eBusDevReqUpdTerm) &&
                           (spBusMsg->msg.devBus.receiverAddr == MY_ADDR)) {
                   /* programmiervorgang im Flash abschlieen (falls erforderlich) */
                   rc = FlashProgramTerminate();
+                  if (rc == true) {
+                     /* Ergebnis mit der Prfsumme des Applikationsbereichs
+                      * besttigen (beim Differenzupdate wurden nicht alle
+                      * Pages bertragen) */
+                     rc = ChecksumOk();
+                  }
                   /* Antwort senden */
                   sTxBusMsg.type = eBusDevRespUpdTerm;
                   sTxBusMsg.senderAddr = MY_ADDR;
@@ -332,6 +406,33 @@ static void ProcessBus(uint8_t ret) {
    }
 }
 
+/*-----------------------------------------------------------------------------
+*  Antwort eBusDevRespUpdDataWin senden
+*  ok: vollstndige Pages programmieren und Pufferzustand melden
+*/
+static void SendUpdDataWinResp(uint8_t receiverAddr, bool ok) {
+
+   uint16_t wordAddr;
+   uint16_t rxMask;
+   uint8_t  window;
+
+   if (ok) {
+      FlashBufFlush(false);
+      FlashBufState(&wordAddr, &rxMask, &window);
+   } else {
+      wordAddr = BUS_FWU_WIN_ERROR;
+      rxMask = 0;
+      window = 0;
+   }
+   sTxBusMsg.type = eBusDevRespUpdDataWin;
+   sTxBusMsg.senderAddr = MY_ADDR;
+   sTxBusMsg.msg.devBus.receiverAddr = receiverAddr;
+   sTxBusMsg.msg.devBus.x.devResp.updDataWin.wordAddr = wordAddr;
+   sTxBusMsg.msg.devBus.x.devResp.updDataWin.rxMask = rxMask;
+   sTxBusMsg.msg.devBus.x.devResp.updDataWin.window = window;
+   BusSend(&sTxBusMsg);
+}
+
 /*-----------------------------------------------------------------------------
 *  Timer-Interrupt fr Zeitbasis
 */
@@ -23,9 +23,13 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
 
 #include "sysdef.h"
 #include "board.h"
+#include "bus.h"
 #include "flash.h"
 #include "flashasm.h"
 
@@ -46,6 +50,16 @@
 
 #define INV_PAGE  0xffff
 
+/* Pagepuffer im RAM fr das Fenster-Update (eBusDevReqUpdDataWin) */
+#define NUM_BUF_PAGES       2
+#define PACKET_WORD_SIZE    (BUS_FWU_PACKET_SIZE / 2)
+#define BUF_PACKETS         (NUM_BUF_PAGES * PAGE_WORD_SIZE / PACKET_WORD_SIZE)
+#define FULL_PAGE_MASK      ((1 << (PAGE_WORD_SIZE / PACKET_WORD_SIZE)) - 1)
+
+#if (BUF_PACKETS > BUS_FWU_WIN_MAX) || ((PAGE_WORD_SIZE / PACKET_WORD_SIZE) > 8)
+#error page buffer does not fit into rxMask
+#endif
+
 /*-----------------------------------------------------------------------------
 *  typedefs
 */
@@ -55,6 +69,12 @@
 */                                
 static uint16_t sActualProgramingPage = INV_PAGE;
 
+static uint16_t sPageBuf[NUM_BUF_PAGES][PAGE_WORD_SIZE];
+static uint8_t  sPageRxMask[NUM_BUF_PAGES]; /* empfangene Pakete je Page */
+static uint8_t  sBufFirst;                  /* Index der Page bei sBufWordAddr */
+static uint16_t sBufWordAddr;               /* alle Worte darunter sind programmiert */
+static bool     sErasePages;                /* Differenzupdate: Page vor Programmierung lschen */
+
 /*-----------------------------------------------------------------------------
 *  Functions
 */
@@ -144,7 +164,142 @@ bool FlashProgramTerminate(void) {
       FlashProgramPagePuffer(sActualProgramingPage);         
       RESTORE_INT(flags);
    } 
+   /* teilgefllte Pages vom Fenster-Update */
+   FlashBufFlush(true);
    return true;                           
 } 
 
+/*-----------------------------------------------------------------------------
+*  Pagepuffer fr Fenster-Update initialisieren
+*  erasePages: Flash wurde nicht gelscht (Differenzupdate), jede Page wird
+*  vor dem Programmieren gelscht
+*/
+void FlashBufInit(bool erasePages) {
+
+   memset(sPageBuf, 0xff, sizeof(sPageBuf));
+   memset(sPageRxMask, 0, sizeof(sPageRxMask));
+   sBufFirst = 0;
+   sBufWordAddr = 0;
+   sErasePages = erasePages;
+}
+
+/*-----------------------------------------------------------------------------
+*  Datenpaket (BUS_FWU_PACKET_SIZE) in Pagepuffer kopieren
+*  Pakete unterhalb des Fensters sind bereits programmiert, Pakete oberhalb
+*  werden verworfen (werden vom Sender wiederholt)
+*  start: Pufferinhalt verwerfen, Fenster beginnt bei der Page von wordAddr
+*  (Differenzupdate, unvernderte Pages werden bersprungen)
+*  Rckgabe false: Adresse ungltig
+*/
+bool FlashBufWrite(uint16_t wordAddr, const uint16_t *pBuf, bool start) {
+
+   uint16_t offset;
+   uint8_t  idx;
+
+   if (((wordAddr % PACKET_WORD_SIZE) != 0) ||
+       ((wordAddr + PACKET_WORD_SIZE) > FIRMWARE_WORD_SIZE)) {
+      return false;
+   }
+   if (start) {
+      memset(sPageBuf, 0xff, sizeof(sPageBuf));
+      memset(sPageRxMask, 0, sizeof(sPageRxMask));
+      sBufFirst = 0;
+      sBufWordAddr = wordAddr & ~(PAGE_WORD_SIZE - 1);
+   }
+   if (wordAddr < sBufWordAddr) {
+      /* Wiederholung */
+      return true;
+   }
+   offset = wordAddr - sBufWordAddr;
+   if (offset >= (NUM_BUF_PAGES * PAGE_WORD_SIZE)) {
+      return true;
+   }
+   idx = (sBufFirst + offset / PAGE_WORD_SIZE) % NUM_BUF_PAGES;
+   offset %= PAGE_WORD_SIZE;
+   memcpy(&sPageBuf[idx][offset], pBuf, PACKET_WORD_SIZE * 2);
+   sPageRxMask[idx] |= 1 << (offset / PACKET_WORD_SIZE);
+
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+*  vollstndige Pages am Fensteranfang programmieren
+*  all: auch teilgefllte Pages programmieren (Abschluss)
+*  Beim Programmieren sind die Interrupts gesperrt, daher wird nur nach
+*  Anforderung einer Antwort programmiert (Sender wartet)
+*/
+void FlashBufFlush(bool all) {
+
+   uint8_t i;
+   int     flags;
+
+   for (i = 0; i < NUM_BUF_PAGES; i++) {
+      if ((sPageRxMask[sBufFirst] != FULL_PAGE_MASK) &&
+          (!all || (sPageRxMask[sBufFirst] == 0))) {
+         break;
+      }
+      flags = DISABLE_INT;
+      if (sErasePages) {
+         FlashPageErase(sBufWordAddr);
+      }
+      FlashFillPagePuffer(0, sPageBuf[sBufFirst], PAGE_WORD_SIZE);
+      FlashProgramPagePuffer(sBufWordAddr);
+      RESTORE_INT(flags);
+
+      memset(sPageBuf[sBufFirst], 0xff, sizeof(sPageBuf[sBufFirst]));
+      sPageRxMask[sBufFirst] = 0;
+      sBufFirst = (sBufFirst + 1) % NUM_BUF_PAGES;
+      sBufWordAddr += PAGE_WORD_SIZE;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+*  Zustand fr die Antwort eBusDevRespUpdDataWin
+*/
+void FlashBufState(uint16_t *pWordAddr, uint16_t *pRxMask, uint8_t *pWindow) {
+
+   uint8_t  i;
+   uint16_t rxMask = 0;
+
+   for (i = 0; i < NUM_BUF_PAGES; i++) {
+      rxMask |= (uint16_t)sPageRxMask[(sBufFirst + i) % NUM_BUF_PAGES] <<
+                (i * PAGE_WORD_SIZE / PACKET_WORD_SIZE);
+   }
+   *pWordAddr = sBufWordAddr;
+   *pRxMask = rxMask;
+   *pWindow = BUF_PACKETS;
+}
+
+/*-----------------------------------------------------------------------------
+*  Prfsumme (CRC-CCITT) ber eine Page fr das Differenzupdate
+*  Im Gegensatz zur Summe von FlashSum werden auch vertauschte Worte erkannt
+*/
+uint16_t FlashPageSum(uint16_t page) {
+
+   uint32_t byteAddr = (uint32_t)page * PAGE_WORD_SIZE * 2;
+   uint16_t i;
+   uint16_t crc = 0xffff;
+
+   for (i = 0; i < (PAGE_WORD_SIZE * 2); i++) {
+      crc = _crc_ccitt_update(crc, pgm_read_byte_far(byteAddr + i));
+   }
+   return crc;
+}
+
+/*-----------------------------------------------------------------------------
+*  Anzahl der Pages im Applikationsbereich
+*/
+uint16_t FlashNumPages(void) {
+
+   return FIRMWARE_WORD_SIZE / PAGE_WORD_SIZE;
+}
+
+/*-----------------------------------------------------------------------------
+*  Pagegre in Worten
+*/
+uint16_t FlashPageWordSize(void) {
+
+   return PAGE_WORD_SIZE;
+}
+
 
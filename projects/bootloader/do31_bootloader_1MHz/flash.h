@@ -50,7 +50,14 @@ void     FlashInit(void);
 void     FlashErase(void);
 bool     FlashProgram(uint16_t wordAddr, uint16_t *pBuf, uint16_t bufWordSize);
 bool     FlashProgramTerminate(void);
+void     FlashBufInit(bool erasePages);
+bool     FlashBufWrite(uint16_t wordAddr, const uint16_t *pBuf, bool start);
+void     FlashBufFlush(bool all);
+void     FlashBufState(uint16_t *pWordAddr, uint16_t *pRxMask, uint8_t *pWindow);
 uint16_t FlashSum(uint16_t wordAddr, uint8_t numWords);
+uint16_t FlashPageSum(uint16_t page);
+uint16_t FlashNumPages(void);
+uint16_t FlashPageWordSize(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,68 @@
+/*
+ * io.h - simulated registers for the bootloader test
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef _SIM_AVR_IO_H
+#define _SIM_AVR_IO_H
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+/* the registers used by the do31 bootloader are plain variables */
+#define SREG       gSimSreg
+#define MCUCR      gSimMcucr
+#define TCCR0      gSimTccr0
+#define OCR0       gSimOcr0
+#define TIMSK      gSimTimsk
+#define PORTA      gSimPort[0]
+#define PORTB      gSimPort[1]
+#define PORTC      gSimPort[2]
+#define PORTD      gSimPort[3]
+#define PORTE      gSimPort[4]
+#define PORTF      gSimPort[5]
+#define PORTG      gSimPort[6]
+#define DDRA       gSimDdr[0]
+#define DDRB       gSimDdr[1]
+#define DDRC       gSimDdr[2]
+#define DDRD       gSimDdr[3]
+#define DDRE       gSimDdr[4]
+#define DDRF       gSimDdr[5]
+#define DDRG       gSimDdr[6]
+#define PIND       gSimPin[3]
+
+/* bit numbers */
+#define SREG_I     7
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+extern uint8_t gSimSreg;
+extern uint8_t gSimMcucr;
+extern uint8_t gSimTccr0;
+extern uint8_t gSimOcr0;
+extern uint8_t gSimTimsk;
+extern uint8_t gSimPort[7];
+extern uint8_t gSimDdr[7];
+extern uint8_t gSimPin[7];
+
+#endif
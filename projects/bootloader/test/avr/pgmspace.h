@@ -0,0 +1,45 @@
+/*
+ * pgmspace.h - simulated flash for the bootloader test
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef _SIM_AVR_PGMSPACE_H
+#define _SIM_AVR_PGMSPACE_H
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+/* 128 kByte flash of the ATmega128 */
+#define SIM_FLASH_SIZE            (128UL * 1024UL)
+
+/* flash constants are in ram, the flash memory is gSimFlash */
+#define PROGMEM
+#define pgm_read_byte(addr)       (*(addr))
+#define pgm_read_word(addr)       (*(addr))
+#define pgm_read_byte_far(addr)   gSimFlash[(addr) % SIM_FLASH_SIZE]
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+extern uint8_t gSimFlash[SIM_FLASH_SIZE];
+
+#endif
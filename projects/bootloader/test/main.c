@@ -0,0 +1,683 @@
+/*
+ * main.c - host test for the firmware update of the do31 bootloader
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+/*
+ * main.c and flash.c of the bootloader run against a simulated flash
+ * (flashasm functions and pgm_read_byte_far on gSimFlash). main.c of the
+ * bootloader is included to call ProcessBus with the request telegrams,
+ * the bus layer is replaced by BusSend storing the response. the flash
+ * behaves like real flash: programming can only clear bits, a page that is
+ * programmed without erase gets a wrong content.
+ *
+ * - window loss: windowed update, on average every LOSS_PERIOD-th packet
+ *   (including the ones with ack request) is lost, the gaps from the response rxMask
+ *   are sent again, a missing response is polled by
+ *   eBusDevReqUpdDataWinState
+ * - broadcast gap fill: new packets are sent to BUS_BROADCAST_ADDR (never
+ *   answered), after every window the device is polled and the gaps are
+ *   sent to the device address
+ * - diff skip: differential update, only the pages with a different page
+ *   checksum are erased, programmed and transferred
+ * - page-sum mismatch: a page is transferred with a wrong word, the page
+ *   checksums show this page only, it is transferred again
+ * - UpdTerm checksum: eBusDevRespUpdTerm reports the checksum of the
+ *   application (wrong as long as the page is not repaired)
+ *
+ * usage: bootloadertest
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "flashasm.h"
+
+/* the bootloader module, its main() is not used */
+#define main BootloaderMain
+#ifdef BOOTLOADER_1MHZ
+#include "../do31_bootloader_1MHz/main.c"
+#else
+#include "../do31_bootloader/main.c"
+#endif
+#undef main
+
+#include <util/crc16.h>
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define DEV_ADDR          5
+#define HOST_ADDR         250
+#define SIM_PAGE_SIZE     256    /* bytes, ATmega128 */
+#define FIRMWARE_WORDS    (MAX_FIRMWARE_SIZE / 2)
+#define PACKET_WORDS      (BUS_FWU_PACKET_SIZE / 2)
+/* test firmware: 64 pages and a partially filled page */
+#define FW_WORDS          (64 * SIM_PAGE_SIZE / 2 + 3 * PACKET_WORDS)
+#define LOSS_PERIOD       7
+#define MAX_ROUNDS        10000
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+/* avr register and memory simulation (see avr/) */
+uint8_t gSimSreg;
+uint8_t gSimMcucr;
+uint8_t gSimTccr0;
+uint8_t gSimOcr0;
+uint8_t gSimTimsk;
+uint8_t gSimPort[7];
+uint8_t gSimDdr[7];
+uint8_t gSimPin[7];
+uint8_t gSimEeprom[SIM_EEPROM_SIZE];
+uint8_t gSimFlash[SIM_FLASH_SIZE];
+
+static uint8_t      sSimPageBuf[SIM_PAGE_SIZE];
+static unsigned int sNumErase;
+static unsigned int sNumProgram;
+
+static TBusTelegram sRxMsg;     /* request to the bootloader */
+static TBusTelegram sResp;      /* last response of the bootloader */
+static unsigned int sNumResp;
+static unsigned int sLossPeriod;
+static unsigned int sNumSent;
+static unsigned int sNumLost;
+static unsigned int sNumPoll;
+
+static uint16_t     sOldImage[FIRMWARE_WORDS];
+static uint16_t     sNewImage[FIRMWARE_WORDS];
+static uint16_t     sBadImage[FIRMWARE_WORDS];
+static unsigned int sSeed = 4711;
+
+/*-----------------------------------------------------------------------------
+*  simulation of flashasm.s
+*/
+uint16_t FlashSum(uint16_t wordAddr, uint8_t numWords) {
+
+    uint32_t byteAddr = (uint32_t)wordAddr * 2;
+    uint16_t sum = 0;
+    unsigned num = (numWords == 0) ? 256 : numWords;
+
+    for (; num > 0; num--, byteAddr += 2) {
+        sum += gSimFlash[byteAddr] | (gSimFlash[byteAddr + 1] << 8);
+    }
+    return sum;
+}
+
+void FlashFillPagePuffer(uint16_t offset, uint16_t *pBuf, uint8_t numWords) {
+
+    uint8_t i;
+
+    for (i = 0; i < numWords; i++) {
+        sSimPageBuf[(offset + i) * 2] = (uint8_t)pBuf[i];
+        sSimPageBuf[(offset + i) * 2 + 1] = (uint8_t)(pBuf[i] >> 8);
+    }
+}
+
+/* programming clears bits only, the page buffer is empty afterwards */
+void FlashProgramPagePuffer(uint16_t pageWordAddr) {
+
+    uint32_t byteAddr = (uint32_t)pageWordAddr * 2;
+    int      i;
+
+    for (i = 0; i < SIM_PAGE_SIZE; i++) {
+        gSimFlash[byteAddr + i] &= sSimPageBuf[i];
+    }
+    memset(sSimPageBuf, 0xff, sizeof(sSimPageBuf));
+    sNumProgram++;
+}
+
+void FlashPageErase(uint16_t pageWordAddr) {
+
+    memset(&gSimFlash[(uint32_t)pageWordAddr * 2], 0xff, SIM_PAGE_SIZE);
+    sNumErase++;
+}
+
+/*-----------------------------------------------------------------------------
+*  bus, sio and led of the bootloader
+*/
+void BusInit(int sioHandle) {
+}
+
+TBusTelegram *BusMsgBufGet(void) {
+
+    return &sRxMsg;
+}
+
+uint8_t BusCheck(void) {
+
+    return BUS_NO_MSG;
+}
+
+uint8_t BusSend(TBusTelegram *pMsg) {
+
+    memcpy(&sResp, pMsg, sizeof(sResp));
+    sNumResp++;
+    return BUS_SEND_OK;
+}
+
+void SioInit(void) {
+}
+
+int SioOpen(const char *pPortName, TSioBaud baud, TSioDataBits dataBits,
+            TSioParity parity, TSioStopBits stopBits, TSioMode mode) {
+
+    return 0;
+}
+
+void SioSetIdleFunc(int handle, TIdleStateFunc idleFunc) {
+}
+
+void SioSetTransceiverPowerDownFunc(int handle, TBusTransceiverPowerDownFunc btpdFunc) {
+}
+
+void LedInit(void) {
+}
+
+void LedCheck(void) {
+}
+
+void LedSet(TLedState state) {
+}
+
+void ApplicationEntry(void) {
+}
+
+/*-----------------------------------------------------------------------------
+*  firmware images
+*/
+static uint16_t ImageSum(const uint16_t *pImage) {
+
+    uint16_t sum = 0;
+    uint32_t i;
+
+    for (i = 0; i < FIRMWARE_WORDS; i++) {
+        sum += pImage[i];
+    }
+    return sum;
+}
+
+/* random firmware of FW_WORDS, the last word is set for the checksum */
+static void ImageInit(uint16_t *pImage) {
+
+    uint32_t i;
+
+    for (i = 0; i < FIRMWARE_WORDS; i++) {
+        pImage[i] = (i < FW_WORDS) ? (uint16_t)rand_r(&sSeed) : 0xffff;
+    }
+    pImage[FW_WORDS - 1] += FLASH_CHECKSUM - ImageSum(pImage);
+}
+
+/* change the words from wordAddr on, the checksum is corrected in page
+ * checksumPage */
+static void ImageChange(uint16_t *pImage, uint16_t wordAddr, uint16_t numWords,
+                        uint16_t checksumPage) {
+
+    for (; numWords > 0; numWords--, wordAddr++) {
+        pImage[wordAddr] ^= 0x5a5a;
+    }
+    pImage[checksumPage * SIM_PAGE_SIZE / 2] += FLASH_CHECKSUM - ImageSum(pImage);
+}
+
+static void ImageToFlash(const uint16_t *pImage) {
+
+    uint32_t i;
+
+    memset(gSimFlash, 0xff, sizeof(gSimFlash));
+    for (i = 0; i < FIRMWARE_WORDS; i++) {
+        gSimFlash[i * 2] = (uint8_t)pImage[i];
+        gSimFlash[i * 2 + 1] = (uint8_t)(pImage[i] >> 8);
+    }
+}
+
+static bool FlashEqual(const uint16_t *pImage) {
+
+    uint32_t i;
+
+    for (i = 0; i < FIRMWARE_WORDS; i++) {
+        if ((gSimFlash[i * 2] | (gSimFlash[i * 2 + 1] << 8)) != pImage[i]) {
+            printf("flash word 0x%04x: 0x%04x, expected 0x%04x\n", (unsigned)i,
+                   gSimFlash[i * 2] | (gSimFlash[i * 2 + 1] << 8), pImage[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/* CRC-CCITT over the bytes of a page (see TBusDevRespUpdPageSum) */
+static uint16_t ImagePageSum(const uint16_t *pImage, uint16_t page) {
+
+    uint16_t crc = 0xffff;
+    int      i;
+
+    for (i = 0; i < (SIM_PAGE_SIZE / 2); i++) {
+        crc = _crc_ccitt_update(crc, (uint8_t)pImage[page * SIM_PAGE_SIZE / 2 + i]);
+        crc = _crc_ccitt_update(crc, (uint8_t)(pImage[page * SIM_PAGE_SIZE / 2 + i] >> 8));
+    }
+    return crc;
+}
+
+/*-----------------------------------------------------------------------------
+*  request in sRxMsg to the bootloader
+*  returns true if answered (sResp)
+*/
+static bool Request(TBusMsgType type, uint8_t receiverAddr) {
+
+    unsigned int numResp = sNumResp;
+
+    sRxMsg.type = type;
+    sRxMsg.senderAddr = HOST_ADDR;
+    sRxMsg.msg.devBus.receiverAddr = receiverAddr;
+    ProcessBus(BUS_MSG_OK);
+    return sNumResp != numResp;
+}
+
+/*-----------------------------------------------------------------------------
+*  enter the update (like after reset with invalid application)
+*/
+static int Enter(bool diff) {
+
+    sFwuState = WAIT_FOR_UPD_ENTER;
+    if (!Request(diff ? eBusDevReqUpdEnterDiff : eBusDevReqUpdEnter, DEV_ADDR) ||
+        (sResp.type != eBusDevRespUpdEnter) ||
+        (sResp.msg.devBus.receiverAddr != HOST_ADDR)) {
+        printf("no response to update enter\n");
+        return -1;
+    }
+    sNumErase = 0;
+    sNumProgram = 0;
+    sNumSent = 0;
+    sNumLost = 0;
+    sNumPoll = 0;
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  terminate the update, success of the response has to be expected
+*/
+static int Term(uint8_t expected) {
+
+    if (!Request(eBusDevReqUpdTerm, DEV_ADDR) ||
+        (sResp.type != eBusDevRespUpdTerm) ||
+        (sResp.msg.devBus.x.devResp.updTerm.success != expected)) {
+        printf("update terminate: no response or success != %u\n", expected);
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  send one eBusDevReqUpdDataWin, on average every sLossPeriod-th packet is
+*  lost, except packets with BUS_FWU_WIN_START (the window of the device
+*  would not be moved)
+*  returns true if answered
+*/
+static bool SendPacket(const uint16_t *pImage, uint16_t wordAddr, uint8_t flags,
+                       uint8_t receiverAddr) {
+
+    TBusDevReqUpdDataWin *pReq = &sRxMsg.msg.devBus.x.devReq.updDataWin;
+
+    sNumSent++;
+    if ((sLossPeriod != 0) && ((rand_r(&sSeed) % sLossPeriod) == 0) &&
+        ((flags & BUS_FWU_WIN_START) == 0)) {
+        sNumLost++;
+        return false;
+    }
+    pReq->wordAddr = wordAddr;
+    pReq->flags = flags;
+    memcpy(pReq->data, &pImage[wordAddr], sizeof(pReq->data));
+    return Request(eBusDevReqUpdDataWin, receiverAddr);
+}
+
+/*-----------------------------------------------------------------------------
+*  windowed transfer of the words startAddr .. endAddr - 1
+*  broadcast: new packets to BUS_BROADCAST_ADDR, the device is polled
+*  start: the first packet moves the window (differential update)
+*  the last partially filled page is programmed by Term()
+*/
+static int SendWin(const uint16_t *pImage, uint16_t startAddr, uint16_t endAddr,
+                   bool broadcast, bool start) {
+
+    TBusDevRespUpdDataWin *pResp = &sResp.msg.devBus.x.devResp.updDataWin;
+    uint16_t     wordAddr = startAddr;
+    uint16_t     rxMask = 0;
+    uint8_t      window = BUS_FWU_WIN_MAX;
+    uint32_t     sentAddr = startAddr;  /* packets from sentAddr on are new */
+    uint32_t     addr;
+    uint16_t     send[BUS_FWU_WIN_MAX];
+    uint8_t      num;
+    uint8_t      flags;
+    uint8_t      i;
+    int          round;
+    unsigned int numResp;
+
+    for (round = 0; round < MAX_ROUNDS; round++) {
+        for (i = 0, num = 0; i < window; i++) {
+            addr = wordAddr + i * PACKET_WORDS;
+            if (addr >= endAddr) {
+                break;
+            }
+            if ((rxMask & (1 << i)) == 0) {
+                send[num++] = addr;
+            }
+        }
+        if (num == 0) {
+            return 0;
+        }
+        numResp = sNumResp;
+        for (i = 0; i < num; i++) {
+            flags = 0;
+            if (start && (round == 0) && (i == 0)) {
+                flags |= BUS_FWU_WIN_START;
+            }
+            if (!broadcast && (i == (num - 1))) {
+                flags |= BUS_FWU_WIN_ACK_REQ;
+            }
+            SendPacket(pImage, send[i], flags,
+                       (broadcast && (send[i] >= sentAddr)) ? BUS_BROADCAST_ADDR : DEV_ADDR);
+        }
+        sentAddr = max(sentAddr, send[num - 1] + PACKET_WORDS);
+        if (sNumResp > numResp + 1) {
+            printf("window 0x%04x: unexpected response\n", wordAddr);
+            return -1;
+        }
+        if (sNumResp == numResp) {
+            sNumPoll++;
+            if (!Request(eBusDevReqUpdDataWinState, DEV_ADDR)) {
+                printf("window 0x%04x: no response to poll\n", wordAddr);
+                return -1;
+            }
+        }
+        if ((sResp.type != eBusDevRespUpdDataWin) ||
+            (pResp->wordAddr == BUS_FWU_WIN_ERROR) ||
+            (pResp->wordAddr < wordAddr) ||
+            (pResp->window == 0) || (pResp->window > BUS_FWU_WIN_MAX)) {
+            printf("window 0x%04x: response error (0x%04x)\n", wordAddr, pResp->wordAddr);
+            return -1;
+        }
+        wordAddr = pResp->wordAddr;
+        rxMask = pResp->rxMask;
+        window = pResp->window;
+    }
+    printf("window 0x%04x: no progress\n", wordAddr);
+    return -1;
+}
+
+/*-----------------------------------------------------------------------------
+*  page checksums of the device compared with pImage
+*  pDiff[page]: different, returns number of different pages or -1
+*/
+static int PageSumDiff(const uint16_t *pImage, bool *pDiff) {
+
+    TBusDevRespUpdPageSum *pResp = &sResp.msg.devBus.x.devResp.updPageSum;
+    uint16_t numPages = FIRMWARE_WORDS * 2 / SIM_PAGE_SIZE;
+    uint16_t page;
+    uint8_t  i;
+    int      numDiff = 0;
+
+    for (page = 0; page < numPages; page += BUS_FWU_PAGESUM_NUM) {
+        sRxMsg.msg.devBus.x.devReq.updPageSum.page = page;
+        if (!Request(eBusDevReqUpdPageSum, DEV_ADDR) ||
+            (sResp.type != eBusDevRespUpdPageSum) ||
+            (pResp->page != page) ||
+            (pResp->pageWordSize != (SIM_PAGE_SIZE / 2)) ||
+            (pResp->numPages != numPages) ||
+            (pResp->num != min(BUS_FWU_PAGESUM_NUM, numPages - page))) {
+            printf("page sum %u: response error\n", page);
+            return -1;
+        }
+        for (i = 0; i < pResp->num; i++) {
+            pDiff[page + i] = (pResp->crc[i] != ImagePageSum(pImage, page + i));
+            if (pDiff[page + i]) {
+                numDiff++;
+            }
+        }
+    }
+    return numDiff;
+}
+
+/*-----------------------------------------------------------------------------
+*  transfer the different pages with BUS_FWU_WIN_START per run of pages
+*/
+static int SendDiff(const uint16_t *pImage, const bool *pDiff) {
+
+    uint16_t numPages = FIRMWARE_WORDS * 2 / SIM_PAGE_SIZE;
+    uint16_t page;
+    uint16_t last;
+
+    for (page = 0; page < numPages; page = last) {
+        if (!pDiff[page]) {
+            last = page + 1;
+            continue;
+        }
+        for (last = page; (last < numPages) && pDiff[last]; last++);
+        if (SendWin(pImage, page * SIM_PAGE_SIZE / 2, last * SIM_PAGE_SIZE / 2,
+                    false, true) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  full windowed update with lost packets and responses
+*/
+static int TestWindowLoss(void) {
+
+    ImageInit(sNewImage);
+    memset(gSimFlash, 0, sizeof(gSimFlash));
+    if (Enter(false) != 0) {
+        return -1;
+    }
+    sLossPeriod = LOSS_PERIOD;
+    if ((SendWin(sNewImage, 0, FW_WORDS, false, false) != 0) ||
+        (Term(1) != 0) ||
+        !FlashEqual(sNewImage)) {
+        printf("window loss: failed\n");
+        return -1;
+    }
+    printf("window loss: %u packets, %u lost, %u polled, %u pages programmed\n",
+           sNumSent, sNumLost, sNumPoll, sNumProgram);
+    if ((sNumLost == 0) || (sNumPoll == 0) ||
+        (sNumProgram != (FW_WORDS * 2 + SIM_PAGE_SIZE - 1) / SIM_PAGE_SIZE)) {
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  fleet update: broadcast packets, polled state, gaps sent to the device
+*/
+static int TestBroadcast(void) {
+
+    unsigned int numResp;
+
+    ImageInit(sNewImage);
+    if (Enter(false) != 0) {
+        return -1;
+    }
+    /* broadcasts are buffered without response */
+    sLossPeriod = 0;
+    numResp = sNumResp;
+    SendPacket(sNewImage, 0, 0, BUS_BROADCAST_ADDR);
+    if ((sNumResp != numResp) ||
+        !Request(eBusDevReqUpdDataWinState, DEV_ADDR) ||
+        (sResp.msg.devBus.x.devResp.updDataWin.wordAddr != 0) ||
+        (sResp.msg.devBus.x.devResp.updDataWin.rxMask != 0x0001)) {
+        printf("broadcast: not buffered or answered\n");
+        return -1;
+    }
+    sLossPeriod = LOSS_PERIOD;
+    if ((SendWin(sNewImage, 0, FW_WORDS, true, false) != 0) ||
+        (Term(1) != 0) ||
+        !FlashEqual(sNewImage)) {
+        printf("broadcast: failed\n");
+        return -1;
+    }
+    printf("broadcast: %u packets, %u lost, %u polled\n", sNumSent, sNumLost, sNumPoll);
+    return (sNumLost != 0) ? 0 : -1;
+}
+
+/*-----------------------------------------------------------------------------
+*  differential update: unchanged pages are skipped
+*/
+static int TestDiffSkip(void) {
+
+    bool diff[FIRMWARE_WORDS * 2 / SIM_PAGE_SIZE];
+    int  numDiff;
+
+    ImageInit(sOldImage);
+    ImageToFlash(sOldImage);
+    memcpy(sNewImage, sOldImage, sizeof(sNewImage));
+    /* pages 3 and 4, 20 and the checksum in 40 */
+    ImageChange(sNewImage, 3 * SIM_PAGE_SIZE / 2 + 100, 80, 40);
+    ImageChange(sNewImage, 20 * SIM_PAGE_SIZE / 2 + 7, 1, 40);
+    if (Enter(true) != 0) {
+        return -1;
+    }
+    if ((sNumErase != 0) || !FlashEqual(sOldImage)) {
+        printf("diff skip: flash changed by enter\n");
+        return -1;
+    }
+    sLossPeriod = LOSS_PERIOD;
+    numDiff = PageSumDiff(sNewImage, diff);
+    if ((numDiff != 4) || !diff[3] || !diff[4] || !diff[20] || !diff[40]) {
+        printf("diff skip: %d different pages\n", numDiff);
+        return -1;
+    }
+    if ((SendDiff(sNewImage, diff) != 0) ||
+        (Term(1) != 0) ||
+        !FlashEqual(sNewImage) ||
+        (PageSumDiff(sNewImage, diff) != 0)) {
+        printf("diff skip: failed\n");
+        return -1;
+    }
+    printf("diff skip: %d pages, %u packets, %u erased, %u programmed\n",
+           numDiff, sNumSent, sNumErase, sNumProgram);
+    if ((sNumErase != numDiff) || (sNumProgram != numDiff) ||
+        (sNumSent < numDiff * SIM_PAGE_SIZE / BUS_FWU_PACKET_SIZE)) {
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  page with wrong content: UpdTerm checksum fails, the page checksum shows
+*  the page, it is transferred again
+*/
+static int TestPageSumMismatch(void) {
+
+    bool diff[FIRMWARE_WORDS * 2 / SIM_PAGE_SIZE];
+    int  numDiff;
+
+    ImageInit(sOldImage);
+    ImageToFlash(sOldImage);
+    memcpy(sNewImage, sOldImage, sizeof(sNewImage));
+    ImageChange(sNewImage, 10 * SIM_PAGE_SIZE / 2, SIM_PAGE_SIZE / 2, 41);
+    /* page 10 is transferred with one wrong word */
+    memcpy(sBadImage, sNewImage, sizeof(sBadImage));
+    sBadImage[10 * SIM_PAGE_SIZE / 2 + 33] ^= 0x0100;
+    if (Enter(true) != 0) {
+        return -1;
+    }
+    sLossPeriod = 0;
+    if ((PageSumDiff(sNewImage, diff) != 2) ||
+        (SendDiff(sBadImage, diff) != 0) ||
+        (Term(0) != 0)) {
+        printf("page sum mismatch: wrong page not detected by terminate\n");
+        return -1;
+    }
+    numDiff = PageSumDiff(sNewImage, diff);
+    if ((numDiff != 1) || !diff[10]) {
+        printf("page sum mismatch: %d different pages\n", numDiff);
+        return -1;
+    }
+    if ((SendDiff(sNewImage, diff) != 0) ||
+        (Term(1) != 0) ||
+        !FlashEqual(sNewImage)) {
+        printf("page sum mismatch: failed\n");
+        return -1;
+    }
+    printf("page sum mismatch: page 10 repaired, %u erased, %u programmed\n",
+           sNumErase, sNumProgram);
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  UpdTerm: checksum of the application, not only the transferred data
+*/
+static int TestTermChecksum(void) {
+
+    ImageInit(sNewImage);
+    /* wrong checksum */
+    sNewImage[0] ^= 0x0001;
+    if (Enter(false) != 0) {
+        return -1;
+    }
+    sLossPeriod = 0;
+    if ((SendWin(sNewImage, 0, FW_WORDS, false, false) != 0) ||
+        (Term(0) != 0) ||
+        !FlashEqual(sNewImage)) {
+        printf("terminate checksum: wrong checksum not detected\n");
+        return -1;
+    }
+    /* differential update without any page: checksum of the old content */
+    ImageInit(sOldImage);
+    ImageToFlash(sOldImage);
+    if ((Enter(true) != 0) ||
+        (Term(1) != 0) ||
+        (sNumErase != 0) || (sNumProgram != 0)) {
+        printf("terminate checksum: valid application not detected\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  main
+*/
+int main(void) {
+
+    int rc = 0;
+
+    memset(sSimPageBuf, 0xff, sizeof(sSimPageBuf));
+    gSimEeprom[MODUL_ADDRESS] = DEV_ADDR;
+    sMyAddr = eeprom_read_byte((const uint8_t *)MODUL_ADDRESS);
+    spBusMsg = BusMsgBufGet();
+
+    if ((TestWindowLoss() != 0) ||
+        (TestBroadcast() != 0) ||
+        (TestDiffSkip() != 0) ||
+        (TestPageSumMismatch() != 0) ||
+        (TestTermChecksum() != 0)) {
+        rc = 1;
+    }
+
+    if (rc != 0) {
+        printf("ERROR\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * crc16.h - crc of avr-libc for the bootloader test
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef _SIM_UTIL_CRC16_H
+#define _SIM_UTIL_CRC16_H
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------------------------
+*  Functions
+*/
+/* CRC-CCITT (polynom 0x1021), optimized version of avr-libc */
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data) {
+
+    data ^= (uint8_t)crc;
+    data ^= data << 4;
+
+    return (((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3);
+}
+
+#endif
@@ -167,11 +167,23 @@ static bool            sTxRetry = false;
 
 static bool            sCheckBusvarEnable = true;
 
+/* delta actual value event to the receiver of busvar 2 */
+static enum {
+    eAveFormatUnknown, /* delta event not confirmed yet */
+    eAveFormatDelta,   /* eBusDevReqActualValueEventDelta */
+    eAveFormatFull     /* no delta support: eBusDevReqActualValueEvent */
+} sAveFormat = eAveFormatUnknown;
+static TBusDevActualValueSmif sAvePrev; /* image of previous event */
+static uint8_t         sAveSeq;
+static bool            sAveSynced = false;  /* receiver has confirmed the previous event */
+static bool            sAvePending = false; /* no response to the previous event */
+
 /*-----------------------------------------------------------------------------
 *  Functions
 */
 static void ProcessBus(uint8_t ret);
 static void ApplicationCheck(void);
+static void MeterDataGet(TBusDevActualValueSmif *pActVal);
 
 void SetupHardware(void);
 static void Host_Task(void);
@@ -227,6 +239,8 @@ static void ApplicationCheck(void) {
     uint16_t actualTimeS = 0;
     TBusVarResult result;
     TBusDevReqActualValueEvent *pAve;
+    TBusDevReqActualValueEventDelta *pAveDelta;
+    TBusDevActualValueSmif actVal;
     uint8_t activationTime;
 
     if (sCheckBusvarEnable) {
@@ -251,25 +265,56 @@ static void ApplicationCheck(void) {
 
     if (memcmp(&sMdOld, &sMd, sizeof(sMdOld)) != 0) {
         memcpy(&sMdOld, &sMd, sizeof(sMdOld));
-        pAve = &sTxMsg.msg.devBus.x.devReq.actualValueEvent;
-        sTxMsg.type = eBusDevReqActualValueEvent;
+        MeterDataGet(&actVal);
+        if (sAvePending) {
+            /* the response could be lost: next event with full image */
+            sAveSynced = false;
+            if (sAveFormat == eAveFormatUnknown) {
+                /* no answer to delta event: use eBusDevReqActualValueEvent */
+                sAveFormat = eAveFormatFull;
+            }
+        }
         sTxMsg.senderAddr = MY_ADDR;
         BusVarRead(2, &sTxMsg.msg.devBus.receiverAddr, sizeof(uint8_t), &result);
-        pAve->devType = eBusDevTypeSmIf;
-
-        pAve->actualValue.smif.countA_plus         = sMd.countA_plus;
-        pAve->actualValue.smif.countA_minus        = sMd.countA_minus;
-        pAve->actualValue.smif.countR_plus         = sMd.countR_plus;
-        pAve->actualValue.smif.countR_minus        = sMd.countR_minus;
-        pAve->actualValue.smif.activePower_plus    = sMd.activePower_plus;
-        pAve->actualValue.smif.activePower_minus   = sMd.activePower_minus;
-        pAve->actualValue.smif.reactivePower_plus  = sMd.reactivePower_plus;
-        pAve->actualValue.smif.reactivePower_minus = sMd.reactivePower_minus;
+        if (sAveFormat == eAveFormatFull) {
+            pAve = &sTxMsg.msg.devBus.x.devReq.actualValueEvent;
+            sTxMsg.type = eBusDevReqActualValueEvent;
+            pAve->devType = eBusDevTypeSmIf;
+            pAve->actualValue.smif = actVal;
+            sAvePending = false;
+        } else {
+            /* only the changed bytes if the receiver has the previous image */
+            pAveDelta = &sTxMsg.msg.devBus.x.devReq.actualValueEventDelta;
+            sTxMsg.type = eBusDevReqActualValueEventDelta;
+            pAveDelta->devType = eBusDevTypeSmIf;
+            sAveSeq++;
+            pAveDelta->seq = sAveSeq;
+            BusEventDeltaEncode(pAveDelta, sAveSynced ? (const uint8_t *)&sAvePrev : 0,
+                                (const uint8_t *)&actVal, sizeof(actVal));
+            sAvePending = true;
+            sAveSynced = false;
+        }
+        sAvePrev = actVal;
 
         sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
     }
 }
 
+/*-----------------------------------------------------------------------------
+*  actual value image of the meter data
+*/
+static void MeterDataGet(TBusDevActualValueSmif *pActVal) {
+
+    pActVal->countA_plus         = sMd.countA_plus;
+    pActVal->countA_minus        = sMd.countA_minus;
+    pActVal->countR_plus         = sMd.countR_plus;
+    pActVal->countR_minus        = sMd.countR_minus;
+    pActVal->activePower_plus    = sMd.activePower_plus;
+    pActVal->activePower_minus   = sMd.activePower_minus;
+    pActVal->reactivePower_plus  = sMd.reactivePower_plus;
+    pActVal->reactivePower_minus = sMd.reactivePower_minus;
+}
+
 /*-----------------------------------------------------------------------------
 *  process received bus telegrams
 */
@@ -302,7 +347,12 @@ static void ProcessBus(uint8_t ret) {
         case eBusDevReqSetVar:
         case eBusDevRespGetVar:
         case eBusDevRespSetVar:
+        case eBusDevReqGetVarBulk:
+        case eBusDevReqSetVarBulk:
+        case eBusDevRespGetVarBulk:
+        case eBusDevRespSetVarBulk:
         case eBusDevReqGetFlashData:
+        case eBusDevRespActualValueEventDelta:
             if (spBusMsg->msg.devBus.receiverAddr == MY_ADDR) {
                 msgForMe = true;
             }
@@ -343,15 +393,7 @@ static void ProcessBus(uint8_t ret) {
         sTxMsg.senderAddr = MY_ADDR;
         sTxMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
         pActVal->devType = eBusDevTypeSmIf;
-
-        pActVal->actualValue.smif.countA_plus         = sMd.countA_plus;
-        pActVal->actualValue.smif.countA_minus        = sMd.countA_minus;
-        pActVal->actualValue.smif.countR_plus         = sMd.countR_plus;
-        pActVal->actualValue.smif.countR_minus        = sMd.countR_minus;
-        pActVal->actualValue.smif.activePower_plus    = sMd.activePower_plus;
-        pActVal->actualValue.smif.activePower_minus   = sMd.activePower_minus;
-        pActVal->actualValue.smif.reactivePower_plus  = sMd.reactivePower_plus;
-        pActVal->actualValue.smif.reactivePower_minus = sMd.reactivePower_minus;
+        MeterDataGet(&pActVal->actualValue.smif);
 
         sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
         break;
@@ -433,6 +475,43 @@ static void ProcessBus(uint8_t ret) {
     case eBusDevRespGetVar:
         BusVarRespGet(spBusMsg->senderAddr, &spBusMsg->msg.devBus.x.devResp.getVar);
         break;
+    case eBusDevRespActualValueEventDelta:
+        if (sAvePending &&
+            (spBusMsg->msg.devBus.x.devResp.actualValueEventDelta.seq == sAveSeq)) {
+            sAvePending = false;
+            sAveFormat = eAveFormatDelta;
+            /* RESYNC: the next event carries the full image */
+            sAveSynced = spBusMsg->msg.devBus.x.devResp.actualValueEventDelta.state ==
+                         BUS_ACTVAL_DELTA_OK;
+        }
+        break;
+    case eBusDevReqGetVarBulk:
+        BusVarGetBulk(&spBusMsg->msg.devBus.x.devReq.getVarBulk,
+                      &sTxMsg.msg.devBus.x.devResp.getVarBulk);
+        sTxMsg.senderAddr = MY_ADDR;
+        sTxMsg.type = eBusDevRespGetVarBulk;
+        sTxMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
+        sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
+        break;
+    case eBusDevReqSetVarBulk:
+        BusVarSetBulk(&spBusMsg->msg.devBus.x.devReq.setVarBulk,
+                      &sTxMsg.msg.devBus.x.devResp.setVarBulk);
+        for (i = 0; i < sTxMsg.msg.devBus.x.devResp.setVarBulk.length; i += 2) {
+            if (sTxMsg.msg.devBus.x.devResp.setVarBulk.entry[i] == 0) { // enable event
+                sCheckBusvarEnable = true;
+            }
+        }
+        sTxMsg.senderAddr = MY_ADDR;
+        sTxMsg.type = eBusDevRespSetVarBulk;
+        sTxMsg.msg.devBus.receiverAddr = spBusMsg->senderAddr;
+        sTxRetry = BusSend(&sTxMsg) != BUS_SEND_OK;
+        break;
+    case eBusDevRespSetVarBulk:
+        BusVarRespSetBulk(spBusMsg->senderAddr, &spBusMsg->msg.devBus.x.devResp.setVarBulk);
+        break;
+    case eBusDevRespGetVarBulk:
+        BusVarRespGetBulk(spBusMsg->senderAddr, &spBusMsg->msg.devBus.x.devResp.getVarBulk);
+        break;
     case eBusDevReqGetFlashData:
         sTxMsg.senderAddr = MY_ADDR;
         sTxMsg.type = eBusDevRespGetFlashData;
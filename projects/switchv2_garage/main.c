@@ -139,7 +139,7 @@ typedef struct {
 /*-----------------------------------------------------------------------------
 *  Variables
 */
-char version[] = "Sw88_grg 0.03";
+char version[] = "Sw88_grg 0.04";
 
 static TBusTelegram *spRxBusMsg;
 static TBusTelegram sTxBusMsg;
@@ -568,9 +568,33 @@ static void ProcessBus(void) {
     uint8_t       i;
     uint8_t       *p;
     bool        msgForMe = false;
+    uint8_t       action;
+    TBusDevSetValueSw8 setValue;
+    static uint8_t sSetValueMultiSender = BUS_CLIENT_ADDRESS_INVALID;
+    static uint8_t sSetValueMultiSeq;
+    static bool    sSetValueMultiResp = false;
+    static uint8_t sSetValueMultiRespAddr;
+    static uint8_t sSetValueMultiRespSeq;
+    static uint16_t sSetValueMultiRespTime;
+    static uint16_t sSetValueMultiRespDelay;
+    uint16_t      actualTime16;
+    uint8_t       idx;
 
     ret = BusCheck();
 
+    /* multicast set value: response in the slot of our entry */
+    if (sSetValueMultiResp && (ret != BUS_MSG_OK)) {
+        GET_TIME_MS16(actualTime16);
+        if (((uint16_t)(actualTime16 - sSetValueMultiRespTime)) >= sSetValueMultiRespDelay) {
+            sSetValueMultiResp = false;
+            sTxBusMsg.type = eBusDevRespSetValueMulti;
+            sTxBusMsg.senderAddr = MY_ADDR;
+            sTxBusMsg.msg.devBus.receiverAddr = sSetValueMultiRespAddr;
+            sTxBusMsg.msg.devBus.x.devResp.setValueMulti.seq = sSetValueMultiRespSeq;
+            BusSend(&sTxBusMsg);
+        }
+    }
+
     if (ret == BUS_MSG_OK) {
         msgType = spRxBusMsg->type;
         switch (msgType) {
@@ -588,6 +612,10 @@ static void ProcessBus(void) {
                msgForMe = true;
             }
             break;
+        case eBusDevReqSetValueMulti:
+            /* my address is in the entry list */
+            msgForMe = true;
+            break;
         case eBusButtonPressed1:
         case eBusButtonPressed2:
         case eBusButtonPressed1_2:
@@ -621,7 +649,7 @@ static void ProcessBus(void) {
         case eBusDevReqSetValue:
             if (spRxBusMsg->msg.devBus.x.devReq.setValue.devType == eBusDevTypeSw8) {
                 /* bit 2 and 3 contains the setvalue for our output pin */
-                uint8_t action = (spRxBusMsg->msg.devBus.x.devReq.setValue.setValue.sw8.digOut[0] & 0x0c) >> 2;
+                action = (spRxBusMsg->msg.devBus.x.devReq.setValue.setValue.sw8.digOut[0] & 0x0c) >> 2;
                 /* support only trigger */
                 if (action == 1) {
                     DigOutTrigger();
@@ -633,6 +661,37 @@ static void ProcessBus(void) {
                 BusSend(&sTxBusMsg);
             }
             break;
+        case eBusDevReqSetValueMulti:
+            memset(&setValue, 0, sizeof(setValue)); /* no change */
+            if (!BusSetValueMultiGet(&spRxBusMsg->msg.devBus.x.devReq.setValueMulti, MY_ADDR,
+                                     (uint8_t *)&setValue, sizeof(setValue), sizeof(setValue.digOut),
+                                     &idx)) {
+                /* no entry for us: the next telegram of this sender is new
+                 * even with the same seq */
+                if (spRxBusMsg->senderAddr == sSetValueMultiSender) {
+                    sSetValueMultiSender = BUS_CLIENT_ADDRESS_INVALID;
+                }
+                break;
+            }
+            /* retry (same seq): confirm only */
+            if ((spRxBusMsg->senderAddr != sSetValueMultiSender) ||
+                (spRxBusMsg->msg.devBus.x.devReq.setValueMulti.seq != sSetValueMultiSeq)) {
+                sSetValueMultiSender = spRxBusMsg->senderAddr;
+                sSetValueMultiSeq = spRxBusMsg->msg.devBus.x.devReq.setValueMulti.seq;
+                /* bit 2 and 3 contains the setvalue for our output pin */
+                action = (setValue.digOut[0] & 0x0c) >> 2;
+                /* support only trigger */
+                if (action == 1) {
+                    DigOutTrigger();
+                }
+            }
+            /* response delayed by the index of our entry (one slot per entry) */
+            sSetValueMultiRespAddr = spRxBusMsg->senderAddr;
+            sSetValueMultiRespSeq = sSetValueMultiSeq;
+            GET_TIME_MS16(sSetValueMultiRespTime);
+            sSetValueMultiRespDelay = idx * BUS_SETVALUE_MULTI_SLOT_MS;
+            sSetValueMultiResp = true;
+            break;
         case eBusDevRespActualValueEvent:
             pClient = sClient;
             for (i = 0; i < sNumClients; i++) {
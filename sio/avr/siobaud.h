@@ -0,0 +1,94 @@
+/*
+ * siobaud.h
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef _SIOBAUD_H
+#define _SIOBAUD_H
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+/* UBRR value for normal and double speed mode (rounded) */
+#define SIO_UBRR(baud)      ((F_CPU + 8UL * (baud)) / (16UL * (baud)) - 1)
+#define SIO_UBRR_X2(baud)   ((F_CPU + 4UL * (baud)) / (8UL * (baud)) - 1)
+
+/* baud rate error of ubrr setting within +-2.5 % (div: 16 normal, 8 double
+ * speed), e.g. 57600 @ 8MHz (2.1 %) is possible, 115200 @ 8MHz (3.5 %) not
+ */
+#define SIO_BAUD_OK(ubrr, div, baud)                                 \
+    (((F_CPU / ((div) * ((ubrr) + 1))) * 40UL >= (baud) * 39UL) &&   \
+     ((F_CPU / ((div) * ((ubrr) + 1))) * 40UL <= (baud) * 41UL))
+
+/* baud rate settings calculated from F_CPU at compile time
+ * normal mode is preferred, double speed mode is used if normal mode is
+ * not exact enough. error is set if the baud rate is not possible
+ */
+#define SIO_BAUD_SETTINGS(baud, ubrr, doubleBr, error)      \
+    if (SIO_BAUD_OK(SIO_UBRR(baud), 16UL, baud)) {          \
+        ubrr = SIO_UBRR(baud);                              \
+        doubleBr = false;                                   \
+        error = false;                                      \
+    } else if (SIO_BAUD_OK(SIO_UBRR_X2(baud), 8UL, baud)) { \
+        ubrr = SIO_UBRR_X2(baud);                           \
+        doubleBr = true;                                    \
+        error = false;                                      \
+    } else {                                                \
+        error = true;                                       \
+    }
+
+/*-----------------------------------------------------------------------------
+*  Functions
+*/
+
+/*-----------------------------------------------------------------------------
+*  scale timer ticks defined for 9600 to baud rate (e.g. intercharacter
+*  timeout of 2 characters). result is rounded up, min. minTicks
+*/
+static inline uint16_t SioScaleTicks(uint16_t ticks9600, TSioBaud baud, uint16_t minTicks) {
+
+    uint8_t  factor;
+    uint16_t ticks;
+
+    switch (baud) {
+    case eSioBaud19200:
+        factor = 2;
+        break;
+    case eSioBaud38400:
+        factor = 4;
+        break;
+    case eSioBaud57600:
+        factor = 6;
+        break;
+    case eSioBaud115200:
+        factor = 12;
+        break;
+    default:
+        factor = 1;
+        break;
+    }
+    ticks = (ticks9600 + factor - 1) / factor;
+    if (ticks < minTicks) {
+        ticks = minTicks;
+    }
+    return ticks;
+}
+
+#endif
@@ -28,6 +28,7 @@
 
 #include "sysdef.h"
 #include "sio.h"
+#include "siobaud.h"
 
 /*-----------------------------------------------------------------------------
 *  Macros
@@ -100,6 +101,18 @@ int SioOpen(const char *pPortName,   /* is ignored */
          error = ERR_9600;
          doubleBr = BRX2_9600;
          break;
+      case eSioBaud19200:
+         SIO_BAUD_SETTINGS(19200, ubrr, doubleBr, error);
+         break;
+      case eSioBaud38400:
+         SIO_BAUD_SETTINGS(38400, ubrr, doubleBr, error);
+         break;
+      case eSioBaud57600:
+         SIO_BAUD_SETTINGS(57600, ubrr, doubleBr, error);
+         break;
+      case eSioBaud115200:
+         SIO_BAUD_SETTINGS(115200, ubrr, doubleBr, error);
+         break;
       default:
          error = true;
          break;
@@ -355,6 +368,14 @@ bool SioHandleValid(int handle) {
     return true;
 }
 
+/*-----------------------------------------------------------------------------
+*  set tx priority
+*  no bus access backoff in this variant (no idle wait), the priority is
+*  ignored
+*/
+void SioSetTxPrio(int handle, TSioTxPrio prio) {
+}
+
 /*-----------------------------------------------------------------------------
 *  USART1 Rx-Complete Interrupt
 */
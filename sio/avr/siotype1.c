@@ -29,6 +29,7 @@
 
 #include "sysdef.h"
 #include "sio.h"
+#include "siobaud.h"
 
 /*-----------------------------------------------------------------------------
 *  Macros
@@ -66,7 +67,13 @@
 #endif
 
 #define MAX_TX_RETRY  16
+/* timing constants for 9600, scaled to the baud rate in SioOpen */
 #define INTERCHAR_TIMEOUT  TIMER1_MS2
+#define BACKOFF_SLOT       TIMER1_MS1
+/* backoff window per retry in BACKOFF_SLOTs */
+#define BACKOFF_WINDOW(prio)  ((prio) == eSioTxPrioHigh ? 4 : 16)
+/* additional bus idle wait of low priority telegrams in BACKOFF_SLOTs */
+#define IDLE_WAIT_LOW         2
 
 #define MAX_JAM_CNT   8
 
@@ -79,6 +86,9 @@ typedef struct {
     uint8_t  txRxComparePos;
     uint8_t  txJamCnt;
     uint16_t txDelayTicks;
+    uint16_t intercharTimeout;   // timer ticks
+    uint16_t backoffSlot;        // timer ticks
+    uint8_t  txPrio;             // TSioTxPrio of buffered tx data
     enum {
         eIdle,          // no activity
         eRxing,         // rx is in progress (no data in tx)
@@ -149,6 +159,29 @@ static uint8_t MyRand(void) {
     return (uint8_t)(sRand + (sRand >> 8));
 }
 
+/*-----------------------------------------------------------------------------
+*  bus idle time before tx start depending on tx priority
+*  high: one backoff slot shorter than intercharacter timeout (min. 2 ticks)
+*  low:  IDLE_WAIT_LOW backoff slots longer
+*/
+static uint16_t IdleWait(TCommState *pComm) {
+    uint16_t ticks;
+
+    switch (pComm->txPrio) {
+    case eSioTxPrioHigh:
+        ticks = pComm->intercharTimeout - pComm->backoffSlot;
+        ticks = max(ticks, 2);
+        break;
+    case eSioTxPrioLow:
+        ticks = pComm->intercharTimeout + IDLE_WAIT_LOW * pComm->backoffSlot;
+        break;
+    default:
+        ticks = pComm->intercharTimeout;
+        break;
+    }
+    return ticks;
+}
+
 /*-----------------------------------------------------------------------------
 *  open sio channel
 */
@@ -171,6 +204,18 @@ int SioOpen(const char *pPortName,   /* is ignored */
         error = ERR_9600;
         doubleBr = BRX2_9600;
         break;
+    case eSioBaud19200:
+        SIO_BAUD_SETTINGS(19200, ubrr, doubleBr, error);
+        break;
+    case eSioBaud38400:
+        SIO_BAUD_SETTINGS(38400, ubrr, doubleBr, error);
+        break;
+    case eSioBaud57600:
+        SIO_BAUD_SETTINGS(57600, ubrr, doubleBr, error);
+        break;
+    case eSioBaud115200:
+        SIO_BAUD_SETTINGS(115200, ubrr, doubleBr, error);
+        break;
     default:
         error = true;
         break;
@@ -231,10 +276,13 @@ int SioOpen(const char *pPortName,   /* is ignored */
     UCSR0C = ucsrc;
 
     sComm.state = eIdle;
+    sComm.intercharTimeout = SioScaleTicks(INTERCHAR_TIMEOUT, baud, 2);
+    sComm.backoffSlot = SioScaleTicks(BACKOFF_SLOT, baud, 1);
     sComm.txRetryCnt = 0;
     sComm.txRxComparePos = 0;
     sComm.txDelayTicks = 0;
     sComm.txStartup = false;
+    sComm.txPrio = eSioTxPrioNormal;
 
     sIdleFunc = 0;
     sBusTransceiverPowerDownFunc = 0;
@@ -344,6 +392,9 @@ uint8_t SioWriteBuffered(int handle, uint8_t *pBuf, uint8_t bufSize) {
 
     if ((sComm.state == eIdle) ||
         (sComm.state == eRxing)) {
+        if (sTxBufBufferedPos == 0) {
+            sComm.txPrio = eSioTxPrioNormal;
+        }
         len = sizeof(sTxBufferBuffered) - sTxBufBufferedPos;
         len = min(len, bufSize);
         memcpy(&sTxBufferBuffered[sTxBufBufferedPos], pBuf, len);
@@ -374,7 +425,7 @@ bool SioSendBuffer(int handle) {
             rc = false;
         }
     } else if (sComm.state == eRxing) {
-        sComm.txDelayTicks = INTERCHAR_TIMEOUT;
+        sComm.txDelayTicks = IdleWait(&sComm);
         sComm.state = eTxPending;
         rc = true;
     } else {
@@ -386,6 +437,18 @@ bool SioSendBuffer(int handle) {
     return rc;
 }
 
+/*-----------------------------------------------------------------------------
+*  set tx priority of the data in the tx buffer (SioWriteBuffered)
+*  the priority is reset to normal by the first write to the empty buffer
+*/
+void SioSetTxPrio(int handle, TSioTxPrio prio) {
+
+    if ((sComm.state == eIdle) ||
+        (sComm.state == eRxing)) {
+        sComm.txPrio = prio;
+    }
+}
+
 /*-----------------------------------------------------------------------------
 *  free space in tx buffer
 */
@@ -504,8 +567,8 @@ ISR(USART_UDRE_vect) {
         }
     } else if (sTxBufWrIdx != rdIdx) {
         if (sComm.state == eRxing) {
-            sComm.txDelayTicks = INTERCHAR_TIMEOUT;
-            TimerStart(INTERCHAR_TIMEOUT);
+            sComm.txDelayTicks = IdleWait(&sComm);
+            TimerStart(sComm.txDelayTicks);
             sComm.state = eTxPending;
             StopTx();
             UCSR0B &= ~(1 << UDRIE0);
@@ -522,8 +585,8 @@ ISR(USART_UDRE_vect) {
                 UDR0 = txChar;
             } else {
                 EIFR = 1 << INTF0;
-                sComm.txDelayTicks = INTERCHAR_TIMEOUT;
-                TimerStart(INTERCHAR_TIMEOUT);
+                sComm.txDelayTicks = IdleWait(&sComm);
+                TimerStart(sComm.txDelayTicks);
                 sComm.state = eTxPending;
                 StopTx();
                 UCSR0B &= ~(1 << UDRIE0);
@@ -564,7 +627,7 @@ ISR(USART_TX_vect) {
 
     if (sComm.state == eTxJamming) {
         sComm.state = eTxStopped;
-        TimerStart(INTERCHAR_TIMEOUT);
+        TimerStart(sComm.intercharTimeout);
     } else {
         sComm.state = eIdle;
         EIFR = 1 < INTF0;
@@ -590,7 +653,7 @@ ISR(USART_RX_vect) {
                 sComm.txRetryCnt = 0;
                 TimerStop();
             } else {
-                TimerStart(INTERCHAR_TIMEOUT);
+                TimerStart(sComm.intercharTimeout);
             }
         } else {
             // collision detected
@@ -621,7 +684,7 @@ ISR(USART_RX_vect) {
     case eIdle:
     default:
         sComm.state = eRxing;
-        TimerStart(INTERCHAR_TIMEOUT);
+        TimerStart(sComm.intercharTimeout);
         doRx = true;
         break;
     }
@@ -707,12 +770,14 @@ static void Timeout(void) {
         if (sComm.txRetryCnt < MAX_TX_RETRY) {
             // timeout on eTxing will appear on tx collision detection
             sComm.state = eTxPending;
+            // @9600 baud, shorter for higher baud rates, normal priority
             // txRetryCnt = 1:  delayTicks = 2 .. 17 ms
             // txRetryCnt = 2:  delayTicks = 2 .. 33 ms
             // txRetryCnt = 3:  delayTicks = 2 .. 49 ms
             // ...
             // txRetryCnt = 15: delayTicks = 2 .. 241 ms
-            sComm.txDelayTicks = INTERCHAR_TIMEOUT + MyRand() % (sComm.txRetryCnt * 16) * TIMER1_MS1;
+            // high priority: 1 .. (4 * txRetryCnt) ms, low priority: + 2 ms
+            sComm.txDelayTicks = IdleWait(&sComm) + MyRand() % (sComm.txRetryCnt * BACKOFF_WINDOW(sComm.txPrio)) * sComm.backoffSlot;
             TimerStart(sComm.txDelayTicks);
         } else {
             // skip current BufferedSend buffer
@@ -766,7 +831,7 @@ static void RxStartDetectionExit(void) {
 ISR(INT0_vect) {
     if (sComm.state == eIdle) {
         sComm.state = eRxing;
-        TimerStart(INTERCHAR_TIMEOUT);
+        TimerStart(sComm.intercharTimeout);
     }
     EIMSK &= ~(1 << INT0);
 }
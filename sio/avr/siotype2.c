@@ -29,6 +29,7 @@
 
 #include "sysdef.h"
 #include "sio.h"
+#include "siobaud.h"
 
 /*-----------------------------------------------------------------------------
 *  Macros
@@ -87,7 +88,13 @@
 #endif
 
 #define MAX_TX_RETRY  16
+/* timing constants for 9600, scaled to the baud rate in SioOpen */
 #define INTERCHAR_TIMEOUT  TIMER1_MS2
+#define BACKOFF_SLOT       TIMER1_MS1
+/* backoff window per retry in BACKOFF_SLOTs */
+#define BACKOFF_WINDOW(prio)  ((prio) == eSioTxPrioHigh ? 4 : 16)
+/* additional bus idle wait of low priority telegrams in BACKOFF_SLOTs */
+#define IDLE_WAIT_LOW         2
 
 #define MAX_JAM_CNT   8
 
@@ -117,6 +124,9 @@ typedef struct {
     uint8_t  txRxComparePos;
     uint8_t  txJamCnt;
     uint16_t txDelayTicks;
+    uint16_t intercharTimeout;   // timer ticks
+    uint16_t backoffSlot;        // timer ticks
+    uint8_t  txPrio;             // TSioTxPrio of buffered tx data
     enum {
         eIdle,          // no activity
         eRxing,         // rx is in progress (no data in tx)
@@ -219,6 +229,29 @@ static uint8_t MyRand(void) {
     return (uint8_t)(sRand + (sRand >> 8));
 }
 
+/*-----------------------------------------------------------------------------
+*  bus idle time before tx start depending on tx priority
+*  high: one backoff slot shorter than intercharacter timeout (min. 2 ticks)
+*  low:  IDLE_WAIT_LOW backoff slots longer
+*/
+static uint16_t IdleWait(TCommState *pComm) {
+    uint16_t ticks;
+
+    switch (pComm->txPrio) {
+    case eSioTxPrioHigh:
+        ticks = pComm->intercharTimeout - pComm->backoffSlot;
+        ticks = max(ticks, 2);
+        break;
+    case eSioTxPrioLow:
+        ticks = pComm->intercharTimeout + IDLE_WAIT_LOW * pComm->backoffSlot;
+        break;
+    default:
+        ticks = pComm->intercharTimeout;
+        break;
+    }
+    return ticks;
+}
+
 /*-----------------------------------------------------------------------------
 *  open sio channel
 */
@@ -243,6 +276,18 @@ int SioOpen(const char *pPortName,   /* is ignored */
         error = ERR_9600;
         doubleBr = BRX2_9600;
         break;
+    case eSioBaud19200:
+        SIO_BAUD_SETTINGS(19200, ubrr, doubleBr, error);
+        break;
+    case eSioBaud38400:
+        SIO_BAUD_SETTINGS(38400, ubrr, doubleBr, error);
+        break;
+    case eSioBaud57600:
+        SIO_BAUD_SETTINGS(57600, ubrr, doubleBr, error);
+        break;
+    case eSioBaud115200:
+        SIO_BAUD_SETTINGS(115200, ubrr, doubleBr, error);
+        break;
     default:
         error = true;
         break;
@@ -357,10 +402,13 @@ int SioOpen(const char *pPortName,   /* is ignored */
     *pChan->ucsrc = ucsrc;
 
     pChan->comm.state = eIdle;
+    pChan->comm.intercharTimeout = SioScaleTicks(INTERCHAR_TIMEOUT, baud, 2);
+    pChan->comm.backoffSlot = SioScaleTicks(BACKOFF_SLOT, baud, 1);
     pChan->comm.txRetryCnt = 0;
     pChan->comm.txRxComparePos = 0;
     pChan->comm.txDelayTicks = 0;
     pChan->comm.txStartup = false;
+    pChan->comm.txPrio = eSioTxPrioNormal;
 
     pChan->valid = true;
     pChan->rxBufWrIdx = 0;
@@ -475,6 +523,9 @@ uint8_t SioWriteBuffered(int handle, uint8_t *pBuf, uint8_t bufSize) {
     pChan = &sChan[handle];
     if ((pChan->comm.state == eIdle) ||
         (pChan->comm.state == eRxing)) {
+        if (pChan->txBufBufferedPos == 0) {
+            pChan->comm.txPrio = eSioTxPrioNormal;
+        }
         len = pChan->txBufBufferedSize - pChan->txBufBufferedPos;
         len = min(len, bufSize);
         memcpy(&pChan->pTxBufBuffered[pChan->txBufBufferedPos], pBuf, len);
@@ -509,7 +560,7 @@ bool SioSendBuffer(int handle) {
             rc = false;
         }
     } else if (pChan->comm.state == eRxing) {
-        pChan->comm.txDelayTicks = INTERCHAR_TIMEOUT;
+        pChan->comm.txDelayTicks = IdleWait(&pChan->comm);
         pChan->comm.state = eTxPending;
         rc = true;
     } else {
@@ -521,6 +572,22 @@ bool SioSendBuffer(int handle) {
     return rc;
 }
 
+/*-----------------------------------------------------------------------------
+*  set tx priority of the data in the tx buffer (SioWriteBuffered)
+*  the priority is reset to normal by the first write to the empty buffer
+*/
+void SioSetTxPrio(int handle, TSioTxPrio prio) {
+
+    TChanDesc  *pChan;
+
+    RETURN_ON_INVALID_HDL(handle);
+    pChan = &sChan[handle];
+    if ((pChan->comm.state == eIdle) ||
+        (pChan->comm.state == eRxing)) {
+        pChan->comm.txPrio = prio;
+    }
+}
+
 /*-----------------------------------------------------------------------------
 *  free space in tx buffer
 */
@@ -676,8 +743,8 @@ static void UdreInt(int handle) {
         }
     } else if (pChan->txBufWrIdx != rdIdx) {
         if (pChan->comm.state == eRxing) {
-            pChan->comm.txDelayTicks = INTERCHAR_TIMEOUT;
-            TimerStart(pChan, INTERCHAR_TIMEOUT);
+            pChan->comm.txDelayTicks = IdleWait(&pChan->comm);
+            TimerStart(pChan, pChan->comm.txDelayTicks);
             pChan->comm.state = eTxPending;
             StopTx(pChan);
             *pChan->ucsrb &= ~(1 << UDRIE);
@@ -695,8 +762,8 @@ static void UdreInt(int handle) {
                 *pChan->udr = txChar;
             } else {
                 *pChan->extIntEIFR = pChan->extIntEIFRVal;
-                pChan->comm.txDelayTicks = INTERCHAR_TIMEOUT;
-                TimerStart(pChan, INTERCHAR_TIMEOUT);
+                pChan->comm.txDelayTicks = IdleWait(&pChan->comm);
+                TimerStart(pChan, pChan->comm.txDelayTicks);
                 pChan->comm.state = eTxPending;
                 StopTx(pChan);
                 *pChan->ucsrb &= ~(1 << UDRIE);
@@ -751,7 +818,7 @@ static void TxcInt(int handle) {
 
     if (pChan->comm.state == eTxJamming) {
         pChan->comm.state = eTxStopped;
-        TimerStart(pChan, INTERCHAR_TIMEOUT);
+        TimerStart(pChan, pChan->comm.intercharTimeout);
     } else {
         pChan->comm.state = eIdle;
         if (pChan->extIntEIMSK != 0) {
@@ -792,7 +859,7 @@ static void RxcInt(int handle) {
                 pChan->comm.txRetryCnt = 0;
                 TimerStop(pChan);
             } else {
-                TimerStart(pChan, INTERCHAR_TIMEOUT);
+                TimerStart(pChan, pChan->comm.intercharTimeout);
             }
         } else {
             // collision detected
@@ -823,7 +890,7 @@ static void RxcInt(int handle) {
     case eIdle:
     default:
         pChan->comm.state = eRxing;
-        TimerStart(pChan, INTERCHAR_TIMEOUT);
+        TimerStart(pChan, pChan->comm.intercharTimeout);
         doRx = true;
         break;
     }
@@ -900,12 +967,14 @@ static void Timeout(int handle) {
         if (pChan->comm.txRetryCnt < MAX_TX_RETRY) {
             // timeout on eTxing will appear on tx collision detection
             pChan->comm.state = eTxPending;
+            // @9600 baud, shorter for higher baud rates, normal priority
             // txRetryCnt = 1:  delayTicks = 2 .. 17 ms
             // txRetryCnt = 2:  delayTicks = 2 .. 33 ms
             // txRetryCnt = 3:  delayTicks = 2 .. 49 ms
             // ...
             // txRetryCnt = 15: delayTicks = 2 .. 241 ms
-            pChan->comm.txDelayTicks = INTERCHAR_TIMEOUT + MyRand() % (pChan->comm.txRetryCnt * 16) * TIMER1_MS1;
+            // high priority: 1 .. (4 * txRetryCnt) ms, low priority: + 2 ms
+            pChan->comm.txDelayTicks = IdleWait(&pChan->comm) + MyRand() % (pChan->comm.txRetryCnt * BACKOFF_WINDOW(pChan->comm.txPrio)) * pChan->comm.backoffSlot;
             TimerStart(pChan, pChan->comm.txDelayTicks);
         } else {
             // skip current BufferedSend buffer
@@ -958,7 +1027,7 @@ static void RxStart(int handle) {
 
     if (pChan->comm.state == eIdle) {
         pChan->comm.state = eRxing;
-        TimerStart(pChan, INTERCHAR_TIMEOUT);
+        TimerStart(pChan, pChan->comm.intercharTimeout);
     }
     *pChan->extIntEIMSK &= ~pChan->extIntEIMSKVal;
 }
@@ -28,8 +28,18 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
 #include <termios.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/select.h>
+#include <linux/serial.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/timerfd.h>
 #include "sysdef.h"
 #include "sio.h"
 
@@ -37,38 +47,132 @@
 *  Macros
 */
 
-#define MAX_NUM_SIO     4
-#define UNREAD_BUF_SIZE 512  // 2er-Potenz!!
-#define TX_BUF_SIZE     255  // max 255
+#define SIO_CHUNK_SIZE  16   // handle table grows by chunks of descriptors
+#define SIO_MAX_CHUNK   64   // max. SIO_MAX_CHUNK * SIO_CHUNK_SIZE handles
+#define SIO_DESC(handle) sSioChunk[(handle) / SIO_CHUNK_SIZE][(handle) % SIO_CHUNK_SIZE]
+#define UNREAD_BUF_SIZE 512  // default, 2er-Potenz!!
+#define TX_BUF_SIZE     255  // default
+#define MIN_UNREAD_BUF_SIZE 256   // one SioUnRead has to fit
+#define MAX_UNREAD_BUF_SIZE 32768 // 2er-Potenz, 16 bit
+#define TX_TIMEOUT_US   1000000 // SioSendBuffer: max. wait for tx space
+#define TX_QUEUE_LEN    32   // number of telegrams in tx queue, 2er-Potenz!!
+#define TX_QUEUE_MSG_SIZE 128 // max. size of one telegram in tx queue
+
+/* eSioModeHalfDuplexCd: timing as sio/avr/siotype1.c in character times */
+#define CD_INTERCHAR_CHARS   2    // idle line: no character for 2 character times
+#define CD_MAX_TX_RETRY      16
+#define CD_JAM_CNT           8
+/* backoff window per retry in slots (1 character time) */
+#define CD_BACKOFF_WINDOW(prio)  ((prio) == eSioTxPrioHigh ? 4 : 16)
+/* additional bus idle wait of low priority telegrams in slots */
+#define CD_IDLE_WAIT_LOW     2
+#define CD_ECHO_MARGIN_US    20000  // read back latency (usb adapters)
+#define CD_BUSY_TIMEOUT_US   1000000 // max. wait for idle line
+
+#define NET_PREFIX_TCP       "tcp://"
+#define NET_PREFIX_UDP       "udp://"
+
+#define REPLAY_PREFIX        "replay://"
+#define REPLAY_LINE_SIZE     4096
 
 /*-----------------------------------------------------------------------------
 *  typedefs
 */
+typedef enum {
+   eSioTransportDevice, // serial device
+   eSioTransportTcp,    // byte stream
+   eSioTransportUdp,    // one datagram per telegram/write
+   eSioTransportReplay  // capture file, fd is a timerfd
+} TSioTransport;
+
+typedef struct {
+   uint64_t     timeUs;   // relative to first chunk of capture
+   unsigned int offs;     // in data
+   uint8_t      len;
+} TSioReplayChunk;
+
 typedef struct {
    bool    used;
    int     fd;
+   TSioTransport transport;
+   bool    closed;             // tcp: connection closed by peer
+   TSioMode mode;
+   uint64_t rxTimeUs;          // time of last chunk read from driver (monotonic)
    struct {
-      uint8_t buf[TX_BUF_SIZE];
-      uint8_t pos;
+      TSioTxPrio   txPrio;
+      unsigned int charTimeUs;
+      unsigned int randState;
+   } cd;
+   struct {
+      uint8_t  *buf;
+      uint16_t size;
+      uint16_t pos;
    } bufferedTx;
    struct {
-      uint8_t        buf[UNREAD_BUF_SIZE];
+      uint8_t      *buf;
+      unsigned int size;       // 2er-Potenz!!
       unsigned int bufIdxWr;
       unsigned int bufIdxRd;
+      uint64_t     timeUs;     // rx time of the characters in buf
    } unRead;
+   struct {
+      uint8_t      *buf;       // size of unRead.buf: max. datagram size
+      unsigned int pos;        // udp: chars of next datagram already read
+   } datagram;
+   struct {
+      TSioReplayChunk *pChunk;
+      unsigned int    numChunk;
+      uint8_t         *pData;
+      unsigned int    idx;     // next chunk
+      uint8_t         pos;     // chars of chunk idx already read
+      double          speed;   // 1: real time, 0: as fast as possible
+      uint64_t        startUs; // replay start (monotonic)
+   } replay;
+   FILE *pCapture;             // SioCaptureOpen
+   struct {
+      struct {
+         uint8_t  buf[TX_QUEUE_MSG_SIZE];
+         uint8_t  len;
+         int      id;
+         uint8_t  prio;
+      } msg[TX_QUEUE_LEN];
+      unsigned int   idxWr;
+      unsigned int   idxRd;
+      uint8_t        posRd;      // chars of msg[idxRd] already written
+      int            nextId;
+      TSioTxDoneFunc doneFunc;
+   } txQueue;
 } TSioDesc;
 
 /*-----------------------------------------------------------------------------
 *  Variables
 */
-static TSioDesc sSio[MAX_NUM_SIO];
+/* handle table: the chunks are allocated on SioOpen and never moved,
+ * SioOpen and SioClose must not run concurrently with any other Sio call
+ * (see sio.h) */
+static TSioDesc **sSioChunk[SIO_MAX_CHUNK];
+static int      sNumSio;
+static unsigned int sRandSeed;
 
 /*-----------------------------------------------------------------------------
 *  Functions
 */
 static bool HandleValid(int handle);
 static unsigned int UnReadBufLen(int handle);
-static uint8_t ReadUnRead(int handle, uint8_t *pBuf, uint8_t bufSize);
+static unsigned int ReadUnRead(int handle, uint8_t *pBuf, unsigned int bufSize);
+static void UnRead(int handle, const uint8_t *pBuf, unsigned int bufSize);
+static unsigned int NumRxChar(int handle, unsigned int max);
+static bool BufAlloc(TSioDesc *pSio, unsigned int rxSize, unsigned int txSize);
+static void BufFree(TSioDesc *pSio);
+static bool WriteAll(TSioDesc *pSio, const uint8_t *pBuf, unsigned int len);
+static uint64_t NowUs(void);
+static int ReadFd(int handle, uint8_t *pBuf, uint8_t bufSize);
+static int NetOpen(const char *pPortName, TSioTransport *pTransport);
+static int ReplayOpen(TSioDesc *pSio, const char *pPortName);
+static uint64_t ReplayDueUs(TSioDesc *pSio, unsigned int idx);
+static void ReplayArm(TSioDesc *pSio);
+static unsigned int ReplayNumDue(TSioDesc *pSio, unsigned int max);
+static bool CdSend(int handle, const uint8_t *pBuf, unsigned int len);
 
 
 /*-----------------------------------------------------------------------------
@@ -78,13 +182,55 @@ void SioInit(void) {
 
    int i;
 
-   for (i = 0; i < MAX_NUM_SIO; i++) {
-      sSio[i].used = false;
+   for (i = 0; i < sNumSio; i++) {
+      if (SIO_DESC(i) != 0) {
+         SIO_DESC(i)->used = false;
+      }
+   }
+   sRandSeed = (unsigned int)getpid() ^ (unsigned int)NowUs();
+}
+
+/*-----------------------------------------------------------------------------
+*  set seed of random num generator (backoff in eSioModeHalfDuplexCd),
+*  used for the handles opened afterwards
+*/
+void SioRandSeed(uint8_t seed) {
+   sRandSeed = seed;
+}
+
+/*-----------------------------------------------------------------------------
+*  close all handles and free the handle table
+*/
+void SioExit(void) {
+
+   int i;
+
+   for (i = 0; i < sNumSio; i++) {
+      if (SIO_DESC(i) != 0) {
+         if (SIO_DESC(i)->used) {
+            SioClose(i);
+         }
+         free(SIO_DESC(i));
+      }
+   }
+   for (i = 0; i < SIO_MAX_CHUNK; i++) {
+      free(sSioChunk[i]);
+      sSioChunk[i] = 0;
    }
+   sNumSio = 0;
 }
 
 /*-----------------------------------------------------------------------------
 *  Schnittstelle �ffnen
+*  pPortName: serial device or network endpoint
+*             tcp://host:port  byte stream (e.g. ser2net raw tcp)
+*             udp://host:port  one datagram per SioWrite/SioSendBuffer/telegram
+*                              of tx queue
+*             replay://file[@speed]  replay of a capture (SioCaptureOpen),
+*                              speed 1: real time (default), N: N times
+*                              faster, 0: as fast as possible
+*                              writes are accepted and discarded
+*  for network endpoints and replay the line settings are not used
 */
 int SioOpen(const char *pPortName,
             TSioBaud baud,
@@ -96,27 +242,72 @@ int SioOpen(const char *pPortName,
    int            fd;
    int            i;
    struct termios settings;
+   TSioDesc       **pChunk;
 
    // freien descriptor suchen
-   for (i = 0; (i < MAX_NUM_SIO) && (sSio[i].used == true); i++);
+   for (i = 0; (i < sNumSio) && (SIO_DESC(i) != 0) && (SIO_DESC(i)->used == true); i++);
 
-   if (i == MAX_NUM_SIO) {
-      // kein Platz
+   if (i == sNumSio) {
+      // kein Platz: Tabelle um einen Block vergroessern
+      pChunk = 0;
+      if (sNumSio < (SIO_MAX_CHUNK * SIO_CHUNK_SIZE)) {
+         pChunk = calloc(SIO_CHUNK_SIZE, sizeof(*pChunk));
+      }
+      if (pChunk == 0) {
+         printf("no handle for %s\r\n", pPortName);
+         return -1;
+      }
+      sSioChunk[sNumSio / SIO_CHUNK_SIZE] = pChunk;
+      sNumSio += SIO_CHUNK_SIZE;
+   }
+   if (SIO_DESC(i) == 0) {
+      SIO_DESC(i) = calloc(1, sizeof(TSioDesc));
+   }
+   if ((SIO_DESC(i) == 0) ||
+       !BufAlloc(SIO_DESC(i), UNREAD_BUF_SIZE, TX_BUF_SIZE)) {
       printf("no handle for %s\r\n", pPortName);
       return -1;
    }
 
-   fd = open(pPortName, O_RDWR | O_NOCTTY | O_NONBLOCK);
+   if ((strncmp(pPortName, NET_PREFIX_TCP, strlen(NET_PREFIX_TCP)) == 0) ||
+       (strncmp(pPortName, NET_PREFIX_UDP, strlen(NET_PREFIX_UDP)) == 0)) {
+      fd = NetOpen(pPortName, &SIO_DESC(i)->transport);
+   } else if (strncmp(pPortName, REPLAY_PREFIX, strlen(REPLAY_PREFIX)) == 0) {
+      fd = ReplayOpen(SIO_DESC(i), pPortName);
+      SIO_DESC(i)->transport = eSioTransportReplay;
+   } else {
+      fd = open(pPortName, O_RDWR | O_NOCTTY | O_NONBLOCK);
+      SIO_DESC(i)->transport = eSioTransportDevice;
+   }
 
    if (fd == -1) {
+      BufFree(SIO_DESC(i));
       return -1;
    }
 
-   sSio[i].used = true;
-   sSio[i].fd = fd;
-   sSio[i].unRead.bufIdxWr = 0;
-   sSio[i].unRead.bufIdxRd = 0;
-   sSio[i].bufferedTx.pos = 0;
+   SIO_DESC(i)->used = true;
+   SIO_DESC(i)->fd = fd;
+   SIO_DESC(i)->closed = false;
+   SIO_DESC(i)->datagram.pos = 0;
+   SIO_DESC(i)->unRead.bufIdxWr = 0;
+   SIO_DESC(i)->unRead.bufIdxRd = 0;
+   SIO_DESC(i)->unRead.timeUs = 0;
+   SIO_DESC(i)->bufferedTx.pos = 0;
+   SIO_DESC(i)->txQueue.idxWr = 0;
+   SIO_DESC(i)->txQueue.idxRd = 0;
+   SIO_DESC(i)->txQueue.posRd = 0;
+   SIO_DESC(i)->txQueue.nextId = 0;
+   SIO_DESC(i)->txQueue.doneFunc = 0;
+   SIO_DESC(i)->mode = mode;
+   SIO_DESC(i)->cd.txPrio = eSioTxPrioNormal;
+   SIO_DESC(i)->rxTimeUs = 0;
+   SIO_DESC(i)->cd.randState = sRandSeed + i;
+   SIO_DESC(i)->cd.charTimeUs = 1042;
+   SIO_DESC(i)->pCapture = 0;
+
+   if (SIO_DESC(i)->transport != eSioTransportDevice) {
+      return i;
+   }
 
    memset(&settings, 0, sizeof(settings));
    tcgetattr(fd, &settings);
@@ -132,14 +323,37 @@ int SioOpen(const char *pPortName,
    settings.c_cflag =   CREAD |           /* characters may be read */
                         CLOCAL;          /* ignore modem state, local connection */
 
+   /* character time: 10 bit */
    switch (baud) {
       case eSioBaud9600:
          cfsetispeed(&settings, B9600);
          cfsetospeed(&settings, B9600);
+         SIO_DESC(i)->cd.charTimeUs = 1042;
+         break;
+      case eSioBaud19200:
+         cfsetispeed(&settings, B19200);
+         cfsetospeed(&settings, B19200);
+         SIO_DESC(i)->cd.charTimeUs = 521;
+         break;
+      case eSioBaud38400:
+         cfsetispeed(&settings, B38400);
+         cfsetospeed(&settings, B38400);
+         SIO_DESC(i)->cd.charTimeUs = 260;
+         break;
+      case eSioBaud57600:
+         cfsetispeed(&settings, B57600);
+         cfsetospeed(&settings, B57600);
+         SIO_DESC(i)->cd.charTimeUs = 174;
+         break;
+      case eSioBaud115200:
+         cfsetispeed(&settings, B115200);
+         cfsetospeed(&settings, B115200);
+         SIO_DESC(i)->cd.charTimeUs = 87;
          break;
       default:
          cfsetispeed(&settings, B9600);
          cfsetospeed(&settings, B9600);
+         SIO_DESC(i)->cd.charTimeUs = 1042;
          break;
    }
 
@@ -173,6 +387,9 @@ int SioOpen(const char *pPortName,
    if (tcsetattr(fd, TCSANOW, &settings) < 0) {
       fprintf(stderr, "Error setting terminal attributes for %s (errno: %s)!\n",
               pPortName, strerror (errno));
+      close(fd);
+      BufFree(SIO_DESC(i));
+      SIO_DESC(i)->used = false;
       return -1;
    }
    return i;
@@ -187,8 +404,16 @@ int SioClose(int handle) {
       return -1;
    }
 
-   sSio[handle].used = false;
-   close(sSio[handle].fd);
+   SIO_DESC(handle)->used = false;
+   close(SIO_DESC(handle)->fd);
+   BufFree(SIO_DESC(handle));
+   if (SIO_DESC(handle)->transport == eSioTransportReplay) {
+      free(SIO_DESC(handle)->replay.pChunk);
+      free(SIO_DESC(handle)->replay.pData);
+   }
+   if (SIO_DESC(handle)->pCapture != 0) {
+      fclose(SIO_DESC(handle)->pCapture);
+   }
 
    return 0;
 }
@@ -202,7 +427,7 @@ int SioGetFd(int handle) {
       return -1;
    }
 
-   return sSio[handle].fd;
+   return SIO_DESC(handle)->fd;
 }
 
 /*-----------------------------------------------------------------------------
@@ -216,8 +441,11 @@ uint8_t SioWrite(int handle, uint8_t *pBuf, uint8_t bufSize) {
     if (!HandleValid(handle)) {
         return 0;
     }
+    if (SIO_DESC(handle)->transport == eSioTransportReplay) {
+        return bufSize;
+    }
 
-    ret = write(sSio[handle].fd, pBuf, bufSize);
+    ret = write(SIO_DESC(handle)->fd, pBuf, bufSize);
     if (ret == -1) {
         bytesWritten = 0;
     } else {
@@ -231,15 +459,15 @@ uint8_t SioWrite(int handle, uint8_t *pBuf, uint8_t bufSize) {
 */
 uint8_t SioWriteBuffered(int handle, uint8_t *pBuf, uint8_t bufSize) {
 
-   uint8_t   len;
+   uint16_t  len;
    TSioDesc  *pSio;
 
    if (!HandleValid(handle)) {
       return 0;
    }
-   pSio = &sSio[handle];
+   pSio = SIO_DESC(handle);
 
-   len = sizeof(pSio->bufferedTx.buf) - pSio->bufferedTx.pos;
+   len = pSio->bufferedTx.size - pSio->bufferedTx.pos;
    len = min(len, bufSize);
    memcpy(&pSio->bufferedTx.buf[pSio->bufferedTx.pos], pBuf, len);
    pSio->bufferedTx.pos += len;
@@ -252,26 +480,212 @@ uint8_t SioWriteBuffered(int handle, uint8_t *pBuf, uint8_t bufSize) {
 */
 bool SioSendBuffer(int handle) {
 
-   int       ret;
    TSioDesc  *pSio;
    bool      rc;
 
    if (!HandleValid(handle)) {
       return 0;
    }
-   pSio = &sSio[handle];
+   pSio = SIO_DESC(handle);
 
-   ret = write(pSio->fd, pSio->bufferedTx.buf, pSio->bufferedTx.pos);
-   if (ret == pSio->bufferedTx.pos) {
-       rc = true;
-   } else {
-       rc = false;
+   if (pSio->transport == eSioTransportReplay) {
+      pSio->bufferedTx.pos = 0;
+      return true;
+   }
+   if (pSio->mode == eSioModeHalfDuplexCd) {
+      rc = CdSend(handle, pSio->bufferedTx.buf, pSio->bufferedTx.pos);
+      pSio->bufferedTx.pos = 0;
+      return rc;
    }
+
+   rc = WriteAll(pSio, pSio->bufferedTx.buf, pSio->bufferedTx.pos);
    pSio->bufferedTx.pos = 0;
 
    return rc;
 }
 
+/*-----------------------------------------------------------------------------
+*  tx priority of buffer: used for the bus access in eSioModeHalfDuplexCd,
+*  in the other modes the buffer is written directly in SioSendBuffer
+*/
+void SioSetTxPrio(int handle, TSioTxPrio prio) {
+
+   if (HandleValid(handle)) {
+      SIO_DESC(handle)->cd.txPrio = prio;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+*  set callback for completion of telegrams in tx queue
+*/
+void SioSetTxDoneFunc(int handle, TSioTxDoneFunc doneFunc) {
+
+   if (HandleValid(handle)) {
+      SIO_DESC(handle)->txQueue.doneFunc = doneFunc;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+*  append one telegram to tx queue - do not yet start with tx
+*  the telegram is queued behind all telegrams of the same or higher priority,
+*  a partly written telegram is never overtaken
+*  return value: id of telegram (passed to TSioTxDoneFunc on completion)
+*                -1 if queue is full or telegram is too long
+*/
+int SioTxQueueAdd(int handle, uint8_t *pBuf, uint8_t bufSize, TSioTxPrio prio) {
+
+   TSioDesc     *pSio;
+   unsigned int idx;
+   unsigned int pos;
+   unsigned int first;
+   int          id;
+
+   if (!HandleValid(handle)) {
+      return -1;
+   }
+   pSio = SIO_DESC(handle);
+
+   if (((pSio->txQueue.idxWr - pSio->txQueue.idxRd) == TX_QUEUE_LEN) ||
+       (bufSize > TX_QUEUE_MSG_SIZE) ||
+       (bufSize == 0)) {
+      return -1;
+   }
+   first = pSio->txQueue.idxRd;
+   if (pSio->txQueue.posRd != 0) {
+      first++;
+   }
+   /* move lower priority telegrams back */
+   for (pos = pSio->txQueue.idxWr; pos != first; pos--) {
+      idx = (pos - 1) & (TX_QUEUE_LEN - 1);
+      if (pSio->txQueue.msg[idx].prio >= prio) {
+         break;
+      }
+      pSio->txQueue.msg[pos & (TX_QUEUE_LEN - 1)] = pSio->txQueue.msg[idx];
+   }
+   idx = pos & (TX_QUEUE_LEN - 1);
+   memcpy(pSio->txQueue.msg[idx].buf, pBuf, bufSize);
+   pSio->txQueue.msg[idx].len = bufSize;
+   pSio->txQueue.msg[idx].prio = prio;
+   id = pSio->txQueue.nextId;
+   pSio->txQueue.msg[idx].id = id;
+   pSio->txQueue.nextId = (id + 1) & 0x7fffffff;
+   pSio->txQueue.idxWr++;
+
+   return id;
+}
+
+/*-----------------------------------------------------------------------------
+*  write queued telegrams with one writev()
+*  does not block: call again when the fd is writable (POLLOUT) and
+*  telegrams are pending. TSioTxDoneFunc is called for each telegram written
+*  completely.
+*  return value: number of telegrams still in queue, -1 on error
+*  eSioModeHalfDuplexCd: the telegrams are sent one after the other with
+*  collision detection (blocks for the transfer), a telegram that cannot be
+*  sent is dropped and -1 is returned
+*/
+int SioTxQueueFlush(int handle) {
+
+   TSioDesc     *pSio;
+   struct iovec iov[TX_QUEUE_LEN];
+   unsigned int num;
+   unsigned int i;
+   unsigned int idx;
+   ssize_t      ret;
+   unsigned int rest;
+   bool         sent;
+
+   if (!HandleValid(handle)) {
+      return -1;
+   }
+   pSio = SIO_DESC(handle);
+
+   num = pSio->txQueue.idxWr - pSio->txQueue.idxRd;
+   if (num == 0) {
+      return 0;
+   }
+   if (pSio->transport == eSioTransportReplay) {
+      /* discard */
+      while (pSio->txQueue.idxRd != pSio->txQueue.idxWr) {
+         idx = pSio->txQueue.idxRd & (TX_QUEUE_LEN - 1);
+         pSio->txQueue.posRd = 0;
+         pSio->txQueue.idxRd++;
+         if (pSio->txQueue.doneFunc != 0) {
+            pSio->txQueue.doneFunc(handle, pSio->txQueue.msg[idx].id);
+         }
+      }
+      return 0;
+   }
+   if (pSio->mode == eSioModeHalfDuplexCd) {
+      while (pSio->txQueue.idxRd != pSio->txQueue.idxWr) {
+         idx = pSio->txQueue.idxRd & (TX_QUEUE_LEN - 1);
+         pSio->cd.txPrio = pSio->txQueue.msg[idx].prio;
+         sent = CdSend(handle, pSio->txQueue.msg[idx].buf + pSio->txQueue.posRd,
+                       pSio->txQueue.msg[idx].len - pSio->txQueue.posRd);
+         pSio->txQueue.posRd = 0;
+         pSio->txQueue.idxRd++;
+         if (!sent) {
+            return -1;
+         }
+         if (pSio->txQueue.doneFunc != 0) {
+            pSio->txQueue.doneFunc(handle, pSio->txQueue.msg[idx].id);
+         }
+      }
+      return 0;
+   }
+   if (pSio->transport == eSioTransportUdp) {
+      /* one datagram per telegram */
+      while (pSio->txQueue.idxRd != pSio->txQueue.idxWr) {
+         idx = pSio->txQueue.idxRd & (TX_QUEUE_LEN - 1);
+         ret = write(pSio->fd, pSio->txQueue.msg[idx].buf, pSio->txQueue.msg[idx].len);
+         if (ret == -1) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+               break;
+            }
+            return -1;
+         }
+         pSio->txQueue.idxRd++;
+         if (pSio->txQueue.doneFunc != 0) {
+            pSio->txQueue.doneFunc(handle, pSio->txQueue.msg[idx].id);
+         }
+      }
+      return pSio->txQueue.idxWr - pSio->txQueue.idxRd;
+   }
+   for (i = 0; i < num; i++) {
+      idx = (pSio->txQueue.idxRd + i) & (TX_QUEUE_LEN - 1);
+      iov[i].iov_base = pSio->txQueue.msg[idx].buf;
+      iov[i].iov_len = pSio->txQueue.msg[idx].len;
+   }
+   // first telegram may be partly written
+   iov[0].iov_base = (uint8_t *)iov[0].iov_base + pSio->txQueue.posRd;
+   iov[0].iov_len -= pSio->txQueue.posRd;
+
+   ret = writev(pSio->fd, iov, num);
+   if (ret == -1) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+         return num;
+      }
+      return -1;
+   }
+
+   while ((ret > 0) && (pSio->txQueue.idxRd != pSio->txQueue.idxWr)) {
+      idx = pSio->txQueue.idxRd & (TX_QUEUE_LEN - 1);
+      rest = pSio->txQueue.msg[idx].len - pSio->txQueue.posRd;
+      if (ret >= rest) {
+         ret -= rest;
+         pSio->txQueue.posRd = 0;
+         pSio->txQueue.idxRd++;
+         if (pSio->txQueue.doneFunc != 0) {
+            pSio->txQueue.doneFunc(handle, pSio->txQueue.msg[idx].id);
+         }
+      } else {
+         pSio->txQueue.posRd += ret;
+         ret = 0;
+      }
+   }
+   return pSio->txQueue.idxWr - pSio->txQueue.idxRd;
+}
+
 /*-----------------------------------------------------------------------------
 *  Sio Empfangspuffer lesen
 */
@@ -288,7 +702,7 @@ uint8_t SioRead(int handle, uint8_t *pBuf, uint8_t bufSize) {
     readUnread = ReadUnRead(handle, pBuf, bufSize);
     if (readUnread < bufSize) {
         // noch Platz im Buffer
-        ret = read(sSio[handle].fd, pBuf + readUnread, bufSize - readUnread);
+        ret = ReadFd(handle, pBuf + readUnread, bufSize - readUnread);
         if (ret > 0) {
             bytesRead = ret;
         }
@@ -297,109 +711,283 @@ uint8_t SioRead(int handle, uint8_t *pBuf, uint8_t bufSize) {
 }
 
 /*-----------------------------------------------------------------------------
-*  Zeichen in Empfangspuffer zur�ckschreiben
+*  read one chunk with its receive time (CLOCK_MONOTONIC in us)
+*  characters of the unread buffer are returned with the time they were read
+*  from the driver, characters read from the driver with the actual time
+*  (see SioSetLowLatency for a time close to the reception on the line)
+*  replay: time of the chunk in the capture, scaled by the replay speed
 */
-uint8_t SioUnRead(int handle, uint8_t *pBuf, uint8_t bufSize) {
+uint8_t SioReadTs(int handle, uint8_t *pBuf, uint8_t bufSize, uint64_t *pTimeUs) {
 
-   unsigned int free;
-   unsigned int used;
-   unsigned int i;
-   unsigned int rdIdx;
-   unsigned int wrIdx;
+   ssize_t ret;
+   uint8_t len;
 
-   if (HandleValid(handle)) {
-      wrIdx = sSio[handle].unRead.bufIdxWr;
-      used = UnReadBufLen(handle);
-      free = UNREAD_BUF_SIZE - 1 - used;
+   if (!HandleValid(handle)) {
+      return 0;
+   }
 
-      for (i = 0; i < bufSize; i++) {
-         sSio[handle].unRead.buf[wrIdx] = *(pBuf + i);
-         wrIdx++;
-         wrIdx &= (UNREAD_BUF_SIZE - 1);
-      }
-      // falls alte Daten im unread-buf �berschrieben wurden: rdIdx korr.
-      if (free < bufSize) {
-         rdIdx = (wrIdx + 1) & (UNREAD_BUF_SIZE - 1);
-         sSio[handle].unRead.bufIdxRd = rdIdx;
+   len = ReadUnRead(handle, pBuf, bufSize);
+   if (len > 0) {
+      *pTimeUs = SIO_DESC(handle)->unRead.timeUs;
+      return len;
+   }
+   ret = ReadFd(handle, pBuf, bufSize);
+   if (ret > 0) {
+      *pTimeUs = SIO_DESC(handle)->rxTimeUs;
+      return (uint8_t)ret;
+   }
+   return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  low latency receive: the driver passes the characters without delay
+*  (ASYNC_LOW_LATENCY, usb adapters: latency timer 1 ms) and a blocking read
+*  returns on the first character (VMIN 1, VTIME 0)
+*  returns false if the driver does not support the low latency flag (e.g.
+*  pty), the termios settings are changed anyway
+*/
+bool SioSetLowLatency(int handle, bool enable) {
+
+   struct serial_struct serial;
+   struct termios       settings;
+   bool                 rc = false;
+
+   if (!HandleValid(handle)) {
+      return false;
+   }
+   if (ioctl(SIO_DESC(handle)->fd, TIOCGSERIAL, &serial) == 0) {
+      if (enable) {
+         serial.flags |= ASYNC_LOW_LATENCY;
+      } else {
+         serial.flags &= ~ASYNC_LOW_LATENCY;
       }
-      sSio[handle].unRead.bufIdxWr = wrIdx;
+      rc = (ioctl(SIO_DESC(handle)->fd, TIOCSSERIAL, &serial) == 0);
    }
-   return bufSize;
+   if (tcgetattr(SIO_DESC(handle)->fd, &settings) == 0) {
+      settings.c_cc[VMIN] = enable ? 1 : 0;
+      settings.c_cc[VTIME] = enable ? 0 : 1;
+      tcsetattr(SIO_DESC(handle)->fd, TCSANOW, &settings);
+   }
+   return rc;
 }
 
+/*-----------------------------------------------------------------------------
+*  record all received characters to pFileName (replay with replay://)
+*  text format, one line per chunk read from the driver:
+*  <time in us> <character in hex> <character in hex> ...
+*  lines starting with # are comments
+*/
+bool SioCaptureOpen(int handle, const char *pFileName) {
+
+   FILE *pFile;
+
+   if (!HandleValid(handle)) {
+      return false;
+   }
+   pFile = fopen(pFileName, "w");
+   if (pFile == 0) {
+      return false;
+   }
+   if (SIO_DESC(handle)->pCapture != 0) {
+      fclose(SIO_DESC(handle)->pCapture);
+   }
+   fprintf(pFile, "# homebus capture: <time us> <hex chars>\n");
+   SIO_DESC(handle)->pCapture = pFile;
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+*  handle replays a capture (replay://): the data starts immediately, the
+*  input must not be flushed after SioOpen
+*/
+bool SioIsReplay(int handle) {
+
+   if (!HandleValid(handle)) {
+      return false;
+   }
+   return SIO_DESC(handle)->transport == eSioTransportReplay;
+}
+
+/*-----------------------------------------------------------------------------
+*  Zeichen in Empfangspuffer zur�ckschreiben
+*/
+uint8_t SioUnRead(int handle, uint8_t *pBuf, uint8_t bufSize) {
+
+   if (HandleValid(handle)) {
+      UnRead(handle, pBuf, bufSize);
+   }
+   return bufSize;
+}
 
 /*-----------------------------------------------------------------------------
 *  Anzahl der Zeichen im Empfangspuffer
 */
 uint8_t SioGetNumRxChar(int handle) {
 
-    int      ret;
-    uint32_t inLen;
-    uint32_t numRxChar = 0;
-
-    if (HandleValid(handle)) {
-        ret = ioctl(sSio[handle].fd, FIONREAD, &inLen);
-        if (ret == 0) {
-            numRxChar = inLen + UnReadBufLen(handle);
-            if (numRxChar > 255) {
-                numRxChar = 255;
-            }
-        }
-    }
-   return numRxChar;
+   if (!HandleValid(handle)) {
+      return 0;
+   }
+   return (uint8_t)NumRxChar(handle, UINT8_MAX);
+}
+
+/*-----------------------------------------------------------------------------
+*  number of received characters, not limited to 255
+*/
+uint16_t SioGetNumRxChar16(int handle) {
+
+   if (!HandleValid(handle)) {
+      return 0;
+   }
+   return (uint16_t)NumRxChar(handle, UINT16_MAX);
+}
+
+/*-----------------------------------------------------------------------------
+*  size of receive (unread) and tx buffer (SioWriteBuffered), linux only
+*  rxSize is rounded up to a power of 2 (256 .. 32768), txSize 255 .. 65535
+*  characters in the buffers are kept, returns false if they don't fit
+*/
+bool SioSetBufSize(int handle, uint16_t rxSize, uint16_t txSize) {
+
+   TSioDesc     *pSio;
+   unsigned int size;
+   unsigned int len;
+   uint8_t      *pUnRead;
+   uint8_t      *pDatagram;
+   uint8_t      *pTx;
+
+   if (!HandleValid(handle)) {
+      return false;
+   }
+   pSio = SIO_DESC(handle);
+
+   for (size = MIN_UNREAD_BUF_SIZE; (size < rxSize) && (size < MAX_UNREAD_BUF_SIZE); size *= 2);
+   txSize = max(txSize, TX_BUF_SIZE);
+   len = UnReadBufLen(handle);
+   if ((len >= size) || (pSio->bufferedTx.pos > txSize) ||
+       (pSio->datagram.pos >= size)) {
+      return false;
+   }
+   pUnRead = malloc(size);
+   pDatagram = malloc(size);
+   pTx = malloc(txSize);
+   if ((pUnRead == 0) || (pDatagram == 0) || (pTx == 0)) {
+      free(pUnRead);
+      free(pDatagram);
+      free(pTx);
+      return false;
+   }
+   /* keep received and buffered characters, the datagram is read again */
+   ReadUnRead(handle, pUnRead, len);
+   memcpy(pTx, pSio->bufferedTx.buf, pSio->bufferedTx.pos);
+   BufFree(pSio);
+   pSio->unRead.buf = pUnRead;
+   pSio->unRead.size = size;
+   pSio->unRead.bufIdxRd = 0;
+   pSio->unRead.bufIdxWr = len;
+   pSio->datagram.buf = pDatagram;
+   pSio->bufferedTx.buf = pTx;
+   pSio->bufferedTx.size = txSize;
+   return true;
 }
 
 /*-----------------------------------------------------------------------------
 *  Zeichen in Empfangspuffer zur�ckschreiben
 */
-static uint8_t ReadUnRead(int handle, uint8_t *pBuf, uint8_t bufSize) {
+static unsigned int ReadUnRead(int handle, uint8_t *pBuf, unsigned int bufSize) {
 
    unsigned int len = 0;
-   unsigned int used;
+   unsigned int part;
    unsigned int i;
    unsigned int rdIdx;
+   TSioDesc     *pSio;
 
    if (HandleValid(handle)) {
-      rdIdx = sSio[handle].unRead.bufIdxRd;
-      used = UnReadBufLen(handle);
-      len = min(bufSize, used);
-      for (i = 0; i < len; i++) {
-         *(pBuf + i) = sSio[handle].unRead.buf[rdIdx];
-         rdIdx++;
-         rdIdx &= (UNREAD_BUF_SIZE - 1);
+      pSio = SIO_DESC(handle);
+      rdIdx = pSio->unRead.bufIdxRd;
+      len = min(bufSize, UnReadBufLen(handle));
+      /* up to two parts: till end of buf and from start */
+      for (i = 0; i < len; i += part) {
+         part = min(len - i, pSio->unRead.size - rdIdx);
+         memcpy(pBuf + i, pSio->unRead.buf + rdIdx, part);
+         rdIdx = (rdIdx + part) & (pSio->unRead.size - 1);
       }
-      sSio[handle].unRead.bufIdxRd = rdIdx;
+      pSio->unRead.bufIdxRd = rdIdx;
    }
-   return (uint8_t)len;
+   return len;
 }
 
+/*-----------------------------------------------------------------------------
+*  Zeichen in Empfangspuffer zur�ckschreiben
+*  bufSize < unRead.size: if the buffer is full the oldest characters are
+*  overwritten
+*/
+static void UnRead(int handle, const uint8_t *pBuf, unsigned int bufSize) {
+
+   unsigned int free;
+   unsigned int part;
+   unsigned int i;
+   unsigned int wrIdx;
+   TSioDesc     *pSio = SIO_DESC(handle);
+
+   wrIdx = pSio->unRead.bufIdxWr;
+   free = pSio->unRead.size - 1 - UnReadBufLen(handle);
+   for (i = 0; i < bufSize; i += part) {
+      part = min(bufSize - i, pSio->unRead.size - wrIdx);
+      memcpy(pSio->unRead.buf + wrIdx, pBuf + i, part);
+      wrIdx = (wrIdx + part) & (pSio->unRead.size - 1);
+   }
+   // falls alte Daten im unread-buf �berschrieben wurden: rdIdx korr.
+   if (free < bufSize) {
+      pSio->unRead.bufIdxRd = (wrIdx + 1) & (pSio->unRead.size - 1);
+   }
+   pSio->unRead.bufIdxWr = wrIdx;
+   pSio->unRead.timeUs = pSio->rxTimeUs;
+}
 
 /*-----------------------------------------------------------------------------
 *  Belegung des unread-buf
 */
 static unsigned int UnReadBufLen(int handle) {
 
-   unsigned int used = UNREAD_BUF_SIZE;
+   unsigned int used = 0;
 
    if (HandleValid(handle)) {
-      used = (sSio[handle].unRead.bufIdxWr - sSio[handle].unRead.bufIdxRd) &
-             (UNREAD_BUF_SIZE - 1);
+      used = (SIO_DESC(handle)->unRead.bufIdxWr - SIO_DESC(handle)->unRead.bufIdxRd) &
+             (SIO_DESC(handle)->unRead.size - 1);
    }
    return used;
 }
 
+/*-----------------------------------------------------------------------------
+*  number of received characters (driver and unread buffer), limited to max
+*/
+static unsigned int NumRxChar(int handle, unsigned int max) {
+
+   TSioDesc     *pSio = SIO_DESC(handle);
+   uint32_t     inLen;
+   unsigned int numRxChar = 0;
+
+   if (pSio->transport == eSioTransportReplay) {
+      numRxChar = ReplayNumDue(pSio, max) + UnReadBufLen(handle);
+   } else if (ioctl(pSio->fd, FIONREAD, &inLen) == 0) {
+      numRxChar = inLen - pSio->datagram.pos + UnReadBufLen(handle);
+   }
+   return min(numRxChar, max);
+}
+
 /*-----------------------------------------------------------------------------
 *  check handle
 */
 static bool HandleValid(int handle) {
 
-    if ((handle >= MAX_NUM_SIO) ||
-        (handle < 0)) {
+    if ((handle >= sNumSio) ||
+        (handle < 0) ||
+        (SIO_DESC(handle) == 0)) {
         printf("invalid handle %i\r\n", handle);
         return false;
     }
 
-    if (sSio[handle].used == false) {
+    if (SIO_DESC(handle)->used == false) {
         printf("invalid handle %i\r\n", handle);
         return false;
     }
@@ -413,16 +1001,598 @@ static bool HandleValid(int handle) {
 bool SioHandleValid(int handle) {
 
     uint32_t inLen;
+    uint8_t  ch;
 
     if (!HandleValid(handle)) {
         return false;
     }
 
-    if (ioctl(sSio[handle].fd, FIONREAD, &inLen) == 0) {
+    if ((SIO_DESC(handle)->transport == eSioTransportTcp) && !SIO_DESC(handle)->closed &&
+        (recv(SIO_DESC(handle)->fd, &ch, 1, MSG_PEEK | MSG_DONTWAIT) == 0)) {
+        SIO_DESC(handle)->closed = true;
+    }
+    if (SIO_DESC(handle)->transport == eSioTransportReplay) {
+        /* end of capture */
+        return (SIO_DESC(handle)->replay.idx < SIO_DESC(handle)->replay.numChunk) ||
+               (UnReadBufLen(handle) > 0);
+    }
+    if (SIO_DESC(handle)->closed) {
+        return false;
+    }
+
+    if (ioctl(SIO_DESC(handle)->fd, FIONREAD, &inLen) == 0) {
         return true;
     } else {
         return false;
     }
 }
 
+/*-----------------------------------------------------------------------------
+*  baud rate in bit/s to TSioBaud (command line option of the tools)
+*/
+bool SioBaudFromRate(unsigned long rate, TSioBaud *pBaud) {
+
+   switch (rate) {
+      case 9600:
+         *pBaud = eSioBaud9600;
+         break;
+      case 19200:
+         *pBaud = eSioBaud19200;
+         break;
+      case 38400:
+         *pBaud = eSioBaud38400;
+         break;
+      case 57600:
+         *pBaud = eSioBaud57600;
+         break;
+      case 115200:
+         *pBaud = eSioBaud115200;
+         break;
+      default:
+         return false;
+   }
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+*  monotonic time in us
+*/
+static uint64_t NowUs(void) {
+
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*-----------------------------------------------------------------------------
+*  eSioModeHalfDuplexCd: read available characters of the line and pass them
+*  to the application via unread buffer
+*/
+static void CdRxDrain(int handle) {
+
+   uint8_t buf[64];
+   int     len;
 
+   while ((len = ReadFd(handle, buf, sizeof(buf))) > 0) {
+      SioUnRead(handle, buf, (uint8_t)len);
+   }
+}
+
+/*-----------------------------------------------------------------------------
+*  eSioModeHalfDuplexCd: wait until the line is idle for idleUs
+*  returns false if the line is busy for longer than CD_BUSY_TIMEOUT_US
+*/
+static bool CdWaitIdle(int handle, unsigned int idleUs) {
+
+   TSioDesc       *pSio = SIO_DESC(handle);
+   uint64_t       start = NowUs();
+   uint64_t       now;
+   uint64_t       rest;
+   fd_set         rdFds;
+   struct timeval tv;
+
+   for (;;) {
+      CdRxDrain(handle);
+      now = NowUs();
+      if ((now - pSio->rxTimeUs) >= idleUs) {
+         return true;
+      }
+      if ((now - start) > CD_BUSY_TIMEOUT_US) {
+         return false;
+      }
+      rest = idleUs - (now - pSio->rxTimeUs);
+      tv.tv_sec = 0;
+      tv.tv_usec = rest;
+      FD_ZERO(&rdFds);
+      FD_SET(pSio->fd, &rdFds);
+      select(pSio->fd + 1, &rdFds, 0, 0, &tv);
+   }
+}
+
+/*-----------------------------------------------------------------------------
+*  eSioModeHalfDuplexCd: write telegram and compare the read back characters
+*  returns false on collision (different or missing read back)
+*  on a difference the characters read are passed to the application: they
+*  may be a telegram of another station that started just before ours
+*/
+static bool CdTxEcho(int handle, const uint8_t *pBuf, unsigned int len) {
+
+   TSioDesc       *pSio = SIO_DESC(handle);
+   uint8_t        echo[UINT8_MAX];
+   uint64_t       deadline;
+   uint64_t       now;
+   unsigned int   pos;
+   ssize_t        ret;
+   fd_set         rdFds;
+   struct timeval tv;
+
+   if (!WriteAll(pSio, pBuf, len)) {
+      return false;
+   }
+   deadline = NowUs() + len * pSio->cd.charTimeUs + CD_ECHO_MARGIN_US;
+   for (pos = 0; pos < len; ) {
+      ret = ReadFd(handle, echo, min(len - pos, sizeof(echo)));
+      if (ret > 0) {
+         if (memcmp(echo, pBuf + pos, ret) != 0) {
+            UnRead(handle, pBuf, pos);
+            UnRead(handle, echo, ret);
+            return false;
+         }
+         pos += ret;
+         continue;
+      }
+      now = NowUs();
+      if (now >= deadline) {
+         return false;
+      }
+      tv.tv_sec = (deadline - now) / 1000000;
+      tv.tv_usec = (deadline - now) % 1000000;
+      FD_ZERO(&rdFds);
+      FD_SET(pSio->fd, &rdFds);
+      select(pSio->fd + 1, &rdFds, 0, 0, &tv);
+   }
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+*  eSioModeHalfDuplexCd: send telegram with bus access as sio/avr/siotype1.c
+*  - wait for idle line (high prio: shorter, low prio: longer idle time)
+*  - write and compare read back
+*  - on collision: jam, wait for idle line and retry after random backoff
+*  received characters of other stations are passed to the application, the
+*  read back is discarded
+*  returns false if the telegram could not be sent
+*/
+static bool CdSend(int handle, const uint8_t *pBuf, unsigned int len) {
+
+   TSioDesc     *pSio = SIO_DESC(handle);
+   unsigned int slotUs = pSio->cd.charTimeUs;
+   unsigned int intercharUs = CD_INTERCHAR_CHARS * slotUs;
+   unsigned int idleUs;
+   unsigned int backoffUs = 0;
+   unsigned int retry = 0;
+   uint8_t      jam[CD_JAM_CNT];
+
+   switch (pSio->cd.txPrio) {
+      case eSioTxPrioHigh:
+         idleUs = intercharUs - slotUs;
+         break;
+      case eSioTxPrioLow:
+         idleUs = intercharUs + CD_IDLE_WAIT_LOW * slotUs;
+         break;
+      default:
+         idleUs = intercharUs;
+         break;
+   }
+   memset(jam, 0, sizeof(jam));
+   for (;;) {
+      if (!CdWaitIdle(handle, idleUs + backoffUs)) {
+         return false;
+      }
+      if (CdTxEcho(handle, pBuf, len)) {
+         return true;
+      }
+      /* collision: stop tx (as far as the driver allows), jam and wait
+       * until the line is idle again. The line is still passed to the
+       * application: a station that starts after the idle time is not cut,
+       * the damaged telegrams are dropped by the checksum of the bus layer */
+      tcflush(pSio->fd, TCOFLUSH);
+      if (write(pSio->fd, jam, sizeof(jam)) == sizeof(jam)) {
+         tcdrain(pSio->fd);
+      }
+      pSio->rxTimeUs = NowUs();
+      CdWaitIdle(handle, intercharUs);
+      retry++;
+      if (retry >= CD_MAX_TX_RETRY) {
+         return false;
+      }
+      backoffUs = (rand_r(&pSio->cd.randState) %
+                   (retry * CD_BACKOFF_WINDOW(pSio->cd.txPrio))) * slotUs;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+*  read from device, socket or capture, sets rxTimeUs and writes the capture
+*  udp: the datagram is read in parts of bufSize: it is removed from the
+*       socket when read completely, so select signals the rest
+*  tcp: end of connection is marked for SioHandleValid
+*  replay: reads (the rest of) the next chunk when due
+*/
+static int ReadFd(int handle, uint8_t *pBuf, uint8_t bufSize) {
+
+   TSioDesc        *pSio = SIO_DESC(handle);
+   TSioReplayChunk *pChunk;
+   ssize_t         ret;
+   ssize_t         len;
+   int             i;
+
+   switch (pSio->transport) {
+      case eSioTransportUdp:
+         len = recv(pSio->fd, pSio->datagram.buf, pSio->unRead.size, MSG_PEEK);
+         if (len < 0) {
+            return len;
+         }
+         ret = min(bufSize, len - pSio->datagram.pos);
+         memcpy(pBuf, pSio->datagram.buf + pSio->datagram.pos, ret);
+         pSio->datagram.pos += ret;
+         if (pSio->datagram.pos >= len) {
+            recv(pSio->fd, pSio->datagram.buf, pSio->unRead.size, 0);
+            pSio->datagram.pos = 0;
+         }
+         break;
+      case eSioTransportTcp:
+         ret = read(pSio->fd, pBuf, bufSize);
+         if ((ret == 0) && (bufSize > 0)) {
+            pSio->closed = true;
+         }
+         break;
+      case eSioTransportReplay:
+         if ((pSio->replay.idx >= pSio->replay.numChunk) ||
+             (ReplayDueUs(pSio, pSio->replay.idx) > NowUs())) {
+            return 0;
+         }
+         pChunk = &pSio->replay.pChunk[pSio->replay.idx];
+         ret = min(bufSize, pChunk->len - pSio->replay.pos);
+         memcpy(pBuf, pSio->replay.pData + pChunk->offs + pSio->replay.pos, ret);
+         pSio->replay.pos += ret;
+         if (pSio->replay.speed > 0) {
+            pSio->rxTimeUs = pSio->replay.startUs + pChunk->timeUs / pSio->replay.speed;
+         } else {
+            pSio->rxTimeUs = pSio->replay.startUs + pChunk->timeUs;
+         }
+         if (pSio->replay.pos >= pChunk->len) {
+            pSio->replay.idx++;
+            pSio->replay.pos = 0;
+            ReplayArm(pSio);
+         }
+         break;
+      default:
+         ret = read(pSio->fd, pBuf, bufSize);
+         break;
+   }
+   if (ret <= 0) {
+      return ret;
+   }
+   if (pSio->transport != eSioTransportReplay) {
+      pSio->rxTimeUs = NowUs();
+   }
+   if (pSio->pCapture != 0) {
+      fprintf(pSio->pCapture, "%llu", (unsigned long long)pSio->rxTimeUs);
+      for (i = 0; i < ret; i++) {
+         fprintf(pSio->pCapture, " %02x", pBuf[i]);
+      }
+      fprintf(pSio->pCapture, "\n");
+      fflush(pSio->pCapture);
+   }
+   return ret;
+}
+
+/*-----------------------------------------------------------------------------
+*  connect to network endpoint tcp://host:port or udp://host:port
+*  host may be a name, an ipv4 address or an ipv6 address in []
+*  returns socket (non blocking) or -1
+*/
+static int NetOpen(const char *pPortName, TSioTransport *pTransport) {
+
+   char            host[256];
+   const char      *pHost;
+   const char      *pPort;
+   size_t          hostLen;
+   struct addrinfo hints;
+   struct addrinfo *pAddrList;
+   struct addrinfo *pAddr;
+   int             fd = -1;
+   int             on = 1;
+
+   memset(&hints, 0, sizeof(hints));
+   hints.ai_family = AF_UNSPEC;
+   if (strncmp(pPortName, NET_PREFIX_TCP, strlen(NET_PREFIX_TCP)) == 0) {
+      *pTransport = eSioTransportTcp;
+      hints.ai_socktype = SOCK_STREAM;
+   } else {
+      *pTransport = eSioTransportUdp;
+      hints.ai_socktype = SOCK_DGRAM;
+   }
+   pHost = pPortName + strlen(NET_PREFIX_TCP);
+   pPort = strrchr(pHost, ':');
+   if (pPort == 0) {
+      fprintf(stderr, "missing port in %s\n", pPortName);
+      return -1;
+   }
+   hostLen = pPort - pHost;
+   if ((hostLen >= 2) && (pHost[0] == '[') && (pHost[hostLen - 1] == ']')) {
+      pHost++;
+      hostLen -= 2;
+   }
+   if (hostLen >= sizeof(host)) {
+      return -1;
+   }
+   memcpy(host, pHost, hostLen);
+   host[hostLen] = '\0';
+   pPort++;
+
+   if (getaddrinfo(host, pPort, &hints, &pAddrList) != 0) {
+      fprintf(stderr, "cannot resolve %s\n", pPortName);
+      return -1;
+   }
+   for (pAddr = pAddrList; pAddr != 0; pAddr = pAddr->ai_next) {
+      fd = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+      if (fd == -1) {
+         continue;
+      }
+      if (connect(fd, pAddr->ai_addr, pAddr->ai_addrlen) == 0) {
+         break;
+      }
+      close(fd);
+      fd = -1;
+   }
+   freeaddrinfo(pAddrList);
+   if (fd == -1) {
+      fprintf(stderr, "cannot connect to %s\n", pPortName);
+      return -1;
+   }
+   if (*pTransport == eSioTransportTcp) {
+      /* telegrams are written as a whole, don't wait for more data */
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+   }
+   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+   return fd;
+}
+
+/*-----------------------------------------------------------------------------
+*  load capture for replay://file[@speed], format see SioCaptureOpen
+*  returns timerfd: it expires when the next chunk is due
+*/
+static int ReplayOpen(TSioDesc *pSio, const char *pPortName) {
+
+   char            name[256];
+   char            *pSpeed;
+   char            *pEnd;
+   char            *pLine;
+   char            *p;
+   FILE            *pFile;
+   uint64_t        timeUs;
+   uint64_t        t0 = 0;
+   unsigned long   ch;
+   unsigned int    sizeChunk = 0;
+   unsigned int    sizeData = 0;
+   unsigned int    lenData = 0;
+   unsigned int    lineNr = 0;
+   TSioReplayChunk *pChunk;
+   uint8_t         *pData;
+   bool            ok;
+   int             fd;
+
+   snprintf(name, sizeof(name), "%s", pPortName + strlen(REPLAY_PREFIX));
+   pSio->replay.speed = 1;
+   pSpeed = strrchr(name, '@');
+   if (pSpeed != 0) {
+      pSio->replay.speed = strtod(pSpeed + 1, &pEnd);
+      if ((pEnd == pSpeed + 1) || (*pEnd != '\0') || (pSio->replay.speed < 0)) {
+         fprintf(stderr, "invalid replay speed in %s\n", pPortName);
+         return -1;
+      }
+      *pSpeed = '\0';
+   }
+   pFile = fopen(name, "r");
+   if (pFile == 0) {
+      fprintf(stderr, "cannot open %s\n", name);
+      return -1;
+   }
+   pSio->replay.pChunk = 0;
+   pSio->replay.numChunk = 0;
+   pSio->replay.pData = 0;
+   pSio->replay.idx = 0;
+   pSio->replay.pos = 0;
+   pLine = malloc(REPLAY_LINE_SIZE);
+   ok = (pLine != 0);
+   while (ok && (fgets(pLine, REPLAY_LINE_SIZE, pFile) != 0)) {
+      lineNr++;
+      for (p = pLine; (*p == ' ') || (*p == '\t'); p++);
+      if ((*p == '#') || (*p == '\n') || (*p == '\r') || (*p == '\0')) {
+         continue;
+      }
+      timeUs = strtoull(p, &pEnd, 10);
+      if (pSio->replay.numChunk == 0) {
+         t0 = timeUs;
+      }
+      if ((pEnd == p) || (timeUs < t0)) {
+         fprintf(stderr, "%s:%u: invalid time\n", name, lineNr);
+         ok = false;
+         break;
+      }
+      if (pSio->replay.numChunk == sizeChunk) {
+         sizeChunk = sizeChunk ? sizeChunk * 2 : 256;
+         pChunk = realloc(pSio->replay.pChunk, sizeChunk * sizeof(*pChunk));
+         if (pChunk == 0) {
+            ok = false;
+            break;
+         }
+         pSio->replay.pChunk = pChunk;
+      }
+      pChunk = &pSio->replay.pChunk[pSio->replay.numChunk];
+      pChunk->timeUs = timeUs - t0;
+      pChunk->offs = lenData;
+      pChunk->len = 0;
+      /* up to 255 characters per line */
+      for (p = pEnd; pChunk->len < 255; p = pEnd) {
+         ch = strtoul(p, &pEnd, 16);
+         if ((pEnd == p) || (ch > 0xff)) {
+            break;
+         }
+         if (lenData == sizeData) {
+            sizeData = sizeData ? sizeData * 2 : 4096;
+            pData = realloc(pSio->replay.pData, sizeData);
+            if (pData == 0) {
+               ok = false;
+               break;
+            }
+            pSio->replay.pData = pData;
+         }
+         pSio->replay.pData[lenData++] = (uint8_t)ch;
+         pChunk->len++;
+      }
+      if (pChunk->len > 0) {
+         pSio->replay.numChunk++;
+      }
+   }
+   fclose(pFile);
+   free(pLine);
+
+   fd = ok ? timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK) : -1;
+   if (fd == -1) {
+      free(pSio->replay.pChunk);
+      free(pSio->replay.pData);
+      return -1;
+   }
+   pSio->fd = fd;
+   pSio->replay.startUs = NowUs();
+   ReplayArm(pSio);
+   return fd;
+}
+
+/*-----------------------------------------------------------------------------
+*  replay: due time of chunk idx
+*/
+static uint64_t ReplayDueUs(TSioDesc *pSio, unsigned int idx) {
+
+   if (pSio->replay.speed > 0) {
+      return pSio->replay.startUs + pSio->replay.pChunk[idx].timeUs / pSio->replay.speed;
+   } else {
+      return pSio->replay.startUs;
+   }
+}
+
+/*-----------------------------------------------------------------------------
+*  replay: timerfd expires at due time of the next chunk, at the end of the
+*  capture immediately (select returns, SioHandleValid reports the end)
+*/
+static void ReplayArm(TSioDesc *pSio) {
+
+   struct itimerspec its;
+   uint64_t          dueUs;
+   uint64_t          ticks;
+
+   /* reset expiration */
+   if (read(pSio->fd, &ticks, sizeof(ticks)) != sizeof(ticks)) {
+      ticks = 0;
+   }
+   if (pSio->replay.idx < pSio->replay.numChunk) {
+      dueUs = ReplayDueUs(pSio, pSio->replay.idx);
+   } else {
+      dueUs = NowUs();
+   }
+   memset(&its, 0, sizeof(its));
+   its.it_value.tv_sec = dueUs / 1000000;
+   its.it_value.tv_nsec = (dueUs % 1000000) * 1000;
+   timerfd_settime(pSio->fd, TFD_TIMER_ABSTIME, &its, 0);
+}
+
+/*-----------------------------------------------------------------------------
+*  replay: number of characters due
+*/
+static unsigned int ReplayNumDue(TSioDesc *pSio, unsigned int max) {
+
+   uint64_t     now = NowUs();
+   unsigned int idx;
+   unsigned int num = 0;
+
+   for (idx = pSio->replay.idx;
+        (idx < pSio->replay.numChunk) && (num < max) && (ReplayDueUs(pSio, idx) <= now);
+        idx++) {
+      num += pSio->replay.pChunk[idx].len;
+   }
+   if (num > 0) {
+      num -= pSio->replay.pos;
+   }
+   return num;
+}
+
+/*-----------------------------------------------------------------------------
+*  allocate rx (unread and datagram) and tx buffer
+*  rxSize: 2er-Potenz
+*/
+static bool BufAlloc(TSioDesc *pSio, unsigned int rxSize, unsigned int txSize) {
+
+   pSio->unRead.buf = malloc(rxSize);
+   pSio->unRead.size = rxSize;
+   pSio->datagram.buf = malloc(rxSize);
+   pSio->bufferedTx.buf = malloc(txSize);
+   pSio->bufferedTx.size = txSize;
+   if ((pSio->unRead.buf == 0) || (pSio->datagram.buf == 0) || (pSio->bufferedTx.buf == 0)) {
+      BufFree(pSio);
+      return false;
+   }
+   return true;
+}
+
+/*-----------------------------------------------------------------------------
+*  free rx and tx buffer
+*/
+static void BufFree(TSioDesc *pSio) {
+
+   free(pSio->unRead.buf);
+   free(pSio->datagram.buf);
+   free(pSio->bufferedTx.buf);
+   pSio->unRead.buf = 0;
+   pSio->datagram.buf = 0;
+   pSio->bufferedTx.buf = 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  write len characters, wait for tx space of the driver (non blocking fd)
+*  returns false on error or if the driver does not accept the characters
+*  within the transfer time plus TX_TIMEOUT_US
+*/
+static bool WriteAll(TSioDesc *pSio, const uint8_t *pBuf, unsigned int len) {
+
+   unsigned int   pos;
+   ssize_t        ret;
+   uint64_t       deadline;
+   uint64_t       now;
+   fd_set         wrFds;
+   struct timeval tv;
+
+   deadline = NowUs() + (uint64_t)len * pSio->cd.charTimeUs + TX_TIMEOUT_US;
+   for (pos = 0; pos < len; ) {
+      ret = write(pSio->fd, pBuf + pos, len - pos);
+      if (ret > 0) {
+         pos += ret;
+         continue;
+      }
+      if ((ret == -1) && (errno != EAGAIN) && (errno != EINTR)) {
+         return false;
+      }
+      now = NowUs();
+      if (now >= deadline) {
+         return false;
+      }
+      tv.tv_sec = (deadline - now) / 1000000;
+      tv.tv_usec = (deadline - now) % 1000000;
+      FD_ZERO(&wrFds);
+      FD_SET(pSio->fd, &wrFds);
+      select(pSio->fd + 1, 0, &wrFds, 0, &tv);
+   }
+   return true;
+}
@@ -0,0 +1,352 @@
+/*
+ * main.c
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+/*
+ * test for eSioModeHalfDuplexCd
+ * NUM_STATION stations (one thread each) use the slave side of a pty. The
+ * main thread emulates the bus: every character time one character is taken
+ * from each master side. A single character is written to all master sides
+ * (read back), the characters of simultaneously sending stations are and-ed
+ * (collision, dominant 0 as rs485). Additionally single characters are
+ * disturbed at random.
+ * The stations send NUM_TX telegrams at random times and count the telegrams
+ * received from the other stations until the end of the test. Without
+ * collision detection telegrams get lost, with collision detection all
+ * telegrams have to be received.
+ *
+ * usage: siocdtest
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/select.h>
+
+#include "sysdef.h"
+#include "sio.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define NUM_STATION      3
+#define NUM_TX           100
+#define CHAR_TIME_NS     520833  // 19200 baud, 10 bit
+#define MAX_TX_GAP_MS    60
+#define NOISE_RATE       500     // one of NOISE_RATE characters is disturbed
+#define RX_TAIL_MS       200     // receive time after last telegram
+
+#define MSG_STX          0x02
+#define MSG_LEN          12
+#define MSG_DATA_LEN     (MSG_LEN - 5)
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+typedef struct {
+    int           id;
+    int           masterFd;
+    int           sioHandle;
+    unsigned int  seed;
+    int           numTxOk;
+    int           numRx;
+    bool          rx[NUM_STATION][NUM_TX];
+    uint8_t       rxBuf[MSG_LEN];
+    int           rxPos;
+    volatile bool done;
+} TStation;
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+static TStation      sStation[NUM_STATION];
+static volatile bool sStop;
+
+/*-----------------------------------------------------------------------------
+*  time in ms
+*/
+static unsigned long TimeMs(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+/*-----------------------------------------------------------------------------
+*  open pty, returns master fd
+*/
+static int PtyOpen(const char **ppSlaveName) {
+
+    int fd;
+
+    fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if ((fd < 0) ||
+        (grantpt(fd) != 0) ||
+        (unlockpt(fd) != 0)) {
+        printf("cannot open pty\n");
+        return -1;
+    }
+    *ppSlaveName = ptsname(fd);
+    return fd;
+}
+
+/*-----------------------------------------------------------------------------
+*  telegram: STX, sender, seq (2 bytes), data, checksum
+*/
+static void MsgBuild(uint8_t *pBuf, int id, int seq) {
+
+    int     i;
+    uint8_t sum = 0;
+
+    pBuf[0] = MSG_STX;
+    pBuf[1] = id;
+    pBuf[2] = seq >> 8;
+    pBuf[3] = seq & 0xff;
+    for (i = 0; i < MSG_DATA_LEN; i++) {
+        pBuf[4 + i] = 0x30 + id * 16 + seq + i;
+    }
+    for (i = 0; i < (MSG_LEN - 1); i++) {
+        sum += pBuf[i];
+    }
+    pBuf[MSG_LEN - 1] = sum;
+}
+
+/*-----------------------------------------------------------------------------
+*  receive telegrams, resync on STX
+*/
+static void StationRx(TStation *pStation, uint8_t ch) {
+
+    uint8_t *pBuf = pStation->rxBuf;
+    uint8_t sum = 0;
+    int     i;
+    int     id;
+    int     seq;
+
+    if ((pStation->rxPos == 0) && (ch != MSG_STX)) {
+        return;
+    }
+    pBuf[pStation->rxPos++] = ch;
+    if (pStation->rxPos < MSG_LEN) {
+        return;
+    }
+    for (i = 0; i < (MSG_LEN - 1); i++) {
+        sum += pBuf[i];
+    }
+    id = pBuf[1];
+    seq = pBuf[2] * 256 + pBuf[3];
+    if ((sum == pBuf[MSG_LEN - 1]) &&
+        (id < NUM_STATION) && (id != pStation->id) && (seq < NUM_TX)) {
+        if (!pStation->rx[id][seq]) {
+            pStation->rx[id][seq] = true;
+            pStation->numRx++;
+        }
+        pStation->rxPos = 0;
+        return;
+    }
+    /* no valid telegram: resync at next STX */
+    for (i = 1; (i < MSG_LEN) && (pBuf[i] != MSG_STX); i++);
+    pStation->rxPos = MSG_LEN - i;
+    memmove(pBuf, pBuf + i, pStation->rxPos);
+}
+
+/*-----------------------------------------------------------------------------
+*  read and wait until timeMs
+*/
+static void StationRxUntil(TStation *pStation, unsigned long timeMs) {
+
+    uint8_t        buf[64];
+    uint8_t        len;
+    uint8_t        i;
+    fd_set         rdFds;
+    struct timeval tv;
+    int            fd = SioGetFd(pStation->sioHandle);
+
+    do {
+        while ((len = SioRead(pStation->sioHandle, buf, sizeof(buf))) > 0) {
+            for (i = 0; i < len; i++) {
+                StationRx(pStation, buf[i]);
+            }
+        }
+        FD_ZERO(&rdFds);
+        FD_SET(fd, &rdFds);
+        tv.tv_sec = 0;
+        tv.tv_usec = 1000;
+        select(fd + 1, &rdFds, 0, 0, &tv);
+    } while ((long)(TimeMs() - timeMs) < 0);
+}
+
+/*-----------------------------------------------------------------------------
+*  station thread
+*/
+static void *Station(void *pArg) {
+
+    TStation *pStation = (TStation *)pArg;
+    uint8_t  msg[MSG_LEN];
+    int      seq;
+
+    for (seq = 0; seq < NUM_TX; seq++) {
+        StationRxUntil(pStation, TimeMs() + rand_r(&pStation->seed) % MAX_TX_GAP_MS);
+        MsgBuild(msg, pStation->id, seq);
+        SioWriteBuffered(pStation->sioHandle, msg, sizeof(msg));
+        SioSetTxPrio(pStation->sioHandle, eSioTxPrioNormal);
+        if (SioSendBuffer(pStation->sioHandle)) {
+            pStation->numTxOk++;
+        }
+    }
+    pStation->done = true;
+    while (!sStop) {
+        StationRxUntil(pStation, TimeMs() + 10);
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  bus emulation until all stations are done
+*/
+static void Wire(unsigned int seed) {
+
+    struct timespec next;
+    uint8_t         ch;
+    uint8_t         line;
+    int             numTx;
+    int             i;
+    bool            done = false;
+    unsigned long   doneMs = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!done || ((TimeMs() - doneMs) < RX_TAIL_MS)) {
+        next.tv_nsec += CHAR_TIME_NS;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, 0);
+
+        line = 0xff;
+        numTx = 0;
+        for (i = 0; i < NUM_STATION; i++) {
+            if (read(sStation[i].masterFd, &ch, 1) == 1) {
+                line &= ch;
+                numTx++;
+            }
+        }
+        if (numTx == 0) {
+            if (!done) {
+                for (i = 0; (i < NUM_STATION) && sStation[i].done; i++);
+                if (i == NUM_STATION) {
+                    done = true;
+                    doneMs = TimeMs();
+                }
+            }
+            continue;
+        }
+        if ((rand_r(&seed) % NOISE_RATE) == 0) {
+            line ^= 0x10;
+        }
+        for (i = 0; i < NUM_STATION; i++) {
+            if (write(sStation[i].masterFd, &line, 1) != 1) {
+                printf("wire write error\n");
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  run stations in mode, returns number of lost telegrams
+*/
+static int Run(TSioMode mode, const char *pModeName) {
+
+    pthread_t     thread[NUM_STATION];
+    const char    *pSlaveName;
+    TStation      *pStation;
+    unsigned long start;
+    int           i;
+    int           lost = 0;
+    int           numTxOk = 0;
+
+    for (i = 0; i < NUM_STATION; i++) {
+        pStation = &sStation[i];
+        memset(pStation, 0, sizeof(*pStation));
+        pStation->id = i;
+        pStation->seed = 1234 + i;
+        pStation->masterFd = PtyOpen(&pSlaveName);
+        if (pStation->masterFd < 0) {
+            return -1;
+        }
+        SioRandSeed(i + 1);
+        pStation->sioHandle = SioOpen(pSlaveName, eSioBaud19200, eSioDataBits8, eSioParityNo,
+                                      eSioStopBits1, mode);
+        if (pStation->sioHandle == -1) {
+            printf("cannot open %s\n", pSlaveName);
+            return -1;
+        }
+    }
+    start = TimeMs();
+    for (i = 0; i < NUM_STATION; i++) {
+        pthread_create(&thread[i], 0, Station, &sStation[i]);
+    }
+    sStop = false;
+    Wire(5678);
+    sStop = true;
+    for (i = 0; i < NUM_STATION; i++) {
+        pthread_join(thread[i], 0);
+    }
+    for (i = 0; i < NUM_STATION; i++) {
+        pStation = &sStation[i];
+        lost += (NUM_STATION - 1) * NUM_TX - pStation->numRx;
+        numTxOk += pStation->numTxOk;
+        SioClose(pStation->sioHandle);
+        close(pStation->masterFd);
+    }
+    printf("%s: %d of %d telegrams sent, %d lost, %lu ms\n", pModeName,
+           numTxOk, NUM_STATION * NUM_TX, lost, TimeMs() - start);
+    return lost;
+}
+
+/*-----------------------------------------------------------------------------
+*  main
+*/
+int main(void) {
+
+    int lostHd;
+    int lostCd;
+
+    SioInit();
+    lostHd = Run(eSioModeHalfDuplex, "half duplex");
+    lostCd = Run(eSioModeHalfDuplexCd, "half duplex cd");
+    /* the emulation has to produce collisions */
+    if ((lostHd <= 0) || (lostCd != 0)) {
+        printf("ERROR\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,382 @@
+/*
+ * main.c
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+/*
+ * test for the network transport of sio (tcp://host:port, udp://host:port)
+ * a loopback server thread echoes all data as a half duplex bus reads back
+ * the own telegrams: tcp in small pieces (the bus layer has to reassemble
+ * the telegrams), udp datagram by datagram (the number of datagrams has to
+ * match the number of telegrams/buffers sent).
+ * Telegrams are sent one by one, as buffer with several telegrams and by the
+ * tx queue. At the end the tcp server closes the connection, the bus layer
+ * has to report the interface error.
+ *
+ * usage: sionettest
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "sio.h"
+#include "bus.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define NUM_MSG          3
+#define TCP_ECHO_CHUNK   3      // tcp echo in pieces of 3 bytes
+#define RX_TIMEOUT_MS    1000
+#define URL_SIZE         64
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+static int           sTcpListenFd;
+static int           sUdpFd;
+static uint16_t      sTcpPort;
+static uint16_t      sUdpPort;
+static volatile int  sNumDatagram;
+static volatile bool sTcpClose;
+static volatile bool sStop;
+
+static TBusTelegram  sMsg[NUM_MSG];
+
+/*-----------------------------------------------------------------------------
+*  time in us
+*/
+static uint64_t TimeUs(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*-----------------------------------------------------------------------------
+*  open loopback socket, returns fd and port
+*/
+static int SocketOpen(int type, uint16_t *pPort) {
+
+    int                fd;
+    struct sockaddr_in addr;
+    socklen_t          addrLen = sizeof(addr);
+
+    fd = socket(AF_INET, type, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+        (getsockname(fd, (struct sockaddr *)&addr, &addrLen) != 0)) {
+        close(fd);
+        return -1;
+    }
+    if ((type == SOCK_STREAM) && (listen(fd, 1) != 0)) {
+        close(fd);
+        return -1;
+    }
+    *pPort = ntohs(addr.sin_port);
+    return fd;
+}
+
+/*-----------------------------------------------------------------------------
+*  loopback server: echo tcp and udp
+*/
+static void *Server(void *pArg) {
+
+    struct pollfd      pfd[3];
+    int                tcpFd = -1;
+    uint8_t            buf[1024];
+    int                len;
+    int                i;
+    struct sockaddr_in addr;
+    socklen_t          addrLen;
+    int                on = 1;
+
+    pfd[0].fd = sTcpListenFd;
+    pfd[1].fd = sUdpFd;
+    for (i = 0; i < 3; i++) {
+        pfd[i].events = POLLIN;
+    }
+    while (!sStop) {
+        if ((tcpFd >= 0) && sTcpClose) {
+            close(tcpFd);
+            tcpFd = -1;
+        }
+        pfd[2].fd = tcpFd;
+        poll(pfd, 3, 10);
+        if (pfd[0].revents & POLLIN) {
+            tcpFd = accept(sTcpListenFd, 0, 0);
+            setsockopt(tcpFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        if (pfd[1].revents & POLLIN) {
+            addrLen = sizeof(addr);
+            len = recvfrom(sUdpFd, buf, sizeof(buf), 0, (struct sockaddr *)&addr, &addrLen);
+            if (len > 0) {
+                sNumDatagram++;
+                sendto(sUdpFd, buf, len, 0, (struct sockaddr *)&addr, addrLen);
+            }
+        }
+        if ((tcpFd >= 0) && (pfd[2].revents & POLLIN)) {
+            len = read(tcpFd, buf, sizeof(buf));
+            for (i = 0; i < len; i += TCP_ECHO_CHUNK) {
+                if (write(tcpFd, buf + i, min(TCP_ECHO_CHUNK, len - i)) < 0) {
+                    break;
+                }
+                usleep(100);
+            }
+        }
+    }
+    if (tcpFd >= 0) {
+        close(tcpFd);
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  test telegrams: short, long with STX/ESC (byte stuffing), variable length
+*/
+static void MsgInit(void) {
+
+    int i;
+
+    memset(sMsg, 0, sizeof(sMsg));
+    sMsg[0].type = eBusDevReqInfo;
+    sMsg[0].senderAddr = 250;
+    sMsg[0].msg.devBus.receiverAddr = 1;
+
+    sMsg[1].type = eBusDevReqEepromWriteBlock;
+    sMsg[1].senderAddr = 250;
+    sMsg[1].msg.devBus.receiverAddr = 2;
+    sMsg[1].msg.devBus.x.devReq.writeEepromBlock.addr = 0x0102;
+    sMsg[1].msg.devBus.x.devReq.writeEepromBlock.length = BUS_EEPROM_BLOCK_SIZE;
+    for (i = 0; i < BUS_EEPROM_BLOCK_SIZE; i++) {
+        sMsg[1].msg.devBus.x.devReq.writeEepromBlock.data[i] = (i % 2) ? 0x02 : 0x1b;
+    }
+
+    sMsg[2].type = eBusDevReqSetVar;
+    sMsg[2].senderAddr = 250;
+    sMsg[2].msg.devBus.receiverAddr = 3;
+    sMsg[2].msg.devBus.x.devReq.setVar.index = 7;
+    sMsg[2].msg.devBus.x.devReq.setVar.length = 2;
+    sMsg[2].msg.devBus.x.devReq.setVar.data[0] = 0x12;
+    sMsg[2].msg.devBus.x.devReq.setVar.data[1] = 0x34;
+}
+
+/*-----------------------------------------------------------------------------
+*  compare telegrams by their encoding
+*/
+static bool MsgEqual(TBusTelegram *pMsg1, TBusTelegram *pMsg2) {
+
+    uint8_t buf1[2 * sizeof(TBusTelegram) + 2];
+    uint8_t buf2[2 * sizeof(TBusTelegram) + 2];
+    uint8_t len1;
+    uint8_t len2;
+
+    if ((BusEncode(pMsg1, buf1, sizeof(buf1), &len1) != BUS_SEND_OK) ||
+        (BusEncode(pMsg2, buf2, sizeof(buf2), &len2) != BUS_SEND_OK)) {
+        return false;
+    }
+    return (len1 == len2) && (memcmp(buf1, buf2, len1) == 0);
+}
+
+/*-----------------------------------------------------------------------------
+*  receive the test telegrams first .. last in order
+*/
+static int RxMsg(TBusCtx *pCtx, int sioHandle, int first, int last) {
+
+    TBusTelegram   *pRxMsg = BusCtxMsgBufGet(pCtx);
+    int            idx = first;
+    int            fd = SioGetFd(sioHandle);
+    uint8_t        ret;
+    uint64_t       start = TimeUs();
+    fd_set         rdFds;
+    struct timeval tv;
+
+    while ((idx <= last) && ((TimeUs() - start) < RX_TIMEOUT_MS * 1000)) {
+        ret = BusCtxCheck(pCtx);
+        if (ret == BUS_MSG_OK) {
+            if (!MsgEqual(pRxMsg, &sMsg[idx])) {
+                printf("telegram %d different\n", idx);
+                return -1;
+            }
+            idx++;
+        } else if (ret == BUS_IF_ERROR) {
+            return -1;
+        } else if (ret != BUS_MSG_RXING) {
+            FD_ZERO(&rdFds);
+            FD_SET(fd, &rdFds);
+            tv.tv_sec = 0;
+            tv.tv_usec = 10000;
+            select(fd + 1, &rdFds, 0, 0, &tv);
+        }
+    }
+    return (idx > last) ? 0 : -1;
+}
+
+/*-----------------------------------------------------------------------------
+*  send and receive the telegrams one by one, in one buffer and by tx queue
+*/
+static int Run(const char *pUrl) {
+
+    int          sioHandle;
+    TBusCtx      *pCtx;
+    int          i;
+    uint8_t      buf[2 * sizeof(TBusTelegram) + 2];
+    uint8_t      len;
+    uint64_t     start;
+    unsigned int roundTripUs = 0;
+    int          ret;
+
+    sioHandle = SioOpen(pUrl, eSioBaud9600, eSioDataBits8, eSioParityNo,
+                        eSioStopBits1, eSioModeHalfDuplex);
+    if (sioHandle == -1) {
+        printf("cannot open %s\n", pUrl);
+        return -1;
+    }
+    pCtx = BusCtxOpen(sioHandle);
+
+    /* one by one: round trip time of the telegram to the server and back */
+    for (i = 0; i < NUM_MSG; i++) {
+        start = TimeUs();
+        if (BusCtxSend(pCtx, &sMsg[i]) != BUS_SEND_OK) {
+            return -1;
+        }
+        if (RxMsg(pCtx, sioHandle, i, i) != 0) {
+            printf("%s: one by one failed\n", pUrl);
+            return -1;
+        }
+        roundTripUs += TimeUs() - start;
+    }
+
+    /* several telegrams in one buffer */
+    for (i = 0; i < NUM_MSG; i++) {
+        if (BusCtxSendToBuf(pCtx, &sMsg[i]) != BUS_SEND_OK) {
+            return -1;
+        }
+    }
+    if ((BusCtxSendBuf(pCtx) != BUS_SEND_OK) ||
+        (RxMsg(pCtx, sioHandle, 0, NUM_MSG - 1) != 0)) {
+        printf("%s: buffer failed\n", pUrl);
+        return -1;
+    }
+
+    /* tx queue */
+    for (i = 0; i < NUM_MSG; i++) {
+        if ((BusEncode(&sMsg[i], buf, sizeof(buf), &len) != BUS_SEND_OK) ||
+            (SioTxQueueAdd(sioHandle, buf, len, eSioTxPrioNormal) < 0)) {
+            return -1;
+        }
+    }
+    for (i = 0; (i < 100) && ((ret = SioTxQueueFlush(sioHandle)) > 0); i++) {
+        usleep(1000);
+    }
+    if ((ret != 0) ||
+        (RxMsg(pCtx, sioHandle, 0, NUM_MSG - 1) != 0)) {
+        printf("%s: tx queue failed\n", pUrl);
+        return -1;
+    }
+    printf("%s: round trip %u us\n", pUrl, roundTripUs / NUM_MSG);
+
+    BusCtxClose(pCtx);
+    return sioHandle;
+}
+
+/*-----------------------------------------------------------------------------
+*  main
+*/
+int main(void) {
+
+    pthread_t thread;
+    char      url[URL_SIZE];
+    int       sioHandle;
+    int       i;
+    TBusCtx   *pCtx;
+    uint8_t   ret = BUS_NO_MSG;
+    int       rc = 0;
+
+    SioInit();
+    MsgInit();
+    sTcpListenFd = SocketOpen(SOCK_STREAM, &sTcpPort);
+    sUdpFd = SocketOpen(SOCK_DGRAM, &sUdpPort);
+    if ((sTcpListenFd < 0) || (sUdpFd < 0)) {
+        printf("cannot open server sockets\n");
+        return 1;
+    }
+    pthread_create(&thread, 0, Server, 0);
+
+    snprintf(url, sizeof(url), "udp://127.0.0.1:%u", sUdpPort);
+    sioHandle = Run(url);
+    /* one datagram per telegram, the buffer in one datagram */
+    if ((sioHandle < 0) || (sNumDatagram != (NUM_MSG + 1 + NUM_MSG))) {
+        printf("udp: %d datagrams\n", sNumDatagram);
+        rc = 1;
+    } else {
+        SioClose(sioHandle);
+    }
+
+    snprintf(url, sizeof(url), "tcp://127.0.0.1:%u", sTcpPort);
+    sioHandle = Run(url);
+    if (sioHandle < 0) {
+        rc = 1;
+    } else {
+        /* connection closed by server */
+        sTcpClose = true;
+        pCtx = BusCtxOpen(sioHandle);
+        for (i = 0; (i < 100) && (ret != BUS_IF_ERROR); i++) {
+            ret = BusCtxCheck(pCtx);
+            usleep(1000);
+        }
+        if (ret != BUS_IF_ERROR) {
+            printf("tcp: close not detected\n");
+            rc = 1;
+        }
+        BusCtxClose(pCtx);
+        SioClose(sioHandle);
+    }
+
+    sStop = true;
+    pthread_join(thread, 0);
+
+    if (rc == 0) {
+        printf("OK\n");
+    } else {
+        printf("ERROR\n");
+    }
+    return rc;
+}
@@ -0,0 +1,314 @@
+/*
+ * main.c
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+/*
+ * test for the capture replay of sio (replay://file[@speed])
+ * a capture with NUM_ROUND * NUM_MSG telegrams is written: one telegram every
+ * MSG_GAP_US, split into chunks of 1..4 characters with their own timestamps
+ * (per character and per chunk capture). The capture is replayed with the
+ * bus layer as fast as possible, in real time and at 4x speed. The telegrams,
+ * the timestamps (capture time scaled by the speed) and the duration of the
+ * replay are checked, the telegrams sent during the replay are discarded and
+ * the end of the capture is reported as interface error.
+ * The replay as fast as possible is recorded by SioCaptureOpen, the recorded
+ * capture has to give the same result.
+ *
+ * usage: sioreplaytest
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/select.h>
+
+#include "sio.h"
+#include "bus.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define NUM_MSG          3
+#define NUM_ROUND        8
+#define MSG_GAP_US       20000
+#define CHAR_TIME_US     87      // 115200 baud, longest telegram < MSG_GAP_US
+#define START_TIME_US    123456789
+#define TIME_MARGIN_US   100000  // scheduling tolerance of the replay duration
+#define RX_TIMEOUT_MS    5000
+#define URL_SIZE         128
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+static TBusTelegram  sMsg[NUM_MSG];
+static uint64_t      sMsgTimeUs[NUM_ROUND * NUM_MSG]; // capture time of last chunk
+
+/*-----------------------------------------------------------------------------
+*  time in us
+*/
+static uint64_t TimeUs(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*-----------------------------------------------------------------------------
+*  test telegrams: short, long with STX/ESC (byte stuffing), variable length
+*/
+static void MsgInit(void) {
+
+    int i;
+
+    memset(sMsg, 0, sizeof(sMsg));
+    sMsg[0].type = eBusDevReqInfo;
+    sMsg[0].senderAddr = 250;
+    sMsg[0].msg.devBus.receiverAddr = 1;
+
+    sMsg[1].type = eBusDevReqEepromWriteBlock;
+    sMsg[1].senderAddr = 250;
+    sMsg[1].msg.devBus.receiverAddr = 2;
+    sMsg[1].msg.devBus.x.devReq.writeEepromBlock.addr = 0x0102;
+    sMsg[1].msg.devBus.x.devReq.writeEepromBlock.length = BUS_EEPROM_BLOCK_SIZE;
+    for (i = 0; i < BUS_EEPROM_BLOCK_SIZE; i++) {
+        sMsg[1].msg.devBus.x.devReq.writeEepromBlock.data[i] = (i % 2) ? 0x02 : 0x1b;
+    }
+
+    sMsg[2].type = eBusDevReqSetVar;
+    sMsg[2].senderAddr = 250;
+    sMsg[2].msg.devBus.receiverAddr = 3;
+    sMsg[2].msg.devBus.x.devReq.setVar.index = 7;
+    sMsg[2].msg.devBus.x.devReq.setVar.length = 2;
+    sMsg[2].msg.devBus.x.devReq.setVar.data[0] = 0x12;
+    sMsg[2].msg.devBus.x.devReq.setVar.data[1] = 0x34;
+}
+
+/*-----------------------------------------------------------------------------
+*  compare telegrams by their encoding
+*/
+static bool MsgEqual(TBusTelegram *pMsg1, TBusTelegram *pMsg2) {
+
+    uint8_t buf1[2 * sizeof(TBusTelegram) + 2];
+    uint8_t buf2[2 * sizeof(TBusTelegram) + 2];
+    uint8_t len1;
+    uint8_t len2;
+
+    if ((BusEncode(pMsg1, buf1, sizeof(buf1), &len1) != BUS_SEND_OK) ||
+        (BusEncode(pMsg2, buf2, sizeof(buf2), &len2) != BUS_SEND_OK)) {
+        return false;
+    }
+    return (len1 == len2) && (memcmp(buf1, buf2, len1) == 0);
+}
+
+/*-----------------------------------------------------------------------------
+*  write capture file
+*/
+static int CaptureWrite(const char *pFileName) {
+
+    FILE     *pFile;
+    uint8_t  buf[2 * sizeof(TBusTelegram) + 2];
+    uint8_t  len;
+    uint8_t  pos;
+    uint8_t  chunk;
+    uint64_t timeUs;
+    int      i;
+    int      j;
+    int      k;
+
+    pFile = fopen(pFileName, "w");
+    if (pFile == 0) {
+        return -1;
+    }
+    fprintf(pFile, "# sioreplaytest capture\n");
+    for (i = 0; i < NUM_ROUND * NUM_MSG; i++) {
+        if (BusEncode(&sMsg[i % NUM_MSG], buf, sizeof(buf), &len) != BUS_SEND_OK) {
+            fclose(pFile);
+            return -1;
+        }
+        timeUs = START_TIME_US + (uint64_t)i * MSG_GAP_US;
+        for (pos = 0, j = 0; pos < len; pos += chunk, j++) {
+            chunk = min(j % 4 + 1, len - pos);
+            fprintf(pFile, "%llu", (unsigned long long)(timeUs + pos * CHAR_TIME_US));
+            for (k = 0; k < chunk; k++) {
+                fprintf(pFile, " %02x", buf[pos + k]);
+            }
+            fprintf(pFile, "\n");
+        }
+        sMsgTimeUs[i] = timeUs + (pos - chunk) * CHAR_TIME_US;
+    }
+    fclose(pFile);
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  replay capture with speed, optionally record it to pCapFile
+*  returns replay time in us or -1
+*/
+static long Replay(const char *pFileName, const char *pSpeed, double speed,
+                   const char *pCapFile) {
+
+    char           url[URL_SIZE];
+    int            sioHandle;
+    int            fd;
+    TBusCtx        *pCtx;
+    TBusTelegram   *pRxMsg;
+    uint8_t        ret;
+    uint8_t        buf[2 * sizeof(TBusTelegram) + 2];
+    uint8_t        len;
+    uint64_t       start;
+    uint64_t       timeUs;
+    uint64_t       firstTimeUs = 0;
+    uint64_t       expectedUs;
+    int            idx = 0;
+    fd_set         rdFds;
+    struct timeval tv;
+
+    snprintf(url, sizeof(url), "replay://%s%s", pFileName, pSpeed);
+    sioHandle = SioOpen(url, eSioBaud9600, eSioDataBits8, eSioParityNo,
+                        eSioStopBits1, eSioModeHalfDuplex);
+    if (sioHandle == -1) {
+        printf("cannot open %s\n", url);
+        return -1;
+    }
+    if (!SioIsReplay(sioHandle)) {
+        printf("%s: no replay handle\n", url);
+        return -1;
+    }
+    if ((pCapFile != 0) && !SioCaptureOpen(sioHandle, pCapFile)) {
+        printf("cannot open %s\n", pCapFile);
+        return -1;
+    }
+    pCtx = BusCtxOpen(sioHandle);
+    pRxMsg = BusCtxMsgBufGet(pCtx);
+    fd = SioGetFd(sioHandle);
+
+    start = TimeUs();
+    while ((TimeUs() - start) < RX_TIMEOUT_MS * 1000) {
+        FD_ZERO(&rdFds);
+        FD_SET(fd, &rdFds);
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        select(fd + 1, &rdFds, 0, 0, &tv);
+        while ((ret = BusCtxCheck(pCtx)) == BUS_MSG_OK) {
+            if ((idx >= NUM_ROUND * NUM_MSG) || !MsgEqual(pRxMsg, &sMsg[idx % NUM_MSG])) {
+                printf("%s: telegram %d different\n", url, idx);
+                return -1;
+            }
+            /* time relative to the first telegram, speed 0: as captured */
+            timeUs = BusCtxMsgTimeGet(pCtx);
+            if (idx == 0) {
+                firstTimeUs = timeUs;
+            }
+            expectedUs = sMsgTimeUs[idx] - sMsgTimeUs[0];
+            if (speed > 0) {
+                expectedUs /= speed;
+            }
+            if (((timeUs - firstTimeUs) > expectedUs + 1) ||
+                ((timeUs - firstTimeUs) + 1 < expectedUs)) {
+                printf("%s: telegram %d at %llu us, expected %llu us\n", url, idx,
+                       (unsigned long long)(timeUs - firstTimeUs),
+                       (unsigned long long)expectedUs);
+                return -1;
+            }
+            idx++;
+            /* the response is discarded */
+            if ((BusCtxSend(pCtx, &sMsg[0]) != BUS_SEND_OK) ||
+                (BusEncode(&sMsg[1], buf, sizeof(buf), &len) != BUS_SEND_OK) ||
+                (SioTxQueueAdd(sioHandle, buf, len, eSioTxPrioNormal) < 0) ||
+                (SioTxQueueFlush(sioHandle) != 0)) {
+                printf("%s: send failed\n", url);
+                return -1;
+            }
+        }
+        if (ret == BUS_IF_ERROR) {
+            break;
+        }
+    }
+    timeUs = TimeUs() - start;
+    BusCtxClose(pCtx);
+    SioClose(sioHandle);
+
+    if ((ret != BUS_IF_ERROR) || (idx != NUM_ROUND * NUM_MSG)) {
+        printf("%s: %d telegrams, no end of capture\n", url, idx);
+        return -1;
+    }
+    printf("%s: %d telegrams in %llu us\n", url, idx, (unsigned long long)timeUs);
+    return (long)timeUs;
+}
+
+/*-----------------------------------------------------------------------------
+*  main
+*/
+int main(void) {
+
+    char    fileName[] = "/tmp/sioreplaytestXXXXXX";
+    char    capFileName[] = "/tmp/sioreplaycapXXXXXX";
+    int     fd1;
+    int     fd2;
+    long    durationUs;
+    long    expectedUs;
+    int     rc = 0;
+
+    SioInit();
+    MsgInit();
+    fd1 = mkstemp(fileName);
+    fd2 = mkstemp(capFileName);
+    if ((fd1 < 0) || (fd2 < 0) || (CaptureWrite(fileName) != 0)) {
+        printf("cannot write capture\n");
+        return 1;
+    }
+    close(fd1);
+    close(fd2);
+
+    /* the capture lasts about (NUM_ROUND * NUM_MSG - 1) * MSG_GAP_US */
+    expectedUs = (NUM_ROUND * NUM_MSG - 1) * MSG_GAP_US;
+    durationUs = Replay(fileName, "@0", 0, capFileName);
+    if ((durationUs < 0) || (durationUs >= expectedUs / 2)) {
+        rc = 1;
+    }
+    durationUs = Replay(capFileName, "@0", 0, 0);
+    if ((durationUs < 0) || (durationUs >= expectedUs / 2)) {
+        rc = 1;
+    }
+    durationUs = Replay(fileName, "", 1, 0);
+    if ((durationUs < expectedUs) || (durationUs >= expectedUs + TIME_MARGIN_US)) {
+        rc = 1;
+    }
+    durationUs = Replay(fileName, "@4", 4, 0);
+    if ((durationUs < expectedUs / 4) || (durationUs >= expectedUs / 4 + TIME_MARGIN_US)) {
+        rc = 1;
+    }
+    unlink(fileName);
+    unlink(capFileName);
+
+    if (rc != 0) {
+        printf("ERROR\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,316 @@
+/*
+ * main.c
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+/*
+ * stress test for the handle table and the buffers of sio
+ * NUM_PORT ptys are opened at the same time (more than the former fixed
+ * table of 4 handles) with BUF_SIZE rx and tx buffers.
+ * tx: every port writes a burst of BURST_LEN characters by SioWriteBuffered
+ *     in random pieces and one SioSendBuffer, the master side of the pty has
+ *     to receive the burst unchanged.
+ * rx: the master sides write a burst of BURST_LEN characters to all ports,
+ *     the ports read in random pieces, random parts (up to MAX_UNREAD_LEN
+ *     characters, beyond 255 and the wrap around of the ring buffer) are
+ *     given back by SioUnRead and read again. In between the buffer size is
+ *     changed (the unread characters have to be kept).
+ * At the end every second port is closed and opened again: the handles have
+ * to be reused.
+ *
+ * usage: siostresstest
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "sysdef.h"
+#include "sio.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define NUM_PORT         32
+#define BURST_LEN        6000
+#define BUF_SIZE         8192
+#define MAX_UNREAD_LEN   2000
+#define TEST_TIMEOUT_MS  20000
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+typedef struct {
+    int          masterFd;
+    int          sioHandle;
+    uint8_t      tx[BURST_LEN];     // burst port -> master
+    uint8_t      rx[BURST_LEN];     // burst master -> port
+    unsigned int rxWritten;         // by master
+    unsigned int rxPos;             // read by port
+    unsigned int unRead;            // characters in unread buffer
+} TPort;
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+static TPort        sPort[NUM_PORT];
+static unsigned int sSeed = 4711;
+
+/*-----------------------------------------------------------------------------
+*  time in ms
+*/
+static unsigned long TimeMs(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+/*-----------------------------------------------------------------------------
+*  open pty and sio on its slave side
+*/
+static int PortOpen(TPort *pPort) {
+
+    const char *pSlaveName;
+
+    pPort->masterFd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if ((pPort->masterFd < 0) ||
+        (grantpt(pPort->masterFd) != 0) ||
+        (unlockpt(pPort->masterFd) != 0)) {
+        printf("cannot open pty\n");
+        return -1;
+    }
+    pSlaveName = ptsname(pPort->masterFd);
+    pPort->sioHandle = SioOpen(pSlaveName, eSioBaud115200, eSioDataBits8, eSioParityNo,
+                               eSioStopBits1, eSioModeFullDuplex);
+    if (pPort->sioHandle == -1) {
+        printf("cannot open %s\n", pSlaveName);
+        return -1;
+    }
+    if (!SioSetBufSize(pPort->sioHandle, BUF_SIZE, BUF_SIZE)) {
+        printf("cannot set buffer size\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  port -> master
+*/
+static int TestTx(void) {
+
+    TPort         *pPort;
+    int           i;
+    unsigned int  pos;
+    uint8_t       len;
+    uint8_t       buf[BURST_LEN];
+    unsigned int  rxLen;
+    int           ret;
+    unsigned long start;
+
+    for (i = 0; i < NUM_PORT; i++) {
+        pPort = &sPort[i];
+        for (pos = 0; pos < BURST_LEN; pos += len) {
+            len = rand_r(&sSeed) % 255 + 1;
+            len = min(len, BURST_LEN - pos);
+            if (SioWriteBuffered(pPort->sioHandle, pPort->tx + pos, len) != len) {
+                printf("port %d: tx buffer full at %u\n", i, pos);
+                return -1;
+            }
+        }
+        if (!SioSendBuffer(pPort->sioHandle)) {
+            printf("port %d: send failed\n", i);
+            return -1;
+        }
+    }
+    for (i = 0; i < NUM_PORT; i++) {
+        pPort = &sPort[i];
+        start = TimeMs();
+        for (rxLen = 0; (rxLen < BURST_LEN) && ((TimeMs() - start) < 1000); ) {
+            ret = read(pPort->masterFd, buf + rxLen, sizeof(buf) - rxLen);
+            if (ret > 0) {
+                rxLen += ret;
+            } else {
+                usleep(1000);
+            }
+        }
+        if ((rxLen != BURST_LEN) || (memcmp(buf, pPort->tx, BURST_LEN) != 0)) {
+            printf("port %d: tx burst different (%u)\n", i, rxLen);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  master -> port with unread
+*/
+static int TestRx(void) {
+
+    TPort         *pPort;
+    int           i;
+    int           ret;
+    uint8_t       buf[UINT8_MAX];
+    uint8_t       len;
+    unsigned int  num;
+    unsigned int  maxNum = 0;
+    unsigned int  numUnRead = 0;
+    unsigned int  numResize = 0;
+    unsigned int  numDone = 0;
+    unsigned long start = TimeMs();
+
+    while ((numDone < NUM_PORT) && ((TimeMs() - start) < TEST_TIMEOUT_MS)) {
+        numDone = 0;
+        for (i = 0; i < NUM_PORT; i++) {
+            pPort = &sPort[i];
+            if (pPort->rxWritten < BURST_LEN) {
+                ret = write(pPort->masterFd, pPort->rx + pPort->rxWritten,
+                            BURST_LEN - pPort->rxWritten);
+                if (ret > 0) {
+                    pPort->rxWritten += ret;
+                }
+            }
+            if (pPort->rxPos == BURST_LEN) {
+                numDone++;
+                continue;
+            }
+            num = SioGetNumRxChar16(pPort->sioHandle);
+            maxNum = max(maxNum, num);
+            if ((num > 255) && (SioGetNumRxChar(pPort->sioHandle) != 255)) {
+                printf("port %d: SioGetNumRxChar %u\n", i, num);
+                return -1;
+            }
+            len = SioRead(pPort->sioHandle, buf, rand_r(&sSeed) % sizeof(buf) + 1);
+            if ((len > 0) && (memcmp(buf, pPort->rx + pPort->rxPos, len) != 0)) {
+                printf("port %d: rx different at %u\n", i, pPort->rxPos);
+                return -1;
+            }
+            pPort->rxPos += len;
+            pPort->unRead -= min(pPort->unRead, len);
+            /* give back the last characters read in pieces of max. 255 */
+            if ((pPort->unRead == 0) && (pPort->rxPos < BURST_LEN) &&
+                ((rand_r(&sSeed) % 8) == 0)) {
+                num = rand_r(&sSeed) % MAX_UNREAD_LEN + 1;
+                num = min(num, pPort->rxPos);
+                pPort->rxPos -= num;
+                pPort->unRead = num;
+                for (; num > 0; num -= len) {
+                    len = min(num, 255);
+                    SioUnRead(pPort->sioHandle, pPort->rx + pPort->rxPos + pPort->unRead - num, len);
+                }
+                numUnRead++;
+                if ((rand_r(&sSeed) % 4) == 0) {
+                    if (!SioSetBufSize(pPort->sioHandle,
+                                       (numResize % 2) ? BUF_SIZE : 2 * BUF_SIZE, BUF_SIZE)) {
+                        printf("port %d: cannot change buffer size\n", i);
+                        return -1;
+                    }
+                    numResize++;
+                }
+            }
+        }
+    }
+    if (numDone < NUM_PORT) {
+        printf("rx timeout\n");
+        return -1;
+    }
+    /* the driver has to be read in parts, the unread buffer beyond 255 */
+    printf("rx: max. %u characters available, %u unread, %u resize\n",
+           maxNum, numUnRead, numResize);
+    return (maxNum > 255) ? 0 : -1;
+}
+
+/*-----------------------------------------------------------------------------
+*  close and open every second port: the handles are reused
+*/
+static int TestReopen(void) {
+
+    int  i;
+    int  handle;
+    bool used[NUM_PORT];
+
+    memset(used, 0, sizeof(used));
+    for (i = 0; i < NUM_PORT; i += 2) {
+        SioClose(sPort[i].sioHandle);
+        close(sPort[i].masterFd);
+    }
+    for (i = 0; i < NUM_PORT; i += 2) {
+        if (PortOpen(&sPort[i]) != 0) {
+            return -1;
+        }
+    }
+    for (i = 0; i < NUM_PORT; i++) {
+        handle = sPort[i].sioHandle;
+        if ((handle < 0) || (handle >= NUM_PORT) || used[handle]) {
+            printf("handle %d not reused\n", handle);
+            return -1;
+        }
+        used[handle] = true;
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  main
+*/
+int main(void) {
+
+    int          i;
+    unsigned int j;
+    int          rc = 0;
+
+    SioInit();
+    for (i = 0; i < NUM_PORT; i++) {
+        memset(&sPort[i], 0, sizeof(sPort[i]));
+        for (j = 0; j < BURST_LEN; j++) {
+            sPort[i].tx[j] = rand_r(&sSeed);
+            sPort[i].rx[j] = rand_r(&sSeed);
+        }
+        if (PortOpen(&sPort[i]) != 0) {
+            return 1;
+        }
+    }
+    if ((TestTx() != 0) ||
+        (TestRx() != 0) ||
+        (TestReopen() != 0)) {
+        rc = 1;
+    }
+    SioExit();
+    for (i = 0; i < NUM_PORT; i++) {
+        close(sPort[i].masterFd);
+    }
+
+    if (rc != 0) {
+        printf("ERROR\n");
+        return 1;
+    }
+    printf("%d ports, %d characters per burst\n", NUM_PORT, BURST_LEN);
+    printf("OK\n");
+    return 0;
+}
@@ -124,6 +124,18 @@ int SioOpen(const char *pPortName,
       case eSioBaud9600:
          dcb.BaudRate = 9600;
          break;
+      case eSioBaud19200:
+         dcb.BaudRate = 19200;
+         break;
+      case eSioBaud38400:
+         dcb.BaudRate = 38400;
+         break;
+      case eSioBaud57600:
+         dcb.BaudRate = 57600;
+         break;
+      case eSioBaud115200:
+         dcb.BaudRate = 115200;
+         break;
       default:
          dcb.BaudRate = 9600;
          break;
@@ -268,6 +280,13 @@ bool SioSendBuffer(int handle) {
     return rc;
 }
 
+/*-----------------------------------------------------------------------------
+*  tx priority of buffer: the buffer is written directly in SioSendBuffer,
+*  there is no bus access arbitration on this side
+*/
+void SioSetTxPrio(int handle, TSioTxPrio prio) {
+}
+
 /*-----------------------------------------------------------------------------
 *  Sio Empfangspuffer lesen
 */
@@ -435,3 +454,38 @@ bool SioHandleValid(int handle) {
 
     return true;
 }
+
+/*-----------------------------------------------------------------------------
+*  no capture replay for win32
+*/
+bool SioIsReplay(int handle) {
+
+    return false;
+}
+
+/*-----------------------------------------------------------------------------
+*  baud rate in bit/s to TSioBaud (command line option of the tools)
+*/
+bool SioBaudFromRate(unsigned long rate, TSioBaud *pBaud) {
+
+   switch (rate) {
+      case 9600:
+         *pBaud = eSioBaud9600;
+         break;
+      case 19200:
+         *pBaud = eSioBaud19200;
+         break;
+      case 38400:
+         *pBaud = eSioBaud38400;
+         break;
+      case 57600:
+         *pBaud = eSioBaud57600;
+         break;
+      case 115200:
+         *pBaud = eSioBaud115200;
+         break;
+      default:
+         return false;
+   }
+   return true;
+}
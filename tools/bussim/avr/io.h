@@ -0,0 +1,131 @@
+/*
+ * io.h - simulated ATmega88 registers for bussim
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef _SIM_AVR_IO_H
+#define _SIM_AVR_IO_H
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+/* the registers used by the avr sio modules are mapped to the register set
+ * of the node that is currently executed by the simulator (gSimRegs)
+ */
+#define SREG       gSimRegs->sreg
+#define UCSR0A     gSimRegs->ucsr0a
+#define UCSR0B     gSimRegs->ucsr0b
+#define UCSR0C     gSimRegs->ucsr0c
+#define UBRR0H     gSimRegs->ubrr0h
+#define UBRR0L     gSimRegs->ubrr0l
+#define EICRA      gSimRegs->eicra
+#define EIMSK      gSimRegs->eimsk
+#define EIFR       gSimRegs->eifr
+#define TCCR1A     gSimRegs->tccr1a
+#define TCCR1B     gSimRegs->tccr1b
+#define TCCR1C     gSimRegs->tccr1c
+#define TIMSK1     gSimRegs->timsk1
+#define TIFR1      gSimRegs->tifr1
+#define OCR1A      gSimRegs->ocr1a
+#define OCR1B      gSimRegs->ocr1b
+#define ICR1       gSimRegs->icr1
+/* read and write accesses are distinguished by the simulator */
+#define UDR0       (*SimUdr())
+#define TCNT1      (*SimTcnt1())
+
+/* bit numbers */
+#define SREG_I     7
+
+#define RXC0       7
+#define TXC0       6
+#define UDRE0      5
+#define U2X0       1
+
+#define RXCIE0     7
+#define TXCIE0     6
+#define UDRIE0     5
+#define RXEN0      4
+#define TXEN0      3
+#define UCSZ02     2
+
+#define UPM01      5
+#define UPM00      4
+#define USBS0      3
+#define UCSZ01     2
+#define UCSZ00     1
+
+#define ISC01      1
+#define ISC00      0
+#define INT0       0
+#define INTF0      0
+
+#define CS10       0
+#define OCIE1A     1
+#define OCF1A      1
+
+/* EIFR bit to detect writes to EIFR, it is set before running node code */
+#define SIM_EIFR_UNCHANGED  0x100
+
+/* number of UDR0 accesses within one call of node code */
+#define SIM_UDR_ACCESS_MAX  8
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+typedef struct {
+    uint8_t  sreg;
+    uint8_t  ucsr0a;
+    uint8_t  ucsr0b;
+    uint8_t  ucsr0c;
+    uint8_t  ubrr0h;
+    uint8_t  ubrr0l;
+    uint8_t  eicra;
+    uint8_t  eimsk;
+    uint16_t eifr;
+    uint8_t  tccr1a;
+    uint8_t  tccr1b;
+    uint8_t  tccr1c;
+    uint8_t  timsk1;
+    uint8_t  tifr1;
+    uint16_t ocr1a;
+    uint16_t ocr1b;
+    uint16_t icr1;
+    /* UDR0 accesses: preset value (read) and value after access (write) */
+    uint16_t udrPreset[SIM_UDR_ACCESS_MAX];
+    uint16_t udr[SIM_UDR_ACCESS_MAX];
+    uint8_t  udrNumAccess;
+    uint16_t udrRx;
+    uint16_t tcnt1;
+} TSimRegs;
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+extern TSimRegs *gSimRegs;
+
+/*-----------------------------------------------------------------------------
+*  Functions
+*/
+volatile uint16_t *SimUdr(void);
+uint16_t *SimTcnt1(void);
+
+#endif
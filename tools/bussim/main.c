@@ -0,0 +1,593 @@
+/*
+ * main.c - discrete-event simulator for the rs485 bus
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "sio.h"
+#include "bus.h"
+#include "node.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define MAX_NUM_NODES    64
+#define TX_QUEUE_LEN     64   /* telegrams waiting for tx per node */
+#define NS_PER_S         1000000000ULL
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+typedef void (* TSetupFunc)(TBusTelegram *pMsg);
+
+typedef struct {
+    uint64_t      *pBuf;
+    unsigned long num;
+    unsigned long size;
+} TLatency;
+
+typedef struct {
+    const char *pName;
+    TSetupFunc setup;
+    unsigned   weight;
+    TLatency   latency;
+} TTrafficClass;
+
+/* char on the wire */
+typedef struct {
+    uint64_t start;
+    uint8_t  ch;
+    bool     startDone;   // start bit delivered to nodes
+    bool     rxDone;      // char delivered to nodes
+} TWireChar;
+
+typedef struct {
+    uint64_t     enqueued[TX_QUEUE_LEN];
+    uint8_t      classIdx[TX_QUEUE_LEN];
+    unsigned     wrIdx;
+    unsigned     rdIdx;
+    uint64_t     nextArrival;
+    unsigned long offered;
+    unsigned long overflow;
+    unsigned long delivered;
+    unsigned long dropped;
+} TApp;
+
+typedef struct {
+    TSioBaud      baud;
+    unsigned long rate;
+} TBaud;
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+static const TBaud sBaud[] = {
+    { eSioBaud9600,     9600 },
+    { eSioBaud19200,   19200 },
+    { eSioBaud38400,   38400 },
+    { eSioBaud57600,   57600 },
+    { eSioBaud115200, 115200 }
+};
+
+static TWireChar *sWire;
+static int       sWireLen;
+static int       sWireSize;
+static uint64_t  sCharTime;
+static uint64_t  sSampleTime;
+static uint64_t  sBusyEnd;
+static uint64_t  sBusyTime;
+
+static TApp      sApp[MAX_NUM_NODES];
+static int       sNumNodes;
+static double    sRate;
+
+static TLatency  sLatency;
+static bool      sNoPrio;
+
+/*-----------------------------------------------------------------------------
+*  Functions
+*/
+static void PrintUsage(void);
+
+/*-----------------------------------------------------------------------------
+*  telegram setup for traffic classes
+*/
+static void SetupButton(TBusTelegram *pMsg) {
+    pMsg->type = eBusButtonPressed1;
+}
+
+static void SetupActualValueEvent(TBusTelegram *pMsg) {
+    pMsg->type = eBusDevReqActualValueEvent;
+    pMsg->msg.devBus.receiverAddr = 0;
+    pMsg->msg.devBus.x.devReq.actualValueEvent.devType = eBusDevTypeDo31;
+}
+
+static void SetupRespActualValue(TBusTelegram *pMsg) {
+    pMsg->type = eBusDevRespActualValue;
+    pMsg->msg.devBus.receiverAddr = 0;
+    pMsg->msg.devBus.x.devResp.actualValue.devType = eBusDevTypeSg;
+}
+
+static void SetupReqActualValue(TBusTelegram *pMsg) {
+    pMsg->type = eBusDevReqActualValue;
+    pMsg->msg.devBus.receiverAddr = 0;
+}
+
+static void SetupRespGetFlashData(TBusTelegram *pMsg) {
+    pMsg->type = eBusDevRespGetFlashData;
+    pMsg->msg.devBus.receiverAddr = 0;
+    pMsg->msg.devBus.x.devResp.getFlashData.addr = 0x1000;
+    pMsg->msg.devBus.x.devResp.getFlashData.numValid = BUS_GETFLASH_PACKET_SIZE;
+}
+
+static void SetupRespGetVar(TBusTelegram *pMsg) {
+    pMsg->type = eBusDevRespGetVar;
+    pMsg->msg.devBus.receiverAddr = 0;
+    pMsg->msg.devBus.x.devResp.getVar.result = eBusVarSuccess;
+    pMsg->msg.devBus.x.devResp.getVar.index = 3;
+    pMsg->msg.devBus.x.devResp.getVar.length = 16;
+}
+
+static TTrafficClass sClass[] = {
+    { "button",  SetupButton,           1 },
+    { "event",   SetupActualValueEvent, 1 },
+    { "actval",  SetupRespActualValue,  0 },
+    { "getvar",  SetupRespGetVar,       0 },
+    { "poll",    SetupReqActualValue,   0 },
+    { "flash",   SetupRespGetFlashData, 0 }
+};
+
+/*-----------------------------------------------------------------------------
+*  parse traffic mix "name=weight,name=weight"
+*/
+static bool ParseMix(char *pMix) {
+
+    char     *pTok;
+    char     *pVal;
+    unsigned i;
+    unsigned sum = 0;
+
+    for (i = 0; i < ARRAY_CNT(sClass); i++) {
+        sClass[i].weight = 0;
+    }
+    for (pTok = strtok(pMix, ","); pTok != 0; pTok = strtok(0, ",")) {
+        pVal = strchr(pTok, '=');
+        if (pVal != 0) {
+            *pVal = '\0';
+            pVal++;
+        }
+        for (i = 0; i < ARRAY_CNT(sClass); i++) {
+            if (strcmp(pTok, sClass[i].pName) == 0) {
+                sClass[i].weight = (pVal != 0) ? atoi(pVal) : 1;
+                sum += sClass[i].weight;
+                break;
+            }
+        }
+        if (i == ARRAY_CNT(sClass)) {
+            printf("unknown traffic class %s\n", pTok);
+            return false;
+        }
+    }
+    return sum > 0;
+}
+
+static uint8_t RandomClass(void) {
+
+    unsigned i;
+    unsigned sum = 0;
+    unsigned r;
+
+    for (i = 0; i < ARRAY_CNT(sClass); i++) {
+        sum += sClass[i].weight;
+    }
+    r = (unsigned)(drand48() * sum);
+    for (i = 0; i < ARRAY_CNT(sClass); i++) {
+        if (r < sClass[i].weight) {
+            break;
+        }
+        r -= sClass[i].weight;
+    }
+    return i;
+}
+
+/*-----------------------------------------------------------------------------
+*  poisson arrivals
+*/
+static uint64_t NextArrival(uint64_t now) {
+    return now + (uint64_t)(-log(1.0 - drand48()) / sRate * NS_PER_S);
+}
+
+/*-----------------------------------------------------------------------------
+*  node starts tx of a char
+*/
+static void WireTx(int nodeIdx, uint64_t timeNs, uint8_t ch) {
+
+    TWireChar *pChar;
+    uint64_t  end = timeNs + sCharTime;
+
+    if (sWireLen == sWireSize) {
+        sWireSize = sWireSize * 2 + 16;
+        sWire = realloc(sWire, sWireSize * sizeof(TWireChar));
+        if (sWire == 0) {
+            printf("out of memory\n");
+            exit(1);
+        }
+    }
+    pChar = &sWire[sWireLen++];
+    pChar->start = timeNs;
+    pChar->ch = ch;
+    pChar->startDone = false;
+    pChar->rxDone = false;
+
+    /* bus utilization */
+    if (end > sBusyEnd) {
+        sBusyTime += end - max(timeNs, sBusyEnd);
+        sBusyEnd = end;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  received char: chars overlapping on the wire are combined, a low bit
+*  (dominant line state) wins
+*/
+static uint8_t WireRx(const TWireChar *pChar) {
+
+    int     i;
+    uint8_t ch = 0xff;
+    uint64_t sample = pChar->start + sSampleTime;
+
+    for (i = 0; i < sWireLen; i++) {
+        if ((sWire[i].start <= sample) &&
+            ((sWire[i].start + sCharTime) > pChar->start)) {
+            ch &= sWire[i].ch;
+        }
+    }
+    return ch;
+}
+
+/*-----------------------------------------------------------------------------
+*  remove chars that cannot overlap a char still to be received
+*/
+static void WireCleanup(uint64_t now) {
+
+    int i;
+    int j = 0;
+
+    for (i = 0; i < sWireLen; i++) {
+        if (!sWire[i].rxDone || ((sWire[i].start + 2 * sCharTime) > now)) {
+            sWire[j++] = sWire[i];
+        }
+    }
+    sWireLen = j;
+}
+
+static void AddLatency(TLatency *pLatency, uint64_t latency) {
+
+    if (pLatency->num == pLatency->size) {
+        pLatency->size = pLatency->size * 2 + 1024;
+        pLatency->pBuf = realloc(pLatency->pBuf, pLatency->size * sizeof(uint64_t));
+        if (pLatency->pBuf == 0) {
+            printf("out of memory\n");
+            exit(1);
+        }
+    }
+    pLatency->pBuf[pLatency->num++] = latency;
+}
+
+static int CompareLatency(const void *p1, const void *p2) {
+
+    uint64_t l1 = *(const uint64_t *)p1;
+    uint64_t l2 = *(const uint64_t *)p2;
+
+    return (l1 > l2) - (l1 < l2);
+}
+
+static double Percentile(const TLatency *pLatency, unsigned percent) {
+
+    unsigned long idx;
+
+    if (pLatency->num == 0) {
+        return 0;
+    }
+    idx = (pLatency->num * percent + 99) / 100;
+    if (idx > 0) {
+        idx--;
+    }
+    return pLatency->pBuf[idx] / 1000000.0;
+}
+
+static void PrintLatency(const char *pName, TLatency *pLatency) {
+
+    qsort(pLatency->pBuf, pLatency->num, sizeof(uint64_t), CompareLatency);
+    printf("%-8s %8lu  p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f\n",
+           pName, pLatency->num,
+           Percentile(pLatency, 50), Percentile(pLatency, 90),
+           Percentile(pLatency, 99), Percentile(pLatency, 100));
+}
+
+/*-----------------------------------------------------------------------------
+*  application of a node: receive telegrams, check tx result, start tx
+*/
+static void Application(int nodeIdx, uint64_t now) {
+
+    TApp         *pApp = &sApp[nodeIdx];
+    TBusTelegram msg;
+    unsigned     idx = pApp->rdIdx % TX_QUEUE_LEN;
+
+    NodeReceive(nodeIdx, now);
+
+    switch (NodeTxState(nodeIdx)) {
+    case eNodeTxOk:
+        AddLatency(&sLatency, now - pApp->enqueued[idx]);
+        AddLatency(&sClass[pApp->classIdx[idx]].latency, now - pApp->enqueued[idx]);
+        pApp->delivered++;
+        pApp->rdIdx++;
+        break;
+    case eNodeTxDropped:
+        pApp->dropped++;
+        pApp->rdIdx++;
+        break;
+    case eNodeTxBusy:
+        return;
+    default:
+        break;
+    }
+    if (pApp->rdIdx != pApp->wrIdx) {
+        idx = pApp->rdIdx % TX_QUEUE_LEN;
+        memset(&msg, 0, sizeof(msg));
+        sClass[pApp->classIdx[idx]].setup(&msg);
+        msg.senderAddr = nodeIdx + 1;
+        NodeSend(nodeIdx, now, &msg, sNoPrio);
+    }
+}
+
+static void NewTelegram(int nodeIdx, uint64_t now) {
+
+    TApp *pApp = &sApp[nodeIdx];
+
+    pApp->offered++;
+    if ((pApp->wrIdx - pApp->rdIdx) < TX_QUEUE_LEN) {
+        pApp->enqueued[pApp->wrIdx % TX_QUEUE_LEN] = now;
+        pApp->classIdx[pApp->wrIdx % TX_QUEUE_LEN] = RandomClass();
+        pApp->wrIdx++;
+    } else {
+        pApp->overflow++;
+    }
+    pApp->nextArrival = NextArrival(now);
+}
+
+/*-----------------------------------------------------------------------------
+*  run the simulation until endTime
+*/
+static void Simulate(uint64_t endTime) {
+
+    uint64_t now;
+    uint64_t t;
+    int      i;
+    int      n;
+    enum {
+        eEvWireStart,
+        eEvWireRx,
+        eEvNode,
+        eEvApp
+    } event;
+    int      idx;
+    uint8_t  ch;
+
+    for (;;) {
+        now = NODE_TIME_NEVER;
+        event = eEvApp;
+        idx = 0;
+        for (i = 0; i < sWireLen; i++) {
+            if (!sWire[i].startDone && (sWire[i].start < now)) {
+                now = sWire[i].start;
+                event = eEvWireStart;
+                idx = i;
+            }
+            if (!sWire[i].rxDone && ((sWire[i].start + sSampleTime) < now)) {
+                now = sWire[i].start + sSampleTime;
+                event = eEvWireRx;
+                idx = i;
+            }
+        }
+        for (n = 0; n < sNumNodes; n++) {
+            t = NodeNextEvent(n);
+            if (t < now) {
+                now = t;
+                event = eEvNode;
+                idx = n;
+            }
+        }
+        for (n = 0; n < sNumNodes; n++) {
+            if (sApp[n].nextArrival < now) {
+                now = sApp[n].nextArrival;
+                event = eEvApp;
+                idx = n;
+            }
+        }
+        if (now >= endTime) {
+            break;
+        }
+
+        switch (event) {
+        case eEvWireStart:
+            sWire[idx].startDone = true;
+            for (n = 0; n < sNumNodes; n++) {
+                NodeStartBit(n, now);
+            }
+            break;
+        case eEvWireRx:
+            sWire[idx].rxDone = true;
+            ch = WireRx(&sWire[idx]);
+            for (n = 0; n < sNumNodes; n++) {
+                NodeRxChar(n, now, ch);
+            }
+            for (n = 0; n < sNumNodes; n++) {
+                Application(n, now);
+            }
+            WireCleanup(now);
+            break;
+        case eEvNode:
+            NodeProcess(idx, now);
+            Application(idx, now);
+            break;
+        case eEvApp:
+            NewTelegram(idx, now);
+            Application(idx, now);
+            break;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  program start
+*/
+int main(int argc, char *argv[]) {
+
+    int           i;
+    int           n;
+    double        simTime = 10.0;
+    unsigned long baudRate = 9600;
+    const TBaud   *pBaud = 0;
+    long          seed = 1;
+    char          mix[256] = "button=1,event=1";
+    TNodeStat     stat;
+    TNodeStat     sum;
+    unsigned long offered = 0;
+    unsigned long overflow = 0;
+    unsigned long delivered = 0;
+    unsigned long dropped = 0;
+    unsigned long pending = 0;
+
+    sNumNodes = 8;
+    sRate = 2.0;
+    for (i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-n") == 0) && (argc > (i + 1))) {
+            sNumNodes = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-t") == 0) && (argc > (i + 1))) {
+            simTime = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-r") == 0) && (argc > (i + 1))) {
+            sRate = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-b") == 0) && (argc > (i + 1))) {
+            baudRate = strtoul(argv[++i], 0, 0);
+        } else if ((strcmp(argv[i], "-m") == 0) && (argc > (i + 1))) {
+            strncpy(mix, argv[++i], sizeof(mix) - 1);
+            mix[sizeof(mix) - 1] = '\0';
+        } else if ((strcmp(argv[i], "-s") == 0) && (argc > (i + 1))) {
+            seed = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-noprio") == 0) {
+            sNoPrio = true;
+        } else {
+            PrintUsage();
+            return -1;
+        }
+    }
+    for (i = 0; i < ARRAY_CNT(sBaud); i++) {
+        if (sBaud[i].rate == baudRate) {
+            pBaud = &sBaud[i];
+        }
+    }
+    if ((pBaud == 0) ||
+        (sNumNodes < 1) || (sNumNodes > MAX_NUM_NODES) ||
+        (simTime <= 0) || (sRate <= 0) ||
+        !ParseMix(mix)) {
+        PrintUsage();
+        return -1;
+    }
+
+    srand48(seed);
+    sCharTime = 10 * (NS_PER_S / pBaud->rate);
+    /* stop bit is sampled in the middle */
+    sSampleTime = 19 * (NS_PER_S / pBaud->rate) / 2;
+    if (NodeInit(sNumNodes, pBaud->baud, pBaud->rate, seed, WireTx) != 0) {
+        printf("cannot open nodes with %lu baud\n", pBaud->rate);
+        return -1;
+    }
+    for (n = 0; n < sNumNodes; n++) {
+        sApp[n].nextArrival = NextArrival(0);
+    }
+
+    Simulate((uint64_t)(simTime * NS_PER_S));
+
+    memset(&sum, 0, sizeof(sum));
+    for (n = 0; n < sNumNodes; n++) {
+        NodeGetStat(n, &stat);
+        sum.txAttempts += stat.txAttempts;
+        sum.collisions += stat.collisions;
+        sum.deferred += stat.deferred;
+        sum.rxOk += stat.rxOk;
+        sum.rxErr += stat.rxErr;
+        offered += sApp[n].offered;
+        overflow += sApp[n].overflow;
+        delivered += sApp[n].delivered;
+        dropped += sApp[n].dropped;
+        pending += sApp[n].wrIdx - sApp[n].rdIdx;
+    }
+    printf("nodes %d, %lu baud, %.1f s, %.2f telegrams/s per node%s\n",
+           sNumNodes, pBaud->rate, simTime, sRate, sNoPrio ? ", no tx priority" : "");
+    printf("offered     %8lu telegrams (%.1f/s), queue overflow %lu\n",
+           offered, offered / simTime, overflow);
+    printf("delivered   %8lu telegrams (%.1f/s), bus busy %.1f %%\n",
+           delivered, delivered / simTime, sBusyTime * 100.0 / (simTime * NS_PER_S));
+    printf("dropped     %8lu telegrams, pending %lu\n", dropped, pending);
+    printf("tx attempts %8lu, collisions %lu (%.2f %%), deferred %lu\n",
+           sum.txAttempts, sum.collisions,
+           sum.txAttempts ? sum.collisions * 100.0 / sum.txAttempts : 0.0,
+           sum.deferred);
+    printf("rx          %8lu telegrams ok, %lu errors\n", sum.rxOk, sum.rxErr);
+    printf("latency ms   number\n");
+    for (i = 0; i < ARRAY_CNT(sClass); i++) {
+        if (sClass[i].weight > 0) {
+            PrintLatency(sClass[i].pName, &sClass[i].latency);
+            free(sClass[i].latency.pBuf);
+        }
+    }
+    PrintLatency("all", &sLatency);
+
+    NodeExit();
+    free(sLatency.pBuf);
+    free(sWire);
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  show help
+*/
+static void PrintUsage(void) {
+
+    unsigned i;
+
+    printf("\nUsage:\n");
+    printf("bussim [-n nodes] [-t seconds] [-r telegrams/s per node] [-b baud]\n");
+    printf("       [-m class=weight,...] [-s seed] [-noprio]\n");
+    printf("traffic classes:");
+    for (i = 0; i < ARRAY_CNT(sClass); i++) {
+        printf(" %s", sClass[i].pName);
+    }
+    printf("\n");
+}
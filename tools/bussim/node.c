@@ -0,0 +1,494 @@
+/*
+ * node.c - simulated bus node running the avr sio module siotype1
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+/* the original avr sio module is compiled into this file. its static
+ * variables hold the state of one node. they are copied from/to the node
+ * descriptor whenever the simulator executes code of another node
+ */
+#include "../../sio/avr/siotype1.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "node.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+/* timer1 tick (prescaler / F_CPU) */
+#define TIMER1_TICK_NS     (1024ULL * 1000000000ULL / F_CPU)
+
+/* max. number of interrupts handled after one event (endless loop guard) */
+#define MAX_NUM_ISR        32
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+/* static variables of siotype1.c */
+typedef struct {
+    TIdleStateFunc                 idleFunc;
+    uint8_t                        rxBuffer[SIO_RX_BUF_SIZE];
+    uint8_t                        rxBufWrIdx;
+    uint8_t                        rxBufRdIdx;
+    uint8_t                        txBuffer[SIO_TX_BUF_SIZE];
+    uint8_t                        txBufWrIdx;
+    uint8_t                        txBufRdIdx;
+    uint8_t                        txBufferBuffered[SIO_TX_BUF_SIZE - 1];
+    uint8_t                        txBufBufferedPos;
+    TBusTransceiverPowerDownFunc   busTransceiverPowerDownFunc;
+    TCommState                     comm;
+    uint16_t                       rand;
+} TSioState;
+
+typedef struct {
+    TSimRegs     regs;
+    TSioState    sio;
+    TBusCtx      *pBus;
+    /* uart */
+    bool         shiftBusy;     // tx shift register in use
+    uint64_t     shiftEnd;      // end of stop bit of char in shift register
+    bool         udrFull;       // tx data register holds a char
+    uint8_t      udrData;
+    bool         txc;           // tx complete flag
+    bool         intf0;         // external interrupt flag (start bit)
+    uint64_t     baudPhase;     // baud rate generator phase
+    /* timer1 */
+    uint64_t     timerPhase;    // node timers are not synchronized
+    uint64_t     timerMatch;    // next compare match interrupt
+    /* telegram transmission */
+    bool         txActive;
+    bool         txDropped;
+    TNodeStat    stat;
+} TNode;
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+TSimRegs *gSimRegs;
+
+static TNode       *sNode;
+static int         sNumNodes;
+static uint64_t    sNow;
+static uint64_t    sCharTime;
+static uint64_t    sBitTime;
+static TNodeTxFunc sTxFunc;
+static volatile uint16_t sScratch;
+
+/*-----------------------------------------------------------------------------
+*  Functions
+*/
+
+/*-----------------------------------------------------------------------------
+*  UDR0 access: each access gets its own location. a read returns the
+*  received char for the first access (rx interrupt), a write is detected
+*  by comparing with the preset value when the node code has returned
+*/
+volatile uint16_t *SimUdr(void) {
+
+    uint8_t idx = gSimRegs->udrNumAccess;
+
+    if (idx >= SIM_UDR_ACCESS_MAX) {
+        sScratch = 0xffff;
+        return &sScratch;
+    }
+    gSimRegs->udrPreset[idx] = (idx == 0) ? gSimRegs->udrRx : 0xffff;
+    gSimRegs->udr[idx] = gSimRegs->udrPreset[idx];
+    gSimRegs->udrNumAccess++;
+
+    return &gSimRegs->udr[idx];
+}
+
+/*-----------------------------------------------------------------------------
+*  TCNT1 is calculated from simulation time
+*/
+uint16_t *SimTcnt1(void) {
+
+    TNode *pNode = (TNode *)gSimRegs;
+
+    gSimRegs->tcnt1 = (uint16_t)((sNow + pNode->timerPhase) / TIMER1_TICK_NS);
+    return &gSimRegs->tcnt1;
+}
+
+/*-----------------------------------------------------------------------------
+*  rx timestamp for the bus library (linux build with BUS_RX_TIMESTAMP):
+*  simulation time of the read
+*/
+uint8_t SioReadTs(int handle, uint8_t *pBuf, uint8_t bufSize, uint64_t *pTimeUs) {
+
+    *pTimeUs = sNow / 1000;
+    return SioRead(handle, pBuf, bufSize);
+}
+
+/*-----------------------------------------------------------------------------
+*  switch to node (restore siotype1 variables and registers)
+*/
+static void Enter(TNode *pNode, uint64_t timeNs) {
+
+    TSioState *pSio = &pNode->sio;
+
+    sNow = timeNs;
+    gSimRegs = &pNode->regs;
+    gSimRegs->udrNumAccess = 0;
+    gSimRegs->udrRx = 0xffff;
+    gSimRegs->eifr = SIM_EIFR_UNCHANGED | (pNode->intf0 ? (1 << INTF0) : 0);
+    if (pNode->txc) {
+        gSimRegs->ucsr0a |= 1 << TXC0;
+    } else {
+        gSimRegs->ucsr0a &= ~(1 << TXC0);
+    }
+
+    sIdleFunc = pSio->idleFunc;
+    memcpy(sRxBuffer, pSio->rxBuffer, sizeof(sRxBuffer));
+    sRxBufWrIdx = pSio->rxBufWrIdx;
+    sRxBufRdIdx = pSio->rxBufRdIdx;
+    memcpy(sTxBuffer, pSio->txBuffer, sizeof(sTxBuffer));
+    sTxBufWrIdx = pSio->txBufWrIdx;
+    sTxBufRdIdx = pSio->txBufRdIdx;
+    memcpy(sTxBufferBuffered, pSio->txBufferBuffered, sizeof(sTxBufferBuffered));
+    sTxBufBufferedPos = pSio->txBufBufferedPos;
+    sBusTransceiverPowerDownFunc = pSio->busTransceiverPowerDownFunc;
+    sComm = pSio->comm;
+    sRand = pSio->rand;
+}
+
+/*-----------------------------------------------------------------------------
+*  start transmission of char in tx shift register
+*/
+static void TxShift(TNode *pNode, uint64_t start, uint8_t ch) {
+
+    pNode->shiftBusy = true;
+    pNode->shiftEnd = start + sCharTime;
+    sTxFunc(pNode - sNode, start, ch);
+}
+
+/*-----------------------------------------------------------------------------
+*  write to UDR0
+*/
+static void TxWrite(TNode *pNode, uint8_t ch) {
+
+    uint64_t start;
+
+    pNode->txc = false;
+    if (!pNode->shiftBusy) {
+        /* start bit begins with the next tick of the baud rate generator */
+        start = sNow + sBitTime - (sNow + pNode->baudPhase) % sBitTime;
+        TxShift(pNode, start, ch);
+    } else if (!pNode->udrFull) {
+        pNode->udrFull = true;
+        pNode->udrData = ch;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  leave node: save siotype1 variables and apply register writes
+*/
+static void Leave(TNode *pNode) {
+
+    TSioState *pSio = &pNode->sio;
+    uint8_t   i;
+    uint64_t  tick;
+    uint16_t  delta;
+
+    pSio->idleFunc = sIdleFunc;
+    memcpy(pSio->rxBuffer, sRxBuffer, sizeof(sRxBuffer));
+    pSio->rxBufWrIdx = sRxBufWrIdx;
+    pSio->rxBufRdIdx = sRxBufRdIdx;
+    memcpy(pSio->txBuffer, sTxBuffer, sizeof(sTxBuffer));
+    pSio->txBufWrIdx = sTxBufWrIdx;
+    pSio->txBufRdIdx = sTxBufRdIdx;
+    memcpy(pSio->txBufferBuffered, sTxBufferBuffered, sizeof(sTxBufferBuffered));
+    pSio->txBufBufferedPos = sTxBufBufferedPos;
+    pSio->busTransceiverPowerDownFunc = sBusTransceiverPowerDownFunc;
+    pSio->comm = sComm;
+    pSio->rand = sRand;
+
+    for (i = 0; i < gSimRegs->udrNumAccess; i++) {
+        if (gSimRegs->udr[i] != gSimRegs->udrPreset[i]) {
+            TxWrite(pNode, (uint8_t)gSimRegs->udr[i]);
+        }
+    }
+    /* writing 1 to a flag clears it */
+    if (((gSimRegs->eifr & SIM_EIFR_UNCHANGED) == 0) &&
+        ((gSimRegs->eifr & (1 << INTF0)) != 0)) {
+        pNode->intf0 = false;
+    }
+
+    if ((gSimRegs->timsk1 & (1 << OCIE1A)) != 0) {
+        tick = (sNow + pNode->timerPhase) / TIMER1_TICK_NS;
+        delta = gSimRegs->ocr1a - (uint16_t)tick;
+        pNode->timerMatch = (tick + (delta == 0 ? 0x10000 : delta)) * TIMER1_TICK_NS -
+                            pNode->timerPhase;
+    } else {
+        pNode->timerMatch = NODE_TIME_NEVER;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  call all pending interrupt service routines
+*/
+static void Interrupts(TNode *pNode) {
+
+    int i;
+    int state;
+
+    for (i = 0; i < MAX_NUM_ISR; i++) {
+        Enter(pNode, sNow);
+        if (((gSimRegs->ucsr0b & (1 << UDRIE0)) != 0) && !pNode->udrFull) {
+            state = sComm.state;
+            USART_UDRE_vect();
+            if ((state != eTxing) && (sComm.state == eTxing)) {
+                pNode->stat.txAttempts++;
+            } else if ((state != eTxPending) && (sComm.state == eTxPending)) {
+                pNode->stat.deferred++;
+            }
+        } else if (((gSimRegs->ucsr0b & (1 << TXCIE0)) != 0) && pNode->txc) {
+            pNode->txc = false;
+            gSimRegs->ucsr0a &= ~(1 << TXC0);
+            USART_TX_vect();
+        } else if (((gSimRegs->eimsk & (1 << INT0)) != 0) && pNode->intf0) {
+            pNode->intf0 = false;
+            gSimRegs->eifr &= ~(1 << INTF0);
+            INT0_vect();
+        } else {
+            Leave(pNode);
+            break;
+        }
+        Leave(pNode);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  create nodes
+*/
+int NodeInit(int numNodes, TSioBaud baud, unsigned long baudRate,
+             uint32_t seed, TNodeTxFunc txFunc) {
+
+    int   i;
+    TNode *pNode;
+
+    sNode = calloc(numNodes, sizeof(TNode));
+    if (sNode == 0) {
+        return -1;
+    }
+    sNumNodes = numNodes;
+    sBitTime = 1000000000ULL / baudRate;
+    sCharTime = 10 * sBitTime;
+    sTxFunc = txFunc;
+    srand(seed);
+
+    for (i = 0; i < numNodes; i++) {
+        pNode = &sNode[i];
+        pNode->timerPhase = (uint64_t)rand() % (0x10000 * TIMER1_TICK_NS);
+        pNode->timerMatch = NODE_TIME_NEVER;
+        pNode->baudPhase = (uint64_t)rand() % sBitTime;
+        Enter(pNode, 0);
+        memset(&sComm, 0, sizeof(sComm));
+        SioInit();
+        if (SioOpen("", baud, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex) < 0) {
+            Leave(pNode);
+            return -1;
+        }
+        /* seed is the module address */
+        SioRandSeed(i + 1 + seed);
+        pNode->pBus = BusCtxOpen(0);
+        Leave(pNode);
+        if (pNode->pBus == 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void NodeExit(void) {
+
+    int i;
+
+    for (i = 0; i < sNumNodes; i++) {
+        BusCtxClose(sNode[i].pBus);
+    }
+    free(sNode);
+    sNode = 0;
+    sNumNodes = 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  time of next node internal event (tx shift register, timer)
+*/
+uint64_t NodeNextEvent(int nodeIdx) {
+
+    TNode *pNode = &sNode[nodeIdx];
+
+    if (pNode->shiftBusy && (pNode->shiftEnd < pNode->timerMatch)) {
+        return pNode->shiftEnd;
+    }
+    return pNode->timerMatch;
+}
+
+/*-----------------------------------------------------------------------------
+*  process node internal events up to timeNs
+*/
+void NodeProcess(int nodeIdx, uint64_t timeNs) {
+
+    TNode   *pNode = &sNode[nodeIdx];
+    uint8_t txBufPos;
+
+    sNow = timeNs;
+    if (pNode->shiftBusy && (pNode->shiftEnd <= timeNs)) {
+        pNode->shiftBusy = false;
+        if (pNode->udrFull) {
+            pNode->udrFull = false;
+            TxShift(pNode, pNode->shiftEnd, pNode->udrData);
+        } else {
+            pNode->txc = true;
+        }
+        Interrupts(pNode);
+    }
+    if (pNode->timerMatch <= timeNs) {
+        Enter(pNode, timeNs);
+        txBufPos = sTxBufBufferedPos;
+        if ((sComm.state == eTxStopped) && (txBufPos != 0)) {
+            TIMER1_COMPA_vect();
+            if (sTxBufBufferedPos == 0) {
+                pNode->txDropped = true;
+            }
+        } else {
+            TIMER1_COMPA_vect();
+        }
+        Leave(pNode);
+        Interrupts(pNode);
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  falling edge of start bit on the wire
+*/
+void NodeStartBit(int nodeIdx, uint64_t timeNs) {
+
+    TNode *pNode = &sNode[nodeIdx];
+
+    sNow = timeNs;
+    pNode->intf0 = true;
+    Interrupts(pNode);
+}
+
+/*-----------------------------------------------------------------------------
+*  char received from the wire
+*/
+void NodeRxChar(int nodeIdx, uint64_t timeNs, uint8_t ch) {
+
+    TNode *pNode = &sNode[nodeIdx];
+    int   state;
+
+    Enter(pNode, timeNs);
+    if ((gSimRegs->ucsr0b & ((1 << RXEN0) | (1 << RXCIE0))) ==
+        ((1 << RXEN0) | (1 << RXCIE0))) {
+        gSimRegs->udrRx = ch;
+        state = sComm.state;
+        USART_RX_vect();
+        if ((state == eTxing) && (sComm.state == eTxJamming)) {
+            pNode->stat.collisions++;
+        }
+    }
+    Leave(pNode);
+    Interrupts(pNode);
+}
+
+/*-----------------------------------------------------------------------------
+*  start transmission of a telegram (like the application main loop)
+*  noPrio: all telegrams are sent with normal tx priority
+*  returns false if the sio is not ready for a new telegram
+*/
+bool NodeSend(int nodeIdx, uint64_t timeNs, TBusTelegram *pMsg, bool noPrio) {
+
+    TNode   *pNode = &sNode[nodeIdx];
+    bool    ready;
+    uint8_t ret = BUS_SEND_OK;
+
+    Enter(pNode, timeNs);
+    ready = !pNode->txActive &&
+            (sTxBufBufferedPos == 0) &&
+            ((sComm.state == eIdle) || (sComm.state == eRxing));
+    if (ready) {
+        ret = BusCtxSendToBuf(pNode->pBus, pMsg);
+        if (ret == BUS_SEND_OK) {
+            if (noPrio) {
+                SioSetTxPrio(0, eSioTxPrioNormal);
+            }
+            ret = BusCtxSendBuf(pNode->pBus);
+        }
+    }
+    Leave(pNode);
+    if (!ready) {
+        return false;
+    }
+    if (ret != BUS_SEND_OK) {
+        fprintf(stderr, "node %d: send error %d\n", nodeIdx, ret);
+        exit(1);
+    }
+    pNode->txActive = true;
+    pNode->txDropped = false;
+    Interrupts(pNode);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+*  state of telegram transmission started with NodeSend
+*  eNodeTxOk and eNodeTxDropped are returned once
+*/
+TNodeTxState NodeTxState(int nodeIdx) {
+
+    TNode *pNode = &sNode[nodeIdx];
+
+    if (!pNode->txActive) {
+        return eNodeTxIdle;
+    } else if (pNode->sio.txBufBufferedPos != 0) {
+        return eNodeTxBusy;
+    }
+    pNode->txActive = false;
+    return pNode->txDropped ? eNodeTxDropped : eNodeTxOk;
+}
+
+/*-----------------------------------------------------------------------------
+*  read received telegrams (like the application main loop)
+*/
+void NodeReceive(int nodeIdx, uint64_t timeNs) {
+
+    TNode   *pNode = &sNode[nodeIdx];
+    uint8_t ret;
+
+    Enter(pNode, timeNs);
+    do {
+        ret = BusCtxCheck(pNode->pBus);
+        if (ret == BUS_MSG_OK) {
+            pNode->stat.rxOk++;
+        } else if (ret == BUS_MSG_ERROR) {
+            pNode->stat.rxErr++;
+        }
+    } while ((ret == BUS_MSG_OK) || (ret == BUS_MSG_ERROR));
+    Leave(pNode);
+}
+
+void NodeGetStat(int nodeIdx, TNodeStat *pStat) {
+    *pStat = sNode[nodeIdx].stat;
+}
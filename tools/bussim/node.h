@@ -0,0 +1,73 @@
+/*
+ * node.h
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef _NODE_H
+#define _NODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sio.h"
+#include "bus.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define NODE_TIME_NEVER   UINT64_MAX
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+/* character transmission start of a node on the wire */
+typedef void (* TNodeTxFunc)(int nodeIdx, uint64_t timeNs, uint8_t ch);
+
+typedef enum {
+    eNodeTxIdle,       // no telegram in transmission
+    eNodeTxBusy,       // telegram is being transmitted (incl. retries)
+    eNodeTxOk,         // telegram transmitted, read back without collision
+    eNodeTxDropped     // telegram dropped after MAX_TX_RETRY collisions
+} TNodeTxState;
+
+typedef struct {
+    unsigned long txAttempts;  // start of telegram transmission on the wire
+    unsigned long collisions;  // collision detected by read back
+    unsigned long deferred;    // tx start deferred because of bus activity
+    unsigned long rxOk;        // telegrams received
+    unsigned long rxErr;       // receive errors reported by bus layer
+} TNodeStat;
+
+/*-----------------------------------------------------------------------------
+*  Functions
+*/
+int          NodeInit(int numNodes, TSioBaud baud, unsigned long baudRate,
+                      uint32_t seed, TNodeTxFunc txFunc);
+void         NodeExit(void);
+uint64_t     NodeNextEvent(int nodeIdx);
+void         NodeProcess(int nodeIdx, uint64_t timeNs);
+void         NodeStartBit(int nodeIdx, uint64_t timeNs);
+void         NodeRxChar(int nodeIdx, uint64_t timeNs, uint8_t ch);
+bool         NodeSend(int nodeIdx, uint64_t timeNs, TBusTelegram *pMsg, bool noPrio);
+TNodeTxState NodeTxState(int nodeIdx);
+void         NodeReceive(int nodeIdx, uint64_t timeNs);
+void         NodeGetStat(int nodeIdx, TNodeStat *pStat);
+
+#endif
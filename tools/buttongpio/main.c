@@ -108,13 +108,13 @@ static int gpio_write(int pin, int value) {
 /*-----------------------------------------------------------------------------
 *  sio open and bus init
 */
-static int init_bus(const char *com_port) {
+static int init_bus(const char *com_port, TSioBaud baud) {
 
     uint8_t ch;
     int     handle;
 
     SioInit();
-    handle = SioOpen(com_port, eSioBaud9600, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+    handle = SioOpen(com_port, baud, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
     if (handle == -1) {
         return -1;
     }
@@ -133,7 +133,8 @@ static int init_bus(const char *com_port) {
 static void print_usage(void) {
 
    printf("\r\nUsage:\r\n");
-   printf("buttongpio -c port -a buttonaddress -i buttoninput -g gpio\n");
+   printf("buttongpio -c port -a buttonaddress -i buttoninput -g gpio [-b baud]\n");
+   printf("baud: 9600 (default), 19200, 38400, 57600, 115200\n");
 }
 
 
@@ -175,6 +176,7 @@ int main(int argc, char *argv[]) {
     unsigned int  start_timestamp;
     unsigned int  curr_timestamp;
     bool          gpio_on = false;
+    TSioBaud      baud = eSioBaud9600;
 
     /* get com interface */
     for (i = 1; i < argc; i++) {
@@ -206,6 +208,17 @@ int main(int argc, char *argv[]) {
             break;
         }
     }
+    /* baud rate */
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0) {
+            if (((i + 1) >= argc) ||
+                !SioBaudFromRate(strtoul(argv[i + 1], 0, 0), &baud)) {
+                print_usage();
+                return 0;
+            }
+            break;
+        }
+    }
     /* gpio output */
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-g") == 0) {
@@ -238,7 +251,7 @@ int main(int argc, char *argv[]) {
 
     start_timestamp = get_tick_count();
     do {
-        sio_handle = init_bus(com_port);
+        sio_handle = init_bus(com_port, baud);
         curr_timestamp = get_tick_count();
         sleep(1);
     }  while ((sio_handle == -1) && ((curr_timestamp - start_timestamp) < BUS_TIMEOUT));
@@ -46,7 +46,20 @@
 static void PrintUsage(void);
 static int  Print(const char *fmt, ...);
 static void sighandler(int sig);
-static int InitBus(const char *comPort);
+static int InitBus(const char *comPort, TSioBaud baud);
+static void PrintEvent(uint8_t addr, const TBusDevReqActualValueEvent *pEv);
+static uint8_t ApplyDeltaEvent(uint8_t addr, const TBusDevReqActualValueEventDelta *pEv);
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+/* actual value image of each device for delta events */
+static struct {
+    bool        valid;
+    uint8_t     seq;
+    TBusDevType devType;
+    uint8_t     image[BUS_ACTVAL_DELTA_SIZE];
+} sImage[256];
 
 /*-----------------------------------------------------------------------------
 *  program start
@@ -54,24 +67,23 @@ static int InitBus(const char *comPort);
 int main(int argc, char *argv[]) {
 
     int           i;
-    int           j;
     char          comPort[SIZE_COMPORT] = "";
     uint8_t       myAddr;
     bool          myAddrValid = false;
     TBusTelegram  txBusMsg;
     uint8_t       busRet;
     TBusTelegram  *pRxBusMsg;
-    uint8_t       mask;
+    uint8_t       state;
+    TBusDevReqActualValueEventDelta delta;
     int           flags;
     int           sioHandle;
     int           sioFd;
     fd_set        rfds;
     int           ret;
-    uint8_t       val8;
-    uint16_t      val16;
     char          buffer[SIZE_CMD_BUF];
     char          *p;
     bool          listenOnly = false;
+    TSioBaud      baud = eSioBaud9600;
 
     signal(SIGPIPE, sighandler);
 
@@ -100,6 +112,18 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* baud rate */
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0) {
+            if (((i + 1) >= argc) ||
+                !SioBaudFromRate(strtoul(argv[i + 1], 0, 0), &baud)) {
+                PrintUsage();
+                return 0;
+            }
+            break;
+        }
+    }
+
     /* list only mode */
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-l") == 0) {
@@ -114,7 +138,7 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
-    sioHandle = InitBus(comPort);
+    sioHandle = InitBus(comPort, baud);
     if (sioHandle == -1) {
         printf("cannot open %s\r\n", comPort);
         return -1;
@@ -133,90 +157,35 @@ int main(int argc, char *argv[]) {
                 pRxBusMsg = BusMsgBufGet();
                 if ((pRxBusMsg->type == eBusDevReqActualValueEvent) &&
                     ((pRxBusMsg->msg.devBus.receiverAddr == myAddr))) {
-                    Print("event address %d device type ", pRxBusMsg->senderAddr);
-                    switch (pRxBusMsg->msg.devBus.x.devReq.actualValueEvent.devType) {
-                    case eBusDevTypeDo31:
-                        Print("DO31\n");
-                        for (i = 0; i < BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE; i++) {
-                            for (j = 0, mask = 1; j < 8; j++, mask <<= 1) {
-                                if ((i == 3) && (j == 7)) {
-                                    // DO31 has 31 outputs, dont display the last bit
-                                    break;
-                                }
-                                if (pRxBusMsg->msg.devBus.x.devReq.actualValueEvent.actualValue.do31.digOut[i] & mask) {
-                                    Print("1");
-                                } else {
-                                    Print("0");
-                                }
-                            }
-                        }
-                        Print("\n");
-                        for (i = 0; i < BUS_DO31_SHADER_SIZE_ACTUAL_VALUE; i++) {
-                            Print("%02x",
-                                pRxBusMsg->msg.devBus.x.devReq.actualValueEvent.actualValue.do31.shader[i]);
-                            if (i < (BUS_DO31_SHADER_SIZE_ACTUAL_VALUE - 1)) {
-                                Print(" ");
-                            }
-                        }
-                        if (!listenOnly) {
-                            memcpy(txBusMsg.msg.devBus.x.devResp.actualValueEvent.actualValue.do31.digOut,
-                                   pRxBusMsg->msg.devBus.x.devReq.actualValueEvent.actualValue.do31.digOut,
-                                   BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE);
-                            memcpy(txBusMsg.msg.devBus.x.devResp.actualValueEvent.actualValue.do31.shader,
-                                   pRxBusMsg->msg.devBus.x.devReq.actualValueEvent.actualValue.do31.shader,
-                                   BUS_DO31_SHADER_SIZE_ACTUAL_VALUE);
-                            txBusMsg.msg.devBus.x.devResp.actualValueEvent.devType = eBusDevTypeDo31;
-                        }
-                        break;
-                    case eBusDevTypePwm4:
-                        Print("PWM4\n");
-                        val8 = pRxBusMsg->msg.devBus.x.devReq.actualValueEvent.actualValue.pwm4.state;
-                        for (i = 0, mask = 1; i < BUS_PWM4_PWM_SIZE_ACTUAL_VALUE; i++, mask <<= 1) {
-                            if (val8 & mask) {
-                                Print("1");
-                            } else {
-                                Print("0");
-                            }
-                        }
-                        Print("\n");
-                        for (i = 0; i < BUS_PWM4_PWM_SIZE_ACTUAL_VALUE; i++) {
-                            val16 = pRxBusMsg->msg.devBus.x.devReq.actualValueEvent.actualValue.pwm4.pwm[i];
-                            txBusMsg.msg.devBus.x.devResp.actualValueEvent.actualValue.pwm4.pwm[i] = val16;
-                            Print("%04x", val16);
-                            if (i < (BUS_PWM4_PWM_SIZE_ACTUAL_VALUE - 1)) {
-                                Print(" ");
-                            }
-                        }
-                        if (!listenOnly) {
-                            txBusMsg.msg.devBus.x.devResp.actualValueEvent.devType = eBusDevTypePwm4;
-                        }
-                        break;
-                    case eBusDevTypeSw8:
-                        Print("SW8\n");
-                        val8 = pRxBusMsg->msg.devBus.x.devReq.actualValueEvent.actualValue.sw8.state;
-                        for (i = 0, mask = 1; i < 8; i++, mask <<= 1) {
-                            if (val8 & mask) {
-                                Print("1");
-                            } else {
-                                Print("0");
-                            }
-                        }
-                        if (!listenOnly) {
-                            txBusMsg.msg.devBus.x.devResp.actualValueEvent.actualValue.sw8.state = val8;
-                            txBusMsg.msg.devBus.x.devResp.actualValueEvent.devType = eBusDevTypeSw8;
-                        }
-                        break;
-                    default:
-                        break;
-                    }
-                    Print("\n");
-                    fflush(stdout);
+                    PrintEvent(pRxBusMsg->senderAddr, &pRxBusMsg->msg.devBus.x.devReq.actualValueEvent);
                     if (!listenOnly) {
+                        /* response: echo of the actual value */
+                        memcpy(&txBusMsg.msg.devBus.x.devResp.actualValueEvent,
+                               &pRxBusMsg->msg.devBus.x.devReq.actualValueEvent,
+                               sizeof(txBusMsg.msg.devBus.x.devResp.actualValueEvent));
                         txBusMsg.type = eBusDevRespActualValueEvent;
                         txBusMsg.senderAddr = pRxBusMsg->msg.devBus.receiverAddr;
                         txBusMsg.msg.devBus.receiverAddr = pRxBusMsg->senderAddr;
                         BusSend(&txBusMsg);
                     }
+                } else if (((pRxBusMsg->type == eBusDevReqActualValueEventDelta) &&
+                            (pRxBusMsg->msg.devBus.receiverAddr == myAddr)) ||
+                           ((pRxBusMsg->type == eBusDevReqActualValueEventFanout) &&
+                            BusEventFanoutGet(&pRxBusMsg->msg.devBus.x.devReq.actualValueEventFanout,
+                                              myAddr, &delta))) {
+                    if (pRxBusMsg->type == eBusDevReqActualValueEventDelta) {
+                        delta = pRxBusMsg->msg.devBus.x.devReq.actualValueEventDelta;
+                    }
+                    state = ApplyDeltaEvent(pRxBusMsg->senderAddr, &delta);
+                    if (!listenOnly) {
+                        txBusMsg.msg.devBus.x.devResp.actualValueEventDelta.devType = delta.devType;
+                        txBusMsg.msg.devBus.x.devResp.actualValueEventDelta.seq = delta.seq;
+                        txBusMsg.msg.devBus.x.devResp.actualValueEventDelta.state = state;
+                        txBusMsg.type = eBusDevRespActualValueEventDelta;
+                        txBusMsg.senderAddr = myAddr;
+                        txBusMsg.msg.devBus.receiverAddr = pRxBusMsg->senderAddr;
+                        BusSend(&txBusMsg);
+                    }
                 }
             } else if (busRet == BUS_IF_ERROR) {
                 Print("bus interface access error - exiting\n");
@@ -241,6 +210,120 @@ int main(int argc, char *argv[]) {
     return ret;
 }
 
+/*-----------------------------------------------------------------------------
+*  print actual value event
+*/
+static void PrintEvent(uint8_t addr, const TBusDevReqActualValueEvent *pEv) {
+
+    int      i;
+    int      j;
+    uint8_t  mask;
+    uint8_t  val8;
+
+    Print("event address %d device type ", addr);
+    switch (pEv->devType) {
+    case eBusDevTypeDo31:
+        Print("DO31\n");
+        for (i = 0; i < BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE; i++) {
+            for (j = 0, mask = 1; j < 8; j++, mask <<= 1) {
+                if ((i == 3) && (j == 7)) {
+                    // DO31 has 31 outputs, dont display the last bit
+                    break;
+                }
+                if (pEv->actualValue.do31.digOut[i] & mask) {
+                    Print("1");
+                } else {
+                    Print("0");
+                }
+            }
+        }
+        Print("\n");
+        for (i = 0; i < BUS_DO31_SHADER_SIZE_ACTUAL_VALUE; i++) {
+            Print("%02x", pEv->actualValue.do31.shader[i]);
+            if (i < (BUS_DO31_SHADER_SIZE_ACTUAL_VALUE - 1)) {
+                Print(" ");
+            }
+        }
+        break;
+    case eBusDevTypePwm4:
+        Print("PWM4\n");
+        val8 = pEv->actualValue.pwm4.state;
+        for (i = 0, mask = 1; i < BUS_PWM4_PWM_SIZE_ACTUAL_VALUE; i++, mask <<= 1) {
+            if (val8 & mask) {
+                Print("1");
+            } else {
+                Print("0");
+            }
+        }
+        Print("\n");
+        for (i = 0; i < BUS_PWM4_PWM_SIZE_ACTUAL_VALUE; i++) {
+            Print("%04x", pEv->actualValue.pwm4.pwm[i]);
+            if (i < (BUS_PWM4_PWM_SIZE_ACTUAL_VALUE - 1)) {
+                Print(" ");
+            }
+        }
+        break;
+    case eBusDevTypeSw8:
+        Print("SW8\n");
+        val8 = pEv->actualValue.sw8.state;
+        for (i = 0, mask = 1; i < 8; i++, mask <<= 1) {
+            if (val8 & mask) {
+                Print("1");
+            } else {
+                Print("0");
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    Print("\n");
+    fflush(stdout);
+}
+
+/*-----------------------------------------------------------------------------
+*  update the device's image with a delta event and print it
+*  returns the state for the response
+*/
+static uint8_t ApplyDeltaEvent(uint8_t addr, const TBusDevReqActualValueEventDelta *pEv) {
+
+    TBusDevReqActualValueEvent ev;
+    uint8_t                    size;
+
+    size = BusEventImageSize(pEv->devType);
+    if ((size == 0) || (size > sizeof(sImage[addr].image))) {
+        return BUS_ACTVAL_DELTA_RESYNC;
+    }
+    if (((pEv->flags & BUS_ACTVAL_DELTA_FULL) == 0) &&
+        sImage[addr].valid &&
+        (sImage[addr].devType == pEv->devType) &&
+        (sImage[addr].seq == pEv->seq)) {
+        /* repeated delta, our response was lost */
+        return BUS_ACTVAL_DELTA_OK;
+    }
+    if (((pEv->flags & BUS_ACTVAL_DELTA_FULL) == 0) &&
+        (!sImage[addr].valid ||
+         (sImage[addr].devType != pEv->devType) ||
+         ((uint8_t)(sImage[addr].seq + 1) != pEv->seq))) {
+        /* delta to an image we don't have */
+        sImage[addr].valid = false;
+        return BUS_ACTVAL_DELTA_RESYNC;
+    }
+    if (!BusEventDeltaApply(pEv, sImage[addr].image, size)) {
+        sImage[addr].valid = false;
+        return BUS_ACTVAL_DELTA_RESYNC;
+    }
+    sImage[addr].valid = true;
+    sImage[addr].devType = pEv->devType;
+    sImage[addr].seq = pEv->seq;
+
+    ev.devType = pEv->devType;
+    memcpy(&ev.actualValue, sImage[addr].image, size);
+    PrintEvent(addr, &ev);
+
+    return BUS_ACTVAL_DELTA_OK;
+}
+
 /*-----------------------------------------------------------------------------
 *  print till successful (for temporarly unavailable pipes)
 */
@@ -269,17 +352,18 @@ static void sighandler(int sig) {
 /*-----------------------------------------------------------------------------
 *  sio open and bus init
 */
-static int InitBus(const char *comPort) {
+static int InitBus(const char *comPort, TSioBaud baud) {
 
     uint8_t ch;
     int     handle;
 
     SioInit();
-    handle = SioOpen(comPort, eSioBaud9600, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+    handle = SioOpen(comPort, baud, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
     if (handle == -1) {
         return -1;
     }
-    while (SioGetNumRxChar(handle) > 0) {
+    /* flush, a replay capture starts immediately */
+    while (!SioIsReplay(handle) && (SioGetNumRxChar(handle) > 0)) {
         SioRead(handle, &ch, sizeof(ch));
     }
     BusInit(handle);
@@ -294,7 +378,8 @@ static int InitBus(const char *comPort) {
 static void PrintUsage(void) {
 
    printf("\r\nUsage:\r\n");
-   printf("eventmonitor -c port -a address [-l]\n");
+   printf("eventmonitor -c port -a address [-b baud] [-l]\n");
+   printf("    -b: baud rate 9600 (default), 19200, 38400, 57600, 115200\n");
    printf("    -l: listen only, do not respond to event notifications\n");
 }
 
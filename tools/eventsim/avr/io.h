@@ -0,0 +1,50 @@
+/*
+ * io.h - simulated port registers for eventsim
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+#ifndef _SIM_AVR_IO_H
+#define _SIM_AVR_IO_H
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+/* the do31 output ports are plain variables */
+#define SREG       gSimSreg
+#define PORTA      gSimPort[0]
+#define PORTB      gSimPort[1]
+#define PORTC      gSimPort[2]
+#define PORTD      gSimPort[3]
+#define PORTE      gSimPort[4]
+#define PORTF      gSimPort[5]
+#define PORTG      gSimPort[6]
+
+/* bit numbers */
+#define SREG_I     7
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+extern uint8_t gSimSreg;
+extern uint8_t gSimPort[7];
+
+#endif
@@ -0,0 +1,338 @@
+/*
+ * main.c - event latency simulation for do31 digital outputs
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "sysdef.h"
+#include "digout.h"
+#include "bus.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define US_PER_S                    1000000ULL
+#define CHANGE_DETECT_CYCLE_TIME_MS 500  /* polling cycle of do31 before the dirty mask */
+#define PULSE_TIME_MS               1000 /* DigOutTrigger */
+#define MAX_DELAY_MS                2000 /* max. delay of DigOutDelayedOn/Off */
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+typedef enum {
+    eModePoll,
+    eModeDirty
+} TMode;
+
+typedef struct {
+    uint64_t      *pBuf;
+    unsigned long num;
+    unsigned long size;
+} TLatency;
+
+typedef struct {
+    unsigned long actions;
+    unsigned long checks;     /* image compares */
+    unsigned long events;
+    unsigned long wireBytes;
+    TLatency      latency;
+} TResult;
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+/* required by sysdef.h and the avr register simulation */
+volatile uint8_t  gTimeMs;
+volatile uint16_t gTimeMs16;
+volatile uint16_t gTime10Ms16;
+volatile uint32_t gTimeMs32;
+volatile uint16_t gTimeS;
+uint8_t gSimSreg;
+uint8_t gSimPort[7];
+
+static double    sRate = 2.0;
+static uint64_t  sLoopUs = 100;
+static unsigned long sBaudRate = 9600;
+
+/*-----------------------------------------------------------------------------
+*  Functions
+*/
+static void PrintUsage(void);
+
+static void SetTime(uint64_t nowUs) {
+
+    uint32_t ms = (uint32_t)(nowUs / 1000);
+
+    gTimeMs = (uint8_t)ms;
+    gTimeMs16 = (uint16_t)ms;
+    gTime10Ms16 = (uint16_t)(ms / 10);
+    gTimeMs32 = ms;
+    gTimeS = (uint16_t)(ms / 1000);
+}
+
+static void AddLatency(TLatency *pLatency, uint64_t latency) {
+
+    if (pLatency->num == pLatency->size) {
+        pLatency->size = pLatency->size * 2 + 1024;
+        pLatency->pBuf = realloc(pLatency->pBuf, pLatency->size * sizeof(uint64_t));
+        if (pLatency->pBuf == 0) {
+            printf("out of memory\n");
+            exit(1);
+        }
+    }
+    pLatency->pBuf[pLatency->num++] = latency;
+}
+
+static int CompareLatency(const void *p1, const void *p2) {
+
+    uint64_t l1 = *(const uint64_t *)p1;
+    uint64_t l2 = *(const uint64_t *)p2;
+
+    return (l1 > l2) - (l1 < l2);
+}
+
+static double Percentile(const TLatency *pLatency, unsigned percent) {
+
+    unsigned long idx;
+
+    if (pLatency->num == 0) {
+        return 0;
+    }
+    idx = (pLatency->num * percent + 99) / 100;
+    if (idx > 0) {
+        idx--;
+    }
+    return pLatency->pBuf[idx] / 1000.0;
+}
+
+/*-----------------------------------------------------------------------------
+*  random switching action of the application or a bus client
+*/
+static void Action(void) {
+
+    TDigOutNumber out = (TDigOutNumber)(drand48() * eDigOutNum);
+    uint32_t      delay = (uint32_t)(drand48() * MAX_DELAY_MS);
+
+    switch ((int)(drand48() * 6)) {
+    case 0:
+        DigOutOn(out);
+        break;
+    case 1:
+        DigOutOff(out);
+        break;
+    case 2:
+        DigOutToggle(out);
+        break;
+    case 3:
+        DigOutTrigger(out);
+        break;
+    case 4:
+        DigOutDelayedOn(out, delay);
+        break;
+    default:
+        DigOutDelayedOff(out, delay);
+        break;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  size of the delta event telegram on the wire
+*/
+static unsigned EventSize(uint8_t seq, const uint8_t *pOld, const uint8_t *pNew) {
+
+    TBusTelegram           msg;
+    TBusDevActualValueDo31 oldVal;
+    TBusDevActualValueDo31 newVal;
+    uint8_t                buf[BUS_MAX_ENCODED_SIZE];
+    uint8_t                len = 0;
+
+    memset(&oldVal, 0, sizeof(oldVal));
+    memset(&newVal, 0, sizeof(newVal));
+    memcpy(oldVal.digOut, pOld, sizeof(oldVal.digOut));
+    memcpy(newVal.digOut, pNew, sizeof(newVal.digOut));
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = eBusDevReqActualValueEventDelta;
+    msg.senderAddr = 240;
+    msg.msg.devBus.receiverAddr = 0;
+    msg.msg.devBus.x.devReq.actualValueEventDelta.devType = eBusDevTypeDo31;
+    msg.msg.devBus.x.devReq.actualValueEventDelta.seq = seq;
+    BusEventDeltaEncode(&msg.msg.devBus.x.devReq.actualValueEventDelta,
+                        (const uint8_t *)&oldVal, (const uint8_t *)&newVal, sizeof(newVal));
+    BusEncode(&msg, buf, sizeof(buf), &len);
+
+    return len;
+}
+
+/*-----------------------------------------------------------------------------
+*  run the do31 digout module and the event change detection
+*  latency: output change to end of the event telegram on the wire
+*/
+static void Simulate(TMode mode, uint64_t endUs, long seed, TResult *pRes) {
+
+    uint64_t now;
+    uint64_t nextAction;
+    uint64_t lastPoll = 0;
+    uint64_t wireFree = 0;
+    uint64_t txEnd;
+    uint64_t changeTime[eDigOutNum];
+    uint8_t  cur[BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE];
+    uint8_t  last[BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE];
+    uint8_t  reported[BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE];
+    uint8_t  changed[BUS_DO31_DIGOUT_SIZE_ACTUAL_VALUE];
+    uint8_t  seq = 0;
+    bool     detect;
+    int      i;
+    uint8_t  mask;
+
+    srand48(seed);
+    SetTime(0);
+    DigOutInit();
+    DigOutOffAll();
+    DigOutChanged(changed, sizeof(changed));
+    memset(last, 0, sizeof(last));
+    memset(reported, 0, sizeof(reported));
+    memset(changeTime, 0, sizeof(changeTime));
+    nextAction = (uint64_t)(-log(1.0 - drand48()) / sRate * US_PER_S);
+
+    for (now = 0; now < endUs; now += sLoopUs) {
+        SetTime(now);
+        while (nextAction <= now) {
+            Action();
+            pRes->actions++;
+            nextAction += (uint64_t)(-log(1.0 - drand48()) / sRate * US_PER_S);
+        }
+        DigOutStateCheck();
+
+        /* time of the output change, not reported yet */
+        DigOutStateAll(cur, sizeof(cur));
+        for (i = 0; i < eDigOutNum; i++) {
+            mask = 1 << (i % 8);
+            if (((cur[i / 8] ^ last[i / 8]) & mask) &&
+                !((last[i / 8] ^ reported[i / 8]) & mask)) {
+                changeTime[i] = now;
+            }
+        }
+        memcpy(last, cur, sizeof(last));
+
+        if (mode == eModePoll) {
+            detect = (now - lastPoll) >= (CHANGE_DETECT_CYCLE_TIME_MS * 1000ULL);
+            if (detect) {
+                lastPoll = now;
+            }
+        } else {
+            detect = DigOutChanged(changed, sizeof(changed));
+        }
+        if (!detect) {
+            continue;
+        }
+        pRes->checks++;
+        if (memcmp(cur, reported, sizeof(cur)) == 0) {
+            continue;
+        }
+
+        /* event telegram, one after the other on the wire */
+        seq++;
+        pRes->events++;
+        pRes->wireBytes += EventSize(seq, reported, cur);
+        txEnd = max(now, wireFree) + EventSize(seq, reported, cur) * 10 * US_PER_S / sBaudRate;
+        wireFree = txEnd;
+        for (i = 0; i < eDigOutNum; i++) {
+            mask = 1 << (i % 8);
+            if ((cur[i / 8] ^ reported[i / 8]) & mask) {
+                AddLatency(&pRes->latency, txEnd - changeTime[i]);
+            }
+        }
+        memcpy(reported, cur, sizeof(reported));
+    }
+}
+
+static void PrintResult(const char *pName, TResult *pRes, double simTime) {
+
+    qsort(pRes->latency.pBuf, pRes->latency.num, sizeof(uint64_t), CompareLatency);
+    printf("%-6s %8lu %8lu %8lu %8.1f  p50 %7.1f  p90 %7.1f  p99 %7.1f  max %7.1f\n",
+           pName, pRes->actions, pRes->checks, pRes->events,
+           pRes->wireBytes * 10.0 * 100.0 / (sBaudRate * simTime),
+           Percentile(&pRes->latency, 50), Percentile(&pRes->latency, 90),
+           Percentile(&pRes->latency, 99), Percentile(&pRes->latency, 100));
+    free(pRes->latency.pBuf);
+}
+
+/*-----------------------------------------------------------------------------
+*  program start
+*/
+int main(int argc, char *argv[]) {
+
+    int     i;
+    double  simTime = 600.0;
+    long    seed = 1;
+    TResult poll;
+    TResult dirty;
+
+    for (i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-t") == 0) && (argc > (i + 1))) {
+            simTime = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-r") == 0) && (argc > (i + 1))) {
+            sRate = atof(argv[++i]);
+        } else if ((strcmp(argv[i], "-l") == 0) && (argc > (i + 1))) {
+            sLoopUs = strtoul(argv[++i], 0, 0);
+        } else if ((strcmp(argv[i], "-b") == 0) && (argc > (i + 1))) {
+            sBaudRate = strtoul(argv[++i], 0, 0);
+        } else if ((strcmp(argv[i], "-s") == 0) && (argc > (i + 1))) {
+            seed = atol(argv[++i]);
+        } else {
+            PrintUsage();
+            return -1;
+        }
+    }
+    if ((simTime <= 0) || (sRate <= 0) || (sLoopUs == 0) || (sBaudRate == 0)) {
+        PrintUsage();
+        return -1;
+    }
+
+    memset(&poll, 0, sizeof(poll));
+    memset(&dirty, 0, sizeof(dirty));
+    Simulate(eModePoll, (uint64_t)(simTime * US_PER_S), seed, &poll);
+    Simulate(eModeDirty, (uint64_t)(simTime * US_PER_S), seed, &dirty);
+
+    printf("%.1f s, %.2f actions/s, main loop %lu us, %lu baud\n",
+           simTime, sRate, (unsigned long)sLoopUs, sBaudRate);
+    printf("mode    actions   checks   events  bus %%   latency ms\n");
+    PrintResult("poll", &poll, simTime);
+    PrintResult("dirty", &dirty, simTime);
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  show help
+*/
+static void PrintUsage(void) {
+
+    printf("\nUsage:\n");
+    printf("eventsim [-t seconds] [-r actions/s] [-l main loop us] [-b baud] [-s seed]\n");
+}
@@ -30,6 +30,7 @@
 #include <unistd.h>
 #include <signal.h>
 #include <errno.h>
+#include <sys/select.h>
 
 #include "sio.h"
 #include "bus.h"
@@ -40,21 +41,41 @@
 
 /* timeout for repeating */
 #define TIMEOUT_MS  100
+/* tx time of a response at 9600 baud, added per outstanding request */
+#define TIMEOUT_MS_PER_RESP  50
 
-/* max number of retries */
+/* max number of retries of a block */
 #define MAX_RETRY  10
 
+/* outstanding requests: the device buffers one response while sending the
+ * previous, further requests may be dropped (and are repeated) */
+#define DEFAULT_DEPTH  2
+#define MAX_DEPTH      8
+
+/*-----------------------------------------------------------------------------
+*  Typedefs
+*/
+typedef struct {
+    bool          busy;
+    uint32_t      flashOffs;
+    unsigned long timeStamp;
+    int           retryCnt;
+} TReq;
+
 /*-----------------------------------------------------------------------------
 *  Variables
 */
 static uint8_t sMyAddr = 0;
+static TReq    sReq[MAX_DEPTH];
+static int     sDepth = DEFAULT_DEPTH;
 
 /*-----------------------------------------------------------------------------
 *  Functions
 */
 static void PrintUsage(void);
 static unsigned long GetTickCount(void);
-static int ReqFlashData(uint8_t address, uint32_t flashOffs, uint8_t *buffer, size_t buffer_size);
+static void SendReq(uint8_t address, TReq *pReq, uint32_t flashOffs);
+static uint32_t LowestOffs(uint32_t nextOffs);
 
 /*-----------------------------------------------------------------------------
 *  restore cursor
@@ -72,7 +93,7 @@ static void signal_callback_handler(int signum) {
 int main(int argc, char *argv[]) {
 
     int            sio;
-    int            ret;
+    int            sioFd;
     uint8_t        len;
     uint8_t        val8;
     int            i;
@@ -80,10 +101,23 @@ int main(int argc, char *argv[]) {
     char           fileName[256];
     uint8_t        moduleAddr;
     bool           moduleAddrValid = false;
-    uint8_t        data[BUS_GETFLASH_PACKET_SIZE];
+    bool           resume = false;
+    TSioBaud       baud = eSioBaud9600;
     FILE           *file;
     uint32_t       flashOffs;
-    int            retryCnt;
+    uint32_t       startOffs;
+    uint32_t       nextOffs;
+    uint32_t       endOffs = UINT32_MAX;
+    uint32_t       numBytes = 0;
+    bool           error = false;
+    bool           busy;
+    unsigned long  startTimeMs;
+    unsigned long  elapsedMs;
+    unsigned long  timeoutMs;
+    fd_set         rfds;
+    struct timeval tv;
+    TBusTelegram   *pBusMsg;
+    TBusDevRespGetFlashData *pResp;
 
     signal(SIGINT, signal_callback_handler);
 
@@ -114,15 +148,30 @@ int main(int argc, char *argv[]) {
                 fileName[sizeof(fileName) - 1] = '\0';
                 i++;
             }
+        } else if (strcmp(argv[i], "-n") == 0) {
+            if (argc > i) {
+                sDepth = atoi(argv[i + 1]);
+                i++;
+            }
+        } else if (strcmp(argv[i], "-b") == 0) {
+            if (((i + 1) >= argc) ||
+                !SioBaudFromRate(strtoul(argv[i + 1], 0, 0), &baud)) {
+                PrintUsage();
+                return -1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            resume = true;
         }
     }
-    if ((comDev[0] == '\0') || (fileName[0] == '\0') || !moduleAddrValid) {
+    if ((comDev[0] == '\0') || (fileName[0] == '\0') || !moduleAddrValid ||
+        (sDepth < 1) || (sDepth > MAX_DEPTH)) {
         PrintUsage();
         return -1;
     }
 
     SioInit();
-    sio = SioOpen(comDev, eSioBaud9600, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+    sio = SioOpen(comDev, baud, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
     if (sio == -1) {
         printf("cannot open %s\n", comDev);
         return -1;
@@ -134,112 +183,163 @@ int main(int argc, char *argv[]) {
         SioRead(sio, &val8, sizeof(val8));
     }
     BusInit(sio);
-
-    /* create file */
-    file = fopen(fileName, "wb+");
+    pBusMsg = BusMsgBufGet();
+    pResp = &pBusMsg->msg.devBus.x.devResp.getFlashData;
+    sioFd = SioGetFd(sio);
+
+    /* create file or continue an existing file */
+    startOffs = 0;
+    file = 0;
+    if (resume) {
+        file = fopen(fileName, "rb+");
+        if (file != 0) {
+            fseek(file, 0, SEEK_END);
+            /* the last block may be incomplete */
+            startOffs = (uint32_t)ftell(file) / BUS_GETFLASH_PACKET_SIZE * BUS_GETFLASH_PACKET_SIZE;
+        }
+    }
+    if (file == 0) {
+        file = fopen(fileName, "wb+");
+    }
     if (file == 0) {
         printf("cannot open %s\r\n", fileName);
         return 0;
     }
+    if (startOffs != 0) {
+        printf("continue at offset %u\n", startOffs);
+    }
 
-    flashOffs = 0;
+    nextOffs = startOffs;
+    /* responses queue up behind the outstanding requests */
+    timeoutMs = TIMEOUT_MS + sDepth * TIMEOUT_MS_PER_RESP;
+    startTimeMs = GetTickCount();
     system("setterm -cursor off");
     printf("received data (bytes):        ");
     do {
-        retryCnt = 5;
-        do {
-            ret = ReqFlashData(moduleAddr, flashOffs, data, sizeof(data));
-            retryCnt--;
-        } while ((ret == -1) && retryCnt);
-        if (ret == -1) {
-            printf("\nerror reading flash data from device %d at address offset 0x%08x", moduleAddr, flashOffs);
-            // error
-            break;
+        /* keep sDepth requests outstanding */
+        busy = false;
+        for (i = 0; i < sDepth; i++) {
+            if (sReq[i].busy && (sReq[i].flashOffs >= endOffs)) {
+                /* beyond the end of the flash data */
+                sReq[i].busy = false;
+            }
+            if (!sReq[i].busy && (nextOffs < endOffs)) {
+                SendReq(moduleAddr, &sReq[i], nextOffs);
+                nextOffs += BUS_GETFLASH_PACKET_SIZE;
+            }
+            busy |= sReq[i].busy;
         }
-        printf("\b\b\b\b\b\b%6d", flashOffs);
-        fflush(stdout);
-        fwrite(data, ret, 1, file);
-        if (ret < BUS_FWU_PACKET_SIZE) {
-            // last packet
+        if (!busy) {
             break;
         }
-        flashOffs += BUS_FWU_PACKET_SIZE;
-    } while (1);
+
+        FD_ZERO(&rfds);
+        FD_SET(sioFd, &rfds);
+        tv.tv_sec = 0;
+        tv.tv_usec = 10000;
+        select(sioFd + 1, &rfds, 0, 0, &tv);
+
+        while (BusCheck() == BUS_MSG_OK) {
+            if ((pBusMsg->type != eBusDevRespGetFlashData)   ||
+                (pBusMsg->msg.devBus.receiverAddr != sMyAddr) ||
+                (pBusMsg->senderAddr != moduleAddr)           ||
+                (pResp->numValid > BUS_GETFLASH_PACKET_SIZE)) {
+                continue;
+            }
+            for (i = 0; i < sDepth; i++) {
+                if (sReq[i].busy && (sReq[i].flashOffs == pResp->addr)) {
+                    break;
+                }
+            }
+            if (i == sDepth) {
+                /* response to a repeated request */
+                continue;
+            }
+            sReq[i].busy = false;
+            /* responses may come out of order after a retry */
+            fseek(file, pResp->addr, SEEK_SET);
+            fwrite(pResp->data, pResp->numValid, 1, file);
+            numBytes += pResp->numValid;
+            if (pResp->numValid < BUS_GETFLASH_PACKET_SIZE) {
+                // last packet
+                endOffs = min(endOffs, pResp->addr + pResp->numValid);
+            }
+        }
+
+        /* retry of single blocks */
+        for (i = 0; (i < sDepth) && !error; i++) {
+            if (!sReq[i].busy || ((GetTickCount() - sReq[i].timeStamp) <= timeoutMs)) {
+                continue;
+            }
+            if (sReq[i].retryCnt >= MAX_RETRY) {
+                error = true;
+            } else {
+                sReq[i].retryCnt++;
+                SendReq(moduleAddr, &sReq[i], sReq[i].flashOffs);
+            }
+        }
+
+        printf("\b\b\b\b\b\b%6u", min(LowestOffs(nextOffs), endOffs));
+        fflush(stdout);
+    } while (!error);
+    elapsedMs = GetTickCount() - startTimeMs;
+
+    if (error) {
+        /* keep the complete part of the file only, continue with -r */
+        flashOffs = LowestOffs(nextOffs);
+        printf("\nerror reading flash data from device %d at address offset 0x%08x", moduleAddr, flashOffs);
+        printf("\ncontinue with -r");
+    } else {
+        flashOffs = endOffs;
+    }
+    fflush(file);
+    ftruncate(fileno(file), flashOffs);
 
     SioClose(sio);
     fclose(file);
     system("setterm -cursor on");
-    printf("\n");
+    printf("\n%u bytes read in %lu.%03lu s (%lu bytes/s)\n", numBytes, elapsedMs / 1000, elapsedMs % 1000,
+           elapsedMs ? (unsigned long)numBytes * 1000 / elapsedMs : 0);
 
-    return 0;
+    return error ? -1 : 0;
 }
 
 
-/*-----------------------------------------------------------------------------
-* sleep
-*/
-int msleep(long ms) {
-
-    struct timespec ts;
-    int ret;
-
-    ts.tv_sec = ms / 1000;
-    ts.tv_nsec = (ms % 1000) * 1000000;
-
-    do {
-        ret = nanosleep(&ts, &ts);
-    } while (ret && errno == EINTR);
-
-    return ret;
-}
-
 /*-----------------------------------------------------------------------------
 *  request flash packet
 */
-static int ReqFlashData(uint8_t address, uint32_t flashOffs, uint8_t *buffer, size_t bufferSize) {
+static void SendReq(uint8_t address, TReq *pReq, uint32_t flashOffs) {
 
     TBusTelegram    txBusMsg;
-    uint8_t         ret;
-    unsigned long   startTimeMs;
-    unsigned long   actualTimeMs;
-    TBusTelegram    *pBusMsg;
-    bool            responseOk = false;
-    bool            timeOut = false;
-    int             numBytes = -1;
 
     txBusMsg.type = eBusDevReqGetFlashData;
     txBusMsg.senderAddr = sMyAddr;
     txBusMsg.msg.devBus.receiverAddr = address;
     txBusMsg.msg.devBus.x.devReq.getFlashData.addr = flashOffs;
     BusSend(&txBusMsg);
-    startTimeMs = GetTickCount();
-    do {
-        actualTimeMs = GetTickCount();
-        ret = BusCheck();
-        if (ret == BUS_MSG_OK) {
-            pBusMsg = BusMsgBufGet();
-            if ((pBusMsg->type == eBusDevRespGetFlashData)                &&
-                (pBusMsg->msg.devBus.receiverAddr == txBusMsg.senderAddr) &&
-                (pBusMsg->senderAddr == txBusMsg.msg.devBus.receiverAddr) &&
-                (pBusMsg->msg.devBus.x.devResp.getFlashData.addr ==
-                 txBusMsg.msg.devBus.x.devReq.getFlashData.addr)) {
-                responseOk = true;
-                memcpy(buffer, pBusMsg->msg.devBus.x.devResp.getFlashData.data, bufferSize);
-                numBytes = pBusMsg->msg.devBus.x.devResp.getFlashData.numValid;
-            }
-        } else {
-            if ((actualTimeMs - startTimeMs) > TIMEOUT_MS) {
-                timeOut = true;
-            }
-        }
-        msleep(1);
-    } while (!responseOk && !timeOut);
 
-    if (responseOk) {
-        return numBytes;
-    } else {
-        return -1;
+    if (!pReq->busy || (pReq->flashOffs != flashOffs)) {
+        pReq->retryCnt = 0;
+    }
+    pReq->busy = true;
+    pReq->flashOffs = flashOffs;
+    pReq->timeStamp = GetTickCount();
+}
+
+/*-----------------------------------------------------------------------------
+*  all data below the returned offset is received
+*/
+static uint32_t LowestOffs(uint32_t nextOffs) {
+
+    int      i;
+    uint32_t offs = nextOffs;
+
+    for (i = 0; i < sDepth; i++) {
+        if (sReq[i].busy) {
+            offs = min(offs, sReq[i].flashOffs);
+        }
     }
+    return offs;
 }
 
 /*-----------------------------------------------------------------------------
@@ -262,9 +362,12 @@ static unsigned long GetTickCount(void) {
 static void PrintUsage(void) {
 
     printf("\nUsage:");
-    printf("firmwaresave -c comport -f filename -a target-address [-o own-address]\n");
+    printf("firmwaresave -c comport -f filename -a target-address [-o own-address] [-b baud] [-n depth] [-r]\n");
     printf("comport: tty device\n");
     printf("filename: firmware binary file\n");
     printf("target-address: target bus address\n");
     printf("own-address: default 0\n");
+    printf("baud: 9600 (default), 19200, 38400, 57600, 115200\n");
+    printf("depth: outstanding requests (1..%d, default %d)\n", MAX_DEPTH, DEFAULT_DEPTH);
+    printf("-r: continue an existing file at its end\n");
 }
@@ -47,41 +47,115 @@
 #define TIMEOUT_MS_STARTUP_RESP      2000
 #define TIMEOUT_MS_UPD_ENTER_RESP    10000  /* braucht l�nger, weil Eeprom und Flash gel�scht werden */
 #define TIMEOUT_MS_UPD_DATA_RESP     1000
-#define TIMEOUT_MS_UPD_TERM_RESP     1000
+#define TIMEOUT_MS_UPD_DATA_WIN_PACKET 50   /* tx time of one packet at 9600 baud (42 chars) */
+#define TIMEOUT_MS_UPD_TERM_RESP     5000   /* the bootloader verifies the checksum */
+#define TIMEOUT_MS_UPD_PAGESUM_RESP  1000
+#define TIMEOUT_MS_UPD_WIN_STATE_RESP 200   /* fleet poll, at most two pages are programmed */
 #define TIMEOUT_MS_REBOOT_RESP       2000
 
 /* Wiederholungen bis zum Abbruch */
 #define MAX_RETRY  10
+/* retries of the first windowed packet before falling back to single packets
+ * (bootloader without windowed update) */
+#define MAX_RETRY_WIN_PROBE  2
 
 #define COM_PORT       argv[1]
 #define FIRMWARE_FILE  argv[2]
 #define TARGET_ADDR    sTargetAddr
 
+#define PACKET_WORD_SIZE  (BUS_FWU_PACKET_SIZE / 2)
 
-#define WAIT_FOR_STARTUP_MSG    0
-#define WAIT_FOR_UPD_ENTER_RESP 1
-#define WAIT_FOR_UPD_DATA_RESP  2
-#define WAIT_FOR_UPD_TERM_RESP  3
-#define WAIT_FOR_REBOOT_RESP    4
+#define WAIT_FOR_STARTUP_MSG        0
+#define WAIT_FOR_UPD_ENTER_RESP     1
+#define WAIT_FOR_UPD_DATA_RESP      2
+#define WAIT_FOR_UPD_TERM_RESP      3
+#define WAIT_FOR_REBOOT_RESP        4
+#define WAIT_FOR_UPD_DATA_WIN_RESP  5
+#define WAIT_FOR_UPD_PAGESUM_RESP   6
 #define ESC  0x1b
 
+/* fleet update: state of each target */
+#define FLEET_MAX_DEV      64
+#define FLEET_IDLE         0
+#define FLEET_REBOOT       1
+#define FLEET_ENTER        2
+#define FLEET_DATA         3
+#define FLEET_DONE         4
+#define FLEET_FAILED       5
+
+/*-----------------------------------------------------------------------------
+*  Typedefs
+*/
+typedef struct {
+    uint8_t       addr;
+    uint8_t       state;
+    int           retryCnt;
+    unsigned long timeStamp;
+    uint32_t      ackWordAddr;
+    uint16_t      rxMask;
+    uint8_t       window;
+    const char    *pError;
+} TFleetDev;
+
 /*-----------------------------------------------------------------------------
 *  Variables
 */
 
 static TBusTelegram  *spBusMsg;
 static uint8_t         sFwuState;
-static FILE           *spFile;
+static uint8_t        *spImage;      /* firmware, padded to packet size with 0xff */
+static uint32_t       sImageWords;
 static uint16_t       sLastWordAddr;
 static bool           sFileTransferComplete = false;
 static unsigned int   sTimeStamp;
 static uint8_t        sTargetAddr;
 
+/* windowed update */
+static uint8_t        sWindow = BUS_FWU_WIN_MAX;
+static uint8_t        sDevWindow;    /* 0: no response from bootloader yet */
+static uint32_t       sAckWordAddr;  /* all words below are programmed */
+static uint16_t       sRxMask;       /* packets from sAckWordAddr buffered by the bootloader */
+static unsigned long  sWinTimeoutMs; /* response timeout incl. tx time of the window */
+
+/* differential update */
+static bool           sDiff = false;
+static uint16_t       sPageWords;    /* 0: all pages are transferred */
+static uint16_t       sNumPages;
+static uint16_t       sPageSumReq;   /* next page for eBusDevReqUpdPageSum */
+static bool          *spPageChanged;
+static uint16_t       sPagesSkipped;
+
+/* fleet update: the same image to several targets at the same time */
+static TFleetDev      sFleet[FLEET_MAX_DEV];
+static int            sFleetNum;
+static int            sSioFd;
+
 /*-----------------------------------------------------------------------------
 *  Functions
 */
 static void ProcessBus(uint8_t ret);
+static bool LoadImage(const char *pName);
 static bool SendDataPacket(bool next) ;
+static void SendWindow(void);
+static bool WindowComplete(uint32_t ackWordAddr, uint16_t rxMask, uint8_t window);
+static void SendTerm(void);
+static void SendEnter(void);
+static void SendPageSumReq(void);
+static bool ComparePageSums(void);
+static void StartData(void);
+static bool PageNeeded(uint32_t wordAddr);
+static uint16_t PageSum(uint16_t page);
+static bool ParseTargets(const char *pArg);
+static void FleetUpdate(void);
+static void FleetEnter(void);
+static void FleetData(void);
+static void FleetTerm(void);
+static bool FleetPoll(TFleetDev *pDev, int maxRetry, unsigned long extraMs);
+static int  FleetSendWindow(void);
+static bool FleetComplete(TFleetDev *pDev);
+static TFleetDev *FleetDev(uint8_t addr);
+static uint8_t WaitMsg(unsigned long timeoutMs);
+static void SendReq(TBusMsgType type, uint8_t addr);
 static void PrintUsage(void);
 #ifndef WIN32
 static unsigned long GetTickCount(void);
@@ -100,27 +174,43 @@ int main(int argc, char *argv[]) {
     int            sioFd;
     fd_set         rfds;
     struct timeval tv;
+    int            i;
 
-    if (argc != 4) {
+    if (argc < 4) {
         PrintUsage();
         return 0;
     }
+    for (i = 4; i < argc; i++) {
+        if ((strcmp(argv[i], "-w") == 0) && ((i + 1) < argc)) {
+            i++;
+            sWindow = atoi(argv[i]);
+            if ((sWindow < 1) || (sWindow > BUS_FWU_WIN_MAX)) {
+                PrintUsage();
+                return 0;
+            }
+        } else if (strcmp(argv[i], "-d") == 0) {
+            sDiff = true;
+        } else {
+            PrintUsage();
+            return 0;
+        }
+    }
 
-    sTargetAddr = atoi(argv[3]);
+    if (!ParseTargets(argv[3]) || (sDiff && (sFleetNum > 1))) {
+        PrintUsage();
+        return 0;
+    }
+    sTargetAddr = sFleet[0].addr;
 
-    /* File mit Firmware �ffnen */
-    spFile = fopen(FIRMWARE_FILE, "rb");
-    if (spFile == 0) {
-        printf("cannot open %s\r\n", FIRMWARE_FILE);
+    /* read the firmware file once */
+    if (!LoadImage(FIRMWARE_FILE)) {
         return 0;
     }
 
     SioInit();
     handle = SioOpen(COM_PORT, eSioBaud9600, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
     if (handle == -1) {
-        if (spFile != 0) {
-            fclose(spFile);
-        }
+        free(spImage);
         return 0;
     }
 
@@ -129,6 +219,14 @@ int main(int argc, char *argv[]) {
     }
     BusInit(handle);
     spBusMsg = BusMsgBufGet();
+    sSioFd = SioGetFd(handle);
+
+    if (sFleetNum > 1) {
+        FleetUpdate();
+        SioClose(handle);
+        free(spImage);
+        return 0;
+    }
 
     /* Reboot-Command aussenden */
     txBusMsg.type = eBusDevReqReboot;
@@ -140,15 +238,19 @@ int main(int argc, char *argv[]) {
     sTimeStamp = GetTickCount();
 
     sioFd = SioGetFd(handle);
-    FD_ZERO(&rfds);
-    FD_SET(sioFd, &rfds);
 
     do {
+        /* select clears the fd on timeout */
+        FD_ZERO(&rfds);
+        FD_SET(sioFd, &rfds);
         tv.tv_sec = 0;
         tv.tv_usec = 100000;
         select(sioFd + 1, &rfds, 0, 0, &tv);
-        ret = BusCheck();
-        ProcessBus(ret);
+        /* all received telegrams (read back of a window) */
+        do {
+            ret = BusCheck();
+            ProcessBus(ret);
+        } while ((ret == BUS_MSG_OK) && !sFileTransferComplete);
         if (sFileTransferComplete) {
             /* Update beendet */
             break;
@@ -159,13 +261,56 @@ int main(int argc, char *argv[]) {
         SioClose(handle);
     }
 
-    if (spFile == 0) {
-        fclose(spFile);
-    }
+    free(spImage);
+    free(spPageChanged);
 
     return 0;
 }
 
+/*-----------------------------------------------------------------------------
+*  load the firmware file to memory
+*  the last packet is padded with 0xff
+*/
+static bool LoadImage(const char *pName) {
+
+    FILE   *pFile;
+    long   size;
+    size_t allocSize;
+
+    pFile = fopen(pName, "rb");
+    if (pFile == 0) {
+        printf("cannot open %s\r\n", pName);
+        return false;
+    }
+    fseek(pFile, 0, SEEK_END);
+    size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    /* word address is 16 bit */
+    if ((size < 0) || (size > (0x10000L * 2))) {
+        printf("invalid size of %s\r\n", pName);
+        fclose(pFile);
+        return false;
+    }
+
+    allocSize = (size + BUS_FWU_PACKET_SIZE - 1) / BUS_FWU_PACKET_SIZE * BUS_FWU_PACKET_SIZE;
+    spImage = malloc(allocSize + BUS_FWU_PACKET_SIZE);
+    if (spImage == 0) {
+        fclose(pFile);
+        return false;
+    }
+    memset(spImage, 0xff, allocSize + BUS_FWU_PACKET_SIZE);
+    if (fread(spImage, 1, size, pFile) != (size_t)size) {
+        printf("cannot read %s\r\n", pName);
+        fclose(pFile);
+        free(spImage);
+        return false;
+    }
+    fclose(pFile);
+    sImageWords = allocSize / 2;
+
+    return true;
+}
+
 /*-----------------------------------------------------------------------------
 *  Verarbeitung der Bustelegramme
 */
@@ -182,10 +327,7 @@ static void ProcessBus(uint8_t ret) {
         case WAIT_FOR_STARTUP_MSG:
             if ((msgType == eBusDevStartup) &&
                 (spBusMsg->senderAddr == TARGET_ADDR)) {
-                txBusMsg.type = eBusDevReqUpdEnter;
-                txBusMsg.senderAddr = MY_ADDR;
-                txBusMsg.msg.devBus.receiverAddr = TARGET_ADDR;
-                BusSend(&txBusMsg);
+                SendEnter();
                 sFwuState = WAIT_FOR_UPD_ENTER_RESP;
                 sRetryCnt = 0;
             }
@@ -193,15 +335,36 @@ static void ProcessBus(uint8_t ret) {
         case WAIT_FOR_UPD_ENTER_RESP:
             if ((msgType == eBusDevRespUpdEnter) &&
                 (spBusMsg->msg.devBus.receiverAddr == MY_ADDR)) {
-                printf("send data (bytes):        ");
-                /* erstes Datenpaket senden */
-                if (SendDataPacket(true) == false) {
-                    /* File hat L�nge 0 */
+                sRetryCnt = 0;
+                if (sDiff) {
+                    /* compare the page checksums first */
+                    sPageSumReq = 0;
+                    SendPageSumReq();
+                    sFwuState = WAIT_FOR_UPD_PAGESUM_RESP;
+                } else {
+                    StartData();
+                }
+            }
+            break;
+        case WAIT_FOR_UPD_PAGESUM_RESP:
+            if ((msgType == eBusDevRespUpdPageSum) &&
+                (spBusMsg->senderAddr == TARGET_ADDR) &&
+                (spBusMsg->msg.devBus.receiverAddr == MY_ADDR) &&
+                (spBusMsg->msg.devBus.x.devResp.updPageSum.page == sPageSumReq)) {
+                sRetryCnt = 0;
+                if (!ComparePageSums()) {
                     sFileTransferComplete = true;
-                    printf("\r\nERROR: file is empty\r\n");
+                } else if (sPageSumReq < sNumPages) {
+                    SendPageSumReq();
                 } else {
-                    sFwuState = WAIT_FOR_UPD_DATA_RESP;
-                    sRetryCnt = 0;
+                    printf("pages: %u changed, %u skipped\r\n",
+                           sNumPages - sPagesSkipped, sPagesSkipped);
+                    if (sPagesSkipped == sNumPages) {
+                        /* nothing to transfer, verify the checksum only */
+                        SendTerm();
+                    } else {
+                        StartData();
+                    }
                 }
             }
             break;
@@ -213,11 +376,7 @@ static void ProcessBus(uint8_t ret) {
                     /* Antwort OK -> n�chstes Paket */
                     if (SendDataPacket(true) == false) {
                         /* keine Daten mehr zu senden -> Update beenden */
-                        txBusMsg.type = eBusDevReqUpdTerm;
-                        txBusMsg.senderAddr = MY_ADDR;
-                        txBusMsg.msg.devBus.receiverAddr = TARGET_ADDR;
-                        BusSend(&txBusMsg);
-                        sFwuState = WAIT_FOR_UPD_TERM_RESP;
+                        SendTerm();
                     }
                 } else {
                     /* Wiederholung des letzten Paketes */
@@ -225,10 +384,42 @@ static void ProcessBus(uint8_t ret) {
                 }
             }
             break;
+        case WAIT_FOR_UPD_DATA_WIN_RESP:
+            if ((msgType == eBusDevRespUpdDataWin) &&
+                (spBusMsg->senderAddr == TARGET_ADDR) &&
+                (spBusMsg->msg.devBus.receiverAddr == MY_ADDR)) {
+                if (spBusMsg->msg.devBus.x.devResp.updDataWin.wordAddr == BUS_FWU_WIN_ERROR) {
+                    printf("\r\ntransfer ERROR (flash)\r\n");
+                    sFileTransferComplete = true;
+                    break;
+                }
+                sRetryCnt = 0;
+                sAckWordAddr = spBusMsg->msg.devBus.x.devResp.updDataWin.wordAddr;
+                sRxMask = spBusMsg->msg.devBus.x.devResp.updDataWin.rxMask;
+                sDevWindow = min(spBusMsg->msg.devBus.x.devResp.updDataWin.window, BUS_FWU_WIN_MAX);
+                printf("\b\b\b\b\b\b%6u", (unsigned)(min(sAckWordAddr, sImageWords) * 2));
+                fflush(stdout);
+                if (WindowComplete(sAckWordAddr, sRxMask, sDevWindow)) {
+                    /* all packets at the bootloader -> terminate */
+                    SendTerm();
+                } else {
+                    SendWindow();
+                }
+            }
+            break;
         case WAIT_FOR_UPD_TERM_RESP:
             if ((msgType == eBusDevRespUpdTerm) &&
                 (spBusMsg->msg.devBus.receiverAddr == MY_ADDR)) {
+                if (spBusMsg->msg.devBus.x.devResp.updTerm.success == 0) {
+                    /* flash error or checksum of the application is not 0x1234 */
+                    printf("\r\ntransfer ERROR (checksum)\r\n");
+                    sFileTransferComplete = true;
+                    break;
+                }
                 printf("\r\ntransfer OK\r\n");
+                if (sPageWords != 0) {
+                    printf("%u of %u pages skipped\r\n", sPagesSkipped, sNumPages);
+                }
                 /* reboot ausl�sen */
                 txBusMsg.type = eBusDevReqReboot;
                 txBusMsg.senderAddr = MY_ADDR;
@@ -268,14 +459,26 @@ static void ProcessBus(uint8_t ret) {
             }
             break;
         case WAIT_FOR_UPD_ENTER_RESP:
-            if ((GetTickCount() - sTimeStamp) > TIMEOUT_MS_UPD_ENTER_RESP) {
+            /* the differential update does not erase the flash */
+            if ((GetTickCount() - sTimeStamp) >
+                (sDiff ? TIMEOUT_MS_UPD_DATA_RESP : TIMEOUT_MS_UPD_ENTER_RESP)) {
                 sTimeStamp = GetTickCount();
                 sRetryCnt++;
+                if (sDiff && (sRetryCnt > MAX_RETRY_WIN_PROBE)) {
+                    /* bootloader without differential update */
+                    printf("no differential update, update all pages\r\n");
+                    sDiff = false;
+                    sRetryCnt = 0;
+                }
                 /* Upd enter Command wiederholen */
-                txBusMsg.type = eBusDevReqUpdEnter;
-                txBusMsg.senderAddr = MY_ADDR;
-                txBusMsg.msg.devBus.receiverAddr = TARGET_ADDR;
-                BusSend(&txBusMsg);
+                SendEnter();
+            }
+            break;
+        case WAIT_FOR_UPD_PAGESUM_RESP:
+            if ((GetTickCount() - sTimeStamp) > TIMEOUT_MS_UPD_PAGESUM_RESP) {
+                sTimeStamp = GetTickCount();
+                sRetryCnt++;
+                SendPageSumReq();
             }
             break;
         case WAIT_FOR_UPD_DATA_RESP:
@@ -286,6 +489,24 @@ static void ProcessBus(uint8_t ret) {
                 SendDataPacket(false);
             }
             break;
+        case WAIT_FOR_UPD_DATA_WIN_RESP:
+            if ((GetTickCount() - sTimeStamp) > sWinTimeoutMs) {
+                sTimeStamp = GetTickCount();
+                sRetryCnt++;
+                if ((sDevWindow == 0) && (sPageWords == 0) &&
+                    (sRetryCnt > MAX_RETRY_WIN_PROBE)) {
+                    /* bootloader without windowed update -> single packets */
+                    printf("\r\nno windowed update, send single packets\r\n");
+                    printf("send data (bytes):        ");
+                    sRetryCnt = 0;
+                    SendDataPacket(true);
+                    sFwuState = WAIT_FOR_UPD_DATA_RESP;
+                } else {
+                    /* repeat missing packets */
+                    SendWindow();
+                }
+            }
+            break;
         case WAIT_FOR_UPD_TERM_RESP:
             if ((GetTickCount() - sTimeStamp) > TIMEOUT_MS_UPD_TERM_RESP) {
                 sTimeStamp = GetTickCount();
@@ -315,7 +536,226 @@ static void ProcessBus(uint8_t ret) {
 }
 
 /*-----------------------------------------------------------------------------
-*  Datenpaket aus File laden und senden
+*  request the update mode, the differential update keeps the flash content
+*/
+static void SendEnter(void) {
+
+    TBusTelegram txBusMsg;
+
+    txBusMsg.type = sDiff ? eBusDevReqUpdEnterDiff : eBusDevReqUpdEnter;
+    txBusMsg.senderAddr = MY_ADDR;
+    txBusMsg.msg.devBus.receiverAddr = TARGET_ADDR;
+    BusSend(&txBusMsg);
+    sTimeStamp = GetTickCount();
+}
+
+/*-----------------------------------------------------------------------------
+*  request the checksums of the pages from sPageSumReq on
+*/
+static void SendPageSumReq(void) {
+
+    TBusTelegram txBusMsg;
+
+    txBusMsg.type = eBusDevReqUpdPageSum;
+    txBusMsg.senderAddr = MY_ADDR;
+    txBusMsg.msg.devBus.receiverAddr = TARGET_ADDR;
+    txBusMsg.msg.devBus.x.devReq.updPageSum.page = sPageSumReq;
+    BusSend(&txBusMsg);
+    sTimeStamp = GetTickCount();
+}
+
+/*-----------------------------------------------------------------------------
+*  compare the page checksums of the response with the image
+*  the first response sets the page layout, the image is padded with 0xff
+*  (erased flash) to the size of the application flash
+*/
+static bool ComparePageSums(void) {
+
+    TBusDevRespUpdPageSum *pResp = &spBusMsg->msg.devBus.x.devResp.updPageSum;
+    uint8_t               *pImage;
+    uint32_t              flashWords;
+    uint8_t               i;
+
+    if (sPageSumReq == 0) {
+        sPageWords = pResp->pageWordSize;
+        sNumPages = pResp->numPages;
+        flashWords = (uint32_t)sPageWords * sNumPages;
+        if ((sPageWords == 0) || ((sPageWords % PACKET_WORD_SIZE) != 0) ||
+            (flashWords > 0x10000UL) || (flashWords < sImageWords)) {
+            printf("\r\nERROR: image does not fit into the flash\r\n");
+            return false;
+        }
+        pImage = realloc(spImage, flashWords * 2);
+        spPageChanged = calloc(sNumPages, sizeof(bool));
+        if ((pImage == 0) || (spPageChanged == 0)) {
+            return false;
+        }
+        memset(pImage + sImageWords * 2, 0xff, (flashWords - sImageWords) * 2);
+        spImage = pImage;
+        sImageWords = flashWords;
+        sPagesSkipped = 0;
+    }
+    if ((pResp->num == 0) || (pResp->num > BUS_FWU_PAGESUM_NUM) ||
+        ((sPageSumReq + pResp->num) > sNumPages)) {
+        printf("\r\nERROR: invalid page checksum response\r\n");
+        return false;
+    }
+    for (i = 0; i < pResp->num; i++, sPageSumReq++) {
+        spPageChanged[sPageSumReq] = pResp->crc[i] != PageSum(sPageSumReq);
+        if (!spPageChanged[sPageSumReq]) {
+            sPagesSkipped++;
+        }
+    }
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+*  start the data transfer
+*/
+static void StartData(void) {
+
+    printf("send data (bytes):        ");
+    if (sImageWords == 0) {
+        /* File hat L�nge 0 */
+        sFileTransferComplete = true;
+        printf("\r\nERROR: file is empty\r\n");
+    } else if ((sWindow > 1) || (sPageWords != 0)) {
+        /* the first packet asks for the window of the bootloader */
+        /* the differential update is windowed only */
+        SendWindow();
+        sFwuState = WAIT_FOR_UPD_DATA_WIN_RESP;
+    } else {
+        /* erstes Datenpaket senden */
+        SendDataPacket(true);
+        sFwuState = WAIT_FOR_UPD_DATA_RESP;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  is the page of wordAddr transferred?
+*/
+static bool PageNeeded(uint32_t wordAddr) {
+
+    if (sPageWords == 0) {
+        return true;
+    }
+    return spPageChanged[wordAddr / sPageWords];
+}
+
+/*-----------------------------------------------------------------------------
+*  CRC-CCITT of an image page, same as the bootloader
+*  (avr-libc _crc_ccitt_update, start value 0xffff)
+*/
+static uint16_t PageSum(uint16_t page) {
+
+    uint8_t  *pData = spImage + (uint32_t)page * sPageWords * 2;
+    uint16_t crc = 0xffff;
+    uint32_t i;
+    uint8_t  data;
+
+    for (i = 0; i < (uint32_t)sPageWords * 2; i++) {
+        data = pData[i] ^ (uint8_t)crc;
+        data ^= data << 4;
+        crc = ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+    }
+    return crc;
+}
+
+/*-----------------------------------------------------------------------------
+*  Update beenden
+*/
+static void SendTerm(void) {
+
+    TBusTelegram txBusMsg;
+
+    txBusMsg.type = eBusDevReqUpdTerm;
+    txBusMsg.senderAddr = MY_ADDR;
+    txBusMsg.msg.devBus.receiverAddr = TARGET_ADDR;
+    BusSend(&txBusMsg);
+    sFwuState = WAIT_FOR_UPD_TERM_RESP;
+}
+
+/*-----------------------------------------------------------------------------
+*  all packets from ackWordAddr on buffered by the bootloader?
+*/
+static bool WindowComplete(uint32_t ackWordAddr, uint16_t rxMask, uint8_t window) {
+
+    uint8_t  i;
+    uint32_t wordAddr;
+
+    if (window == 0) {
+        return false;
+    }
+    for (i = 0, wordAddr = ackWordAddr; wordAddr < sImageWords; i++, wordAddr += PACKET_WORD_SIZE) {
+        if (!PageNeeded(wordAddr)) {
+            /* unchanged page */
+            continue;
+        }
+        if ((i >= BUS_FWU_WIN_MAX) || ((rxMask & (1 << i)) == 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+*  send up to sWindow packets not buffered by the bootloader yet, within the
+*  window of the bootloader from sAckWordAddr on
+*  the last packet requests the response (cumulative and selective ack)
+*  if the page at sAckWordAddr is unchanged (differential update) the window
+*  is moved to the next changed page
+*/
+static void SendWindow(void) {
+
+    TBusTelegram txBusMsg;
+    uint8_t      i;
+    uint8_t      devWindow;
+    uint8_t      num = 0;
+    uint8_t      packet[BUS_FWU_WIN_MAX];
+    uint32_t     wordAddr;
+    uint32_t     baseWordAddr = sAckWordAddr;
+    uint16_t     rxMask = sRxMask;
+    bool         start = false;
+
+    if (!PageNeeded(baseWordAddr)) {
+        baseWordAddr -= baseWordAddr % sPageWords;
+        while ((baseWordAddr < sImageWords) && !PageNeeded(baseWordAddr)) {
+            baseWordAddr += sPageWords;
+        }
+        rxMask = 0;
+        start = true;
+    }
+
+    /* the window of the bootloader is unknown until the first response */
+    devWindow = (sDevWindow == 0) ? 1 : sDevWindow;
+    for (i = 0; (i < devWindow) && (num < sWindow); i++) {
+        wordAddr = baseWordAddr + i * PACKET_WORD_SIZE;
+        if (wordAddr >= sImageWords) {
+            break;
+        }
+        if (PageNeeded(wordAddr) && ((rxMask & (1 << i)) == 0)) {
+            packet[num++] = i;
+        }
+    }
+
+    txBusMsg.type = eBusDevReqUpdDataWin;
+    txBusMsg.senderAddr = MY_ADDR;
+    txBusMsg.msg.devBus.receiverAddr = TARGET_ADDR;
+    for (i = 0; i < num; i++) {
+        wordAddr = baseWordAddr + packet[i] * PACKET_WORD_SIZE;
+        txBusMsg.msg.devBus.x.devReq.updDataWin.wordAddr = (uint16_t)wordAddr;
+        txBusMsg.msg.devBus.x.devReq.updDataWin.flags =
+            ((i == (num - 1)) ? BUS_FWU_WIN_ACK_REQ : 0) |
+            ((start && (i == 0)) ? BUS_FWU_WIN_START : 0);
+        memcpy(txBusMsg.msg.devBus.x.devReq.updDataWin.data, spImage + wordAddr * 2, BUS_FWU_PACKET_SIZE);
+        BusSend(&txBusMsg);
+    }
+    sWinTimeoutMs = TIMEOUT_MS_UPD_DATA_RESP + num * TIMEOUT_MS_UPD_DATA_WIN_PACKET;
+    sTimeStamp = GetTickCount();
+}
+
+/*-----------------------------------------------------------------------------
+*  Datenpaket aus dem Speicher senden
 *  der Parameter gibt an, ob das zuletzt gesendete Paket wiederholt werden soll
 */
 static bool SendDataPacket(bool next) {
@@ -334,27 +774,393 @@ static bool SendDataPacket(bool next) {
     } else {
         /* letztes Paket wiederholen */
         txBusMsg.msg.devBus.x.devReq.updData.wordAddr = sLastWordAddr;
-        fseek(spFile, sLastWordAddr * 2, SEEK_SET);
     }
 
-    int lenToRead = sizeof(txBusMsg.msg.devBus.x.devReq.updData.data);
-    int len = fread(txBusMsg.msg.devBus.x.devReq.updData.data, 1, lenToRead, spFile);
-
-    if (len == 0) {
+    if (txBusMsg.msg.devBus.x.devReq.updData.wordAddr >= sImageWords) {
         /* Fileende - alle Daten sind �bertragen */
         return false;
     } else {
-        printf("\b\b\b\b\b\b%6d", txBusMsg.msg.devBus.x.devReq.updData.wordAddr * 2 + len);
+        printf("\b\b\b\b\b\b%6d", (txBusMsg.msg.devBus.x.devReq.updData.wordAddr + PACKET_WORD_SIZE) * 2);
         fflush(stdout);
 
-        /* falls Fileende erreicht, ist letztes Paket kann nicht mehr so gro� wie Puffer */
-        /* nicht def. Daten werden auf 0xff gesetzt */
-        memset((void *)((intptr_t)txBusMsg.msg.devBus.x.devReq.updData.data + len), 0xff, lenToRead - len);
+        /* the last packet is padded with 0xff by LoadImage */
+        memcpy(txBusMsg.msg.devBus.x.devReq.updData.data,
+               spImage + txBusMsg.msg.devBus.x.devReq.updData.wordAddr * 2, BUS_FWU_PACKET_SIZE);
         BusSend(&txBusMsg);
         return true;
     }
 }
 
+/*-----------------------------------------------------------------------------
+*  target address or comma separated list of target addresses (fleet update)
+*/
+static bool ParseTargets(const char *pArg) {
+
+    char *pEnd;
+    long addr;
+    int  i;
+
+    sFleetNum = 0;
+    do {
+        addr = strtol(pArg, &pEnd, 0);
+        if ((pEnd == pArg) || (addr <= MY_ADDR) || (addr >= BUS_BROADCAST_ADDR) ||
+            (sFleetNum >= FLEET_MAX_DEV)) {
+            return false;
+        }
+        for (i = 0; i < sFleetNum; i++) {
+            if (sFleet[i].addr == addr) {
+                return false;
+            }
+        }
+        sFleet[sFleetNum].addr = (uint8_t)addr;
+        sFleet[sFleetNum].state = FLEET_IDLE;
+        sFleetNum++;
+        pArg = pEnd + 1;
+    } while (*pEnd == ',');
+
+    return *pEnd == '\0';
+}
+
+/*-----------------------------------------------------------------------------
+*  fleet update
+*  the targets are rebooted one after the other (no collision of the startup
+*  messages), the flash is erased in parallel. the data packets are
+*  broadcast, a packet missing at a single target only is sent to this
+*  target. after each window all targets are polled for their state.
+*/
+static void FleetUpdate(void) {
+
+    int i;
+    int numOk = 0;
+
+    FleetEnter();
+    FleetData();
+    FleetTerm();
+
+    for (i = 0; i < sFleetNum; i++) {
+        if (sFleet[i].state == FLEET_DONE) {
+            printf("target %d: OK\r\n", sFleet[i].addr);
+            numOk++;
+        } else {
+            printf("target %d: ERROR (%s)\r\n", sFleet[i].addr, sFleet[i].pError);
+        }
+    }
+    printf("%d of %d targets updated\r\n", numOk, sFleetNum);
+}
+
+/*-----------------------------------------------------------------------------
+*  reboot the targets and enter the update mode
+*/
+static void FleetEnter(void) {
+
+    int           i;
+    TFleetDev     *pDev;
+    TBusMsgType   msgType;
+    unsigned long now;
+    unsigned long timeout;
+    bool          rebooting;
+    bool          pending;
+
+    do {
+        if (WaitMsg(100) == BUS_MSG_OK) {
+            msgType = spBusMsg->type;
+            pDev = FleetDev(spBusMsg->senderAddr);
+            if ((pDev != 0) && (msgType == eBusDevStartup) && (pDev->state == FLEET_REBOOT)) {
+                /* erase takes a while, the next target is rebooted meanwhile */
+                SendReq(eBusDevReqUpdEnter, pDev->addr);
+                pDev->state = FLEET_ENTER;
+                pDev->retryCnt = 0;
+                pDev->timeStamp = GetTickCount();
+            } else if ((pDev != 0) && (msgType == eBusDevRespUpdEnter) &&
+                       (spBusMsg->msg.devBus.receiverAddr == MY_ADDR) &&
+                       (pDev->state == FLEET_ENTER)) {
+                pDev->state = FLEET_DATA;
+            }
+            continue;
+        }
+        now = GetTickCount();
+        rebooting = false;
+        pending = false;
+        for (i = 0; i < sFleetNum; i++) {
+            pDev = &sFleet[i];
+            if ((pDev->state != FLEET_REBOOT) && (pDev->state != FLEET_ENTER)) {
+                continue;
+            }
+            timeout = (pDev->state == FLEET_REBOOT) ? TIMEOUT_MS_STARTUP_RESP : TIMEOUT_MS_UPD_ENTER_RESP;
+            if ((now - pDev->timeStamp) > timeout) {
+                if (pDev->retryCnt >= MAX_RETRY) {
+                    pDev->state = FLEET_FAILED;
+                    pDev->pError = "no response";
+                    continue;
+                }
+                pDev->retryCnt++;
+                pDev->timeStamp = now;
+                SendReq((pDev->state == FLEET_REBOOT) ? eBusDevReqReboot : eBusDevReqUpdEnter, pDev->addr);
+            }
+            rebooting |= pDev->state == FLEET_REBOOT;
+            pending = true;
+        }
+        if (!rebooting) {
+            /* reboot the next target */
+            for (i = 0; i < sFleetNum; i++) {
+                pDev = &sFleet[i];
+                if (pDev->state == FLEET_IDLE) {
+                    SendReq(eBusDevReqReboot, pDev->addr);
+                    pDev->state = FLEET_REBOOT;
+                    pDev->retryCnt = 0;
+                    pDev->timeStamp = now;
+                    pending = true;
+                    break;
+                }
+            }
+        }
+    } while (pending);
+}
+
+/*-----------------------------------------------------------------------------
+*  transfer the image to all targets in FLEET_DATA
+*/
+static void FleetData(void) {
+
+    int      i;
+    int      num;
+    bool     complete;
+    uint32_t minAck;
+
+    printf("send data (bytes):        ");
+    /* the first poll asks for the window of the bootloaders */
+    for (i = 0; i < sFleetNum; i++) {
+        if (sFleet[i].state != FLEET_DATA) {
+            continue;
+        }
+        sFleet[i].window = 0;
+        if (!FleetPoll(&sFleet[i], MAX_RETRY_WIN_PROBE, 0)) {
+            sFleet[i].state = FLEET_FAILED;
+            sFleet[i].pError = "no windowed update";
+        }
+    }
+
+    do {
+        num = FleetSendWindow();
+        complete = true;
+        minAck = sImageWords;
+        for (i = 0; i < sFleetNum; i++) {
+            if ((sFleet[i].state != FLEET_DATA) || FleetComplete(&sFleet[i])) {
+                continue;
+            }
+            /* the poll is sent after the window */
+            if (!FleetPoll(&sFleet[i], MAX_RETRY, num * TIMEOUT_MS_UPD_DATA_WIN_PACKET)) {
+                sFleet[i].state = FLEET_FAILED;
+                continue;
+            }
+            num = 0;
+            minAck = min(minAck, sFleet[i].ackWordAddr);
+            complete &= FleetComplete(&sFleet[i]);
+        }
+        printf("\b\b\b\b\b\b%6u", (unsigned)(minAck * 2));
+        fflush(stdout);
+    } while (!complete);
+    printf("\r\n");
+}
+
+/*-----------------------------------------------------------------------------
+*  terminate the update at each target and start the new firmware
+*/
+static void FleetTerm(void) {
+
+    int           i;
+    int           retry;
+    TFleetDev     *pDev;
+    unsigned long timeStamp;
+    bool          resp;
+
+    for (i = 0; i < sFleetNum; i++) {
+        pDev = &sFleet[i];
+        if (pDev->state != FLEET_DATA) {
+            continue;
+        }
+        pDev->state = FLEET_FAILED;
+        pDev->pError = "no response";
+        for (retry = 0, resp = false; !resp && (retry <= MAX_RETRY); retry++) {
+            SendReq(eBusDevReqUpdTerm, pDev->addr);
+            timeStamp = GetTickCount();
+            while (!resp && ((GetTickCount() - timeStamp) < TIMEOUT_MS_UPD_TERM_RESP)) {
+                if ((WaitMsg(100) == BUS_MSG_OK) &&
+                    (spBusMsg->type == eBusDevRespUpdTerm) &&
+                    (spBusMsg->senderAddr == pDev->addr) &&
+                    (spBusMsg->msg.devBus.receiverAddr == MY_ADDR)) {
+                    resp = true;
+                    if (spBusMsg->msg.devBus.x.devResp.updTerm.success == 0) {
+                        pDev->pError = "checksum";
+                    } else {
+                        pDev->state = FLEET_DONE;
+                    }
+                }
+            }
+        }
+        if (pDev->state != FLEET_DONE) {
+            continue;
+        }
+        /* start the application */
+        for (retry = 0, resp = false; !resp && (retry <= MAX_RETRY); retry++) {
+            SendReq(eBusDevReqReboot, pDev->addr);
+            timeStamp = GetTickCount();
+            while (!resp && ((GetTickCount() - timeStamp) < TIMEOUT_MS_REBOOT_RESP)) {
+                resp = (WaitMsg(100) == BUS_MSG_OK) &&
+                       (spBusMsg->type == eBusDevStartup) &&
+                       (spBusMsg->senderAddr == pDev->addr);
+            }
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  request the buffer state of a target
+*  extraMs: tx time of the telegrams sent before the request
+*/
+static bool FleetPoll(TFleetDev *pDev, int maxRetry, unsigned long extraMs) {
+
+    int           retry;
+    unsigned long timeStamp;
+    TBusDevRespUpdDataWin *pResp = &spBusMsg->msg.devBus.x.devResp.updDataWin;
+
+    for (retry = 0; retry <= maxRetry; retry++, extraMs = 0) {
+        SendReq(eBusDevReqUpdDataWinState, pDev->addr);
+        timeStamp = GetTickCount();
+        while ((GetTickCount() - timeStamp) < (TIMEOUT_MS_UPD_WIN_STATE_RESP + extraMs)) {
+            if ((WaitMsg(100) != BUS_MSG_OK) ||
+                (spBusMsg->type != eBusDevRespUpdDataWin) ||
+                (spBusMsg->senderAddr != pDev->addr) ||
+                (spBusMsg->msg.devBus.receiverAddr != MY_ADDR)) {
+                continue;
+            }
+            if (pResp->wordAddr == BUS_FWU_WIN_ERROR) {
+                pDev->pError = "flash";
+                return false;
+            }
+            pDev->ackWordAddr = pResp->wordAddr;
+            pDev->rxMask = pResp->rxMask;
+            pDev->window = min(pResp->window, BUS_FWU_WIN_MAX);
+            return true;
+        }
+    }
+    pDev->pError = "no response";
+    return false;
+}
+
+/*-----------------------------------------------------------------------------
+*  send up to sWindow packets missing at any target, from the lowest
+*  acknowledged address on. a packet missing at several targets is broadcast.
+*  returns the number of packets
+*/
+static int FleetSendWindow(void) {
+
+    TBusTelegram txBusMsg;
+    TFleetDev    *pDev;
+    TFleetDev    *pMissing = 0;
+    int          i;
+    int          num = 0;
+    int          numMissing;
+    uint32_t     minAck = sImageWords;
+    uint32_t     wordAddr;
+    uint32_t     pos;
+
+    for (i = 0; i < sFleetNum; i++) {
+        if ((sFleet[i].state == FLEET_DATA) && !FleetComplete(&sFleet[i])) {
+            minAck = min(minAck, sFleet[i].ackWordAddr);
+        }
+    }
+
+    txBusMsg.type = eBusDevReqUpdDataWin;
+    txBusMsg.senderAddr = MY_ADDR;
+    for (wordAddr = minAck;
+         (wordAddr < sImageWords) && (wordAddr < (minAck + BUS_FWU_WIN_MAX * PACKET_WORD_SIZE)) &&
+         (num < sWindow);
+         wordAddr += PACKET_WORD_SIZE) {
+        numMissing = 0;
+        for (i = 0; i < sFleetNum; i++) {
+            pDev = &sFleet[i];
+            if ((pDev->state != FLEET_DATA) || (wordAddr < pDev->ackWordAddr)) {
+                continue;
+            }
+            /* packets beyond the window of the target are discarded */
+            pos = (wordAddr - pDev->ackWordAddr) / PACKET_WORD_SIZE;
+            if ((pos < pDev->window) && ((pDev->rxMask & (1 << pos)) == 0)) {
+                numMissing++;
+                pMissing = pDev;
+            }
+        }
+        if (numMissing == 0) {
+            continue;
+        }
+        txBusMsg.msg.devBus.receiverAddr = (numMissing > 1) ? BUS_BROADCAST_ADDR : pMissing->addr;
+        txBusMsg.msg.devBus.x.devReq.updDataWin.wordAddr = (uint16_t)wordAddr;
+        txBusMsg.msg.devBus.x.devReq.updDataWin.flags = 0;
+        memcpy(txBusMsg.msg.devBus.x.devReq.updDataWin.data, spImage + wordAddr * 2, BUS_FWU_PACKET_SIZE);
+        BusSend(&txBusMsg);
+        num++;
+    }
+    return num;
+}
+
+/*-----------------------------------------------------------------------------
+*  all packets at the target?
+*/
+static bool FleetComplete(TFleetDev *pDev) {
+
+    return WindowComplete(pDev->ackWordAddr, pDev->rxMask, pDev->window);
+}
+
+/*-----------------------------------------------------------------------------
+*  fleet target by address
+*/
+static TFleetDev *FleetDev(uint8_t addr) {
+
+    int i;
+
+    for (i = 0; i < sFleetNum; i++) {
+        if (sFleet[i].addr == addr) {
+            return &sFleet[i];
+        }
+    }
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+*  wait up to timeoutMs for a telegram
+*/
+static uint8_t WaitMsg(unsigned long timeoutMs) {
+
+    fd_set         rfds;
+    struct timeval tv;
+    uint8_t        ret;
+
+    ret = BusCheck();
+    if (ret == BUS_MSG_OK) {
+        return ret;
+    }
+    FD_ZERO(&rfds);
+    FD_SET(sSioFd, &rfds);
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    select(sSioFd + 1, &rfds, 0, 0, &tv);
+
+    return BusCheck();
+}
+
+/*-----------------------------------------------------------------------------
+*  send a request without data
+*/
+static void SendReq(TBusMsgType type, uint8_t addr) {
+
+    TBusTelegram txBusMsg;
+
+    txBusMsg.type = type;
+    txBusMsg.senderAddr = MY_ADDR;
+    txBusMsg.msg.devBus.receiverAddr = addr;
+    BusSend(&txBusMsg);
+}
+
 #ifndef WIN32
 static unsigned long GetTickCount(void) {
 
@@ -374,8 +1180,13 @@ static unsigned long GetTickCount(void) {
 static void PrintUsage(void) {
 
     printf("\r\nUsage:");
-    printf("firmwarupdate comport filename target\r\n");
+    printf("firmwarupdate comport filename target[,target..] [-w window] [-d]\r\n");
     printf("comport: com1 com2 ..\r\n");
     printf("filename: new firmware binary file\r\n");
     printf("target: target address\r\n");
+    printf("        several targets: the image is sent to all targets at the same time\r\n");
+    printf("window: packets sent without response (1..%d, default %d)\r\n", BUS_FWU_WIN_MAX, BUS_FWU_WIN_MAX);
+    printf("        1: wait for the response of each packet\r\n");
+    printf("-d: differential update, only pages with a different checksum\r\n");
+    printf("    are erased and transferred (single target only)\r\n");
 }
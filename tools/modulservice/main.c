@@ -23,6 +23,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -73,6 +74,8 @@
 #define OP_DIAG                             22
 #define OP_SET_VAR                          23
 #define OP_GET_VAR                          24
+#define OP_SET_VALUE_MULTI                  25
+#define OP_SCAN                             26
 
 #define SIZE_CLIENT_LIST                    BUS_MAX_CLIENT_NUM
 
@@ -80,14 +83,50 @@
 
 #define CMD_SIZE                            300
 
+/* bus scan: info requests outstanding at the same time */
+#define SCAN_DEPTH_DEFAULT                  16
+#define SCAN_DEPTH_MAX                      32
+/* response timeout for absent addresses, measured from the end of the
+ * request or the last telegram on the bus to the start of the response.
+ * starts with SCAN_TIMEOUT_INIT and follows twice the SCAN_RESP_PERCENTILE
+ * of the last SCAN_RESP_SAMPLES response times (a single slow module does not slow down the scan). the
+ * timeout is doubled for each retry of an address (slow modules) */
+#define SCAN_TIMEOUT_INIT                   100 /* ms */
+#define SCAN_TIMEOUT_MIN                    20  /* ms */
+#define SCAN_RESP_SAMPLES                   32
+#define SCAN_RESP_PERCENTILE                90  /* % */
+#define SCAN_RETRY                          1
+#define SCAN_CHAR_TIME_US                   1042 /* 9600 baud, 10 bit */
+
+/* multicast set value: the responses arrive in one slot per entry,
+ * the telegram is repeated for the entries not confirmed */
+#define SETVALUE_MULTI_TIMEOUT              200 /* ms after the last slot */
+#define SETVALUE_MULTI_RETRY                2
+
 /*-----------------------------------------------------------------------------
 *  Typedefs
 */
+typedef enum {
+    eScanSkip,
+    eScanIdle,
+    eScanWait,
+    eScanFound,
+    eScanAbsent
+} TScanState;
+
+typedef struct {
+    TScanState    state;
+    int           tries;
+    unsigned long sentTimeMs;
+    uint8_t       devType;
+    char          version[BUS_DEV_INFO_VERSION_LEN + 1];
+} TScanEntry;
 
 /*-----------------------------------------------------------------------------
 *  Variables
 */
 static uint8_t myAddr = 0;
+static int     sSioFd;
 
 /*-----------------------------------------------------------------------------
 *  Functions
@@ -99,9 +138,20 @@ static bool ModuleReadClientAddress(uint8_t address, uint8_t *pList, uint8_t lis
 static bool ModuleSetClientAddress(uint8_t address, uint8_t *pList, uint8_t listLen);
 static bool ModuleReadEeprom(uint8_t address, uint8_t *pBuf, unsigned int bufLen, unsigned int eepromAddress);
 static bool ModuleWriteEeprom(uint8_t address, uint8_t *pBuf, unsigned int bufLen, unsigned int eepromAddress);
+static int  ModuleEepromBlock(uint8_t address, TBusTelegram *pTxMsg, TBusMsgType respType, uint8_t *pData);
+static bool ModuleReadEepromByte(uint8_t address, uint8_t *pBuf, unsigned int bufLen, unsigned int eepromAddress);
+static bool ModuleWriteEepromByte(uint8_t address, uint8_t *pBuf, unsigned int bufLen, unsigned int eepromAddress);
 static bool ModuleGetActualValue(uint8_t address, TBusDevRespActualValue *pBuf);
 static bool ModuleSetValue(uint8_t address, TBusDevReqSetValue *pBuf);
+static bool ModuleSetValueMulti(TBusDevReqSetValueMulti *pBuf);
+static bool SetValueMultiParse(const char *pArg, TBusDevReqSetValueMulti *pBuf);
+static int  SetValueMultiAddr(const TBusDevReqSetValueMulti *pBuf, uint8_t *pAddr);
 static bool ModuleInfo(uint8_t address, TBusDevRespInfo *pBuf, uint16_t resp_timeout);
+static bool ModuleScan(int start, int stop, int depth);
+static unsigned long ScanTimeout(const unsigned long *pRespTimeMs, int num);
+static int  CompareTime(const void *p1, const void *p2);
+static uint8_t WaitMsg(unsigned long timeoutMs);
+static const char *DevTypeName(uint8_t devType);
 static bool ModuleDiag(uint8_t address, TBusDevRespDiag *pBuf, uint16_t resp_timeout);
 static bool ModuleClockCalib(uint8_t address, uint8_t calibAddress);
 static bool SwitchEvent(uint8_t clientAddr, uint8_t state);
@@ -134,6 +184,7 @@ int main(int argc, char *argv[]) {
     uint8_t                mask;
     TBusDevRespActualValue actVal;
     TBusDevReqSetValue     setVal;
+    TBusDevReqSetValueMulti setValMulti;
     TBusDevRespInfo        info;
     TBusDevRespDiag        diag;
     TBusDevReqSetVar       setVar;
@@ -146,6 +197,7 @@ int main(int argc, char *argv[]) {
     char                   *p;
     uint8_t                val8;
     uint8_t                defaultMyAddr = 0;
+    TSioBaud               baud = eSioBaud9600;
 
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-c") == 0) {
@@ -166,6 +218,13 @@ int main(int argc, char *argv[]) {
                 defaultMyAddr = myAddr;
                 i++;
             }
+        } else if (strcmp(argv[i], "-b") == 0) {
+            if (((i + 1) >= argc) ||
+                !SioBaudFromRate(strtoul(argv[i + 1], 0, 0), &baud)) {
+                PrintUsage();
+                return -1;
+            }
+            i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             server_run = true;
             break;
@@ -177,7 +236,7 @@ int main(int argc, char *argv[]) {
     }
 
     SioInit();
-    handle = SioOpen(comPort, eSioBaud9600, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+    handle = SioOpen(comPort, baud, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
     if (handle == -1) {
         printf("cannot open %s\n", comPort);
         return -1;
@@ -189,6 +248,7 @@ int main(int argc, char *argv[]) {
         SioRead(handle, &val8, sizeof(val8));
     }
     BusInit(handle);
+    sSioFd = SioGetFd(handle);
 
     do {
         if (server_run) {
@@ -552,6 +612,22 @@ int main(int argc, char *argv[]) {
                 printf("OK\n");
             }
             break;
+        case OP_SET_VALUE_MULTI:
+            memset(&setValMulti, 0, sizeof(setValMulti));
+            ret = true;
+            for (j = argi; (j < argc) && (argv[j][0] != '-') && ret; j++) {
+                ret = SetValueMultiParse(argv[j], &setValMulti);
+            }
+            if (!ret || (setValMulti.length == 0)) {
+                printf("invalid entry list\n");
+                ret = false;
+                break;
+            }
+            ret = ModuleSetValueMulti(&setValMulti);
+            if (ret) {
+                printf("OK\n");
+            }
+            break;
         case OP_INFO:
             ret = ModuleInfo(moduleAddr, &info, RESPONSE_TIMEOUT);
             if (ret) {
@@ -671,6 +747,15 @@ int main(int argc, char *argv[]) {
                 printf("OK\n");
             }
             break;
+        case OP_SCAN:
+            if ((argc - argi) > 1) {
+                ret = ModuleScan(atoi(argv[argi]), atoi(argv[argi + 1]),
+                                 ((argc - argi) > 2) ? atoi(argv[argi + 2]) : SCAN_DEPTH_DEFAULT);
+                if (ret) {
+                    printf("OK\n");
+                }
+            }
+            break;
         case OP_SET_VAR:
             if ((argc - argi) > 1) {
                 setVar.index = atoi(argv[argi]);
@@ -836,6 +921,119 @@ static bool ModuleSetValue(uint8_t address, TBusDevReqSetValue *pSetVal) {
     }
 }
 
+/*-----------------------------------------------------------------------------
+*  parse entry addr=hhhh.. (data bytes in hex) or addr=*hh (hh for all outputs)
+*  and append it to the multicast set value
+*/
+static bool SetValueMultiParse(const char *pArg, TBusDevReqSetValueMulti *pSetValMulti) {
+
+    uint8_t       data[BUS_SETVALUE_MULTI_SIZE];
+    uint8_t       len = 0;
+    unsigned long addr;
+    char          *p;
+    char          hex[3] = "";
+    bool          fill = false;
+
+    addr = strtoul(pArg, &p, 0);
+    if ((p == pArg) || (*p != '=') || (addr > UINT8_MAX)) {
+        return false;
+    }
+    p++;
+    if (*p == '*') {
+        fill = true;
+        p++;
+    }
+    while (isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1]) &&
+           (len < sizeof(data))) {
+        hex[0] = p[0];
+        hex[1] = p[1];
+        data[len] = (uint8_t)strtoul(hex, 0, 16);
+        len++;
+        p += 2;
+    }
+    if ((*p != '\0') || (len == 0)) {
+        return false;
+    }
+    return BusSetValueMultiAdd(pSetValMulti, (uint8_t)addr, data, len, fill);
+}
+
+/*-----------------------------------------------------------------------------
+*  addresses of the entries of a multicast set value
+*  returns the number of entries
+*/
+static int SetValueMultiAddr(const TBusDevReqSetValueMulti *pSetValMulti, uint8_t *pAddr) {
+
+    const uint8_t *pEntry = pSetValMulti->entry;
+    const uint8_t *pEnd = pSetValMulti->entry + pSetValMulti->length;
+    int           num = 0;
+
+    while ((pEntry + BUS_SETVALUE_MULTI_HDR_SIZE) <= pEnd) {
+        pAddr[num] = pEntry[0];
+        num++;
+        pEntry += BUS_SETVALUE_MULTI_HDR_SIZE + (pEntry[1] & BUS_SETVALUE_MULTI_LEN_MASK);
+    }
+    return num;
+}
+
+/*-----------------------------------------------------------------------------
+*  multicast set value
+*  the devices confirm in the slot of their entry. the confirmed entries are
+*  removed and the telegram with the same seq is repeated for the rest
+*  (SETVALUE_MULTI_RETRY).
+*/
+static bool ModuleSetValueMulti(TBusDevReqSetValueMulti *pSetValMulti) {
+
+    static uint8_t          sSeq = 0;
+    TBusTelegram            txBusMsg;
+    TBusDevReqSetValueMulti *pReq = &txBusMsg.msg.devBus.x.devReq.setValueMulti;
+    uint8_t                 ret;
+    unsigned long           startTimeMs;
+    unsigned long           actualTimeMs;
+    unsigned long           timeoutMs;
+    TBusTelegram            *pBusMsg;
+    uint8_t                 addr[BUS_SETVALUE_MULTI_SIZE / BUS_SETVALUE_MULTI_HDR_SIZE];
+    int                     num;
+    int                     tries;
+    int                     i;
+
+    txBusMsg.type = eBusDevReqSetValueMulti;
+    txBusMsg.senderAddr = MY_ADDR;
+    txBusMsg.msg.devBus.receiverAddr = 0;
+    memcpy(pReq, pSetValMulti, sizeof(*pReq));
+    pReq->seq = sSeq;
+    sSeq++;
+    for (tries = 0; (tries <= SETVALUE_MULTI_RETRY) && (pReq->length > 0); tries++) {
+        num = SetValueMultiAddr(pReq, addr);
+        timeoutMs = num * BUS_SETVALUE_MULTI_SLOT_MS + SETVALUE_MULTI_TIMEOUT;
+        BusSend(&txBusMsg);
+        startTimeMs = GetTickCount();
+        actualTimeMs = startTimeMs;
+        do {
+            ret = WaitMsg(timeoutMs - (actualTimeMs - startTimeMs));
+            actualTimeMs = GetTickCount();
+            if (ret == BUS_MSG_OK) {
+                pBusMsg = BusMsgBufGet();
+                if ((pBusMsg->type == eBusDevRespSetValueMulti)     &&
+                    (pBusMsg->msg.devBus.receiverAddr == MY_ADDR) &&
+                    (pBusMsg->msg.devBus.x.devResp.setValueMulti.seq == pReq->seq)) {
+                    BusSetValueMultiRemove(pReq, pBusMsg->senderAddr);
+                }
+            }
+        } while ((pReq->length > 0) && ((actualTimeMs - startTimeMs) < timeoutMs));
+    }
+
+    if (pReq->length > 0) {
+        num = SetValueMultiAddr(pReq, addr);
+        printf("no confirmation from:");
+        for (i = 0; i < num; i++) {
+            printf(" %d", addr[i]);
+        }
+        printf("\n");
+        return false;
+    }
+    return true;
+}
+
 /*-----------------------------------------------------------------------------
 *  read info
 */
@@ -891,6 +1089,224 @@ static bool ModuleInfo(uint8_t address, TBusDevRespInfo *pBuf, uint16_t resp_tim
     }
 }
 
+/*-----------------------------------------------------------------------------
+*  scan address range for modules
+*  up to depth info requests are outstanding, an address is absent when
+*  there is no response within the timeout after the last telegram on the
+*  bus. absent addresses are requested again (SCAN_RETRY). late responses
+*  are accepted until the end of the scan.
+*  output per module: address;type;version
+*/
+static bool ModuleScan(int start, int stop, int depth) {
+
+    static TScanEntry entry[256];
+    TScanEntry      *pEntry;
+    TBusTelegram    txBusMsg;
+    TBusTelegram    *pBusMsg;
+    uint8_t         ret;
+    uint8_t         wait[SCAN_DEPTH_MAX];
+    int             numWait = 0;
+    int             numTodo = 0;
+    int             addr;
+    int             i;
+    unsigned long   actualTimeMs;
+    unsigned long   lastRxTimeMs;
+    unsigned long   refTimeMs;
+    unsigned long   respTimeMs[SCAN_RESP_SAMPLES];
+    int             numResp = 0;
+    unsigned long   timeoutMs = SCAN_TIMEOUT_INIT;
+    unsigned long   entryTimeoutMs;
+    unsigned long   waitMs;
+    unsigned long   txEndTimeMs = 0;
+    uint8_t         encBuf[BUS_MAX_ENCODED_SIZE];
+    uint8_t         encLen = 0;
+    const char      *pName;
+
+    if ((start < 0) || (stop > 255) || (start > stop)) {
+        return false;
+    }
+    if (depth < 1) {
+        depth = 1;
+    } else if (depth > SCAN_DEPTH_MAX) {
+        depth = SCAN_DEPTH_MAX;
+    }
+
+    memset(entry, 0, sizeof(entry));
+    for (addr = start; addr <= stop; addr++) {
+        if ((addr != MY_ADDR) && (addr != BUS_BROADCAST_ADDR)) {
+            entry[addr].state = eScanIdle;
+            numTodo++;
+        }
+    }
+
+    txBusMsg.type = eBusDevReqInfo;
+    txBusMsg.senderAddr = MY_ADDR;
+    lastRxTimeMs = GetTickCount();
+
+    while (numTodo > 0) {
+        /* fill the window, retries first (lowest idle address) */
+        for (addr = start; (addr <= stop) && (numWait < depth); addr++) {
+            pEntry = &entry[addr];
+            if (pEntry->state == eScanIdle) {
+                txBusMsg.msg.devBus.receiverAddr = (uint8_t)addr;
+                BusSend(&txBusMsg);
+                /* requests are queued: estimate the end of transmission */
+                BusEncode(&txBusMsg, encBuf, sizeof(encBuf), &encLen);
+                txEndTimeMs = max(GetTickCount(), txEndTimeMs) + (encLen * SCAN_CHAR_TIME_US + 999) / 1000;
+                pEntry->state = eScanWait;
+                pEntry->sentTimeMs = txEndTimeMs;
+                pEntry->tries++;
+                wait[numWait] = (uint8_t)addr;
+                numWait++;
+            }
+        }
+
+        /* wait for a telegram up to the next timeout of the window */
+        actualTimeMs = GetTickCount();
+        waitMs = RESPONSE_TIMEOUT;
+        for (i = 0; i < numWait; i++) {
+            pEntry = &entry[wait[i]];
+            refTimeMs = max(pEntry->sentTimeMs, lastRxTimeMs);
+            entryTimeoutMs = min(timeoutMs << (pEntry->tries - 1), RESPONSE_TIMEOUT);
+            if ((refTimeMs + entryTimeoutMs) <= actualTimeMs) {
+                waitMs = 0;
+            } else {
+                waitMs = min(waitMs, refTimeMs + entryTimeoutMs - actualTimeMs);
+            }
+        }
+        ret = WaitMsg(waitMs);
+        actualTimeMs = GetTickCount();
+        if (ret == BUS_MSG_OK) {
+            pBusMsg = BusMsgBufGet();
+            pEntry = &entry[pBusMsg->senderAddr];
+            if ((pBusMsg->type == eBusDevRespInfo)            &&
+                (pBusMsg->msg.devBus.receiverAddr == MY_ADDR) &&
+                (pEntry->state != eScanSkip)                  &&
+                (pEntry->state != eScanFound)) {
+                if (pEntry->state == eScanWait) {
+                    /* late responses after the timeout are not sampled */
+                    BusEncode(pBusMsg, encBuf, sizeof(encBuf), &encLen);
+                    refTimeMs = max(pEntry->sentTimeMs, lastRxTimeMs) +
+                                encLen * SCAN_CHAR_TIME_US / 1000;
+                    respTimeMs[numResp % SCAN_RESP_SAMPLES] =
+                        (actualTimeMs > refTimeMs) ? actualTimeMs - refTimeMs : 0;
+                    numResp++;
+                    timeoutMs = ScanTimeout(respTimeMs, min(numResp, SCAN_RESP_SAMPLES));
+                }
+                pEntry->devType = pBusMsg->msg.devBus.x.devResp.info.devType;
+                memcpy(pEntry->version, pBusMsg->msg.devBus.x.devResp.info.version, BUS_DEV_INFO_VERSION_LEN);
+                pEntry->version[BUS_DEV_INFO_VERSION_LEN] = '\0';
+                if (pEntry->state != eScanAbsent) {
+                    /* eScanAbsent is already done */
+                    numTodo--;
+                }
+                pEntry->state = eScanFound;
+            }
+            lastRxTimeMs = actualTimeMs;
+        }
+
+        /* timeout of outstanding requests, found entries leave the window */
+        for (i = 0; i < numWait; ) {
+            pEntry = &entry[wait[i]];
+            if (pEntry->state == eScanWait) {
+                refTimeMs = max(pEntry->sentTimeMs, lastRxTimeMs);
+                entryTimeoutMs = min(timeoutMs << (pEntry->tries - 1), RESPONSE_TIMEOUT);
+                if ((actualTimeMs <= refTimeMs) ||
+                    ((actualTimeMs - refTimeMs) < entryTimeoutMs)) {
+                    i++;
+                    continue;
+                }
+                if (pEntry->tries > SCAN_RETRY) {
+                    pEntry->state = eScanAbsent;
+                    numTodo--;
+                } else {
+                    pEntry->state = eScanIdle;
+                }
+            }
+            numWait--;
+            wait[i] = wait[numWait];
+        }
+    }
+
+    for (addr = start; addr <= stop; addr++) {
+        pEntry = &entry[addr];
+        if (pEntry->state == eScanFound) {
+            pName = DevTypeName(pEntry->devType);
+            if (pName != 0) {
+                printf("%d;%s;%s\n", addr, pName, pEntry->version);
+            } else {
+                printf("%d;%d;%s\n", addr, pEntry->devType, pEntry->version);
+            }
+        }
+    }
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+*  scan timeout: twice the SCAN_RESP_PERCENTILE of the response times
+*/
+static unsigned long ScanTimeout(const unsigned long *pRespTimeMs, int num) {
+
+    unsigned long sorted[SCAN_RESP_SAMPLES];
+
+    memcpy(sorted, pRespTimeMs, num * sizeof(sorted[0]));
+    qsort(sorted, num, sizeof(sorted[0]), CompareTime);
+    return min(max(sorted[(num - 1) * SCAN_RESP_PERCENTILE / 100] * 2, SCAN_TIMEOUT_MIN),
+               RESPONSE_TIMEOUT);
+}
+
+static int CompareTime(const void *p1, const void *p2) {
+
+    unsigned long t1 = *(const unsigned long *)p1;
+    unsigned long t2 = *(const unsigned long *)p2;
+
+    return (t1 > t2) - (t1 < t2);
+}
+
+/*-----------------------------------------------------------------------------
+*  wait up to timeoutMs for a telegram
+*/
+static uint8_t WaitMsg(unsigned long timeoutMs) {
+
+    fd_set         rfds;
+    struct timeval tv;
+    uint8_t        ret;
+
+    ret = BusCheck();
+    if ((ret == BUS_MSG_OK) || (timeoutMs == 0)) {
+        return ret;
+    }
+    FD_ZERO(&rfds);
+    FD_SET(sSioFd, &rfds);
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    select(sSioFd + 1, &rfds, 0, 0, &tv);
+
+    return BusCheck();
+}
+
+/*-----------------------------------------------------------------------------
+*  name of device type, 0 for unknown types
+*/
+static const char *DevTypeName(uint8_t devType) {
+
+    switch (devType) {
+    case eBusDevTypeDo31:    return "DO31";
+    case eBusDevTypeSw8:     return "SW8";
+    case eBusDevTypeLum:     return "LUM";
+    case eBusDevTypeLed:     return "LED";
+    case eBusDevTypeSw16:    return "SW16";
+    case eBusDevTypeWind:    return "WIND";
+    case eBusDevTypeRs485If: return "RS485IF";
+    case eBusDevTypePwm4:    return "PWM4";
+    case eBusDevTypeSmIf:    return "SMIF";
+    case eBusDevTypeKeyb:    return "KEYB";
+    case eBusDevTypeKeyRc:   return "KEYRC";
+    case eBusDevTypeSg:      return "SG";
+    default:                 return 0;
+    }
+}
+
 /*-----------------------------------------------------------------------------
 *  read diag
 */
@@ -1217,6 +1633,8 @@ static bool ModuleSetClientAddress(uint8_t address, uint8_t *pList, uint8_t list
 
 /*-----------------------------------------------------------------------------
 *  read eeprom data from bus module
+*  block telegrams are used, modules without support for them (no response
+*  to the first block request) are read byte by byte
 */
 static bool ModuleReadEeprom(
     uint8_t address,
@@ -1224,6 +1642,137 @@ static bool ModuleReadEeprom(
     unsigned int bufLen,
     unsigned int eepromAddress) {
 
+    TBusTelegram    txBusMsg;
+    unsigned int    numRead = 0;
+    int             len;
+
+    txBusMsg.type = eBusDevReqEepromReadBlock;
+    txBusMsg.senderAddr = MY_ADDR;
+    txBusMsg.msg.devBus.receiverAddr = address;
+
+    while (numRead < bufLen) {
+        txBusMsg.msg.devBus.x.devReq.readEepromBlock.addr = (uint16_t)(eepromAddress + numRead);
+        txBusMsg.msg.devBus.x.devReq.readEepromBlock.length =
+            (uint8_t)min(bufLen - numRead, BUS_EEPROM_BLOCK_SIZE);
+        len = ModuleEepromBlock(address, &txBusMsg, eBusDevRespEepromReadBlock, pBuf + numRead);
+        if (len < 0) {
+            if (numRead == 0) {
+                return ModuleReadEepromByte(address, pBuf, bufLen, eepromAddress);
+            }
+            break;
+        } else if (len == 0) {
+            /* end of eeprom */
+            break;
+        }
+        numRead += len;
+    }
+
+    if (numRead == bufLen) {
+        return true;
+    } else {
+        return false;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  write eeprom data to bus module
+*  see ModuleReadEeprom
+*/
+static bool ModuleWriteEeprom(
+    uint8_t address,
+    uint8_t *pBuf,
+    unsigned int bufLen,
+    unsigned int eepromAddress) {
+
+    TBusTelegram    txBusMsg;
+    unsigned int    numWritten = 0;
+    int             len;
+
+    txBusMsg.type = eBusDevReqEepromWriteBlock;
+    txBusMsg.senderAddr = MY_ADDR;
+    txBusMsg.msg.devBus.receiverAddr = address;
+
+    while (numWritten < bufLen) {
+        len = (int)min(bufLen - numWritten, BUS_EEPROM_BLOCK_SIZE);
+        txBusMsg.msg.devBus.x.devReq.writeEepromBlock.addr = (uint16_t)(eepromAddress + numWritten);
+        txBusMsg.msg.devBus.x.devReq.writeEepromBlock.length = (uint8_t)len;
+        memcpy(txBusMsg.msg.devBus.x.devReq.writeEepromBlock.data, pBuf + numWritten, len);
+        len = ModuleEepromBlock(address, &txBusMsg, eBusDevRespEepromWriteBlock, 0);
+        if (len < 0) {
+            if (numWritten == 0) {
+                return ModuleWriteEepromByte(address, pBuf, bufLen, eepromAddress);
+            }
+            break;
+        } else if (len == 0) {
+            /* end of eeprom */
+            break;
+        }
+        numWritten += len;
+    }
+
+    if (numWritten == bufLen) {
+        return true;
+    } else {
+        return false;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  send block eeprom request and wait for the response
+*  read data is copied to pData
+*  returns the number of bytes read/written, -1 on timeout
+*/
+static int ModuleEepromBlock(
+    uint8_t address,
+    TBusTelegram *pTxMsg,
+    TBusMsgType respType,
+    uint8_t *pData) {
+
+    uint8_t         ret;
+    unsigned long   startTimeMs;
+    unsigned long   actualTimeMs;
+    TBusTelegram    *pBusMsg;
+    uint16_t        addr = pTxMsg->msg.devBus.x.devReq.readEepromBlock.addr;
+    uint8_t         len = pTxMsg->msg.devBus.x.devReq.readEepromBlock.length;
+
+    BusSend(pTxMsg);
+    startTimeMs = GetTickCount();
+    do {
+        actualTimeMs = GetTickCount();
+        ret = BusCheck();
+        if (ret == BUS_MSG_OK) {
+            pBusMsg = BusMsgBufGet();
+            if ((pBusMsg->type == respType) &&
+                (pBusMsg->msg.devBus.receiverAddr == MY_ADDR) &&
+                (pBusMsg->senderAddr == address)) {
+                if (respType == eBusDevRespEepromReadBlock) {
+                    TBusDevRespEepromReadBlock *pResp = &pBusMsg->msg.devBus.x.devResp.readEepromBlock;
+                    if ((pResp->addr == addr) && (pResp->length <= len)) {
+                        memcpy(pData, pResp->data, pResp->length);
+                        return pResp->length;
+                    }
+                } else {
+                    TBusDevRespEepromWriteBlock *pResp = &pBusMsg->msg.devBus.x.devResp.writeEepromBlock;
+                    if ((pResp->addr == addr) && (pResp->length <= len)) {
+                        return pResp->length;
+                    }
+                }
+            }
+        }
+    } while ((actualTimeMs - startTimeMs) <= RESPONSE_TIMEOUT);
+
+    return -1;
+}
+
+/*-----------------------------------------------------------------------------
+*  read eeprom data from bus module byte by byte
+*/
+static bool ModuleReadEepromByte(
+    uint8_t address,
+    uint8_t *pBuf,
+    unsigned int bufLen,
+    unsigned int eepromAddress) {
+
     TBusTelegram    txBusMsg;
     uint8_t         ret;
     unsigned long   startTimeMs;
@@ -1276,9 +1825,9 @@ static bool ModuleReadEeprom(
 }
 
 /*-----------------------------------------------------------------------------
-*  write eeprom data from bus module
+*  write eeprom data to bus module byte by byte
 */
-static bool ModuleWriteEeprom(
+static bool ModuleWriteEepromByte(
     uint8_t address,
     uint8_t *pBuf,
     unsigned int bufLen,
@@ -1684,6 +2233,13 @@ static int GetOperation(int argc, char *argv[], int *pArgi) {
             } else {
                 break;
             }
+        } else if (strcmp(argv[i], "-setvalmulti") == 0) {
+            if (argc > i) {
+                *pArgi = i + 1;
+                operation = OP_SET_VALUE_MULTI;
+            } else {
+                break;
+            }
         } else if (strcmp(argv[i], "-info") == 0) {
             operation = OP_INFO;
         } else if (strcmp(argv[i], "-clockcalib") == 0) {
@@ -1707,6 +2263,13 @@ static int GetOperation(int argc, char *argv[], int *pArgi) {
             } else {
                 break;
             }
+        } else if (strcmp(argv[i], "-scan") == 0) {
+            if (argc > i) {
+                *pArgi = i + 1;
+                operation = OP_SCAN;
+            } else {
+                break;
+            }
         } else if (strcmp(argv[i], "-diag") == 0) {
             operation = OP_DIAG;
         } else if (strcmp(argv[i], "-setvar") == 0) {
@@ -1739,7 +2302,7 @@ static int GetOperation(int argc, char *argv[], int *pArgi) {
 static void PrintUsage(void) {
 
     printf("\nUsage:\n");
-    printf("modulservice -c port -a addr [-o ownaddr] [-s]                \n");  
+    printf("modulservice -c port -a addr [-o ownaddr] [-b baud] [-s]      \n");  
     printf("                             (-na addr                           |\n");
     printf("                              -setcl addr1 .. addr16             |\n");
     printf("                              -getcl                             |\n");
@@ -1754,8 +2317,10 @@ static void PrintUsage(void) {
     printf("                              -setvalrs485if data0 .. data31     |\n");
     printf("                              -setvalpwm4 set0 pwm0 .. set3 pwm3 |\n");
     printf("                              -setvalkeyrc command               |\n");
+    printf("                              -setvalmulti addr=data ..          |\n");
     printf("                              -info                              |\n");
     printf("                              -inforange start stopp             |\n");
+    printf("                              -scan start stopp [depth]          |\n");
     printf("                              -clockcalib addr                   |\n");
     printf("                              -switchstate data                  |\n");
     printf("                              -setvar index data1 .. dataN       |\n");
@@ -1765,6 +2330,7 @@ static void PrintUsage(void) {
     printf("-c port: com1 com2 ..\n");
     printf("-a addr: addr = address of module\n");
     printf("-o addr: addr = our address, default:0\n");
+    printf("-b baud: 9600 (default), 19200, 38400, 57600, 115200\n");
     printf("-s server mode, accept command from stdin\n");
     printf("-na addr: set new address, addr = new address\n");
     printf("-setcl addr1 .. addr16 : set client address list, addr1 = 1st client's address\n");
@@ -1780,8 +2346,13 @@ static void PrintUsage(void) {
     printf("-setvalrs485if data0 .. data31: set byte value for rs485if\n");
     printf("-setvalpwm4 set0 pwm0 .. set3 pwm3: setX = command, pwmX = 16 bit value\n");
     printf("-setvalkeyrc command: 0 = no action, 1 = lock, 2 = unlock, 3 = eto\n");
+    printf("-setvalmulti addr=data ..: set value of several modules with one telegram,\n");
+    printf("    data = set value bytes in hex (addr=aaaa..) or one byte for all outputs (addr=*aa),\n");
+    printf("    the confirmations are collected and the telegram is repeated for the missing ones\n");
     printf("-info: read type and version string from modul\n");
     printf("-inforange start stopp: read type and version string from modul start to stopp address\n");	
+    printf("-scan start stopp [depth]: fast -inforange with depth (default %d) requests in parallel,\n", SCAN_DEPTH_DEFAULT);
+    printf("    output per module: address;type;version\n");
     printf("-clockcalib: clock calibration\n");
     printf("-switchstate: generate a switch pressed or released event (ReqSwitchState, -a addr is the client)\n");
     printf("-setvar: write device variable\n");
@@ -0,0 +1,448 @@
+/*
+ * main.c
+ *
+ * Copyright 2013 Klaus Gusenleitner <klaus.gusenleitner@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ *
+ */
+
+/*
+ * test for modulservice -scan and -setvalmulti
+ * modulservice is started on the slave side of pty A, the simulated modules
+ * use the slave side of pty B. The master sides of both ptys are connected
+ * by a half duplex wire: every chunk is delayed by its transfer time at
+ * 9600 baud and written to both ptys (read back of own characters).
+ * The modules answer eBusDevReqInfo after their latency. One module ignores
+ * the first request (retry), one is slow (adaptive timeout). The inventory
+ * printed by modulservice is compared with the module table.
+ * eBusDevReqSetValueMulti is confirmed in the slot of the entry (entry index
+ * * BUS_SETVALUE_MULTI_SLOT_MS). The module ignoring the first request has to
+ * get the retry, an absent address has to be reported as not confirmed.
+ *
+ * The scan is run with the default depth and with depth 1 (one request at
+ * a time).
+ *
+ * usage: scantest [modulservice binary] [depth]
+ *        default binary: ../../bin/modulservice relative to scantest
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <signal.h>
+#include <libgen.h>
+#include <sys/wait.h>
+
+#include "sio.h"
+#include "bus.h"
+
+/*-----------------------------------------------------------------------------
+*  Macros
+*/
+#define MODULSERVICE     "../../bin/modulservice" /* relative to scantest */
+#define BIT_US_9600      104
+#define MAX_PENDING      16
+#define TEST_TIMEOUT_MS  60000
+#define SIZE_OUTPUT      4096
+#define SIZE_PATH        1024
+
+/*-----------------------------------------------------------------------------
+*  typedefs
+*/
+typedef struct {
+    uint8_t     addr;
+    TBusDevType devType;
+    const char  *pVersion;
+    int         latencyMs;
+    bool        ignoreFirst;
+    int         numReq;
+    int         numSetValueMulti;
+} TModule;
+
+typedef struct {
+    TBusTelegram  msg;
+    unsigned long dueMs;
+} TPending;
+
+/*-----------------------------------------------------------------------------
+*  Variables
+*/
+static TModule sModule[] = {
+    {   1, eBusDevTypeDo31,    "DO31 1.05",  5, false, 0, 0 },
+    {   2, eBusDevTypeSw8,     "SW8 2.01",   5, false, 0, 0 },
+    {  17, eBusDevTypePwm4,    "PWM4 1.00",  5, true,  0, 0 },
+    {  40, eBusDevTypeSg,      "SG 1.02",   40, false, 0, 0 },
+    {  41, eBusDevTypeSmIf,    "SMIF 0.90",  5, false, 0, 0 },
+    { 100, eBusDevTypeKeyRc,   "KEYRC 1.10", 5, false, 0, 0 },
+    { 200, eBusDevTypeRs485If, "RS485 3.00", 5, false, 0, 0 },
+    { 254, eBusDevTypeLed,     "LED 1.01",   5, false, 0, 0 }
+};
+
+static const char *sTypeName[] = {
+    [eBusDevTypeDo31]    = "DO31",
+    [eBusDevTypeSw8]     = "SW8",
+    [eBusDevTypePwm4]    = "PWM4",
+    [eBusDevTypeSg]      = "SG",
+    [eBusDevTypeSmIf]    = "SMIF",
+    [eBusDevTypeKeyRc]   = "KEYRC",
+    [eBusDevTypeRs485If] = "RS485IF",
+    [eBusDevTypeLed]     = "LED"
+};
+
+static TPending sPending[MAX_PENDING];
+static int      sNumPending;
+
+/*-----------------------------------------------------------------------------
+*  time in ms
+*/
+static unsigned long TimeMs(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+}
+
+/*-----------------------------------------------------------------------------
+*  open pty, returns master fd
+*/
+static int PtyOpen(const char **ppSlaveName) {
+
+    int fd;
+
+    fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((fd < 0) ||
+        (grantpt(fd) != 0) ||
+        (unlockpt(fd) != 0)) {
+        printf("cannot open pty\n");
+        return -1;
+    }
+    *ppSlaveName = ptsname(fd);
+    return fd;
+}
+
+/*-----------------------------------------------------------------------------
+*  transfer chunk from one master side to the wire
+*/
+static void Wire(int fromFd, int *pMasterFd) {
+
+    uint8_t buf[256];
+    int     len;
+
+    len = read(fromFd, buf, sizeof(buf));
+    if (len <= 0) {
+        return;
+    }
+    usleep(len * 10 * BIT_US_9600);
+    if ((write(pMasterFd[0], buf, len) != len) ||
+        (write(pMasterFd[1], buf, len) != len)) {
+        printf("wire write error\n");
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  simulated modules: queue info response
+*/
+static void ModuleRx(TBusTelegram *pMsg) {
+
+    unsigned int i;
+    TModule      *pModule;
+    TPending     *pPending;
+    uint8_t      setValue[BUS_SETVALUE_MULTI_SIZE];
+    uint8_t      idx;
+
+    if (pMsg->type == eBusDevReqSetValueMulti) {
+        for (i = 0; (i < ARRAY_CNT(sModule)) && (sNumPending < MAX_PENDING); i++) {
+            pModule = &sModule[i];
+            if (!BusSetValueMultiGet(&pMsg->msg.devBus.x.devReq.setValueMulti, pModule->addr,
+                                     setValue, sizeof(setValue), 1, &idx)) {
+                continue;
+            }
+            pModule->numSetValueMulti++;
+            if (pModule->ignoreFirst && (pModule->numSetValueMulti == 1)) {
+                continue;
+            }
+            pPending = &sPending[sNumPending];
+            memset(&pPending->msg, 0, sizeof(pPending->msg));
+            pPending->msg.type = eBusDevRespSetValueMulti;
+            pPending->msg.senderAddr = pModule->addr;
+            pPending->msg.msg.devBus.receiverAddr = pMsg->senderAddr;
+            pPending->msg.msg.devBus.x.devResp.setValueMulti.seq =
+                pMsg->msg.devBus.x.devReq.setValueMulti.seq;
+            pPending->dueMs = TimeMs() + pModule->latencyMs + idx * BUS_SETVALUE_MULTI_SLOT_MS;
+            sNumPending++;
+        }
+        return;
+    }
+    if (pMsg->type != eBusDevReqInfo) {
+        return;
+    }
+    for (i = 0; i < ARRAY_CNT(sModule); i++) {
+        pModule = &sModule[i];
+        if (pModule->addr == pMsg->msg.devBus.receiverAddr) {
+            break;
+        }
+    }
+    if ((i == ARRAY_CNT(sModule)) || (sNumPending == MAX_PENDING)) {
+        return;
+    }
+    pModule->numReq++;
+    if (pModule->ignoreFirst && (pModule->numReq == 1)) {
+        return;
+    }
+    pPending = &sPending[sNumPending];
+    memset(&pPending->msg, 0, sizeof(pPending->msg));
+    pPending->msg.type = eBusDevRespInfo;
+    pPending->msg.senderAddr = pModule->addr;
+    pPending->msg.msg.devBus.receiverAddr = pMsg->senderAddr;
+    pPending->msg.msg.devBus.x.devResp.info.devType = pModule->devType;
+    strncpy((char *)pPending->msg.msg.devBus.x.devResp.info.version, pModule->pVersion,
+            BUS_DEV_INFO_VERSION_LEN);
+    pPending->dueMs = TimeMs() + pModule->latencyMs;
+    sNumPending++;
+}
+
+/*-----------------------------------------------------------------------------
+*  simulated modules: send due responses
+*/
+static void ModuleTx(TBusCtx *pCtx) {
+
+    int           i;
+    unsigned long now = TimeMs();
+
+    for (i = 0; i < sNumPending; ) {
+        if ((long)(now - sPending[i].dueMs) >= 0) {
+            BusCtxSend(pCtx, &sPending[i].msg);
+            sNumPending--;
+            sPending[i] = sPending[sNumPending];
+        } else {
+            i++;
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------------
+*  start modulservice on pSlaveName with the operation ppArg, returns fd of
+*  its stdout
+*/
+static int Start(const char *pBin, const char *pSlaveName, const char **ppArg, pid_t *pPid) {
+
+    int        pipeFd[2];
+    const char *argv[16];
+    int        argc = 0;
+
+    if (pipe(pipeFd) != 0) {
+        return -1;
+    }
+    argv[argc++] = pBin;
+    argv[argc++] = "-c";
+    argv[argc++] = pSlaveName;
+    while ((*ppArg != 0) && (argc < ((int)ARRAY_CNT(argv) - 1))) {
+        argv[argc++] = *ppArg++;
+    }
+    argv[argc] = 0;
+    *pPid = fork();
+    if (*pPid == 0) {
+        dup2(pipeFd[1], STDOUT_FILENO);
+        close(pipeFd[0]);
+        close(pipeFd[1]);
+        execv(pBin, (char * const *)argv);
+        _exit(127);
+    }
+    close(pipeFd[1]);
+    return pipeFd[0];
+}
+
+/*-----------------------------------------------------------------------------
+*  run modulservice with the simulated modules until it exits
+*  pOutput: its stdout, returns the duration in ms
+*/
+static unsigned long Run(const char *pBin, const char **ppArg, char *pOutput, int outputSize) {
+
+    const char    *pSlaveName;
+    int           masterFd[2];
+    int           sioHandle;
+    int           outFd;
+    TBusCtx       *pCtx;
+    TBusTelegram  *pRxMsg;
+    struct pollfd pfd[4];
+    pid_t         pid;
+    int           outLen = 0;
+    int           len;
+    unsigned int  i;
+    unsigned long start;
+    bool          done = false;
+
+    pOutput[0] = '\0';
+    masterFd[1] = PtyOpen(&pSlaveName);
+    if (masterFd[1] < 0) {
+        return 0;
+    }
+    sioHandle = SioOpen(pSlaveName, eSioBaud9600, eSioDataBits8, eSioParityNo,
+                        eSioStopBits1, eSioModeHalfDuplex);
+    if (sioHandle == -1) {
+        printf("cannot open %s\n", pSlaveName);
+        return 0;
+    }
+    pCtx = BusCtxOpen(sioHandle);
+    pRxMsg = BusCtxMsgBufGet(pCtx);
+
+    masterFd[0] = PtyOpen(&pSlaveName);
+    if (masterFd[0] < 0) {
+        return 0;
+    }
+    sNumPending = 0;
+    start = TimeMs();
+    outFd = Start(pBin, pSlaveName, ppArg, &pid);
+    if (outFd < 0) {
+        return 0;
+    }
+
+    pfd[0].fd = masterFd[0];
+    pfd[1].fd = masterFd[1];
+    pfd[2].fd = SioGetFd(sioHandle);
+    pfd[3].fd = outFd;
+    for (i = 0; i < ARRAY_CNT(pfd); i++) {
+        pfd[i].events = POLLIN;
+    }
+    while (!done && ((TimeMs() - start) < TEST_TIMEOUT_MS)) {
+        poll(pfd, ARRAY_CNT(pfd), 1);
+        if (pfd[0].revents & POLLIN) {
+            Wire(masterFd[0], masterFd);
+        }
+        if (pfd[1].revents & POLLIN) {
+            Wire(masterFd[1], masterFd);
+        }
+        while (BusCtxCheck(pCtx) == BUS_MSG_OK) {
+            ModuleRx(pRxMsg);
+        }
+        ModuleTx(pCtx);
+        if (pfd[3].revents & (POLLIN | POLLHUP)) {
+            len = read(outFd, pOutput + outLen, outputSize - outLen - 1);
+            if (len > 0) {
+                outLen += len;
+            } else {
+                done = true;
+            }
+        }
+    }
+    pOutput[outLen] = '\0';
+    kill(pid, SIGTERM);
+    waitpid(pid, 0, 0);
+    close(outFd);
+    BusCtxClose(pCtx);
+    SioClose(sioHandle);
+    close(masterFd[0]);
+    close(masterFd[1]);
+
+    return TimeMs() - start;
+}
+
+/*-----------------------------------------------------------------------------
+*  scan of all addresses, the inventory has to match the module table
+*/
+static int TestScan(const char *pBin, const char *pDepth) {
+
+    const char    *scanArg[] = { "-scan", "1", "254", pDepth, 0 };
+    char          output[SIZE_OUTPUT];
+    char          expected[SIZE_OUTPUT];
+    int           len;
+    unsigned int  i;
+    unsigned long durationMs;
+
+    for (i = 0; i < ARRAY_CNT(sModule); i++) {
+        sModule[i].numReq = 0;
+    }
+    durationMs = Run(pBin, scanArg, output, sizeof(output));
+    expected[0] = '\0';
+    for (i = 0; i < ARRAY_CNT(sModule); i++) {
+        len = strlen(expected);
+        snprintf(expected + len, sizeof(expected) - len, "%d;%s;%s\n",
+                 sModule[i].addr, sTypeName[sModule[i].devType], sModule[i].pVersion);
+    }
+    strncat(expected, "OK\n", sizeof(expected) - strlen(expected) - 1);
+    printf("%s", output);
+    printf("scan 1..254 depth %s: %lu ms\n", pDepth ? pDepth : "default", durationMs);
+    return (strcmp(output, expected) == 0) ? 0 : -1;
+}
+
+/*-----------------------------------------------------------------------------
+*  main
+*/
+int main(int argc, char *argv[]) {
+
+    char          dir[SIZE_PATH];
+    char          path[SIZE_PATH + sizeof(MODULSERVICE) + 1];
+    const char    *pBin;
+    const char    *pDepth = (argc > 2) ? argv[2] : 0;
+    /* 17 ignores the first telegram (retry), 99 is absent */
+    const char    *multiArg[] = { "-setvalmulti", "1=*aa", "2=0400", "17=020012", 0 };
+    const char    *multiAbsentArg[] = { "-setvalmulti", "2=0400", "99=*aa", 0 };
+    char          output[SIZE_OUTPUT];
+    unsigned long durationMs;
+    int           rc = 0;
+
+    if (argc > 1) {
+        pBin = argv[1];
+    } else {
+        strncpy(dir, argv[0], sizeof(dir) - 1);
+        dir[sizeof(dir) - 1] = '\0';
+        snprintf(path, sizeof(path), "%s/%s", dirname(dir), MODULSERVICE);
+        pBin = path;
+    }
+
+    SioInit();
+
+    if ((TestScan(pBin, pDepth) != 0) ||
+        ((pDepth == 0) && (TestScan(pBin, "1") != 0))) {
+        rc = 1;
+    }
+
+    /* confirmed entries are not repeated */
+    durationMs = Run(pBin, multiArg, output, sizeof(output));
+    printf("%s", output);
+    printf("setvalmulti: %lu ms\n", durationMs);
+    if ((strcmp(output, "OK\n") != 0) ||
+        (sModule[0].numSetValueMulti != 1) ||
+        (sModule[1].numSetValueMulti != 1) ||
+        (sModule[2].numSetValueMulti != 2)) {
+        rc = 1;
+    }
+    durationMs = Run(pBin, multiAbsentArg, output, sizeof(output));
+    printf("%s", output);
+    printf("setvalmulti absent: %lu ms\n", durationMs);
+    if ((strcmp(output, "no confirmation from: 99\nERROR\n") != 0) ||
+        (sModule[1].numSetValueMulti != 2)) {
+        rc = 1;
+    }
+
+    if (rc != 0) {
+        printf("ERROR\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -55,6 +55,7 @@
 *  Variables
 */
 static FILE  *spOutput;
+static bool  sLatency = false;
 
 /*-----------------------------------------------------------------------------
 *  Functions
@@ -73,7 +74,10 @@ int main(int argc, char *argv[]) {
     FILE *pLogFile = 0;
     char comPort[SIZE_COMPORT] = "";
     char logFile[MAX_NAME_LEN] = "";
+    char capFile[MAX_NAME_LEN] = "";
     bool raw = false;
+    bool replay;
+    TSioBaud baud = eSioBaud9600;
     uint8_t len;
     uint8_t val8;
 
@@ -103,6 +107,29 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* record capture for replay:// */
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-cap") == 0) {
+            if (argc > i) {
+                strncpy(capFile, argv[i + 1], sizeof(capFile) - 1);
+                capFile[sizeof(capFile) - 1] = 0;
+            }
+            break;
+        }
+    }
+
+    /* baud rate */
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-b") == 0) {
+            if (((i + 1) >= argc) ||
+                !SioBaudFromRate(strtoul(argv[i + 1], 0, 0), &baud)) {
+                PrintUsage();
+                return 0;
+            }
+            break;
+        }
+    }
+
     /* raw-Modus? */
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-raw") == 0) {
@@ -111,6 +138,14 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* time since previous telegram */
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-lat") == 0) {
+            sLatency = true;
+            break;
+        }
+    }
+
     if (strlen(logFile) != 0) {
         pLogFile = fopen(logFile, "wb");
         if (pLogFile == 0) {
@@ -126,7 +161,7 @@ int main(int argc, char *argv[]) {
     }
 
     SioInit();
-    handle = SioOpen(comPort, eSioBaud9600, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+    handle = SioOpen(comPort, baud, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
 
     if (handle == -1) {
         printf("cannot open %s\r\n", comPort);
@@ -135,11 +170,21 @@ int main(int argc, char *argv[]) {
         }
         return 0;
     }
+    replay = SioIsReplay(handle);
+    if (sLatency && !replay && !SioSetLowLatency(handle, true)) {
+        printf("no low latency mode for %s\r\n", comPort);
+    }
 
-    // wait for sio input to settle and the flush
-    usleep(100000);
-    while ((len = SioGetNumRxChar(handle)) != 0) {
-        SioRead(handle, &val8, sizeof(val8));
+    // wait for sio input to settle and the flush (not for replay, the
+    // capture starts immediately)
+    if (!replay) {
+        usleep(100000);
+        while ((len = SioGetNumRxChar(handle)) != 0) {
+            SioRead(handle, &val8, sizeof(val8));
+        }
+    }
+    if ((strlen(capFile) != 0) && !SioCaptureOpen(handle, capFile)) {
+        printf("cannot open %s\r\n", capFile);
     }
 
     if (raw) {
@@ -164,10 +209,13 @@ int main(int argc, char *argv[]) {
 static void PrintUsage(void) {
 
     printf("\r\nUsage:");
-    printf("monitor -c port [-f file] [-raw]\r\n");
-    printf("port: com1 com2 ..\r\n");
+    printf("monitor -c port [-b baud] [-f file] [-cap file] [-raw] [-lat]\r\n");
+    printf("port: com1 com2 .., replay://file[@speed] to replay a capture\r\n");
+    printf("-b: baud rate 9600 (default), 19200, 38400, 57600, 115200\r\n");
     printf("file, if no logfile: log to console\r\n");
+    printf("-cap: record capture of received data for replay\r\n");
     printf("-raw: log hex data\r\n");
+    printf("-lat: low latency receive, print time since previous telegram\r\n");
 }
 
 /*-----------------------------------------------------------------------------
@@ -194,6 +242,10 @@ static void BusMonRaw(int sioHandle) {
         FD_SET(sioFd, &fds);
         result = select(maxFd + 1, &fds, 0, 0, 0);
 
+        if ((result > 0) && !SioHandleValid(sioHandle)) {
+            /* end of replay */
+            break;
+        }
         if ((result > 0) && SioRead(sioHandle, &ch, 1) == 1) {
             /* received char */
             if (ch == STX) {
@@ -250,6 +302,8 @@ static void BusMonDecoded(int sioHandle) {
     struct timespec ts;
     struct tm       *ptm;
     bool            skipError;
+    uint64_t        msgTimeUs;
+    uint64_t        lastMsgTimeUs = 0;
 
     BusInit(sioHandle);
     pBusMsg = BusMsgBufGet();
@@ -265,14 +319,29 @@ static void BusMonDecoded(int sioHandle) {
             continue;
         }
         ret = BusCheck();
-        if (ret == BUS_MSG_OK) {
+        if (ret == BUS_IF_ERROR) {
+            /* end of replay */
+            break;
+        } else if (ret == BUS_MSG_OK) {
             skipError = false;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ptm = localtime(&ts.tv_sec);
-            fprintf(spOutput, "%d-%02d-%02d %2d:%02d:%02d.%03d  ",
-                    ptm->tm_year + 1900, ptm->tm_mon + 1, ptm->tm_mday,
-                    ptm->tm_hour, ptm->tm_min, ptm->tm_sec,
-                    (int)ts.tv_nsec / 1000000);
+            if (sLatency) {
+                /* same width as date and time */
+                msgTimeUs = BusMsgTimeGet();
+                if (lastMsgTimeUs == 0) {
+                    lastMsgTimeUs = msgTimeUs;
+                }
+                fprintf(spOutput, "+%15lu.%03lu ms  ",
+                        (unsigned long)((msgTimeUs - lastMsgTimeUs) / 1000),
+                        (unsigned long)((msgTimeUs - lastMsgTimeUs) % 1000));
+                lastMsgTimeUs = msgTimeUs;
+            } else {
+                clock_gettime(CLOCK_REALTIME, &ts);
+                ptm = localtime(&ts.tv_sec);
+                fprintf(spOutput, "%d-%02d-%02d %2d:%02d:%02d.%03d  ",
+                        ptm->tm_year + 1900, ptm->tm_mon + 1, ptm->tm_mday,
+                        ptm->tm_hour, ptm->tm_min, ptm->tm_sec,
+                        (int)ts.tv_nsec / 1000000);
+            }
 
             fprintf(spOutput, "%4d ", pBusMsg->senderAddr);
 
@@ -1125,6 +1194,209 @@ static void BusMonDecoded(int sioHandle) {
                     fprintf(spOutput, " %02x", pBusMsg->msg.devBus.x.devResp.getFlashData.data[i]);
                 }
                 break;
+            case eBusDevReqSetValueMulti:
+                fprintf(spOutput, "request set value multicast\r\n");
+                fprintf(spOutput, SPACE "seq: %d", pBusMsg->msg.devBus.x.devReq.setValueMulti.seq);
+                {
+                    TBusDevReqSetValueMulti *pReq = &pBusMsg->msg.devBus.x.devReq.setValueMulti;
+                    uint8_t                 len;
+
+                    for (i = 0; (i + BUS_SETVALUE_MULTI_HDR_SIZE) <= min(pReq->length, sizeof(pReq->entry)); ) {
+                        len = pReq->entry[i + 1] & BUS_SETVALUE_MULTI_LEN_MASK;
+                        fprintf(spOutput, "\r\n" SPACE "addr %d%s:", pReq->entry[i],
+                                (pReq->entry[i + 1] & BUS_SETVALUE_MULTI_FILL) != 0 ? " (fill)" : "");
+                        i += BUS_SETVALUE_MULTI_HDR_SIZE;
+                        for (; (len > 0) && (i < sizeof(pReq->entry)); len--, i++) {
+                            fprintf(spOutput, " %02x", pReq->entry[i]);
+                        }
+                    }
+                }
+                break;
+            case eBusDevRespSetValueMulti:
+                fprintf(spOutput, "response set value multicast ");
+                fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, SPACE "seq: %d", pBusMsg->msg.devBus.x.devResp.setValueMulti.seq);
+                break;
+            case eBusDevReqGetVarBulk:
+                fprintf(spOutput, "request get var bulk ");
+                fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, SPACE "index:");
+                for (i = 0; i < min(pBusMsg->msg.devBus.x.devReq.getVarBulk.length, BUS_VAR_BULK_SIZE); i++) {
+                    fprintf(spOutput, " %d", pBusMsg->msg.devBus.x.devReq.getVarBulk.entry[i]);
+                }
+                break;
+            case eBusDevRespGetVarBulk:
+            case eBusDevReqSetVarBulk:
+            case eBusDevRespSetVarBulk:
+                {
+                    TBusDevRespGetVarBulk *pBulk = &pBusMsg->msg.devBus.x.devResp.getVarBulk;
+                    uint8_t               len = 0;
+                    uint8_t               hdrLen;
+
+                    /* all bulk telegrams: length, entry[] */
+                    if (pBusMsg->type == eBusDevRespGetVarBulk) {
+                        fprintf(spOutput, "response get var bulk ");
+                    } else if (pBusMsg->type == eBusDevReqSetVarBulk) {
+                        fprintf(spOutput, "request set var bulk ");
+                    } else {
+                        fprintf(spOutput, "response set var bulk ");
+                    }
+                    fprintf(spOutput, "receiver %d", pBusMsg->msg.devBus.receiverAddr);
+                    for (i = 0; i < min(pBulk->length, BUS_VAR_BULK_SIZE); ) {
+                        fprintf(spOutput, "\r\n" SPACE "index: %d", pBulk->entry[i]);
+                        if (pBusMsg->type == eBusDevReqSetVarBulk) {
+                            len = pBulk->entry[i + 1];
+                            hdrLen = 2;
+                        } else if (pBusMsg->type == eBusDevRespGetVarBulk) {
+                            fprintf(spOutput, " result: %d", pBulk->entry[i + 1]);
+                            len = pBulk->entry[i + 2];
+                            hdrLen = 3;
+                        } else {
+                            fprintf(spOutput, " result: %d", pBulk->entry[i + 1]);
+                            len = 0;
+                            hdrLen = 2;
+                        }
+                        i += hdrLen;
+                        if (len > 0) {
+                            fprintf(spOutput, " data:");
+                        }
+                        for (; (len > 0) && (i < BUS_VAR_BULK_SIZE); len--, i++) {
+                            fprintf(spOutput, " %02x", pBulk->entry[i]);
+                        }
+                    }
+                }
+                break;
+            case eBusDevReqActualValueEventDelta:
+                {
+                    TBusDevReqActualValueEventDelta *pDelta = &pBusMsg->msg.devBus.x.devReq.actualValueEventDelta;
+                    uint8_t                         len = min(pDelta->length, BUS_ACTVAL_DELTA_SIZE);
+
+                    fprintf(spOutput, "request actual value event delta ");
+                    fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                    fprintf(spOutput, SPACE "device type: %d seq: %d\r\n", pDelta->devType, pDelta->seq);
+                    if ((pDelta->flags & BUS_ACTVAL_DELTA_FULL) != 0) {
+                        fprintf(spOutput, SPACE "full:");
+                        for (i = 0; i < len; i++) {
+                            fprintf(spOutput, " %02x", pDelta->entry[i]);
+                        }
+                    } else {
+                        fprintf(spOutput, SPACE "delta (offset:value):");
+                        for (i = 0; (i + 1) < len; i += 2) {
+                            fprintf(spOutput, " %d:%02x", pDelta->entry[i], pDelta->entry[i + 1]);
+                        }
+                    }
+                }
+                break;
+            case eBusDevReqActualValueEventFanout:
+                {
+                    TBusDevReqActualValueEventFanout *pFanout = &pBusMsg->msg.devBus.x.devReq.actualValueEventFanout;
+                    uint8_t                          len = min(pFanout->length, BUS_ACTVAL_FANOUT_SIZE);
+
+                    fprintf(spOutput, "request actual value event fanout\r\n");
+                    fprintf(spOutput, SPACE "clients:");
+                    for (i = 1; (len > 0) && (i <= pFanout->data[0]) && (i < len); i++) {
+                        fprintf(spOutput, " %d", pFanout->data[i]);
+                    }
+                    fprintf(spOutput, "\r\n" SPACE "event:");
+                    for (; i < len; i++) {
+                        fprintf(spOutput, " %02x", pFanout->data[i]);
+                    }
+                }
+                break;
+            case eBusDevRespActualValueEventDelta:
+                fprintf(spOutput, "response actual value event delta ");
+                fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, SPACE "device type: %d seq: %d state: %s",
+                        pBusMsg->msg.devBus.x.devResp.actualValueEventDelta.devType,
+                        pBusMsg->msg.devBus.x.devResp.actualValueEventDelta.seq,
+                        pBusMsg->msg.devBus.x.devResp.actualValueEventDelta.state == BUS_ACTVAL_DELTA_OK ?
+                        "OK" : "RESYNC");
+                break;
+            case eBusDevReqUpdDataWin:
+                fprintf(spOutput, "request update data window ");
+                if (pBusMsg->msg.devBus.receiverAddr == BUS_BROADCAST_ADDR) {
+                    fprintf(spOutput, "receiver all\r\n");
+                } else {
+                    fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                }
+                fprintf(spOutput, SPACE "wordaddr: %04x ackreq: %d start: %d\r\n",
+                        pBusMsg->msg.devBus.x.devReq.updDataWin.wordAddr,
+                        (pBusMsg->msg.devBus.x.devReq.updDataWin.flags & BUS_FWU_WIN_ACK_REQ) != 0,
+                        (pBusMsg->msg.devBus.x.devReq.updDataWin.flags & BUS_FWU_WIN_START) != 0);
+                fprintf(spOutput, SPACE "data: ");
+                for (i = 0; i < BUS_FWU_PACKET_SIZE / 2; i++) {
+                    fprintf(spOutput, "%04x ", pBusMsg->msg.devBus.x.devReq.updDataWin.data[i]);
+                }
+                break;
+            case eBusDevRespUpdDataWin:
+                fprintf(spOutput, "response update data window ");
+                fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, SPACE "wordaddr: %04x rxmask: %04x window: %d",
+                        pBusMsg->msg.devBus.x.devResp.updDataWin.wordAddr,
+                        pBusMsg->msg.devBus.x.devResp.updDataWin.rxMask,
+                        pBusMsg->msg.devBus.x.devResp.updDataWin.window);
+                break;
+            case eBusDevReqUpdDataWinState:
+                fprintf(spOutput, "request update data window state ");
+                fprintf(spOutput, "receiver %d", pBusMsg->msg.devBus.receiverAddr);
+                break;
+            case eBusDevReqUpdEnterDiff:
+                fprintf(spOutput, "request update enter differential ");
+                fprintf(spOutput, "receiver %d", pBusMsg->msg.devBus.receiverAddr);
+                break;
+            case eBusDevReqUpdPageSum:
+                fprintf(spOutput, "request update page checksum ");
+                fprintf(spOutput, "receiver %d ", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, "page: %d", pBusMsg->msg.devBus.x.devReq.updPageSum.page);
+                break;
+            case eBusDevRespUpdPageSum:
+                fprintf(spOutput, "response update page checksum ");
+                fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, SPACE "page: %d page size: %d words pages: %d\r\n",
+                        pBusMsg->msg.devBus.x.devResp.updPageSum.page,
+                        pBusMsg->msg.devBus.x.devResp.updPageSum.pageWordSize,
+                        pBusMsg->msg.devBus.x.devResp.updPageSum.numPages);
+                fprintf(spOutput, SPACE "crc: ");
+                for (i = 0; (i < pBusMsg->msg.devBus.x.devResp.updPageSum.num) && (i < BUS_FWU_PAGESUM_NUM); i++) {
+                    fprintf(spOutput, "%04x ", pBusMsg->msg.devBus.x.devResp.updPageSum.crc[i]);
+                }
+                break;
+            case eBusDevReqEepromReadBlock:
+                fprintf(spOutput, "request read eeprom block ");
+                fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, SPACE "address: %04x length: %d",
+                        pBusMsg->msg.devBus.x.devReq.readEepromBlock.addr,
+                        pBusMsg->msg.devBus.x.devReq.readEepromBlock.length);
+                break;
+            case eBusDevRespEepromReadBlock:
+                fprintf(spOutput, "response read eeprom block ");
+                fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, SPACE "address: %04x length: %d\r\n",
+                        pBusMsg->msg.devBus.x.devResp.readEepromBlock.addr,
+                        pBusMsg->msg.devBus.x.devResp.readEepromBlock.length);
+                fprintf(spOutput, SPACE "data:");
+                for (i = 0; (i < pBusMsg->msg.devBus.x.devResp.readEepromBlock.length) && (i < BUS_EEPROM_BLOCK_SIZE); i++) {
+                    fprintf(spOutput, " %02x", pBusMsg->msg.devBus.x.devResp.readEepromBlock.data[i]);
+                }
+                break;
+            case eBusDevReqEepromWriteBlock:
+                fprintf(spOutput, "request write eeprom block ");
+                fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, SPACE "address: %04x length: %d\r\n",
+                        pBusMsg->msg.devBus.x.devReq.writeEepromBlock.addr,
+                        pBusMsg->msg.devBus.x.devReq.writeEepromBlock.length);
+                fprintf(spOutput, SPACE "data:");
+                for (i = 0; (i < pBusMsg->msg.devBus.x.devReq.writeEepromBlock.length) && (i < BUS_EEPROM_BLOCK_SIZE); i++) {
+                    fprintf(spOutput, " %02x", pBusMsg->msg.devBus.x.devReq.writeEepromBlock.data[i]);
+                }
+                break;
+            case eBusDevRespEepromWriteBlock:
+                fprintf(spOutput, "response write eeprom block ");
+                fprintf(spOutput, "receiver %d\r\n", pBusMsg->msg.devBus.receiverAddr);
+                fprintf(spOutput, SPACE "address: %04x length: %d",
+                        pBusMsg->msg.devBus.x.devResp.writeEepromBlock.addr,
+                        pBusMsg->msg.devBus.x.devResp.writeEepromBlock.length);
+                break;
             case eBusDevStartup:
                 fprintf(spOutput, "device startup");
                 break;
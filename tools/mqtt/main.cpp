@@ -202,17 +202,18 @@ static void set_alarm(int fd, unsigned long ms) {
 /*-----------------------------------------------------------------------------
 *  sio open and bus init
 */
-static int InitBus(const char *comPort) {
+static int InitBus(const char *comPort, TSioBaud baud) {
 
     uint8_t ch;
     int     handle;
 
     SioInit();
-    handle = SioOpen(comPort, eSioBaud9600, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+    handle = SioOpen(comPort, baud, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
     if (handle == -1) {
         return -1;
     }
-    while (SioGetNumRxChar(handle) > 0) {
+    /* flush, a replay capture starts immediately */
+    while (!SioIsReplay(handle) && (SioGetNumRxChar(handle) > 0)) {
         SioRead(handle, &ch, sizeof(ch));
     }
     BusInit(handle);
@@ -1535,7 +1536,8 @@ printf("publish init state: VAR [idx %d, len %d] at %d\n", index, length, addres
 static void print_usage(void) {
 
     printf("\nUsage:\n");
-    printf("mqtt -c sio-port -a bus-address -f yaml-cfg -e event-listen-bus-address -m mqtt-broker-ip [-p mqtt-port]\n");
+    printf("mqtt -c sio-port -a bus-address -f yaml-cfg -e event-listen-bus-address -m mqtt-broker-ip [-p mqtt-port] [-b baud]\n");
+    printf("baud: 9600 (default), 19200, 38400, 57600, 115200\n");
 }
 
 /*-----------------------------------------------------------------------------
@@ -1556,6 +1558,7 @@ int main(int argc, char *argv[]) {
     int              port = 1883; /* default */
     bool             my_addr_valid = false;
     bool             event_addr_valid = false;
+    TSioBaud         baud = eSioBaud9600;
     struct timeval   tv;
     char             topic[MAX_LEN_TOPIC];
     T_topic_desc     *topic_entry;
@@ -1605,6 +1608,14 @@ int main(int argc, char *argv[]) {
                 port = (int)strtoul(argv[i + 1], 0, 0);
             }
         }
+        /* baud rate */
+        if (strcmp(argv[i], "-b") == 0) {
+            if (((i + 1) >= argc) ||
+                !SioBaudFromRate(strtoul(argv[i + 1], 0, 0), &baud)) {
+                print_usage();
+                return 0;
+            }
+        }
     }
 
     if ((strlen(com_port) == 0)  ||
@@ -1633,7 +1644,7 @@ int main(int argc, char *argv[]) {
     mosquitto_log_callback_set(mosq, my_log_callback);
     mosquitto_message_callback_set(mosq, my_message_callback);
 
-    busHandle = InitBus(com_port);
+    busHandle = InitBus(com_port, baud);
     if (busHandle == -1) {
         syslog(LOG_ERR, "can't open %s", com_port);
         return -1;
@@ -1758,6 +1769,11 @@ int main(int argc, char *argv[]) {
             mosquitto_loop_write(mosq, 1);
         }
         mosquitto_loop_misc(mosq);
+        if (!SioHandleValid(busHandle)) {
+            /* end of replay */
+            syslog(LOG_ERR, "bus interface access error - exiting");
+            break;
+        }
     }
 
     mosquitto_lib_cleanup();
@@ -89,6 +89,7 @@ int main(int argc, char *argv[]) {
    char     *word;
    int      sioHdl;
    FILE     *pCmd;
+   TSioBaud baud = eSioBaud9600;
 
    /* get com interface */
    for (i = 1; i < argc; i++) {
@@ -106,6 +107,18 @@ int main(int argc, char *argv[]) {
      return 0;
    }
 
+   /* baud rate */
+   for (i = 1; i < argc; i++) {
+     if (strcmp(argv[i], "-b") == 0) {
+       if (((i + 1) >= argc) ||
+           !SioBaudFromRate(strtoul(argv[i + 1], 0, 0), &baud)) {
+         PrintUsage();
+         return 0;
+       }
+       break;
+     }
+   }
+
    /* get command file name */
    for (i = 1; i < argc; i++) {
      if (strcmp(argv[i], "-x") == 0) {
@@ -128,7 +141,7 @@ int main(int argc, char *argv[]) {
    }
 
     SioInit();
-    sioHdl = SioOpen(comPort, eSioBaud9600, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+    sioHdl = SioOpen(comPort, baud, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
     if (sioHdl == -1) {
        printf("cannot open %s\r\n", comPort);
        return 0;
@@ -268,8 +281,9 @@ static unsigned long GetTickCount(void) {
 static void PrintUsage(void) {
 
    printf("\nUsage:\n");
-   printf("shuttercontrol -c port -x commandfile\n");
+   printf("shuttercontrol -c port -x commandfile [-b baud]\n");
    printf("-c port: comX /dev/ttyX\n");
+   printf("-b baud: 9600 (default), 19200, 38400, 57600, 115200\n");
    printf("-x command file\n");
 }
 
@@ -92,17 +92,18 @@ static unsigned long get_tick_count(void) {
 /*-----------------------------------------------------------------------------
 *  sio open and bus init
 */
-static int InitBus(const char *comPort) {
+static int InitBus(const char *comPort, TSioBaud baud) {
 
     uint8_t ch;
     int     handle;
 
     SioInit();
-    handle = SioOpen(comPort, eSioBaud9600, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
+    handle = SioOpen(comPort, baud, eSioDataBits8, eSioParityNo, eSioStopBits1, eSioModeHalfDuplex);
     if (handle == -1) {
         return -1;
     }
-    while (SioGetNumRxChar(handle) > 0) {
+    /* flush, a replay capture starts immediately */
+    while (!SioIsReplay(handle) && (SioGetNumRxChar(handle) > 0)) {
         SioRead(handle, &ch, sizeof(ch));
     }
     BusInit(handle);
@@ -261,6 +262,8 @@ static void serve_bus(void) {
     case eBusDevReqSetVar:
     case eBusDevRespGetVar:
     case eBusDevRespSetVar:
+    case eBusDevReqGetVarBulk:
+    case eBusDevReqSetVarBulk:
         if (rx_msg->msg.devBus.receiverAddr == my_addr) {
             msg_for_me = true;
         }
@@ -296,6 +299,22 @@ static void serve_bus(void) {
         tx_msg.msg.devBus.x.devResp.setVar.index = val8;
         tx_retry = BusSend(&tx_msg) != BUS_SEND_OK;
         break;
+    case eBusDevReqGetVarBulk:
+        BusVarGetBulk(&rx_msg->msg.devBus.x.devReq.getVarBulk,
+                      &tx_msg.msg.devBus.x.devResp.getVarBulk);
+        tx_msg.senderAddr = my_addr;
+        tx_msg.type = eBusDevRespGetVarBulk;
+        tx_msg.msg.devBus.receiverAddr = rx_msg->senderAddr;
+        tx_retry = BusSend(&tx_msg) != BUS_SEND_OK;
+        break;
+    case eBusDevReqSetVarBulk:
+        BusVarSetBulk(&rx_msg->msg.devBus.x.devReq.setVarBulk,
+                      &tx_msg.msg.devBus.x.devResp.setVarBulk);
+        tx_msg.senderAddr = my_addr;
+        tx_msg.type = eBusDevRespSetVarBulk;
+        tx_msg.msg.devBus.receiverAddr = rx_msg->senderAddr;
+        tx_retry = BusSend(&tx_msg) != BUS_SEND_OK;
+        break;
     default:
         break;
     }
@@ -307,7 +326,8 @@ static void serve_bus(void) {
 static void print_usage(void) {
 
    printf("\nUsage:\n");
-   printf("varserver -c sio-port -a bus-address -f yaml-cfg\n");
+   printf("varserver -c sio-port -a bus-address -f yaml-cfg [-b baud]\n");
+   printf("baud: 9600 (default), 19200, 38400, 57600, 115200\n");
 }
 
 /*-----------------------------------------------------------------------------
@@ -324,6 +344,7 @@ int main(int argc, char *argv[]) {
     char             com_port[PATH_LEN] = "";
     char             config[PATH_LEN] = "";
     bool             my_addr_valid = false;
+    TSioBaud         baud = eSioBaud9600;
     struct timeval   tv;
 
     for (i = 1; i < argc; i++) {
@@ -355,6 +376,16 @@ int main(int argc, char *argv[]) {
             }
             break;
         }
+        /* baud rate */
+        if (strcmp(argv[i], "-b") == 0) {
+            if (((i + 1) >= argc) ||
+                !SioBaudFromRate(strtoul(argv[i + 1], 0, 0), &baud)) {
+                print_usage();
+                return 0;
+            }
+            i++;
+            continue;
+        }
     }
 
     if ((strlen(com_port) == 0)  ||
@@ -376,7 +407,7 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-    busHandle = InitBus(com_port);
+    busHandle = InitBus(com_port, baud);
     if (busHandle == -1) {
         syslog(LOG_ERR, "can't open %s", com_port);
         return -1;
@@ -395,5 +426,12 @@ int main(int argc, char *argv[]) {
         if ((ret > 0) && FD_ISSET(busFd, &rfds)) {
             serve_bus();
         }
+        if (!SioHandleValid(busHandle)) {
+            /* end of replay */
+            syslog(LOG_ERR, "bus interface access error - exiting");
+            break;
+        }
     }
+    SioClose(busHandle);
+    return 0;
 }